@@ -1,3 +1,4 @@
 %VULKAN_SDK%/Bin/glslangValidator.exe -V -S vert -o Shader_vert.spv Shader.vert
 %VULKAN_SDK%/Bin/glslangValidator.exe -V -S frag -o Shader_frag.spv Shader.frag
+%VULKAN_SDK%/Bin/glslangValidator.exe -V -S comp -o Cull_comp.spv Cull.comp
 pause
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+#include "TypesAndMacros.h"
+
+namespace Hash {
+
+	/**
+	 * Hash a block of memory (64-bit FNV-1a)
+	 * @param[in] pData	Data to hash
+	 * @param[in] size	Size of the data
+	 * @param[in] hash	Hash to continue from
+	 * @return			Hash
+	 */
+	inline u64 Fnv1a(const void* pData, sizeT size, u64 hash = 0xCBF2'9CE4'8422'2325)
+	{
+		const u8* pBytes = (const u8*)pData;
+		for (sizeT i = 0; i < size; ++i)
+		{
+			hash ^= pBytes[i];
+			hash *= 0x0000'0100'0000'01B3;
+		}
+		return hash;
+	}
+
+	/**
+	 * Combine a value into a hash
+	 * @param[in] hash	Hash to continue from
+	 * @param[in] value	Value to hash (hashed by its bytes, so it should not contain padding)
+	 * @return			Hash
+	 */
+	template<typename T>
+	inline u64 Combine(u64 hash, const T& value)
+	{
+		return Fnv1a(&value, sizeof(T), hash);
+	}
+
+}
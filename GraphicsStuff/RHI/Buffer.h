@@ -1,4 +1,5 @@
 #pragma once
+#include <string>
 #include <vector>
 
 #include "RHICommon.h"
@@ -9,6 +10,7 @@ namespace RHI {
 	
 	class Texture;
 	class CommandList;
+	class MemoryHeap;
 
 	class Buffer
 	{
@@ -44,6 +46,18 @@ namespace RHI {
 		 * @return					True if the buffer was created successfully, false otherwise
 		 */
 		virtual b8 CreateIndexBuffer(RHIContext* pContext, u32 indexCount, IndexType indexType, BufferFlags flags) = 0;
+		/**
+		 * Create a buffer placed in a memory heap
+		 * @param[in] pContext		RHI context
+		 * @param[in] type			Buffer type
+		 * @param[in] size			Buffer size
+		 * @param[in] flags			Buffer flags, dynamic and readback buffers can't be placed in a heap
+		 * @param[in] pHeap			Memory heap
+		 * @param[in] heapOffset	Offset in the heap, a multiple of the alignment of the memory requirements
+		 * @param[in] format		Buffer data format (texel buffers only)
+		 * @return					True if the buffer was created successfully, false otherwise
+		 */
+		virtual b8 CreatePlaced(RHIContext* pContext, BufferType type, u64 size, BufferFlags flags, MemoryHeap* pHeap, u64 heapOffset, PixelFormat format = PixelFormat()) = 0;
 
 		/**
 		 * Detroy a buffer
@@ -115,6 +129,11 @@ namespace RHI {
 		* @return Buffer size
 		*/
 		uint64_t GetSize() const { return m_Size; }
+		/**
+		 * Get the buffer flags
+		 * @return Buffer flags
+		 */
+		BufferFlags GetFlags() const { return m_Flags; }
 		/**
 		 * Get the amount of vertices in the buffer
 		 * @return	Amount of vertices in the buffer
@@ -152,6 +171,17 @@ namespace RHI {
 		*/
 		u64 GetMemorySize() const { return m_MemorySize; }
 
+		/**
+		 * Set the debug name, used to identify the buffer in memory statistics
+		 * @param[in] name	Debug name
+		 */
+		void SetDebugName(const std::string& name) { m_DebugName = name; }
+		/**
+		 * Get the debug name
+		 * @return	Debug name, empty if no name was set
+		 */
+		const std::string& GetDebugName() const { return m_DebugName; }
+
 	protected:
 
 		BufferType m_Type;
@@ -159,6 +189,7 @@ namespace RHI {
 		RHIContext* m_pContext;
 		BufferFlags m_Flags;
 		u64 m_MemorySize;				/**< Size of the buffer on the GPU */
+		std::string m_DebugName;		/**< Debug name */
 
 		// Data for vertex and index buffers
 #pragma warning(push)
@@ -0,0 +1,193 @@
+
+#include "BufferArena.h"
+#include <algorithm>
+#include "Buffer.h"
+#include "IDynamicRHI.h"
+
+namespace RHI {
+
+	namespace {
+
+		/**
+		 * Round an offset up to a multiple of an alignment, which doesn't need to be a power of 2
+		 */
+		u64 AlignUp(u64 offset, u64 alignment)
+		{
+			return (offset + alignment - 1) / alignment * alignment;
+		}
+
+		/**
+		 * Get the least common multiple of 2 alignments
+		 */
+		u64 LeastCommonMultiple(u64 a, u64 b)
+		{
+			u64 x = a;
+			u64 y = b;
+			while (y != 0)
+			{
+				u64 tmp = x % y;
+				x = y;
+				y = tmp;
+			}
+			return a / x * b;
+		}
+
+	}
+
+	BufferArena::BufferArena()
+		: m_pRhi(nullptr)
+		, m_Type(BufferType::Default)
+		, m_Flags(BufferFlags::None)
+		, m_PageSize(0)
+		, m_MinAlignment(1)
+	{
+	}
+
+	BufferArena::~BufferArena()
+	{
+	}
+
+	b8 BufferArena::Create(IDynamicRHI* pRhi, BufferType type, BufferFlags flags, u64 pageSize)
+	{
+		m_pRhi = pRhi;
+		m_Type = type;
+		m_Flags = flags;
+		m_PageSize = pageSize;
+		m_MinAlignment = std::max(m_pRhi->GetContext()->GetBufferOffsetAlignment(type), u64(1));
+		return m_PageSize != 0;
+	}
+
+	b8 BufferArena::Destroy()
+	{
+		b8 res = true;
+		for (Page& page : m_Pages)
+		{
+			res &= m_pRhi->DestroyBuffer(page.pBuffer);
+		}
+		m_Pages.clear();
+		return res;
+	}
+
+	BufferRange BufferArena::Allocate(u64 size, u64 alignment)
+	{
+		BufferRange range = {};
+		if (size == 0)
+			return range;
+
+		alignment = LeastCommonMultiple(std::max(alignment, u64(1)), m_MinAlignment);
+		for (Page& page : m_Pages)
+		{
+			if (page.size - page.usedSize >= size && TakeRange(page, size, alignment, range))
+				return range;
+		}
+
+		// No page has enough space left, ranges larger than a page get a buffer of their own
+		Page page = {};
+		page.size = std::max(size, m_PageSize);
+		page.usedSize = 0;
+		page.pBuffer = m_pRhi->CreateBuffer(m_Type, page.size, m_Flags);
+		if (!page.pBuffer)
+		{
+			//g_Logger.LogError("Failed to create a buffer arena page!");
+			return range;
+		}
+		page.pBuffer->SetDebugName("BufferArena page");
+		page.freeRanges.push_back(std::make_pair(u64(0), page.size));
+		TakeRange(page, size, alignment, range);
+		m_Pages.push_back(page);
+		return range;
+	}
+
+	BufferRange BufferArena::AllocateVertices(u32 vertexCount, u16 vertexSize)
+	{
+		return Allocate(u64(vertexCount) * vertexSize, vertexSize);
+	}
+
+	BufferRange BufferArena::AllocateIndices(u32 indexCount, IndexType indexType)
+	{
+		return Allocate(u64(indexCount) * u64(indexType), u64(indexType));
+	}
+
+	void BufferArena::Free(const BufferRange& range)
+	{
+		if (!range.pBuffer)
+			return;
+
+		for (std::vector<Page>::iterator pageIt = m_Pages.begin(); pageIt != m_Pages.end(); ++pageIt)
+		{
+			if (pageIt->pBuffer != range.pBuffer)
+				continue;
+
+			// Insert the range sorted by offset, merged with the free ranges next to it
+			std::vector<std::pair<u64, u64>>& freeRanges = pageIt->freeRanges;
+			std::vector<std::pair<u64, u64>>::iterator it = std::lower_bound(freeRanges.begin(), freeRanges.end(), std::make_pair(range.offset, u64(0)));
+			u64 offset = range.offset;
+			u64 size = range.size;
+			if (it != freeRanges.end() && offset + size == it->first)
+			{
+				size += it->second;
+				it = freeRanges.erase(it);
+			}
+			if (it != freeRanges.begin() && (it - 1)->first + (it - 1)->second == offset)
+				(it - 1)->second += size;
+			else
+				freeRanges.insert(it, std::make_pair(offset, size));
+
+			pageIt->usedSize -= range.size;
+			// Buffers of ranges larger than a page are released as soon as they are empty
+			if (pageIt->usedSize == 0 && pageIt->size != m_PageSize)
+			{
+				m_pRhi->DestroyBuffer(pageIt->pBuffer);
+				m_Pages.erase(pageIt);
+			}
+			return;
+		}
+	}
+
+	u64 BufferArena::GetUsedSize() const
+	{
+		u64 usedSize = 0;
+		for (const Page& page : m_Pages)
+		{
+			usedSize += page.usedSize;
+		}
+		return usedSize;
+	}
+
+	b8 BufferArena::TakeRange(Page& page, u64 size, u64 alignment, BufferRange& range)
+	{
+		sizeT bestIndex = page.freeRanges.size();
+		u64 bestOffset = 0;
+		for (sizeT i = 0; i < page.freeRanges.size(); ++i)
+		{
+			const std::pair<u64, u64>& freeRange = page.freeRanges[i];
+			u64 offset = AlignUp(freeRange.first, alignment);
+			if (offset + size > freeRange.first + freeRange.second)
+				continue;
+			if (bestIndex == page.freeRanges.size() || freeRange.second < page.freeRanges[bestIndex].second)
+			{
+				bestIndex = i;
+				bestOffset = offset;
+			}
+		}
+		if (bestIndex == page.freeRanges.size())
+			return false;
+
+		// The alignment padding in front of the range and the remainder behind it stay free
+		std::pair<u64, u64> freeRange = page.freeRanges[bestIndex];
+		page.freeRanges.erase(page.freeRanges.begin() + bestIndex);
+		u64 end = bestOffset + size;
+		u64 freeEnd = freeRange.first + freeRange.second;
+		if (end < freeEnd)
+			page.freeRanges.insert(page.freeRanges.begin() + bestIndex, std::make_pair(end, freeEnd - end));
+		if (bestOffset > freeRange.first)
+			page.freeRanges.insert(page.freeRanges.begin() + bestIndex, std::make_pair(freeRange.first, bestOffset - freeRange.first));
+
+		page.usedSize += size;
+		range.pBuffer = page.pBuffer;
+		range.offset = bestOffset;
+		range.size = size;
+		return true;
+	}
+
+}
@@ -0,0 +1,148 @@
+// Copyright 2018 Jelte Meganck. All Rights Reserved.
+//
+// BufferArena.h: Sub-allocation of ranges from large shared buffers
+#pragma once
+#include <vector>
+#include "../General/TypesAndMacros.h"
+#include "RHICommon.h"
+
+namespace RHI {
+	class Buffer;
+	class IDynamicRHI;
+
+	/**
+	 * Range of a buffer, sub-allocated from a buffer arena
+	 */
+	struct BufferRange
+	{
+		Buffer* pBuffer;	/**< Buffer containing the range, nullptr if the allocation failed */
+		u64 offset;			/**< Offset of the range in the buffer */
+		u64 size;			/**< Size of the range */
+
+		/**
+		 * Check if the range was allocated
+		 * @return	True if the range is valid, false otherwise
+		 */
+		b8 IsValid() const { return pBuffer != nullptr; }
+		/**
+		 * Get the vertex offset to draw the vertices in the range, with the buffer bound at offset 0
+		 * @param[in] vertexSize	Size of a vertex
+		 * @return					Vertex offset
+		 */
+		u32 GetVertexOffset(u16 vertexSize) const { return u32(offset / vertexSize); }
+		/**
+		 * Get the first index to draw the indices in the range, with the buffer bound at offset 0
+		 * @param[in] indexType		Index type
+		 * @return					First index
+		 */
+		u32 GetFirstIndex(IndexType indexType) const { return u32(offset / u64(indexType)); }
+	};
+
+	/**
+	 * Arena of large buffers of a single type, small buffers are sub-allocated from it as ranges,
+	 * so many meshes can share a single bound vertex and index buffer and be drawn with a vertex offset and first index
+	 * @note	Ranges share their buffer, so they should be written without BufferWriteFlags::Discard, which clears the whole buffer
+	 */
+	class BufferArena
+	{
+	public:
+		BufferArena();
+		~BufferArena();
+
+		/**
+		 * Create a buffer arena, buffers (pages) are only created when ranges are allocated
+		 * @param[in] pRhi		Dynamic RHI
+		 * @param[in] type		Type of the buffers
+		 * @param[in] flags		Flags of the buffers
+		 * @param[in] pageSize	Size of a buffer in the arena, larger ranges get a buffer of their own size
+		 * @return				True if the arena was created successfully, false otherwise
+		 */
+		b8 Create(IDynamicRHI* pRhi, BufferType type, BufferFlags flags, u64 pageSize);
+		/**
+		 * Destroy the arena and all its buffers
+		 * @return	True if the arena was destroyed successfully, false otherwise
+		 * @note	All ranges become invalid, the buffers may not be used by the gpu anymore
+		 */
+		b8 Destroy();
+
+		/**
+		 * Allocate a range
+		 * @param[in] size		Size of the range
+		 * @param[in] alignment	Alignment of the offset of the range, does not need to be a power of 2, the minimum offset alignment of the buffer type is always respected
+		 * @return				Buffer range, invalid if the allocation failed
+		 */
+		BufferRange Allocate(u64 size, u64 alignment = 1);
+		/**
+		 * Allocate a range for vertices, the offset is a multiple of the vertex size
+		 * @param[in] vertexCount	Amount of vertices
+		 * @param[in] vertexSize	Size of a vertex
+		 * @return					Buffer range, invalid if the allocation failed
+		 */
+		BufferRange AllocateVertices(u32 vertexCount, u16 vertexSize);
+		/**
+		 * Allocate a range for indices, the offset is a multiple of the index size
+		 * @param[in] indexCount	Amount of indices
+		 * @param[in] indexType		Index type
+		 * @return					Buffer range, invalid if the allocation failed
+		 * @note					The buffers have no index type of their own, so they need to be bound with an explicit index type
+		 */
+		BufferRange AllocateIndices(u32 indexCount, IndexType indexType);
+		/**
+		 * Free a range
+		 * @param[in] range	Buffer range
+		 * @note			The range may not be used by the gpu anymore
+		 */
+		void Free(const BufferRange& range);
+
+		/**
+		 * Get the type of the buffers
+		 * @return	Buffer type
+		 */
+		BufferType GetType() const { return m_Type; }
+		/**
+		 * Get the size of a buffer in the arena
+		 * @return	Page size
+		 */
+		u64 GetPageSize() const { return m_PageSize; }
+		/**
+		 * Get the amount of buffers in the arena
+		 * @return	Amount of buffers
+		 */
+		u32 GetPageCount() const { return u32(m_Pages.size()); }
+		/**
+		 * Get the size used by ranges, excluding alignment padding
+		 * @return	Used size
+		 */
+		u64 GetUsedSize() const;
+
+	private:
+		/**
+		 * Buffer in the arena
+		 */
+		struct Page
+		{
+			Buffer* pBuffer;							/**< Buffer */
+			u64 size;									/**< Size of the buffer */
+			u64 usedSize;								/**< Size used by ranges */
+			std::vector<std::pair<u64, u64>> freeRanges;	/**< Free ranges (offset, size), sorted by offset */
+		};
+
+		/**
+		 * Take a range from a page, using the smallest free range that fits
+		 * @param[in] page			Page
+		 * @param[in] size			Size of the range
+		 * @param[in] alignment		Alignment of the offset
+		 * @param[out] range		Buffer range
+		 * @return					True if the range fits in the page, false otherwise
+		 */
+		static b8 TakeRange(Page& page, u64 size, u64 alignment, BufferRange& range);
+
+		IDynamicRHI* m_pRhi;		/**< Dynamic RHI */
+		BufferType m_Type;			/**< Type of the buffers */
+		BufferFlags m_Flags;		/**< Flags of the buffers */
+		u64 m_PageSize;				/**< Size of a buffer */
+		u64 m_MinAlignment;			/**< Minimum offset alignment of the buffer type */
+		std::vector<Page> m_Pages;	/**< Buffers */
+	};
+
+}
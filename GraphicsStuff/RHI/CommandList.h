@@ -3,6 +3,7 @@
 
 #include "../General/TypesAndMacros.h"
 #include "RHICommon.h"
+#include "RenderingDesc.h"
 
 namespace RHI {
 	class RHIContext;
@@ -57,12 +58,29 @@ namespace RHI {
 		 * End the current render pass
 		 */
 		virtual void EndRenderPass() = 0;
+		/**
+		 * Begin rendering to a set of render targets, without a render pass or framebuffer object
+		 * @param[in] desc	Rendering description
+		 * @note			Pipelines used while rendering need to be created without a render pass, with matching rendering formats
+		 *					When dynamic rendering is unsupported, a cached render pass and framebuffer are used instead
+		 */
+		virtual void BeginRendering(const RenderingDesc& desc) = 0;
+		/**
+		 * End rendering started with BeginRendering
+		 */
+		virtual void EndRendering() = 0;
+		/**
+		 * Check if rendering without render pass and framebuffer objects is natively supported
+		 * @return	True if BeginRendering doesn't need render pass and framebuffer objects, false otherwise
+		 */
+		virtual b8 IsDynamicRenderingSupported() const = 0;
 
 		/**
 		 * Bind a vertex buffer
 		 * @param[in] inputSlot		Input slot of the buffer
 		 * @param[in] pBuffer		Vertex buffer to bind
 		 * @param[in] offset		Offset in buffer
+		 * @note					Rebinding the bound buffer and offset is skipped, so meshes sharing a buffer from a BufferArena can bind it per draw
 		 */
 		virtual void BindVertexBuffer(u16 inputSlot, Buffer* pBuffer, u64 offset) = 0;
 		/**
@@ -84,6 +102,7 @@ namespace RHI {
 		 * @param[in] offset		Offset in buffer
 		 * @param[in] type			Index type
 		 * @note					Use this function when using a combined buffer (vertices, indices, etc. in same buffer)
+		 * @note					Rebinding the bound buffer, offset and type is skipped
 		 */
 		virtual void BindIndexBuffer(Buffer* pBuffer, u64 offset, IndexType type) = 0;
 		/**
@@ -116,17 +135,63 @@ namespace RHI {
 		 * @note						Use this function when using a combined buffer (vertices, indices, etc. in same buffer)
 		 */
 		virtual void BindDescriptorSets(u32 firstSet, const std::vector<DescriptorSet*>& sets, const std::vector<u32>& dynamicOffsets) = 0;
+		/**
+		 * Update push constants of the bound pipeline
+		 * @param[in] offset	Offset in the push constant range
+		 * @param[in] size		Size of the data
+		 * @param[in] pData		Data to push
+		 */
+		virtual void PushConstants(u32 offset, u32 size, const void* pData) = 0;
 
 		/**
 		 * Set the viewport
 		 * @param[in] viewport	Viewport
 		 */
-		virtual void SetViewport(Viewport& viewport) = 0;
+		virtual void SetViewport(const Viewport& viewport) = 0;
 		/**
 		 * Set the scissor rect
 		 * @param[in] scissor	Scissor rect
 		 */
-		virtual void SetScissor(ScissorRect& scissor) = 0;
+		virtual void SetScissor(const ScissorRect& scissor) = 0;
+		/**
+		 * Set the cull mode
+		 * @param[in] cullMode	Cull mode
+		 * @note				Only used by pipelines with DynamicState::CullMode, binding a pipeline with the state baked in discards it
+		 */
+		virtual void SetCullMode(CullMode cullMode) = 0;
+		/**
+		 * Set the front face
+		 * @param[in] frontFace	Front face
+		 * @note				Only used by pipelines with DynamicState::FrontFace, binding a pipeline with the state baked in discards it
+		 */
+		virtual void SetFrontFace(FrontFace frontFace) = 0;
+		/**
+		 * Set the primitive topology
+		 * @param[in] topology	Primitive topology (same topology class as the bound pipeline's)
+		 * @note				Only used by pipelines with DynamicState::PrimitiveTopology, binding a pipeline with the state baked in discards it
+		 */
+		virtual void SetPrimitiveTopology(PrimitiveTopology topology) = 0;
+		/**
+		 * Set the depth test state
+		 * @param[in] enableTest	If a depth test needs to be used
+		 * @param[in] enableWrite	If the depth needs to be written to
+		 * @param[in] compareOp		Depth compare op
+		 * @note					Only used by pipelines with DynamicState::DepthTest, binding a pipeline with the state baked in discards it
+		 */
+		virtual void SetDepthTest(b8 enableTest, b8 enableWrite, CompareOp compareOp) = 0;
+		/**
+		 * Set the stencil test state
+		 * @param[in] enableTest	If a stencil test needs to be used
+		 * @param[in] front			Stencil op state for front face (masks and reference are ignored)
+		 * @param[in] back			Stencil op state for back face (masks and reference are ignored)
+		 * @note					Only used by pipelines with DynamicState::StencilTest, binding a pipeline with the state baked in discards it
+		 */
+		virtual void SetStencilTest(b8 enableTest, const StencilOpState& front, const StencilOpState& back) = 0;
+		/**
+		 * Check if extended dynamic state is supported
+		 * @return	True if pipelines can have DynamicState::Extended states dynamic, false otherwise
+		 */
+		virtual b8 IsExtendedDynamicStateSupported() const = 0;
 
 		/**
 		 * Draw a number of vertices and instances
@@ -145,6 +210,57 @@ namespace RHI {
 		 * @param[in] firstInstance		Index of instance to start drawing from
 		 */
 		virtual void DrawIndexed(u32 indexCount, u32 instanceCount = 1, u32 firstIndex = 0, u32 vertexOffset = 0, u32 firstInstance = 0) = 0;
+		/**
+		 * Draw using parameters read from a buffer
+		 * @param[in] pBuffer		Buffer containing DrawIndirectCommand structures
+		 * @param[in] offset		Offset in buffer of the first command
+		 * @param[in] drawCount		Amount of draws to execute
+		 * @param[in] stride		Stride in bytes between consecutive commands
+		 */
+		virtual void DrawIndirect(Buffer* pBuffer, u64 offset, u32 drawCount = 1, u32 stride = sizeof(DrawIndirectCommand)) = 0;
+		/**
+		 * Draw using parameters read from a buffer (indexed)
+		 * @param[in] pBuffer		Buffer containing DrawIndexedIndirectCommand structures
+		 * @param[in] offset		Offset in buffer of the first command
+		 * @param[in] drawCount		Amount of draws to execute
+		 * @param[in] stride		Stride in bytes between consecutive commands
+		 */
+		virtual void DrawIndexedIndirect(Buffer* pBuffer, u64 offset, u32 drawCount = 1, u32 stride = sizeof(DrawIndexedIndirectCommand)) = 0;
+		/**
+		 * Draw using parameters read from a buffer, with the amount of draws read from a second buffer
+		 * @param[in] pBuffer		Buffer containing DrawIndirectCommand structures
+		 * @param[in] offset		Offset in buffer of the first command
+		 * @param[in] pCountBuffer	Buffer containing the draw count
+		 * @param[in] countOffset	Offset in the count buffer
+		 * @param[in] maxDrawCount	Maximum amount of draws to execute
+		 * @param[in] stride		Stride in bytes between consecutive commands
+		 * @note					Requires IsDrawIndirectCountSupported()
+		 */
+		virtual void DrawIndirectCount(Buffer* pBuffer, u64 offset, Buffer* pCountBuffer, u64 countOffset, u32 maxDrawCount, u32 stride = sizeof(DrawIndirectCommand)) = 0;
+		/**
+		 * Draw using parameters read from a buffer, with the amount of draws read from a second buffer (indexed)
+		 * @param[in] pBuffer		Buffer containing DrawIndexedIndirectCommand structures
+		 * @param[in] offset		Offset in buffer of the first command
+		 * @param[in] pCountBuffer	Buffer containing the draw count
+		 * @param[in] countOffset	Offset in the count buffer
+		 * @param[in] maxDrawCount	Maximum amount of draws to execute
+		 * @param[in] stride		Stride in bytes between consecutive commands
+		 * @note					Requires IsDrawIndirectCountSupported()
+		 */
+		virtual void DrawIndexedIndirectCount(Buffer* pBuffer, u64 offset, Buffer* pCountBuffer, u64 countOffset, u32 maxDrawCount, u32 stride = sizeof(DrawIndexedIndirectCommand)) = 0;
+		/**
+		 * Check if the count variants of the indirect draws are supported
+		 * @return	True if DrawIndirectCount and DrawIndexedIndirectCount can be used, false otherwise
+		 */
+		virtual b8 IsDrawIndirectCountSupported() const = 0;
+
+		/**
+		 * Dispatch compute work groups
+		 * @param[in] groupCountX	Amount of work groups in the x dimension
+		 * @param[in] groupCountY	Amount of work groups in the y dimension
+		 * @param[in] groupCountZ	Amount of work groups in the z dimension
+		 */
+		virtual void Dispatch(u32 groupCountX, u32 groupCountY = 1, u32 groupCountZ = 1) = 0;
 
 		/**
 		 * Copy data from one buffer to another
@@ -220,6 +336,14 @@ namespace RHI {
 		 *							(make sure you know what you are doing!)
 		 */
 		virtual void CopyTextureToBuffer(Texture* pTexture, Buffer* pBuffer, const std::vector<TextureBufferCopyRegion>& regions) = 0;
+		/**
+		 * Fill a region of a buffer with a repeated 32-bit value
+		 * @param[in] pBuffer		Buffer to fill
+		 * @param[in] offset		Offset in buffer (multiple of 4)
+		 * @param[in] size			Amount of bytes to fill (multiple of 4), u64(-1) fills until the end of the buffer
+		 * @param[in] value			Value to fill with
+		 */
+		virtual void FillBuffer(Buffer* pBuffer, u64 offset, u64 size, u32 value) = 0;
 
 		/**
 		* Transition the layout of a texture
@@ -230,6 +354,33 @@ namespace RHI {
 		* @note						Command buffer automatically batches transitions
 		*/
 		virtual void TransitionTextureLayout(PipelineStage srcStage, PipelineStage dstStage, Texture* pTexture, const TextureLayoutTransition& transition) = 0;
+		/**
+		* Make writes to a buffer in the source stage visible to the destination stage
+		* @param[in] srcStage		Source stage
+		* @param[in] dstStage		Destination stage
+		* @param[in] pBuffer		Buffer
+		* @param[in] offset			Offset of the region in the buffer
+		* @param[in] size			Size of the region, u64(-1) covers the rest of the buffer
+		* @note						Command buffer automatically batches barriers
+		*/
+		virtual void BufferBarrier(PipelineStage srcStage, PipelineStage dstStage, Buffer* pBuffer, u64 offset = 0, u64 size = u64(-1)) = 0;
+		/**
+		* Hand the memory of a heap over to a texture, after it was used by other resources placed at an overlapping offset
+		* @param[in] srcStage		Stage in which the previous resource was last used
+		* @param[in] dstStage		Stage in which the texture is first used
+		* @param[in] pTexture		Texture that starts using the memory
+		* @param[in] layout			Layout to transition the texture to
+		* @note						The contents of the texture are undefined after the barrier, the previous resource can't be used until it gets the memory back
+		*/
+		virtual void AliasingBarrier(PipelineStage srcStage, PipelineStage dstStage, Texture* pTexture, TextureLayout layout) = 0;
+		/**
+		* Hand the memory of a heap over to a buffer, after it was used by other resources placed at an overlapping offset
+		* @param[in] srcStage		Stage in which the previous resource was last used
+		* @param[in] dstStage		Stage in which the buffer is first used
+		* @param[in] pBuffer		Buffer that starts using the memory
+		* @note						The contents of the buffer are undefined after the barrier, the previous resource can't be used until it gets the memory back
+		*/
+		virtual void AliasingBarrier(PipelineStage srcStage, PipelineStage dstStage, Buffer* pBuffer) = 0;
 
 		/**
 		 * Submit the command buffer to its queue
@@ -74,6 +74,12 @@ namespace RHI {
 		 * @param[in] texAndSamplers		Texture and sampler write info
 		 */
 		virtual b8 Write(const std::vector<DescriptorSetBufferInfo>& buffers, const std::vector<DescriptorSetTextureSamplerInfo>& texAndSamplers) = 0;
+		/**
+		 * Write all bindings of the descriptor set at once
+		 * @param[in] pPackedData	Packed descriptor data, filled in with DescriptorSetLayout::PackBuffer and DescriptorSetLayout::PackTexture
+		 * @note					The packed data can be kept around (e.g. per material) and written to multiple sets
+		 */
+		virtual b8 WriteAll(const void* pPackedData) = 0;
 
 		/**
 		 * Get the descriptor set's layout
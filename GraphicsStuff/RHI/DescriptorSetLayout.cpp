@@ -1,5 +1,6 @@
 
 #include "DescriptorSetLayout.h"
+#include "../General/Hash.h"
 
 namespace RHI {
 
@@ -7,6 +8,10 @@ namespace RHI {
 	DescriptorSetLayout::DescriptorSetLayout()
 		: m_pContext(nullptr)
 		, m_pManager(nullptr)
+		, m_RefCount(0)
+		, m_PackedDataSize(0)
+		, m_Hash(0)
+		, m_UpdateAfterBind(false)
 	{
 	}
 
@@ -14,9 +19,24 @@ namespace RHI {
 	{
 	}
 
-	b8 DescriptorSetLayout::Matches(const std::vector<DescriptorSetBinding>& bindings)
+	u64 DescriptorSetLayout::HashBindings(const std::vector<DescriptorSetBinding>& bindings, b8 updateAfterBind)
 	{
-		if (bindings.size() != m_Bindings.size())
+		// Hash members separately, DescriptorSetBinding contains padding
+		u64 hash = Hash::Combine(0xCBF2'9CE4'8422'2325, u32(bindings.size()));
+		hash = Hash::Combine(hash, updateAfterBind);
+		for (const DescriptorSetBinding& binding : bindings)
+		{
+			hash = Hash::Combine(hash, binding.type);
+			hash = Hash::Combine(hash, binding.shadertype);
+			hash = Hash::Combine(hash, binding.count);
+			hash = Hash::Combine(hash, binding.pImmutableSampler);
+		}
+		return hash;
+	}
+
+	b8 DescriptorSetLayout::Matches(const std::vector<DescriptorSetBinding>& bindings, b8 updateAfterBind)
+	{
+		if (bindings.size() != m_Bindings.size() || updateAfterBind != m_UpdateAfterBind)
 			return false;
 
 		for (sizeT i = 0; i < m_Bindings.size(); ++i)
@@ -26,7 +46,8 @@ namespace RHI {
 
 			if (binding0.type != binding1.type ||
 				binding0.shadertype != binding1.shadertype ||
-				binding0.count != binding1.count)
+				binding0.count != binding1.count ||
+				binding0.pImmutableSampler != binding1.pImmutableSampler)
 			{
 				return false;
 			}
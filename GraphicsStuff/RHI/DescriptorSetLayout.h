@@ -9,12 +9,16 @@
 namespace RHI {
 	class RHIContext;
 	class DescriptorSetManager;
+	class Buffer;
+	class Texture;
+	class Sampler;
 
 	struct DescriptorSetBinding
 	{
 		DescriptorSetBindingType type;	/**< Descriptor set type */
 		ShaderType shadertype;	/**< Shader type/stage */
-		u32 count;				/**< Number of uniform variables of this type, 0 is reserved */
+		u32 count;				/**< Number of uniform variables of this type, 0 reserves the binding slot without using it */
+		Sampler* pImmutableSampler;	/**< Immutable sampler for sampler and combined image sampler bindings, nullptr if none, the layout holds a reference to it in the sampler cache */
 	};
 
 	class DescriptorSetLayout
@@ -37,11 +41,30 @@ namespace RHI {
 		 */
 		virtual b8 Destroy() = 0;
 
+		/**
+		 * Calculate the canonical hash of a group of bindings, bindings are hashed in order, as their index is their binding slot
+		 * @param[in] bindings			Descriptor set bindings
+		 * @param[in] updateAfterBind	Whether the bindings can be updated after being bound
+		 * @return						Hash
+		 */
+		static u64 HashBindings(const std::vector<DescriptorSetBinding>& bindings, b8 updateAfterBind = false);
 		/**
 		 * Check if a group of binding matches the layout's bindings
-		 * @return	True if the bindings match, false otherwise
+		 * @param[in] bindings			Descriptor set bindings
+		 * @param[in] updateAfterBind	Whether the bindings can be updated after being bound
+		 * @return						True if the bindings match, false otherwise
+		 */
+		b8 Matches(const std::vector<DescriptorSetBinding>& bindings, b8 updateAfterBind = false);
+		/**
+		 * Get the hash of the layout's bindings
+		 * @return	Hash
 		 */
-		b8 Matches(const std::vector<DescriptorSetBinding>& bindings);
+		u64 GetHash() const { return m_Hash; }
+		/**
+		 * Check if the layout's bindings can be updated after being bound
+		 * @return	True if the bindings can be updated after being bound, false otherwise
+		 */
+		b8 IsUpdateAfterBind() const { return m_UpdateAfterBind; }
 
 		/**
 		 * Get the layout's descriptor set bindings
@@ -49,6 +72,31 @@ namespace RHI {
 		 */
 		std::vector<DescriptorSetBinding>& GetBindings() { return m_Bindings; }
 
+		/**
+		 * Get the size of the packed descriptor data for DescriptorSet::WriteAll
+		 * @return	Size of the packed data
+		 */
+		sizeT GetPackedDataSize() const { return m_PackedDataSize; }
+		/**
+		 * Pack a buffer into packed descriptor data
+		 * @param[in] pPackedData	Packed descriptor data (GetPackedDataSize() bytes)
+		 * @param[in] binding		Binding to pack to
+		 * @param[in] pBuffer		Buffer to pack
+		 * @param[in] offset		Offset in buffer
+		 * @param[in] range			Range in buffer
+		 * @param[in] arrayElement	Element of the array to pack the buffer to
+		 */
+		virtual void PackBuffer(void* pPackedData, u32 binding, Buffer* pBuffer, u64 offset = 0, u64 range = u64(-1), u32 arrayElement = 0) = 0;
+		/**
+		 * Pack a texture and a sampler into packed descriptor data
+		 * @param[in] pPackedData	Packed descriptor data (GetPackedDataSize() bytes)
+		 * @param[in] binding		Binding to pack to
+		 * @param[in] pTexture		Texture to pack (may be nullptr for sampler bindings)
+		 * @param[in] pSampler		Sampler to pack (may be nullptr for image bindings)
+		 * @param[in] arrayElement	Element of the array to pack the texture and sampler to
+		 */
+		virtual void PackTexture(void* pPackedData, u32 binding, Texture* pTexture, Sampler* pSampler, u32 arrayElement = 0) = 0;
+
 		/**
 		 * Increment the layout reference count
 		 */
@@ -68,6 +116,9 @@ namespace RHI {
 		DescriptorSetManager* m_pManager;
 		std::vector<DescriptorSetBinding> m_Bindings;
 		u32 m_RefCount;
+		sizeT m_PackedDataSize;		/**< Size of the packed descriptor data */
+		u64 m_Hash;					/**< Hash of the bindings */
+		b8 m_UpdateAfterBind;		/**< Whether the bindings can be updated after being bound */
 	};
 
 }
@@ -1,10 +1,22 @@
 
+#include <cassert>
 #include "DescriptorSetManager.h"
+#include "RHIContext.h"
+#include "SamplerCache.h"
+#include "ShaderReflection.h"
 
 namespace RHI {
 
 	DescriptorSetManager::DescriptorSetManager()
 		: m_pContext(nullptr)
+		, m_CacheHits(0)
+		, m_CacheMisses(0)
+		, m_BindlessDesc()
+		, m_pBindlessLayout(nullptr)
+		, m_pBindlessSet(nullptr)
+		, m_BindlessTextureCount(0)
+		, m_BindlessSamplerCount(0)
+		, m_BindlessBufferCount(0)
 	{
 	}
 
@@ -12,4 +24,84 @@ namespace RHI {
 	{
 	}
 
+	b8 DescriptorSetManager::CreateDescriptorSetLayouts(const ShaderReflection& reflection, std::vector<DescriptorSetLayout*>& layouts)
+	{
+		layouts.clear();
+		u32 setCount = reflection.GetSetCount();
+		for (u32 set = 0; set < setCount; ++set)
+		{
+			DescriptorSetLayout* pLayout = CreateDescriptorSetLayout(reflection.GetSetBindings(set));
+			if (!pLayout)
+			{
+				for (DescriptorSetLayout* pCreatedLayout : layouts)
+				{
+					DestroyDescriptorSetLayout(pCreatedLayout);
+				}
+				layouts.clear();
+				return false;
+			}
+			layouts.push_back(pLayout);
+		}
+		return true;
+	}
+
+	void DescriptorSetManager::UnregisterBindlessTexture(BindlessIndex index)
+	{
+		m_RetiredBindlessTextures.push_back({ index, m_pContext->GetFrameIndex(), nullptr });
+	}
+
+	void DescriptorSetManager::UnregisterBindlessSampler(BindlessIndex index)
+	{
+		assert(index < m_BindlessSamplers.size() && m_BindlessSamplers[index]);
+		if (--m_BindlessSamplerRefs[index] > 0)
+			return;
+
+		// The sampler can be registered again right away, it then gets a new index
+		Sampler* pSampler = m_BindlessSamplers[index];
+		m_BindlessSamplerIndices.erase(pSampler);
+		m_BindlessSamplers[index] = nullptr;
+		m_RetiredBindlessSamplers.push_back({ index, m_pContext->GetFrameIndex(), pSampler });
+	}
+
+	void DescriptorSetManager::UnregisterBindlessBuffer(BindlessIndex index)
+	{
+		m_RetiredBindlessBuffers.push_back({ index, m_pContext->GetFrameIndex(), nullptr });
+	}
+
+	BindlessIndex DescriptorSetManager::AllocateBindlessIndex(std::vector<BindlessIndex>& freeIndices, u32& usedCount, u32 maxCount)
+	{
+		if (freeIndices.size() > 0)
+		{
+			BindlessIndex index = freeIndices.back();
+			freeIndices.pop_back();
+			return index;
+		}
+
+		if (usedCount == maxCount)
+			return InvalidBindlessIndex;
+		return usedCount++;
+	}
+
+	void DescriptorSetManager::ReleaseRetiredBindlessIndices(b8 force)
+	{
+		ReleaseRetiredBindlessIndices(m_RetiredBindlessTextures, m_FreeBindlessTextures, force);
+		ReleaseRetiredBindlessIndices(m_RetiredBindlessSamplers, m_FreeBindlessSamplers, force);
+		ReleaseRetiredBindlessIndices(m_RetiredBindlessBuffers, m_FreeBindlessBuffers, force);
+	}
+
+	void DescriptorSetManager::ReleaseRetiredBindlessIndices(std::vector<RetiredBindlessIndex>& retiredIndices, std::vector<BindlessIndex>& freeIndices, b8 force)
+	{
+		// Indices are retired in frame order, so the completed ones are at the front
+		sizeT count = 0;
+		while (count < retiredIndices.size() && (force || m_pContext->IsFrameComplete(retiredIndices[count].frame)))
+		{
+			const RetiredBindlessIndex& retired = retiredIndices[count];
+			if (retired.pSampler)
+				m_pContext->GetSamplerCache()->ReleaseSampler(retired.pSampler);
+			freeIndices.push_back(retired.index);
+			++count;
+		}
+		retiredIndices.erase(retiredIndices.begin(), retiredIndices.begin() + count);
+	}
+
 }
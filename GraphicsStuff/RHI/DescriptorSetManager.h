@@ -2,12 +2,31 @@
 //
 // DescriptorSetManager.h: Descriptor set manager
 #pragma once
+#include <unordered_map>
 #include "RHICommon.h"
 #include "DescriptorSetLayout.h"
 
 namespace RHI {
 	class DescriptorSet;
 	class RHIContext;
+	class Texture;
+	class Sampler;
+	class Buffer;
+	class ShaderReflection;
+
+	typedef u32 BindlessIndex;
+	static const BindlessIndex InvalidBindlessIndex = BindlessIndex(-1);
+
+	/**
+	 * Bindless descriptor set description
+	 * The bindless set has 3 partially bound arrays: sampled images (binding 0), samplers (binding 1) and storage buffers (binding 2)
+	 */
+	struct BindlessDesc
+	{
+		u32 maxTextures;	/**< Maximum amount of registered textures */
+		u32 maxSamplers;	/**< Maximum amount of registered samplers */
+		u32 maxBuffers;		/**< Maximum amount of registered storage buffers */
+	};
 
 	class DescriptorSetManager
 	{
@@ -33,6 +52,14 @@ namespace RHI {
 		 * @return				Pointer to a descriptor set, nullptr if the creation failed
 		 */
 		virtual DescriptorSetLayout* CreateDescriptorSetLayout(const std::vector<DescriptorSetBinding>& bindings) = 0;
+		/**
+		 * Create the descriptor set layouts used by reflected shaders
+		 * @param[in] reflection	Shader reflection, merged across all stages of the pipeline
+		 * @param[out] layouts		Descriptor set layouts, indexed by set
+		 * @return					True if the layouts were created successfully, false otherwise
+		 * @note					Every layout needs to be destroyed with DestroyDescriptorSetLayout
+		 */
+		b8 CreateDescriptorSetLayouts(const ShaderReflection& reflection, std::vector<DescriptorSetLayout*>& layouts);
 		/**
 		 * Create a descriptor set
 		 * @param[in] pLayout	Descriptor set layout
@@ -52,11 +79,176 @@ namespace RHI {
 		 */
 		virtual b8 DestroyDescriptorSet(DescriptorSet* pDescriptorSet) = 0;
 
+		/**
+		 * Create a transient descriptor set, only valid during the current frame
+		 * @param[in] pLayout	Descriptor set layout
+		 * @return				Pointer to a descriptor set, nullptr if the creation failed
+		 * @note				Transient sets are not destroyed individually, they are released in bulk when their frame index is reused in BeginFrame
+		 */
+		virtual DescriptorSet* CreateTransientDescriptorSet(DescriptorSetLayout* pLayout) = 0;
+		/**
+		 * Begin a new frame, releasing all transient descriptor sets previously created for the frame index and recycling the bindless indices of completed frames
+		 * @param[in] frameIndex	Index of the frame in flight (0-2)
+		 * @note					The GPU has to be done with the previous frame using this index (its fence must have been waited on)
+		 */
+		virtual void BeginFrame(u32 frameIndex) = 0;
+
+		/**
+		 * Get a descriptor set with the given contents, reusing an identical set when one is cached
+		 * @param[in] pLayout		Descriptor set layout
+		 * @param[in] pPackedData	Packed descriptor data, filled in with DescriptorSetLayout::PackBuffer and DescriptorSetLayout::PackTexture
+		 * @return					Pointer to a descriptor set, nullptr if the creation failed
+		 * @note					Cached sets are owned by the manager and must not be written to or destroyed, sets that stay unused are evicted
+		 */
+		virtual DescriptorSet* GetCachedDescriptorSet(DescriptorSetLayout* pLayout, const void* pPackedData) = 0;
+		/**
+		 * Remove all cached descriptor sets referencing a buffer
+		 * @param[in] pBuffer	Buffer that is about to be destroyed
+		 */
+		virtual void InvalidateCachedDescriptorSets(Buffer* pBuffer) = 0;
+		/**
+		 * Remove all cached descriptor sets referencing a texture
+		 * @param[in] pTexture	Texture that is about to be destroyed
+		 */
+		virtual void InvalidateCachedDescriptorSets(Texture* pTexture) = 0;
+		/**
+		 * Remove all cached descriptor sets referencing a sampler
+		 * @param[in] pSampler	Sampler that is about to be destroyed
+		 */
+		virtual void InvalidateCachedDescriptorSets(Sampler* pSampler) = 0;
+		/**
+		 * Get the amount of descriptor set cache hits
+		 * @return	Amount of cache hits
+		 */
+		u64 GetCacheHits() const { return m_CacheHits; }
+		/**
+		 * Get the amount of descriptor set cache misses
+		 * @return	Amount of cache misses
+		 */
+		u64 GetCacheMisses() const { return m_CacheMisses; }
+
+		/**
+		 * Check if bindless descriptors are supported
+		 * @return	True if bindless descriptors are supported, false otherwise
+		 */
+		virtual b8 IsBindlessSupported() = 0;
+		/**
+		 * Enable bindless descriptors, creating the bindless descriptor set
+		 * @param[in] desc	Bindless description
+		 * @return			True if bindless descriptors were enabled successfully, false otherwise
+		 * @note			The bindless set can be bound once, resources registered afterwards are visible to later draws without rebinding
+		 */
+		virtual b8 EnableBindless(const BindlessDesc& desc) = 0;
+		/**
+		 * Check if bindless descriptors are enabled
+		 * @return	True if bindless descriptors are enabled, false otherwise
+		 */
+		b8 IsBindlessEnabled() const { return m_pBindlessSet != nullptr; }
+
+		/**
+		 * Register a texture in the bindless set
+		 * @param[in] pTexture	Texture to register
+		 * @return				Index of the texture in the bindless texture array, InvalidBindlessIndex if the array is full
+		 */
+		virtual BindlessIndex RegisterBindlessTexture(Texture* pTexture) = 0;
+		/**
+		 * Register a sampler in the bindless set, registering a sampler that is already registered returns the same index
+		 * @param[in] pSampler	Sampler to register
+		 * @return				Index of the sampler in the bindless sampler array, InvalidBindlessIndex if the array is full
+		 * @note				The bindless set holds a reference to the sampler in the sampler cache, until the sampler is unregistered as many times as it was registered
+		 */
+		virtual BindlessIndex RegisterBindlessSampler(Sampler* pSampler) = 0;
+		/**
+		 * Register a storage buffer in the bindless set
+		 * @param[in] pBuffer	Buffer to register
+		 * @return				Index of the buffer in the bindless buffer array, InvalidBindlessIndex if the array is full
+		 */
+		virtual BindlessIndex RegisterBindlessBuffer(Buffer* pBuffer) = 0;
+		/**
+		 * Unregister a texture from the bindless set
+		 * @param[in] index	Index of the texture
+		 * @note			The index is only reused once the frames in flight that could reference it have completed
+		 */
+		void UnregisterBindlessTexture(BindlessIndex index);
+		/**
+		 * Unregister a sampler from the bindless set
+		 * @param[in] index	Index of the sampler
+		 * @note			The index is only reused and the sampler only released once the frames in flight that could reference it have completed
+		 */
+		void UnregisterBindlessSampler(BindlessIndex index);
+		/**
+		 * Unregister a storage buffer from the bindless set
+		 * @param[in] index	Index of the buffer
+		 * @note			The index is only reused once the frames in flight that could reference it have completed
+		 */
+		void UnregisterBindlessBuffer(BindlessIndex index);
+
+		/**
+		 * Get the bindless descriptor set layout
+		 * @return	Bindless descriptor set layout, nullptr if bindless descriptors aren't enabled
+		 */
+		DescriptorSetLayout* GetBindlessLayout() { return m_pBindlessLayout; }
+		/**
+		 * Get the bindless descriptor set
+		 * @return	Bindless descriptor set, nullptr if bindless descriptors aren't enabled
+		 */
+		DescriptorSet* GetBindlessSet() { return m_pBindlessSet; }
 
 	protected:
+		/**
+		 * Unregistered bindless index, which frames in flight might still reference
+		 */
+		struct RetiredBindlessIndex
+		{
+			BindlessIndex index;	/**< Bindless index */
+			u64 frame;				/**< Frame in which the index was unregistered */
+			Sampler* pSampler;		/**< Sampler to release together with the index, nullptr for textures and buffers */
+		};
+
+		/**
+		 * Allocate a bindless index
+		 * @param[in] freeIndices	Free indices
+		 * @param[in] usedCount		Amount of indices that have been used
+		 * @param[in] maxCount		Maximum amount of indices
+		 * @return					Index, InvalidBindlessIndex if no indices are left
+		 */
+		BindlessIndex AllocateBindlessIndex(std::vector<BindlessIndex>& freeIndices, u32& usedCount, u32 maxCount);
+		/**
+		 * Return the retired bindless indices of completed frames to their free lists, should be called once per frame
+		 * @param[in] force	If all retired indices should be returned, only allowed when the device is idle
+		 */
+		void ReleaseRetiredBindlessIndices(b8 force);
+		/**
+		 * Return the retired indices of a bindless array to its free list
+		 * @param[in] retiredIndices	Retired indices, in unregistration order
+		 * @param[in] freeIndices		Free indices
+		 * @param[in] force				If all retired indices should be returned
+		 */
+		void ReleaseRetiredBindlessIndices(std::vector<RetiredBindlessIndex>& retiredIndices, std::vector<BindlessIndex>& freeIndices, b8 force);
+
 		RHIContext* m_pContext;
 		std::vector<DescriptorSetLayout*> m_Layouts;
+		std::unordered_multimap<u64, DescriptorSetLayout*> m_LayoutLookup;	/**< Layouts by binding hash */
 		std::vector<DescriptorSet*> m_DescriptorSets;
+
+		u64 m_CacheHits;									/**< Descriptor set cache hits */
+		u64 m_CacheMisses;									/**< Descriptor set cache misses */
+
+		BindlessDesc m_BindlessDesc;						/**< Bindless description */
+		DescriptorSetLayout* m_pBindlessLayout;				/**< Bindless descriptor set layout */
+		DescriptorSet* m_pBindlessSet;						/**< Bindless descriptor set */
+		u32 m_BindlessTextureCount;							/**< Amount of used bindless texture indices */
+		u32 m_BindlessSamplerCount;							/**< Amount of used bindless sampler indices */
+		u32 m_BindlessBufferCount;							/**< Amount of used bindless buffer indices */
+		std::vector<BindlessIndex> m_FreeBindlessTextures;	/**< Free bindless texture indices */
+		std::vector<BindlessIndex> m_FreeBindlessSamplers;	/**< Free bindless sampler indices */
+		std::vector<BindlessIndex> m_FreeBindlessBuffers;	/**< Free bindless buffer indices */
+		std::vector<RetiredBindlessIndex> m_RetiredBindlessTextures;	/**< Unregistered bindless texture indices */
+		std::vector<RetiredBindlessIndex> m_RetiredBindlessSamplers;	/**< Unregistered bindless sampler indices */
+		std::vector<RetiredBindlessIndex> m_RetiredBindlessBuffers;		/**< Unregistered bindless buffer indices */
+		std::unordered_map<Sampler*, BindlessIndex> m_BindlessSamplerIndices;	/**< Bindless indices of registered samplers */
+		std::vector<Sampler*> m_BindlessSamplers;			/**< Registered sampler per bindless index */
+		std::vector<u32> m_BindlessSamplerRefs;				/**< Registration count per bindless sampler index */
 	};
 
 }
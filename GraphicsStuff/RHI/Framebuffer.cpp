@@ -6,6 +6,7 @@ namespace RHI {
 	Framebuffer::Framebuffer()
 		: m_pContext(nullptr)
 		, m_pRenderPass(nullptr)
+		, m_RefCount(0)
 	{
 	}
 
@@ -37,6 +37,25 @@ namespace RHI {
 		 * @return	Render targets
 		 */
 		const std::vector<RenderTarget*>& GetRenderTargets() const { return m_RenderTargets; }
+		/**
+		 * Get the associated render pass
+		 * @return	Render pass
+		 */
+		RenderPass* GetRenderPass() const { return m_pRenderPass; }
+
+		/**
+		 * Increment the framebuffer reference count
+		 */
+		void IncRefs() { ++m_RefCount; }
+		/**
+		 * Decrement the framebuffer reference count
+		 */
+		void DecRefs() { if (m_RefCount > 0) { --m_RefCount; } }
+		/**
+		 * Get the framebuffer's reference count
+		 * @return	Reference count
+		 */
+		u32 GetReferenceCount() const { return m_RefCount; }
 		/**
 		* Get the framebuffer width
 		* @return	Framebuffer width
@@ -55,6 +74,7 @@ namespace RHI {
 
 		u32 m_Width;								/**< Framebuffer height */
 		u32 m_Height;								/**< Framebuffer width */
+		u32 m_RefCount;								/**< Reference count, managed by the render pass cache */
 	};
 
 }
\ No newline at end of file
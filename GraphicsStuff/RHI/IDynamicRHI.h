@@ -9,6 +9,7 @@
 #include "Pipeline.h"
 #include "DescriptorSet.h"
 #include "RHIContext.h"
+#include "MemoryHeap.h"
 
 struct GLFWwindow;
 
@@ -17,6 +18,7 @@ namespace RHI {
 	struct SamplerDesc;
 	struct RenderTargetDesc;
 	class SwapChain;
+	class SparseTextureResidency;
 
 	/**
 	 * RHI description
@@ -87,14 +89,14 @@ namespace RHI {
 		// Render pass																  //
 		////////////////////////////////////////////////////////////////////////////////
 		/**
-		 * Create a render pass
+		 * Create a render pass, render passes with the same signature share a single render pass object
 		 * @param[in] attachments	Render pass attachments
 		 * @param[in] subpasses		Sub render passes
 		 * @return					Pointer to the render pass, nullptr if the creation failed
 		 */
 		virtual RenderPass* CreateRenderPass(const std::vector<RenderPassAttachment>& attachments, const std::vector<SubRenderPass>& subpasses) = 0;
 		/**
-		 * Destroy a render pass
+		 * Destroy a render pass, the render pass object is only destroyed when it's no longer shared
 		 * @param[in] pRenderPass	Render pass to destroy
 		 * @return					True if the render pass was destroyed successfully, false otherwise
 		 */
@@ -126,14 +128,14 @@ namespace RHI {
 		// Framebuffers																  //
 		////////////////////////////////////////////////////////////////////////////////
 		/**
-		 * Create a framebuffer
+		 * Create a framebuffer, framebuffers with the same render pass and render targets are shared
 		 * @param[in] renderTargets		Render targets
 		 * @param[in] pRenderPass		Associated render pass
 		 * @return						Pointer to the framebuffer, nullptr if the creation failed
 		 */
 		virtual Framebuffer* CreateFramebuffer(const std::vector<RenderTarget*>& renderTargets, RenderPass* pRenderPass) = 0;
 		/**
-		 * Destroy a framebuffer
+		 * Destroy a framebuffer, the framebuffer stays cached until one of its render targets or its render pass is destroyed
 		 * @param[in] pFramebuffer	Framebuffer to destroy
 		 * @return					True if the framebuffer was destroyed successfully, false otherwise
 		 */
@@ -152,13 +154,13 @@ namespace RHI {
 		// Samplers																	  //
 		////////////////////////////////////////////////////////////////////////////////
 		/**
-		* Create a sampler
+		* Create a sampler, samplers with the same description share a single sampler object
 		* @param[in] desc	Sampler description
 		* @return			Pointer to the sampler, nullptr if the creation failed
 		*/
 		virtual Sampler* CreateSampler(const SamplerDesc& desc) = 0;
 		/**
-		* Destroy a sampler
+		* Destroy a sampler, the sampler object is only destroyed when it's no longer shared
 		* @param[in] pSampler	Sampler to destroy
 		* @return				True if the sampler was destroyed successfully, false otherwise
 		*/
@@ -232,6 +234,70 @@ namespace RHI {
 		 */
 		virtual b8 DestroyBuffer(Buffer* pBuffer) = 0;
 
+		////////////////////////////////////////////////////////////////////////////////
+		// Memory heaps																  //
+		////////////////////////////////////////////////////////////////////////////////
+		/**
+		 * Create a memory heap, to place resources that are never used at the same time in the same memory
+		 * @param[in] size	Size of the heap
+		 * @return			Pointer to the memory heap, nullptr if the creation failed
+		 * @note			Textures and render targets are placed with the heap and offset in their description
+		 */
+		virtual MemoryHeap* CreateMemoryHeap(u64 size) = 0;
+		/**
+		 * Destroy a memory heap
+		 * @param[in] pHeap	Memory heap to destroy
+		 * @return			True if the memory heap was destroyed successfully, false otherwise
+		 */
+		virtual b8 DestroyMemoryHeap(MemoryHeap* pHeap) = 0;
+		/**
+		 * Create a buffer placed in a memory heap
+		 * @param[in] type			Buffer type
+		 * @param[in] size			Buffer size
+		 * @param[in] flags			Buffer flags, dynamic and readback buffers can't be placed in a heap
+		 * @param[in] pHeap			Memory heap
+		 * @param[in] heapOffset	Offset in the heap, a multiple of the alignment of the memory requirements
+		 * @return					Pointer to the buffer, nullptr if the creation failed
+		 */
+		virtual Buffer* CreatePlacedBuffer(BufferType type, u64 size, BufferFlags flags, MemoryHeap* pHeap, u64 heapOffset) = 0;
+		/**
+		 * Get the memory requirements of a texture placed in a memory heap
+		 * @param[in] desc	Texture description
+		 * @return			Memory requirements, a size of 0 if the texture can't be created
+		 */
+		virtual MemoryRequirements GetMemoryRequirements(const TextureDesc& desc) = 0;
+		/**
+		 * Get the memory requirements of a render target placed in a memory heap
+		 * @param[in] desc	Render target description
+		 * @return			Memory requirements, a size of 0 if the render target can't be created
+		 */
+		virtual MemoryRequirements GetMemoryRequirements(const RenderTargetDesc& desc) = 0;
+		/**
+		 * Get the memory requirements of a buffer placed in a memory heap
+		 * @param[in] type	Buffer type
+		 * @param[in] size	Buffer size
+		 * @param[in] flags	Buffer flags
+		 * @return			Memory requirements, a size of 0 if the buffer can't be created
+		 */
+		virtual MemoryRequirements GetMemoryRequirements(BufferType type, u64 size, BufferFlags flags) = 0;
+
+		////////////////////////////////////////////////////////////////////////////////
+		// Sparse textures															  //
+		////////////////////////////////////////////////////////////////////////////////
+		/**
+		 * Create the tile residency of a sparse texture
+		 * @param[in] pTexture		Texture, created with TextureFlags::Sparse
+		 * @param[in] memoryBudget	Amount of memory the resident tiles and mip tail can use
+		 * @return					Pointer to the sparse texture residency, nullptr if the creation failed
+		 */
+		virtual SparseTextureResidency* CreateSparseTextureResidency(Texture* pTexture, u64 memoryBudget) = 0;
+		/**
+		 * Destroy the tile residency of a sparse texture, needs to happen before the texture is destroyed
+		 * @param[in] pResidency	Sparse texture residency to destroy
+		 * @return					True if the sparse texture residency was destroyed successfully, false otherwise
+		 */
+		virtual b8 DestroySparseTextureResidency(SparseTextureResidency* pResidency) = 0;
+
 		////////////////////////////////////////////////////////////////////////////////
 		// Desriptor sets															  //
 		////////////////////////////////////////////////////////////////////////////////
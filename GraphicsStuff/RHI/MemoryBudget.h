@@ -0,0 +1,33 @@
+// Copyright 2018 Jelte Meganck. All Rights Reserved.
+//
+// MemoryBudget.h: Device memory budgets
+#pragma once
+#include <functional>
+#include "../General/TypesAndMacros.h"
+
+namespace RHI {
+
+	/**
+	 * Usage and budget of a device memory heap
+	 */
+	struct MemoryHeapBudget
+	{
+		u64 size;			/**< Size of the heap */
+		u64 budget;			/**< Amount of memory the process can use before allocations may fail or start paging */
+		u64 usage;			/**< Amount of memory used by the process, including memory not allocated through the RHI when the driver reports it */
+		u64 allocated;		/**< Amount of memory allocated through the RHI */
+		b8 deviceLocal;		/**< If the heap is device local memory */
+	};
+
+	/**
+	 * Eviction callback, called when a heap is about to go over its budget or an allocation failed
+	 * @param[in] heapIndex	Index of the heap that needs memory
+	 * @param[in] size		Amount of memory that should be released
+	 * @return				Amount of memory that was released
+	 * @note				Released resources must not be used by command lists that are still executing
+	 */
+	typedef std::function<u64(u32 heapIndex, u64 size)> MemoryEvictionCallback;
+	typedef u32 MemoryEvictionCallbackHandle;
+	static const MemoryEvictionCallbackHandle InvalidMemoryEvictionCallbackHandle = MemoryEvictionCallbackHandle(-1);
+
+}
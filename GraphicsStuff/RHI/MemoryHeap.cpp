@@ -0,0 +1,16 @@
+
+#include "MemoryHeap.h"
+
+namespace RHI {
+
+
+	MemoryHeap::MemoryHeap()
+		: m_pContext(nullptr)
+		, m_Size(0)
+	{
+	}
+
+	MemoryHeap::~MemoryHeap()
+	{
+	}
+}
@@ -0,0 +1,56 @@
+// Copyright 2018 Jelte Meganck. All Rights Reserved.
+//
+// MemoryHeap.h: Device memory that resources can be placed in
+#pragma once
+#include "../General/TypesAndMacros.h"
+
+namespace RHI {
+	class RHIContext;
+
+	/**
+	 * Memory requirements of a resource placed in a memory heap
+	 */
+	struct MemoryRequirements
+	{
+		u64 size;		/**< Size of the resource in memory */
+		u64 alignment;	/**< Alignment of the offset of the resource in a heap */
+	};
+
+	/**
+	 * Block of device memory that buffers and textures can be placed in at explicit offsets,
+	 * resources that are never used at the same time can be placed at overlapping offsets to share memory
+	 * @note	Only one of the resources that overlap may be in use at a time, switching between them needs an aliasing barrier
+	 * @see		CommandList::AliasingBarrier
+	 */
+	class MemoryHeap
+	{
+	public:
+		MemoryHeap();
+		virtual ~MemoryHeap();
+
+		/**
+		 * Create a memory heap
+		 * @param[in] pContext	RHI context
+		 * @param[in] size		Size of the heap
+		 * @return				True if the heap was created successfully, false otherwise
+		 */
+		virtual b8 Create(RHIContext* pContext, u64 size) = 0;
+		/**
+		 * Destroy the memory heap
+		 * @return	True if the heap was destroyed successfully, false otherwise
+		 * @note	All resources placed in the heap need to be destroyed first
+		 */
+		virtual b8 Destroy() = 0;
+
+		/**
+		 * Get the size of the heap
+		 * @return	Heap size
+		 */
+		u64 GetSize() const { return m_Size; }
+
+	protected:
+		RHIContext* m_pContext;	/**< RHI context */
+		u64 m_Size;				/**< Size of the heap */
+	};
+
+}
@@ -7,6 +7,7 @@ namespace RHI {
 		: m_pContext()
 		, m_Type()
 		, m_GraphicsDesc()
+		, m_ComputeDesc()
 	{
 	}
 
@@ -9,6 +9,7 @@
 #include "DepthStencilDesc.h"
 #include "CommandList.h"
 #include "RasterizerDesc.h"
+#include "RenderingDesc.h"
 #include "TessellationDesc.h"
 #include "Viewport.h"
 #include "ScissorRect.h"
@@ -36,19 +37,23 @@ namespace RHI {
 		BlendStateDesc blendState;								/**< Blend state description */
 		DepthStencilDesc depthStencil;							/**< Depth stencil test */
 		TessellationDesc tesellation;							/**< Tessellation descriptor */
-		DynamicState dynamicState;								/**< Dynamic state */
+		DynamicState dynamicState = DynamicState::Viewport | DynamicState::Scissor;	/**< Dynamic state, viewport and scissor are dynamic by default, so pipelines don't depend on the render target size (extended states still need valid values in the description, as fallback) */
 
 		// TODO: Multi viewport support?
-		Viewport viewport;										/**< Viewport (ignored when viewport is set as dynamic) */
-		ScissorRect scissor;									/**< Scissor rect (ignored when scissor is set as dynamic) */
+		Viewport viewport;										/**< Viewport (ignored when viewport is set as dynamic, set it with CommandList::SetViewport instead) */
+		ScissorRect scissor;									/**< Scissor rect (ignored when scissor is set as dynamic, set it with CommandList::SetScissor instead) */
 
-		RenderPass* pRenderPass;								/**< Render pass */
+		RenderPass* pRenderPass;								/**< Render pass, nullptr when the pipeline is used with CommandList::BeginRendering */
+		RenderingFormats renderingFormats;						/**< Attachment formats (only used when pRenderPass is nullptr) */
 		std::vector<DescriptorSetLayout*> descriptorSetLayouts;	/**< Descriptor sets */
+		u32 pushConstantSize;									/**< Size of the push constant range, visible to all stages (0 for no push constants) */
 	};
 
 	struct ComputePipelineDesc
 	{
-		Shader* pComputeShader;
+		Shader* pComputeShader;									/**< Compute shader */
+		std::vector<DescriptorSetLayout*> descriptorSetLayouts;	/**< Descriptor sets */
+		u32 pushConstantSize;									/**< Size of the push constant range (0 for no push constants) */
 	};
 
 	class Pipeline
@@ -94,16 +99,20 @@ namespace RHI {
 		* @return	Compute pipeline description
 		*/
 		const ComputePipelineDesc& GetComputeDesc() const { return m_ComputeDesc; }
+		/**
+		 * Check if a state is dynamic for the pipeline
+		 * @param[in] state	Dynamic state
+		 * @return			True if all given states are dynamic, false otherwise (always false for compute pipelines)
+		 * @note			Extended dynamic states are only dynamic when the backend supports them, otherwise they are baked into the pipeline
+		 */
+		b8 IsDynamic(DynamicState state) const { return m_Type == PipelineType::Graphics && (m_GraphicsDesc.dynamicState & state) == state; }
 
 	protected:
 		RHIContext* m_pContext;	/**< RHI context */
 		PipelineType m_Type;			/**< Pipeline type */
 
-		union
-		{
-			GraphicsPipelineDesc m_GraphicsDesc;
-			ComputePipelineDesc m_ComputeDesc;
-		};
+		GraphicsPipelineDesc m_GraphicsDesc;	/**< Graphics pipeline description (graphics pipelines only) */
+		ComputePipelineDesc m_ComputeDesc;		/**< Compute pipeline description (compute pipelines only) */
 	};
 
 }
@@ -64,6 +64,7 @@ namespace RHI {
 		Dynamic = 0x02, /**< Dynamic buffer, data will be changed often (incompatible with static) */
 		NoWrite = 0x04,	/**< Disable buffer write */
 		NoRead = 0x08,	/**< Disable buffer read */
+		Readback = 0x10,	/**< Buffer is mostly read back by the cpu, host visible memory will prefer cpu cached memory */
 	};
 	ENABLE_ENUM_FLAG_OPERATORS(BufferFlags);
 
@@ -80,7 +81,7 @@ namespace RHI {
 		UInt = sizeof(u32)		/**< Unsigned int */
 	};
 
-	enum class TextureFlags : u8
+	enum class TextureFlags : u16
 	{
 		None = 0x00,		/**< No flags */
 		Dynamic = 0x01,		/**< Dynamic texture, changed often (while this may be benifitial for copying data, the user needs to check if this doesn't impact their performace to much, since this flag does not guarantee an optimal layout on the GPU) */
@@ -93,6 +94,8 @@ namespace RHI {
 		RenderTargetable = 0x20,	/**< [INTERNAL] If the texture can be used as a the underlying texture for a rendertarget */
 		Color = 0x40,				/**< [INTERNAL] If the texture can be used as a the underlying texture for a color attachment */
 		DepthStencil = 0x80,		/**< [INTERNAL] If the texture can be used as a the underlying texture for a depth stencil attachment */
+		Transient = 0x100,			/**< [INTERNAL] Attachment contents are never loaded or stored, so its memory can be lazily allocated or shared with other transient attachments */
+		Sparse = 0x200,				/**< Texture memory is bound per tile by a sparse texture residency instead of for the whole texture at once */
 	};
 	ENABLE_ENUM_FLAG_OPERATORS(TextureFlags);
 
@@ -268,7 +271,13 @@ namespace RHI {
 		DepthBounds = 0x0040,
 		StencilCompareMask = 0x0080,
 		StencilWriteMask = 0x0100,
-		StencilReference = 0x0200
+		StencilReference = 0x0200,
+		CullMode = 0x0400,				/**< Cull mode (extended dynamic state) */
+		FrontFace = 0x0800,				/**< Front face (extended dynamic state) */
+		PrimitiveTopology = 0x1000,		/**< Primitive topology (extended dynamic state), the topology set must be of the same class (point, line, triangle or patch) as the pipeline's */
+		DepthTest = 0x2000,				/**< Depth test enable, depth write enable and depth compare op (extended dynamic state) */
+		StencilTest = 0x4000,			/**< Stencil test enable and stencil ops (extended dynamic state) */
+		Extended = CullMode | FrontFace | PrimitiveTopology | DepthTest | StencilTest,	/**< All extended dynamic state, these are baked into the pipeline when extended dynamic state is unsupported */
 	};
 	ENABLE_ENUM_FLAG_OPERATORS(DynamicState);
 
@@ -483,5 +492,28 @@ namespace RHI {
 		u32 reference;			/**< Reference value to compare to */
 	};
 
+	/**
+	 * Layout of a single non-indexed indirect draw, as read from an indirect buffer
+	 */
+	struct DrawIndirectCommand
+	{
+		u32 vertexCount;		/**< Amount of vertices to draw */
+		u32 instanceCount;		/**< Amount of instances to draw */
+		u32 firstVertex;		/**< Index of vertex to start drawing from */
+		u32 firstInstance;		/**< Index of instance to start drawing from */
+	};
+
+	/**
+	 * Layout of a single indexed indirect draw, as read from an indirect buffer
+	 */
+	struct DrawIndexedIndirectCommand
+	{
+		u32 indexCount;			/**< Amount of indices to draw */
+		u32 instanceCount;		/**< Amount of instances to draw */
+		u32 firstIndex;			/**< Index of index to start drawing from */
+		i32 vertexOffset;		/**< Offset in vertex buffer (index n == vertex at offset + n) */
+		u32 firstInstance;		/**< Index of instance to start drawing from */
+	};
+
 	
 }
\ No newline at end of file
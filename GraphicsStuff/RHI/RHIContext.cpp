@@ -1,12 +1,18 @@
 
 #include "RHIContext.h"
 #include "Queue.h"
+#include "RenderPassCache.h"
 
 namespace RHI {
 
 	RHIContext::RHIContext()
 		: m_pCommandListManager(nullptr)
 		, m_pDescriptorSetManager(nullptr)
+		, m_pSamplerCache(nullptr)
+		, m_pRenderPassCache(nullptr)
+		, m_NextEvictionCallbackHandle(0)
+		, m_IsEvicting(false)
+		, m_FrameIndex(0)
 	{
 	}
 
@@ -36,4 +42,49 @@ namespace RHI {
 		}
 		return pOutQueue;
 	}
+
+	void RHIContext::NextFrame()
+	{
+		++m_FrameIndex;
+
+		// The render pass cache has no per-frame call of its own, and this is the point where the frames retired framebuffers wait for can complete
+		if (m_pRenderPassCache)
+			m_pRenderPassCache->ReleaseRetiredFramebuffers(false);
+	}
+
+	MemoryEvictionCallbackHandle RHIContext::RegisterEvictionCallback(const MemoryEvictionCallback& callback)
+	{
+		MemoryEvictionCallbackHandle handle = m_NextEvictionCallbackHandle++;
+		m_EvictionCallbacks.push_back(std::make_pair(handle, callback));
+		return handle;
+	}
+
+	void RHIContext::UnregisterEvictionCallback(MemoryEvictionCallbackHandle handle)
+	{
+		for (auto it = m_EvictionCallbacks.begin(); it != m_EvictionCallbacks.end(); ++it)
+		{
+			if (it->first == handle)
+			{
+				m_EvictionCallbacks.erase(it);
+				return;
+			}
+		}
+	}
+
+	u64 RHIContext::RequestEviction(u32 heapIndex, u64 size)
+	{
+		// Callbacks free memory, which must not recursively trigger more eviction
+		if (m_IsEvicting)
+			return 0;
+		m_IsEvicting = true;
+
+		u64 released = 0;
+		for (sizeT i = 0; i < m_EvictionCallbacks.size() && released < size; ++i)
+		{
+			released += m_EvictionCallbacks[i].second(heapIndex, size - released);
+		}
+
+		m_IsEvicting = false;
+		return released;
+	}
 }
@@ -2,9 +2,11 @@
 //
 // RHIContext.h: RHI Context
 #pragma once
+#include <string>
 #include <vector>
 #include "../General/TypesAndMacros.h"
 #include "RHICommon.h"
+#include "MemoryBudget.h"
 
 struct GLFWwindow;
 
@@ -13,6 +15,13 @@ namespace RHI {
 	class Queue;
 	class CommandListManager;
 	class DescriptorSetManager;
+	class SamplerCache;
+	class RenderPassCache;
+
+	/**
+	 * Maximum amount of frames the gpu can lag behind the cpu, resources used in a frame can only be released this many frames later
+	 */
+	static const u32 MaxFramesInFlight = 3;
 
 	/**
 	 * RHI Context, contains data for the creation and use of RHI Objects
@@ -50,12 +59,94 @@ namespace RHI {
 		 * @return	Descriptor set manager
 		 */
 		DescriptorSetManager* GetDescriptorSetManager() { return m_pDescriptorSetManager; }
+		/**
+		 * Get the sampler cache
+		 * @return	Sampler cache
+		 */
+		SamplerCache* GetSamplerCache() { return m_pSamplerCache; }
+		/**
+		 * Get the render pass and framebuffer cache
+		 * @return	Render pass cache
+		 */
+		RenderPassCache* GetRenderPassCache() { return m_pRenderPassCache; }
+		/**
+		 * Get the minimum alignment of an offset in a buffer when binding it in a descriptor set
+		 * @param[in] type	Buffer type
+		 * @return			Minimum offset alignment, a power of 2
+		 */
+		virtual u64 GetBufferOffsetAlignment(BufferType type) = 0;
+
+		/**
+		 * Advance the frame counter and release the cached objects retired by completed frames,
+		 * should be called once per frame, after waiting for the frame MaxFramesInFlight frames ago and before recording new work
+		 */
+		void NextFrame();
+		/**
+		 * Get the current frame
+		 * @return	Frame index
+		 */
+		u64 GetFrameIndex() const { return m_FrameIndex; }
+		/**
+		 * Check if the gpu finished all work of a frame
+		 * @param[in] frame	Frame index
+		 * @return			True if the frame is more than MaxFramesInFlight frames old, false otherwise
+		 */
+		b8 IsFrameComplete(u64 frame) const { return m_FrameIndex >= frame + MaxFramesInFlight; }
+
+		/**
+		 * Update the memory heap usage and budgets, should be called once per frame
+		 */
+		virtual void UpdateMemoryBudgets() = 0;
+		/**
+		 * Move resources out of sparsely used device memory, so it can be released, should be called once per frame
+		 * @param[in] maxBytes	Maximum amount of bytes to copy this frame
+		 * @note				Moves finish a few frames later, resources that are written by the gpu or bound in sets that are in use aren't moved
+		 */
+		virtual void DefragmentMemory(u64 maxBytes) = 0;
+		/**
+		 * Write the memory statistics and a listing of all allocations to a json file, to track down memory regressions
+		 * @param[in] filePath	Path of the json file
+		 * @return				True if the file was written successfully, false otherwise
+		 * @note				Allocations are identified by the debug name of the buffer or texture they belong to
+		 */
+		virtual b8 DumpMemoryJson(const std::string& filePath) = 0;
+		/**
+		 * Get the memory heap usage and budgets, as of the last update
+		 * @return	Memory heap budgets, indexed by heap
+		 */
+		const std::vector<MemoryHeapBudget>& GetMemoryBudgets() const { return m_MemoryBudgets; }
+		/**
+		 * Register a callback to release memory when a heap runs out of budget
+		 * @param[in] callback	Eviction callback
+		 * @return				Handle to unregister the callback with
+		 */
+		MemoryEvictionCallbackHandle RegisterEvictionCallback(const MemoryEvictionCallback& callback);
+		/**
+		 * Unregister an eviction callback
+		 * @param[in] handle	Handle of the callback
+		 */
+		void UnregisterEvictionCallback(MemoryEvictionCallbackHandle handle);
+		/**
+		 * Ask the eviction callbacks to release memory from a heap, callbacks are called in registration order until enough memory was released
+		 * @param[in] heapIndex	Index of the heap
+		 * @param[in] size		Amount of memory to release
+		 * @return				Amount of memory that was released
+		 */
+		u64 RequestEviction(u32 heapIndex, u64 size);
 
 	protected:
 		CommandListManager* m_pCommandListManager;		/**< Command list manager */
 		DescriptorSetManager* m_pDescriptorSetManager;	/**< Descriptor set manager */
+		SamplerCache* m_pSamplerCache;					/**< Sampler cache */
+		RenderPassCache* m_pRenderPassCache;			/**< Render pass and framebuffer cache */
 		std::vector<Queue*> m_Queues;						/**< Device queues */
 
+		std::vector<MemoryHeapBudget> m_MemoryBudgets;		/**< Memory heap budgets, as of the last update */
+		std::vector<std::pair<MemoryEvictionCallbackHandle, MemoryEvictionCallback>> m_EvictionCallbacks;	/**< Eviction callbacks in registration order */
+		MemoryEvictionCallbackHandle m_NextEvictionCallbackHandle;	/**< Handle of the next registered eviction callback */
+		b8 m_IsEvicting;									/**< If the eviction callbacks are being called */
+		u64 m_FrameIndex;									/**< Current frame */
+
 	};
 
 }
@@ -1,15 +1,82 @@
 
 #include "RenderPass.h"
+#include "../General/Hash.h"
 
 namespace RHI {
 
 
 	RenderPass::RenderPass()
 		: m_pContext(nullptr)
+		, m_RefCount(0)
 	{
 	}
 
 	RenderPass::~RenderPass()
 	{
 	}
+
+	u64 RenderPass::HashSignature(const std::vector<RenderPassAttachment>& attachments, const std::vector<SubRenderPass>& subpasses)
+	{
+		u64 hash = Hash::Combine(0xCBF2'9CE4'8422'2325, u32(attachments.size()));
+		for (const RenderPassAttachment& attachment : attachments)
+		{
+			hash = Hash::Combine(hash, attachment.format.components);
+			hash = Hash::Combine(hash, attachment.format.transform);
+			hash = Hash::Combine(hash, attachment.samples);
+			hash = Hash::Combine(hash, attachment.type);
+			hash = Hash::Combine(hash, attachment.loadOp);
+			hash = Hash::Combine(hash, attachment.storeOp);
+			hash = Hash::Combine(hash, attachment.stencilLoadOp);
+			hash = Hash::Combine(hash, attachment.stencilStoreOp);
+		}
+		hash = Hash::Combine(hash, u32(subpasses.size()));
+		for (const SubRenderPass& subpass : subpasses)
+		{
+			hash = Hash::Combine(hash, u32(subpass.attachments.size()));
+			for (const RenderPassAttachmentRef& ref : subpass.attachments)
+			{
+				hash = Hash::Combine(hash, ref.index);
+				hash = Hash::Combine(hash, ref.type);
+			}
+		}
+		return hash;
+	}
+
+	b8 RenderPass::Matches(const std::vector<RenderPassAttachment>& attachments, const std::vector<SubRenderPass>& subpasses) const
+	{
+		if (attachments.size() != m_Attachments.size() || subpasses.size() != m_SubPasses.size())
+			return false;
+
+		for (sizeT i = 0; i < m_Attachments.size(); ++i)
+		{
+			const RenderPassAttachment& attachment0 = m_Attachments[i];
+			const RenderPassAttachment& attachment1 = attachments[i];
+
+			if (!(attachment0.format == attachment1.format) ||
+				attachment0.samples != attachment1.samples ||
+				attachment0.type != attachment1.type ||
+				attachment0.loadOp != attachment1.loadOp ||
+				attachment0.storeOp != attachment1.storeOp ||
+				attachment0.stencilLoadOp != attachment1.stencilLoadOp ||
+				attachment0.stencilStoreOp != attachment1.stencilStoreOp)
+			{
+				return false;
+			}
+		}
+
+		for (sizeT i = 0; i < m_SubPasses.size(); ++i)
+		{
+			const std::vector<RenderPassAttachmentRef>& refs0 = m_SubPasses[i].attachments;
+			const std::vector<RenderPassAttachmentRef>& refs1 = subpasses[i].attachments;
+			if (refs0.size() != refs1.size())
+				return false;
+
+			for (sizeT j = 0; j < refs0.size(); ++j)
+			{
+				if (refs0[j].index != refs1[j].index || refs0[j].type != refs1[j].type)
+					return false;
+			}
+		}
+		return true;
+	}
 }
@@ -54,10 +54,51 @@ namespace RHI {
 		 */
 		virtual b8 Destroy() = 0;
 
+		/**
+		 * Calculate the hash of a render pass signature, covering the attachment formats, sample counts, load/store ops and subpasses
+		 * @param[in] attachments	Attachments
+		 * @param[in] subpasses		Sub passes
+		 * @return					Hash
+		 */
+		static u64 HashSignature(const std::vector<RenderPassAttachment>& attachments, const std::vector<SubRenderPass>& subpasses);
+		/**
+		 * Check if attachments and subpasses match the render pass
+		 * @param[in] attachments	Attachments
+		 * @param[in] subpasses		Sub passes
+		 * @return					True if the attachments and subpasses match, false otherwise
+		 */
+		b8 Matches(const std::vector<RenderPassAttachment>& attachments, const std::vector<SubRenderPass>& subpasses) const;
+
+		/**
+		 * Get the render pass attachments
+		 * @return	Attachments
+		 */
+		const std::vector<RenderPassAttachment>& GetAttachments() const { return m_Attachments; }
+		/**
+		 * Get the render pass subpasses
+		 * @return	Sub passes
+		 */
+		const std::vector<SubRenderPass>& GetSubPasses() const { return m_SubPasses; }
+
+		/**
+		 * Increment the render pass reference count
+		 */
+		void IncRefs() { ++m_RefCount; }
+		/**
+		 * Decrement the render pass reference count
+		 */
+		void DecRefs() { if (m_RefCount > 0) { --m_RefCount; } }
+		/**
+		 * Get the render pass' reference count
+		 * @return	Reference count
+		 */
+		u32 GetReferenceCount() const { return m_RefCount; }
+
 	protected:
 		RHIContext* m_pContext;					/**< RHI context */
 		std::vector<RenderPassAttachment> m_Attachments;	/**< Render pass attachments */
 		std::vector<SubRenderPass> m_SubPasses;			/**< Subpasses */
+		u32 m_RefCount;							/**< Reference count, managed by the render pass cache */
 	};
 
 }
@@ -0,0 +1,193 @@
+
+#include <algorithm>
+#include "RenderPassCache.h"
+#include "RenderTarget.h"
+#include "RHIContext.h"
+#include "../General/Hash.h"
+
+namespace RHI {
+
+	RenderPassCache::RenderPassCache()
+		: m_pContext(nullptr)
+	{
+	}
+
+	RenderPassCache::~RenderPassCache()
+	{
+	}
+
+	RenderPass* RenderPassCache::GetRenderPass(const std::vector<RenderPassAttachment>& attachments, const std::vector<SubRenderPass>& subpasses)
+	{
+		u64 hash = RenderPass::HashSignature(attachments, subpasses);
+		auto range = m_RenderPasses.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second->Matches(attachments, subpasses))
+			{
+				it->second->IncRefs();
+				return it->second;
+			}
+		}
+
+		RenderPass* pRenderPass = CreateRenderPassObject(attachments, subpasses);
+		if (!pRenderPass)
+			return nullptr;
+
+		pRenderPass->IncRefs();
+		m_RenderPasses.insert({ hash, pRenderPass });
+		return pRenderPass;
+	}
+
+	b8 RenderPassCache::ReleaseRenderPass(RenderPass* pRenderPass)
+	{
+		if (!pRenderPass)
+			return false;
+
+		pRenderPass->DecRefs();
+		if (pRenderPass->GetReferenceCount() > 0)
+			return true;
+
+		auto range = m_RenderPasses.equal_range(RenderPass::HashSignature(pRenderPass->GetAttachments(), pRenderPass->GetSubPasses()));
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second == pRenderPass)
+			{
+				m_RenderPasses.erase(it);
+				break;
+			}
+		}
+
+		// Framebuffers can't outlive their render pass
+		for (auto it = m_Framebuffers.begin(); it != m_Framebuffers.end();)
+		{
+			if (it->second.pRenderPass == pRenderPass)
+			{
+				it->second.pFramebuffer->Destroy();
+				delete it->second.pFramebuffer;
+				it = m_Framebuffers.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		b8 res = pRenderPass->Destroy();
+		delete pRenderPass;
+		return res;
+	}
+
+	RenderPass* RenderPassCache::GetPersistentRenderPass(const std::vector<RenderPassAttachment>& attachments, const std::vector<SubRenderPass>& subpasses)
+	{
+		RenderPass* pRenderPass = GetRenderPass(attachments, subpasses);
+		if (!pRenderPass)
+			return nullptr;
+
+		// The cache only holds a single reference to each persistent render pass
+		if (std::find(m_PersistentRenderPasses.begin(), m_PersistentRenderPasses.end(), pRenderPass) != m_PersistentRenderPasses.end())
+			pRenderPass->DecRefs();
+		else
+			m_PersistentRenderPasses.push_back(pRenderPass);
+		return pRenderPass;
+	}
+
+	Framebuffer* RenderPassCache::GetFramebuffer(const std::vector<RenderTarget*>& renderTargets, RenderPass* pRenderPass)
+	{
+		std::vector<Texture*> textures;
+		textures.reserve(renderTargets.size());
+		for (RenderTarget* pRT : renderTargets)
+		{
+			textures.push_back(pRT->GetTexture());
+		}
+
+		u64 hash = Hash::Combine(0xCBF2'9CE4'8422'2325, pRenderPass);
+		hash = Hash::Fnv1a(textures.data(), textures.size() * sizeof(Texture*), hash);
+
+		auto range = m_Framebuffers.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			FramebufferEntry& entry = it->second;
+			if (entry.pRenderPass == pRenderPass && entry.textures == textures)
+			{
+				entry.pFramebuffer->IncRefs();
+				return entry.pFramebuffer;
+			}
+		}
+
+		Framebuffer* pFramebuffer = CreateFramebufferObject(renderTargets, pRenderPass);
+		if (!pFramebuffer)
+			return nullptr;
+
+		pFramebuffer->IncRefs();
+		FramebufferEntry entry;
+		entry.pRenderPass = pRenderPass;
+		entry.textures = textures;
+		entry.pFramebuffer = pFramebuffer;
+		m_Framebuffers.insert({ hash, entry });
+		return pFramebuffer;
+	}
+
+	b8 RenderPassCache::ReleaseFramebuffer(Framebuffer* pFramebuffer)
+	{
+		// The framebuffer may already have been evicted, so only compare pointers
+		for (std::pair<const u64, FramebufferEntry>& pair : m_Framebuffers)
+		{
+			if (pair.second.pFramebuffer == pFramebuffer)
+			{
+				pFramebuffer->DecRefs();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void RenderPassCache::InvalidateFramebuffers(Texture* pTexture)
+	{
+		for (auto it = m_Framebuffers.begin(); it != m_Framebuffers.end();)
+		{
+			const std::vector<Texture*>& textures = it->second.textures;
+			if (std::find(textures.begin(), textures.end(), pTexture) != textures.end())
+			{
+				m_RetiredFramebuffers.push_back({ it->second.pFramebuffer, m_pContext->GetFrameIndex() });
+				it = m_Framebuffers.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	void RenderPassCache::ReleaseRetiredFramebuffers(b8 force)
+	{
+		// Framebuffers are retired in frame order, so the completed ones are at the front
+		sizeT count = 0;
+		while (count < m_RetiredFramebuffers.size() && (force || m_pContext->IsFrameComplete(m_RetiredFramebuffers[count].frame)))
+		{
+			m_RetiredFramebuffers[count].pFramebuffer->Destroy();
+			delete m_RetiredFramebuffers[count].pFramebuffer;
+			++count;
+		}
+		m_RetiredFramebuffers.erase(m_RetiredFramebuffers.begin(), m_RetiredFramebuffers.begin() + count);
+	}
+
+	void RenderPassCache::DestroyObjects()
+	{
+		ReleaseRetiredFramebuffers(true);
+		for (std::pair<const u64, FramebufferEntry>& pair : m_Framebuffers)
+		{
+			pair.second.pFramebuffer->Destroy();
+			delete pair.second.pFramebuffer;
+		}
+		m_Framebuffers.clear();
+
+		for (std::pair<const u64, RenderPass*>& pair : m_RenderPasses)
+		{
+			pair.second->Destroy();
+			delete pair.second;
+		}
+		m_RenderPasses.clear();
+		m_PersistentRenderPasses.clear();
+	}
+
+}
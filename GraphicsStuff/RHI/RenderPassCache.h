@@ -0,0 +1,129 @@
+// Copyright 2018 Jelte Meganck. All Rights Reserved.
+//
+// RenderPassCache.h: Render pass and framebuffer cache
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "../General/TypesAndMacros.h"
+#include "RenderPass.h"
+#include "Framebuffer.h"
+
+namespace RHI {
+	class RHIContext;
+	class Texture;
+
+	/**
+	 * Render pass and framebuffer cache
+	 * Render passes are shared by attachment signature, framebuffers by render pass and attachment textures
+	 */
+	class RenderPassCache
+	{
+	public:
+		RenderPassCache();
+		virtual ~RenderPassCache();
+
+		/**
+		 * Create the render pass cache
+		 * @param[in] pContext	RHI context
+		 * @return				True if the render pass cache was created successfully, false otherwise
+		 */
+		virtual b8 Create(RHIContext* pContext) = 0;
+		/**
+		 * Destroy the render pass cache and all render passes and framebuffers in it
+		 * @return	True if the render pass cache was destroyed successfully, false otherwise
+		 */
+		virtual b8 Destroy() = 0;
+
+		/**
+		 * Get a render pass, creating it if no render pass with the same signature exists, and add a reference to it
+		 * @param[in] attachments	Attachments
+		 * @param[in] subpasses		Sub passes
+		 * @return					Pointer to a render pass, nullptr if the creation failed
+		 */
+		RenderPass* GetRenderPass(const std::vector<RenderPassAttachment>& attachments, const std::vector<SubRenderPass>& subpasses);
+		/**
+		 * Release a reference to a render pass, the render pass and its framebuffers are destroyed when it's no longer referenced
+		 * @param[in] pRenderPass	Render pass to release
+		 * @return					True if the render pass was released successfully, false otherwise
+		 */
+		b8 ReleaseRenderPass(RenderPass* pRenderPass);
+		/**
+		 * Get a render pass that is kept alive by the cache until it is destroyed, without adding a reference to it
+		 * @param[in] attachments	Attachments
+		 * @param[in] subpasses		Sub passes
+		 * @return					Pointer to a render pass, nullptr if the creation failed
+		 * @note					Used for render passes created internally, e.g. when emulating dynamic rendering
+		 */
+		RenderPass* GetPersistentRenderPass(const std::vector<RenderPassAttachment>& attachments, const std::vector<SubRenderPass>& subpasses);
+
+		/**
+		 * Get a framebuffer, creating it if no framebuffer for the render pass and render target textures exists, and add a reference to it
+		 * @param[in] renderTargets	Render targets
+		 * @param[in] pRenderPass	Associated render pass
+		 * @return					Pointer to a framebuffer, nullptr if the creation failed
+		 */
+		Framebuffer* GetFramebuffer(const std::vector<RenderTarget*>& renderTargets, RenderPass* pRenderPass);
+		/**
+		 * Release a reference to a framebuffer, unreferenced framebuffers stay cached until one of their textures or their render pass is destroyed
+		 * @param[in] pFramebuffer	Framebuffer to release
+		 * @return					True if the framebuffer was released successfully, false otherwise
+		 */
+		b8 ReleaseFramebuffer(Framebuffer* pFramebuffer);
+		/**
+		 * Remove all framebuffers using a texture from the cache, they are destroyed once the frames in flight that could use them have completed
+		 * @param[in] pTexture	Texture that is about to be destroyed
+		 */
+		void InvalidateFramebuffers(Texture* pTexture);
+		/**
+		 * Destroy the invalidated framebuffers the gpu doesn't use anymore, should be called once per frame
+		 * @param[in] force	If all invalidated framebuffers should be destroyed, only allowed when the device is idle
+		 */
+		void ReleaseRetiredFramebuffers(b8 force);
+
+	protected:
+		/**
+		 * Cached framebuffer
+		 */
+		struct FramebufferEntry
+		{
+			RenderPass* pRenderPass;			/**< Render pass */
+			std::vector<Texture*> textures;		/**< Attachment textures */
+			Framebuffer* pFramebuffer;			/**< Framebuffer */
+		};
+
+		/**
+		 * Invalidated framebuffer, which frames in flight might still use
+		 */
+		struct RetiredFramebuffer
+		{
+			Framebuffer* pFramebuffer;			/**< Framebuffer */
+			u64 frame;							/**< Frame in which the framebuffer was invalidated */
+		};
+
+		/**
+		 * Create a new render pass object
+		 * @param[in] attachments	Attachments
+		 * @param[in] subpasses		Sub passes
+		 * @return					Pointer to a render pass, nullptr if the creation failed
+		 */
+		virtual RenderPass* CreateRenderPassObject(const std::vector<RenderPassAttachment>& attachments, const std::vector<SubRenderPass>& subpasses) = 0;
+		/**
+		 * Create a new framebuffer object
+		 * @param[in] renderTargets	Render targets
+		 * @param[in] pRenderPass	Associated render pass
+		 * @return					Pointer to a framebuffer, nullptr if the creation failed
+		 */
+		virtual Framebuffer* CreateFramebufferObject(const std::vector<RenderTarget*>& renderTargets, RenderPass* pRenderPass) = 0;
+		/**
+		 * Destroy all render passes and framebuffers in the cache
+		 */
+		void DestroyObjects();
+
+		RHIContext* m_pContext;												/**< RHI context */
+		std::unordered_multimap<u64, RenderPass*> m_RenderPasses;			/**< Render passes by signature hash */
+		std::unordered_multimap<u64, FramebufferEntry> m_Framebuffers;		/**< Framebuffers by hash of their render pass and textures */
+		std::vector<RenderPass*> m_PersistentRenderPasses;					/**< Render passes the cache holds a reference to */
+		std::vector<RetiredFramebuffer> m_RetiredFramebuffers;				/**< Invalidated framebuffers, in invalidation order */
+	};
+
+}
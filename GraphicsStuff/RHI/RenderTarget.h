@@ -10,6 +10,7 @@
 
 namespace RHI {
 	class RHIContext;
+	class MemoryHeap;
 
 	struct RenderTargetDesc
 	{
@@ -18,6 +19,9 @@ namespace RHI {
 		PixelFormat format		= PixelFormat();			/**< Format */
 		SampleCount samples		= SampleCount::Sample1;		/**< Sample count */
 		RenderTargetType type	= RenderTargetType::None;	/**< Type */
+		b8 transient			= false;					/**< Contents are never loaded, stored or sampled, so it doesn't need to be backed by real memory, transient render targets with the same description may share memory, so they can't be used in the same rendering pass (BeginRendering only) */
+		MemoryHeap* pHeap		= nullptr;					/**< Heap to place the render target in, nullptr to allocate its own memory */
+		u64 heapOffset			= 0;						/**< Offset in the heap, a multiple of the alignment of the memory requirements */
 	};
 
 	class RenderTarget
@@ -0,0 +1,37 @@
+// Copyright 2018 Jelte Meganck. All Rights Reserved.
+//
+// RenderingDesc.h: Render pass-less rendering descriptors
+#pragma once
+#include "../General/TypesAndMacros.h"
+#include "PixelFormat.h"
+#include "RHICommon.h"
+
+namespace RHI {
+	class RenderTarget;
+
+	constexpr u32 MaxRenderingColorAttachments = 8;	/**< Max amount of color attachments when rendering without a render pass */
+
+	struct RenderingAttachment
+	{
+		RenderTarget* pRenderTarget	= nullptr;				/**< Render target, the clear value is taken from the render target */
+		LoadOp loadOp				= LoadOp::DontCare;		/**< Load op */
+		StoreOp storeOp				= StoreOp::DontCare;	/**< Store op */
+		LoadOp stencilLoadOp		= LoadOp::DontCare;		/**< Stencil load op (depth stencil only) */
+		StoreOp stencilStoreOp		= StoreOp::DontCare;	/**< Stencil store op (depth stencil only) */
+	};
+
+	struct RenderingDesc
+	{
+		RenderingAttachment colorAttachments[MaxRenderingColorAttachments];	/**< Color attachments */
+		u32 colorAttachmentCount = 0;										/**< Amount of color attachments */
+		RenderingAttachment depthStencilAttachment;							/**< Depth stencil attachment (pRenderTarget is nullptr when unused) */
+	};
+
+	struct RenderingFormats
+	{
+		PixelFormat colorFormats[MaxRenderingColorAttachments];	/**< Color attachment formats */
+		u32 colorFormatCount = 0;								/**< Amount of color attachments */
+		PixelFormat depthStencilFormat = PixelFormat();			/**< Depth stencil format (PixelFormat() when unused) */
+	};
+
+}
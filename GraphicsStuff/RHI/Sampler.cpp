@@ -1,5 +1,6 @@
 
 #include "Sampler.h"
+#include "../General/Hash.h"
 
 namespace RHI {
 
@@ -7,10 +8,49 @@ namespace RHI {
 	Sampler::Sampler()
 		: m_pContext(nullptr)
 		, m_Desc()
+		, m_RefCount(0)
 	{
 	}
 
 	Sampler::~Sampler()
 	{
 	}
+
+	u64 SamplerDesc::GetHash() const
+	{
+		// Hash members separately, SamplerDesc contains padding
+		u64 hash = Hash::Combine(0xCBF2'9CE4'8422'2325, magFilter);
+		hash = Hash::Combine(hash, minFilter);
+		hash = Hash::Combine(hash, addressU);
+		hash = Hash::Combine(hash, addressV);
+		hash = Hash::Combine(hash, addressW);
+		hash = Hash::Combine(hash, enableAnisotropy);
+		hash = Hash::Combine(hash, anisotropy);
+		hash = Hash::Combine(hash, enableCompare);
+		hash = Hash::Combine(hash, compareOp);
+		hash = Hash::Combine(hash, mipLodBias);
+		hash = Hash::Combine(hash, minLod);
+		hash = Hash::Combine(hash, maxLod);
+		hash = Hash::Combine(hash, borderColor);
+		hash = Hash::Combine(hash, unnormalizedCoordinates);
+		return hash;
+	}
+
+	b8 SamplerDesc::operator==(const SamplerDesc& desc) const
+	{
+		return magFilter == desc.magFilter &&
+			minFilter == desc.minFilter &&
+			addressU == desc.addressU &&
+			addressV == desc.addressV &&
+			addressW == desc.addressW &&
+			enableAnisotropy == desc.enableAnisotropy &&
+			anisotropy == desc.anisotropy &&
+			enableCompare == desc.enableCompare &&
+			compareOp == desc.compareOp &&
+			mipLodBias == desc.mipLodBias &&
+			minLod == desc.minLod &&
+			maxLod == desc.maxLod &&
+			borderColor == desc.borderColor &&
+			unnormalizedCoordinates == desc.unnormalizedCoordinates;
+	}
 }
@@ -41,6 +41,18 @@ namespace RHI {
 		 * @param[in] addressMode	Address mode
 		 */
 		void SetAddressMode(AddressMode addressMode) { addressU = addressV = addressW = addressMode; }
+
+		/**
+		 * Calculate the hash of the sampler description
+		 * @return	Hash
+		 */
+		u64 GetHash() const;
+		/**
+		 * Check if 2 sampler descriptions are equal
+		 * @param[in] desc	Sampler description
+		 * @return			True if the descriptions are equal, false otherwise
+		 */
+		b8 operator==(const SamplerDesc& desc) const;
 	};
 
 	class Sampler
@@ -62,9 +74,30 @@ namespace RHI {
 		 */
 		virtual b8 Destroy() = 0;
 
+		/**
+		 * Get the sampler description
+		 * @return	Sampler description
+		 */
+		const SamplerDesc& GetDesc() const { return m_Desc; }
+
+		/**
+		 * Increment the sampler reference count
+		 */
+		void IncRefs() { ++m_RefCount; }
+		/**
+		 * Decrement the sampler reference count
+		 */
+		void DecRefs() { if (m_RefCount > 0) { --m_RefCount; } }
+		/**
+		 * Get the sampler's reference count
+		 * @return	Reference count
+		 */
+		u32 GetReferenceCount() const { return m_RefCount; }
+
 	protected:
 		RHIContext* m_pContext;	/**< RHI context */
 		SamplerDesc m_Desc;				/**< Sampler description */
+		u32 m_RefCount;					/**< Reference count, managed by the sampler cache */
 	};
 
 }
@@ -0,0 +1,76 @@
+
+#include "SamplerCache.h"
+#include "RHIContext.h"
+#include "DescriptorSetManager.h"
+
+namespace RHI {
+
+	SamplerCache::SamplerCache()
+		: m_pContext(nullptr)
+	{
+	}
+
+	SamplerCache::~SamplerCache()
+	{
+	}
+
+	Sampler* SamplerCache::GetSampler(const SamplerDesc& desc)
+	{
+		u64 hash = desc.GetHash();
+		auto range = m_Samplers.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second->GetDesc() == desc)
+			{
+				it->second->IncRefs();
+				return it->second;
+			}
+		}
+
+		Sampler* pSampler = CreateSamplerObject(desc);
+		if (!pSampler)
+			return nullptr;
+
+		pSampler->IncRefs();
+		m_Samplers.insert({ hash, pSampler });
+		return pSampler;
+	}
+
+	b8 SamplerCache::ReleaseSampler(Sampler* pSampler)
+	{
+		if (!pSampler)
+			return false;
+
+		pSampler->DecRefs();
+		if (pSampler->GetReferenceCount() > 0)
+			return true;
+
+		auto range = m_Samplers.equal_range(pSampler->GetDesc().GetHash());
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second == pSampler)
+			{
+				m_Samplers.erase(it);
+				break;
+			}
+		}
+
+		if (m_pContext->GetDescriptorSetManager())
+			m_pContext->GetDescriptorSetManager()->InvalidateCachedDescriptorSets(pSampler);
+
+		b8 res = pSampler->Destroy();
+		delete pSampler;
+		return res;
+	}
+
+	void SamplerCache::DestroySamplers()
+	{
+		for (std::pair<const u64, Sampler*>& pair : m_Samplers)
+		{
+			pair.second->Destroy();
+			delete pair.second;
+		}
+		m_Samplers.clear();
+	}
+
+}
@@ -0,0 +1,67 @@
+// Copyright 2018 Jelte Meganck. All Rights Reserved.
+//
+// SamplerCache.h: Sampler cache
+#pragma once
+#include <unordered_map>
+#include "../General/TypesAndMacros.h"
+#include "Sampler.h"
+
+namespace RHI {
+	class RHIContext;
+
+	/**
+	 * Sampler cache, samplers with the same description share a single ref-counted sampler object
+	 */
+	class SamplerCache
+	{
+	public:
+		SamplerCache();
+		virtual ~SamplerCache();
+
+		/**
+		 * Create the sampler cache
+		 * @param[in] pContext	RHI context
+		 * @return				True if the sampler cache was created successfully, false otherwise
+		 */
+		virtual b8 Create(RHIContext* pContext) = 0;
+		/**
+		 * Destroy the sampler cache and all samplers in it
+		 * @return	True if the sampler cache was destroyed successfully, false otherwise
+		 */
+		virtual b8 Destroy() = 0;
+
+		/**
+		 * Get a sampler, creating it if no sampler with the same description exists, and add a reference to it
+		 * @param[in] desc	Sampler description
+		 * @return			Pointer to a sampler, nullptr if the creation failed
+		 */
+		Sampler* GetSampler(const SamplerDesc& desc);
+		/**
+		 * Release a reference to a sampler, the sampler is destroyed when it's no longer referenced
+		 * @param[in] pSampler	Sampler to release
+		 * @return				True if the sampler was released successfully, false otherwise
+		 */
+		b8 ReleaseSampler(Sampler* pSampler);
+		/**
+		 * Get the amount of unique samplers in the cache
+		 * @return	Amount of samplers
+		 */
+		u32 GetSamplerCount() const { return u32(m_Samplers.size()); }
+
+	protected:
+		/**
+		 * Create a new sampler object
+		 * @param[in] desc	Sampler description
+		 * @return			Pointer to a sampler, nullptr if the creation failed
+		 */
+		virtual Sampler* CreateSamplerObject(const SamplerDesc& desc) = 0;
+		/**
+		 * Destroy all samplers in the cache
+		 */
+		void DestroySamplers();
+
+		RHIContext* m_pContext;								/**< RHI context */
+		std::unordered_multimap<u64, Sampler*> m_Samplers;	/**< Samplers by description hash */
+	};
+
+}
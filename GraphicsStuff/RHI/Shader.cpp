@@ -34,6 +34,13 @@ namespace RHI {
 		stream.read((char*)m_Source.data(), size);
 		stream.close();
 
+		// Spir-v can be reflected right away, so layouts can be derived from the shader
+		if (m_Language == ShaderLanguage::Spirv && !m_Reflection.Reflect(m_Source, m_Type))
+		{
+			//g_Logger.LogFormat(LogRenderCore(), LogLevel::Error, "Failed to reflect shader: %s!", m_FilePath);
+			return false;
+		}
+
 		return true;
 	}
 }
@@ -6,6 +6,7 @@
 #include <vector>
 #include "../General/TypesAndMacros.h"
 #include "RHICommon.h"
+#include "ShaderReflection.h"
 
 namespace RHI {
 	class RHIContext;
@@ -63,6 +64,11 @@ namespace RHI {
 		* @return	True if the text shader source is compiled, false otherwise
 		*/
 		b8 IsCompiled() const { return m_IsCompiled; }
+		/**
+		* Get the reflected resources of the shader
+		* @return	Shader reflection (empty when the source isn't spir-v)
+		*/
+		const ShaderReflection& GetReflection() const { return m_Reflection; }
 
 	protected:
 		/**
@@ -79,6 +85,7 @@ namespace RHI {
 
 		ShaderLanguage m_Language;		/**< Shader language */
 		b8 m_IsCompiled;				/**< If the source was text, has it been compiled? */
+		ShaderReflection m_Reflection;	/**< Reflected resources */
 	};
 
 }
@@ -0,0 +1,581 @@
+
+#include "ShaderReflection.h"
+#include <algorithm>
+
+namespace RHI {
+
+	namespace {
+
+		// Subset of the spir-v spec needed for reflection
+		constexpr u32 SpirvMagic = 0x0723'0203;
+
+		enum SpirvOp : u16
+		{
+			OpName = 5,
+			OpTypeInt = 21,
+			OpTypeFloat = 22,
+			OpTypeVector = 23,
+			OpTypeMatrix = 24,
+			OpTypeImage = 25,
+			OpTypeSampler = 26,
+			OpTypeSampledImage = 27,
+			OpTypeArray = 28,
+			OpTypeRuntimeArray = 29,
+			OpTypeStruct = 30,
+			OpTypePointer = 32,
+			OpConstant = 43,
+			OpSpecConstantTrue = 48,
+			OpSpecConstantFalse = 49,
+			OpSpecConstant = 50,
+			OpVariable = 59,
+			OpDecorate = 71,
+			OpMemberDecorate = 72,
+		};
+
+		enum SpirvDecoration : u32
+		{
+			DecorationSpecId = 1,
+			DecorationBufferBlock = 3,
+			DecorationArrayStride = 6,
+			DecorationMatrixStride = 7,
+			DecorationBuiltIn = 11,
+			DecorationLocation = 30,
+			DecorationBinding = 33,
+			DecorationDescriptorSet = 34,
+			DecorationOffset = 35,
+		};
+
+		enum SpirvStorageClass : u32
+		{
+			StorageClassUniformConstant = 0,
+			StorageClassInput = 1,
+			StorageClassUniform = 2,
+			StorageClassPushConstant = 9,
+			StorageClassStorageBuffer = 12,
+		};
+
+		enum SpirvDim : u32
+		{
+			DimBuffer = 5,
+			DimSubpassData = 6,
+		};
+
+		constexpr u32 SpirvUnset = u32(-1);
+		constexpr u32 SpirvMaxStructMembers = 16383;	/**< Minimum limit on struct members every implementation supports, larger indices are treated as malformed */
+
+		/**
+		 * Everything known about a spir-v id
+		 */
+		struct SpirvId
+		{
+			u16 op = 0;							/**< Opcode defining the id */
+			u32 typeId = SpirvUnset;			/**< Component, element, pointee or result type */
+			u32 storageClass = SpirvUnset;		/**< Storage class of pointers and variables */
+			u32 operand = 0;					/**< Width (scalars), component count (vectors, matrices), length id (arrays) or value (constants) */
+			u32 dim = 0;						/**< Image dimension */
+			u32 sampled = 0;					/**< Image sampled mode (1: sampled, 2: storage) */
+			b8 isSigned = false;				/**< Signedness of integers */
+			std::vector<u32> members;			/**< Struct member types */
+			std::vector<u32> memberOffsets;		/**< Struct member offsets */
+			std::vector<u32> memberMatrixStrides;	/**< Struct member matrix strides */
+
+			u32 set = SpirvUnset;				/**< Descriptor set decoration */
+			u32 binding = SpirvUnset;			/**< Binding decoration */
+			u32 location = SpirvUnset;			/**< Location decoration */
+			u32 specId = SpirvUnset;			/**< Specialization id decoration */
+			u32 arrayStride = 0;				/**< Array stride decoration */
+			b8 builtIn = false;					/**< BuiltIn decoration */
+			b8 bufferBlock = false;				/**< BufferBlock decoration */
+			std::string name;					/**< Debug name */
+		};
+
+		/**
+		 * Get the size of a type in a block
+		 * @param[in] ids			Spir-v ids
+		 * @param[in] typeId		Type id
+		 * @param[in] matrixStride	Matrix stride of the member, 0 if tightly packed
+		 * @return					Size of the type
+		 */
+		u32 GetBlockTypeSize(const std::vector<SpirvId>& ids, u32 typeId, u32 matrixStride)
+		{
+			const SpirvId& type = ids[typeId];
+			switch (type.op)
+			{
+			case OpTypeInt:
+			case OpTypeFloat:
+				return type.operand / 8;
+			case OpTypeVector:
+				return type.operand * GetBlockTypeSize(ids, type.typeId, 0);
+			case OpTypeMatrix:
+				return type.operand * (matrixStride ? matrixStride : GetBlockTypeSize(ids, type.typeId, 0));
+			case OpTypeArray:
+			{
+				u32 length = ids[type.operand].operand;
+				u32 stride = type.arrayStride ? type.arrayStride : GetBlockTypeSize(ids, type.typeId, matrixStride);
+				return length * stride;
+			}
+			case OpTypeStruct:
+			{
+				u32 size = 0;
+				for (sizeT i = 0; i < type.members.size(); ++i)
+				{
+					u32 offset = i < type.memberOffsets.size() ? type.memberOffsets[i] : size;
+					u32 memberMatrixStride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+					size = std::max(size, offset + GetBlockTypeSize(ids, type.members[i], memberMatrixStride));
+				}
+				return size;
+			}
+			default:
+				// Runtime arrays have no static size
+				return 0;
+			}
+		}
+
+		/**
+		 * Get the vertex input element type of a type
+		 * @param[in] ids		Spir-v ids
+		 * @param[in] typeId	Type id
+		 * @return				Element type, None if the type can't be used as a vertex input
+		 */
+		InputElementType GetInputElementType(const std::vector<SpirvId>& ids, u32 typeId)
+		{
+			const SpirvId& type = ids[typeId];
+			u32 components = 1;
+			const SpirvId* pScalar = &type;
+			if (type.op == OpTypeVector)
+			{
+				components = type.operand;
+				pScalar = &ids[type.typeId];
+			}
+			if (components < 1 || components > 4)
+				return InputElementType::None;
+
+			InputElementType base;
+			if (pScalar->op == OpTypeFloat && pScalar->operand == 32)
+				base = InputElementType::Float1;
+			else if (pScalar->op == OpTypeInt && pScalar->operand == 32)
+				base = pScalar->isSigned ? InputElementType::Int1 : InputElementType::UInt1;
+			else if (pScalar->op == OpTypeInt && pScalar->operand == 16)
+				base = pScalar->isSigned ? InputElementType::Short1 : InputElementType::UShort1;
+			else
+				return InputElementType::None;
+
+			// Element types are ordered by component count
+			return InputElementType(u8(base) + components - 1);
+		}
+
+		/**
+		 * Check if an instruction the reflection reads has all the operands it reads, and only uses ids within the id bound
+		 * @param[in] pInst		Instruction
+		 * @param[in] length	Word count of the instruction
+		 * @param[in] idBound	Id bound of the module
+		 * @return				True if the instruction is valid, false otherwise
+		 */
+		b8 IsInstructionValid(const u32* pInst, u16 length, u32 idBound)
+		{
+			// Minimum length and the range of words holding ids
+			u16 minLength;
+			u16 firstId = 1;
+			u16 idEnd;
+			switch (u16(pInst[0] & 0xFFFF))
+			{
+			case OpName:
+				// The string is nul-terminated and padded, so the last byte of the instruction is always 0
+				if (length < 3 || (pInst[length - 1] >> 24) != 0)
+					return false;
+				minLength = 3;
+				idEnd = 2;
+				break;
+			case OpTypeInt:				minLength = 4;		idEnd = 2;		break;
+			case OpTypeFloat:			minLength = 3;		idEnd = 2;		break;
+			case OpTypeVector:
+			case OpTypeMatrix:			minLength = 4;		idEnd = 3;		break;
+			case OpTypeArray:			minLength = 4;		idEnd = 4;		break;
+			case OpTypeImage:			minLength = 9;		idEnd = 3;		break;
+			case OpTypeSampler:			minLength = 2;		idEnd = 2;		break;
+			case OpTypeSampledImage:
+			case OpTypeRuntimeArray:	minLength = 3;		idEnd = 3;		break;
+			case OpTypeStruct:			minLength = 2;		idEnd = length;	break;
+			case OpTypePointer:
+				// The storage class between the result and the pointee isn't an id
+				if (length < 4 || pInst[3] >= idBound)
+					return false;
+				minLength = 4;
+				idEnd = 2;
+				break;
+			case OpConstant:
+			case OpSpecConstant:
+			case OpSpecConstantTrue:
+			case OpSpecConstantFalse:
+			case OpVariable:
+				minLength = u16(pInst[0] & 0xFFFF) == OpVariable ? 4 : 3;
+				idEnd = 3;
+				break;
+			case OpDecorate:
+				if (length < 3)
+					return false;
+				// Decorations whose literal operand is read
+				if (pInst[2] == DecorationSpecId || pInst[2] == DecorationArrayStride || pInst[2] == DecorationLocation ||
+					pInst[2] == DecorationBinding || pInst[2] == DecorationDescriptorSet)
+					minLength = 4;
+				else
+					minLength = 3;
+				idEnd = 2;
+				break;
+			case OpMemberDecorate:
+				if (length < 4 || pInst[2] > SpirvMaxStructMembers)
+					return false;
+				minLength = (pInst[3] == DecorationOffset || pInst[3] == DecorationMatrixStride) ? 5 : 4;
+				idEnd = 2;
+				break;
+			default:
+				return true;
+			}
+
+			if (length < minLength)
+				return false;
+			for (u16 i = firstId; i < idEnd; ++i)
+			{
+				if (pInst[i] >= idBound)
+					return false;
+			}
+			return true;
+		}
+
+	}
+
+	ShaderReflection::ShaderReflection()
+		: m_PushConstantSize(0)
+		, m_PushConstantStages(ShaderType::None)
+		, m_Stages(ShaderType::None)
+	{
+	}
+
+	ShaderReflection::~ShaderReflection()
+	{
+	}
+
+	b8 ShaderReflection::Reflect(const std::vector<u8>& code, ShaderType stage)
+	{
+		m_Bindings.clear();
+		m_Inputs.clear();
+		m_SpecializationConstants.clear();
+		m_PushConstantSize = 0;
+		m_PushConstantStages = ShaderType::None;
+		m_Stages = stage;
+
+		const u32* pWords = (const u32*)code.data();
+		sizeT wordCount = code.size() / 4;
+		if (wordCount < 5 || pWords[0] != SpirvMagic)
+		{
+			//g_Logger.LogError(LogRenderCore(), "Shader code is not valid spir-v!");
+			return false;
+		}
+
+		// Header: magic, version, generator, id bound, schema
+		u32 idBound = pWords[3];
+		std::vector<SpirvId> ids(idBound);
+		std::vector<u32> variables;
+
+		for (sizeT offset = 5; offset < wordCount;)
+		{
+			const u32* pInst = pWords + offset;
+			u16 op = u16(pInst[0] & 0xFFFF);
+			u16 length = u16(pInst[0] >> 16);
+			if (length == 0 || offset + length > wordCount || !IsInstructionValid(pInst, length, idBound))
+			{
+				//g_Logger.LogError(LogRenderCore(), "Malformed spir-v instruction!");
+				return false;
+			}
+			offset += length;
+
+			switch (op)
+			{
+			case OpName:
+				ids[pInst[1]].name = (const char*)(pInst + 2);
+				break;
+			case OpTypeInt:
+				ids[pInst[1]].op = op;
+				ids[pInst[1]].operand = pInst[2];
+				ids[pInst[1]].isSigned = pInst[3] != 0;
+				break;
+			case OpTypeFloat:
+				ids[pInst[1]].op = op;
+				ids[pInst[1]].operand = pInst[2];
+				break;
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeArray:
+				ids[pInst[1]].op = op;
+				ids[pInst[1]].typeId = pInst[2];
+				ids[pInst[1]].operand = pInst[3];
+				break;
+			case OpTypeImage:
+				// result, sampled type, dim, depth, arrayed, ms, sampled, format
+				ids[pInst[1]].op = op;
+				ids[pInst[1]].dim = pInst[3];
+				ids[pInst[1]].sampled = pInst[7];
+				break;
+			case OpTypeSampler:
+				ids[pInst[1]].op = op;
+				break;
+			case OpTypeSampledImage:
+			case OpTypeRuntimeArray:
+				ids[pInst[1]].op = op;
+				ids[pInst[1]].typeId = pInst[2];
+				break;
+			case OpTypeStruct:
+				ids[pInst[1]].op = op;
+				ids[pInst[1]].members.assign(pInst + 2, pInst + length);
+				break;
+			case OpTypePointer:
+				ids[pInst[1]].op = op;
+				ids[pInst[1]].storageClass = pInst[2];
+				ids[pInst[1]].typeId = pInst[3];
+				break;
+			case OpConstant:
+			case OpSpecConstant:
+			case OpSpecConstantTrue:
+			case OpSpecConstantFalse:
+				ids[pInst[2]].op = op;
+				ids[pInst[2]].typeId = pInst[1];
+				ids[pInst[2]].operand = length > 3 ? pInst[3] : 0;
+				break;
+			case OpVariable:
+				ids[pInst[2]].op = op;
+				ids[pInst[2]].typeId = pInst[1];
+				ids[pInst[2]].storageClass = pInst[3];
+				variables.push_back(pInst[2]);
+				break;
+			case OpDecorate:
+			{
+				SpirvId& id = ids[pInst[1]];
+				switch (pInst[2])
+				{
+				case DecorationSpecId:			id.specId = pInst[3];		break;
+				case DecorationBufferBlock:		id.bufferBlock = true;		break;
+				case DecorationArrayStride:		id.arrayStride = pInst[3];	break;
+				case DecorationBuiltIn:			id.builtIn = true;			break;
+				case DecorationLocation:		id.location = pInst[3];		break;
+				case DecorationBinding:			id.binding = pInst[3];		break;
+				case DecorationDescriptorSet:	id.set = pInst[3];			break;
+				default:													break;
+				}
+				break;
+			}
+			case OpMemberDecorate:
+			{
+				SpirvId& id = ids[pInst[1]];
+				u32 member = pInst[2];
+				if (pInst[3] == DecorationOffset)
+				{
+					if (id.memberOffsets.size() <= member)
+						id.memberOffsets.resize(member + 1, 0);
+					id.memberOffsets[member] = pInst[4];
+				}
+				else if (pInst[3] == DecorationMatrixStride)
+				{
+					if (id.memberMatrixStrides.size() <= member)
+						id.memberMatrixStrides.resize(member + 1, 0);
+					id.memberMatrixStrides[member] = pInst[4];
+				}
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		for (u32 variableId : variables)
+		{
+			const SpirvId& variable = ids[variableId];
+			const SpirvId& pointer = ids[variable.typeId];
+			if (pointer.op != OpTypePointer)
+			{
+				//g_Logger.LogError(LogRenderCore(), "Malformed spir-v variable!");
+				return false;
+			}
+			u32 typeId = pointer.typeId;
+
+			switch (variable.storageClass)
+			{
+			case StorageClassUniformConstant:
+			case StorageClassUniform:
+			case StorageClassStorageBuffer:
+			{
+				if (variable.binding == SpirvUnset)
+					break;
+
+				ShaderResourceBinding binding;
+				binding.set = variable.set == SpirvUnset ? 0 : variable.set;
+				binding.binding = variable.binding;
+				binding.stages = stage;
+				binding.name = variable.name;
+
+				// Arrays of resources take up multiple descriptors
+				binding.count = 1;
+				while (ids[typeId].op == OpTypeArray || ids[typeId].op == OpTypeRuntimeArray)
+				{
+					binding.count = ids[typeId].op == OpTypeArray ? binding.count * ids[ids[typeId].operand].operand : 0;
+					typeId = ids[typeId].typeId;
+				}
+
+				const SpirvId& type = ids[typeId];
+				if (variable.storageClass == StorageClassStorageBuffer)
+				{
+					binding.type = DescriptorSetBindingType::Storage;
+				}
+				else if (variable.storageClass == StorageClassUniform)
+				{
+					// Older spir-v marks storage buffers as uniform buffer blocks
+					binding.type = type.bufferBlock ? DescriptorSetBindingType::Storage : DescriptorSetBindingType::Uniform;
+				}
+				else if (type.op == OpTypeSampledImage)
+				{
+					binding.type = DescriptorSetBindingType::CombinedImageSampler;
+				}
+				else if (type.op == OpTypeSampler)
+				{
+					binding.type = DescriptorSetBindingType::Sampler;
+				}
+				else if (type.op == OpTypeImage)
+				{
+					if (type.dim == DimBuffer)
+						binding.type = type.sampled == 2 ? DescriptorSetBindingType::StorageTexelBuffer : DescriptorSetBindingType::UniformTexelBuffer;
+					else if (type.dim == DimSubpassData)
+						binding.type = DescriptorSetBindingType::InputAttachment;
+					else
+						binding.type = type.sampled == 2 ? DescriptorSetBindingType::StorageImage : DescriptorSetBindingType::SampledImage;
+				}
+				else
+				{
+					// Acceleration structures and other extension types aren't supported by the RHI
+					break;
+				}
+
+				m_Bindings.push_back(binding);
+				break;
+			}
+			case StorageClassPushConstant:
+			{
+				m_PushConstantSize = std::max(m_PushConstantSize, GetBlockTypeSize(ids, typeId, 0));
+				m_PushConstantStages = stage;
+				break;
+			}
+			case StorageClassInput:
+			{
+				// Only vertex inputs are fed by the input descriptor, built-ins don't have a location
+				if (stage != ShaderType::Vertex || variable.builtIn || variable.location == SpirvUnset)
+					break;
+
+				ShaderInputVariable input;
+				input.location = variable.location;
+				input.type = GetInputElementType(ids, typeId);
+				input.name = variable.name;
+				m_Inputs.push_back(input);
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		for (const SpirvId& id : ids)
+		{
+			if (id.specId != SpirvUnset)
+				m_SpecializationConstants.push_back({ id.specId, id.name });
+		}
+
+		std::sort(m_Bindings.begin(), m_Bindings.end(), [](const ShaderResourceBinding& binding0, const ShaderResourceBinding& binding1)
+		{
+			return binding0.set != binding1.set ? binding0.set < binding1.set : binding0.binding < binding1.binding;
+		});
+		std::sort(m_Inputs.begin(), m_Inputs.end(), [](const ShaderInputVariable& input0, const ShaderInputVariable& input1)
+		{
+			return input0.location < input1.location;
+		});
+		std::sort(m_SpecializationConstants.begin(), m_SpecializationConstants.end(), [](const ShaderSpecializationConstant& constant0, const ShaderSpecializationConstant& constant1)
+		{
+			return constant0.id < constant1.id;
+		});
+
+		return true;
+	}
+
+	b8 ShaderReflection::Merge(const ShaderReflection& reflection)
+	{
+		for (const ShaderResourceBinding& binding : reflection.m_Bindings)
+		{
+			auto it = std::lower_bound(m_Bindings.begin(), m_Bindings.end(), binding, [](const ShaderResourceBinding& binding0, const ShaderResourceBinding& binding1)
+			{
+				return binding0.set != binding1.set ? binding0.set < binding1.set : binding0.binding < binding1.binding;
+			});
+
+			if (it != m_Bindings.end() && it->set == binding.set && it->binding == binding.binding)
+			{
+				if (it->type != binding.type)
+				{
+					//g_Logger.LogFormat(LogRenderCore(), LogLevel::Error, "Binding %u in set %u is declared with different types across stages!", binding.binding, binding.set);
+					return false;
+				}
+				it->stages |= binding.stages;
+				it->count = std::max(it->count, binding.count);
+			}
+			else
+			{
+				m_Bindings.insert(it, binding);
+			}
+		}
+
+		if (reflection.m_Inputs.size() > 0)
+			m_Inputs = reflection.m_Inputs;
+
+		for (const ShaderSpecializationConstant& constant : reflection.m_SpecializationConstants)
+		{
+			auto it = std::lower_bound(m_SpecializationConstants.begin(), m_SpecializationConstants.end(), constant, [](const ShaderSpecializationConstant& constant0, const ShaderSpecializationConstant& constant1)
+			{
+				return constant0.id < constant1.id;
+			});
+			if (it == m_SpecializationConstants.end() || it->id != constant.id)
+				m_SpecializationConstants.insert(it, constant);
+		}
+
+		m_PushConstantSize = std::max(m_PushConstantSize, reflection.m_PushConstantSize);
+		m_PushConstantStages |= reflection.m_PushConstantStages;
+		m_Stages |= reflection.m_Stages;
+		return true;
+	}
+
+	std::vector<DescriptorSetBinding> ShaderReflection::GetSetBindings(u32 set) const
+	{
+		std::vector<DescriptorSetBinding> bindings;
+		for (const ShaderResourceBinding& binding : m_Bindings)
+		{
+			if (binding.set != set)
+				continue;
+
+			// Unused binding slots are reserved with a count of 0
+			if (bindings.size() <= binding.binding)
+				bindings.resize(binding.binding + 1, { DescriptorSetBindingType::Uniform, ShaderType::None, 0, nullptr });
+
+			bindings[binding.binding] = { binding.type, binding.stages, binding.count, nullptr };
+		}
+		return bindings;
+	}
+
+	InputDescriptor ShaderReflection::GetInputDescriptor() const
+	{
+		InputDescriptor inputDescriptor;
+		for (const ShaderInputVariable& input : m_Inputs)
+		{
+			inputDescriptor.Append(InputElementDesc(InputSemantic::None, u16(input.location), input.type, HV_GFX_DEF_ELEM_ALIGN, 0, 0));
+		}
+		return inputDescriptor;
+	}
+
+	u32 ShaderReflection::GetSetCount() const
+	{
+		return m_Bindings.size() > 0 ? m_Bindings.back().set + 1 : 0;
+	}
+
+}
@@ -0,0 +1,119 @@
+// Copyright 2018 Jelte Meganck. All Rights Reserved.
+//
+// ShaderReflection.h: Spir-v shader reflection
+#pragma once
+#include <string>
+#include <vector>
+#include "../General/TypesAndMacros.h"
+#include "RHICommon.h"
+#include "InputDescriptor.h"
+#include "DescriptorSetLayout.h"
+
+namespace RHI {
+
+	struct ShaderResourceBinding
+	{
+		u32 set;						/**< Descriptor set index */
+		u32 binding;					/**< Binding index in the set */
+		DescriptorSetBindingType type;	/**< Descriptor type */
+		u32 count;						/**< Amount of descriptors, 0 for runtime sized arrays */
+		ShaderType stages;				/**< Stages using the binding */
+		std::string name;				/**< Name of the variable, empty when the spir-v was stripped */
+	};
+
+	struct ShaderInputVariable
+	{
+		u32 location;				/**< Input location */
+		InputElementType type;		/**< Element type, None for types that can't be used as a vertex input */
+		std::string name;			/**< Name of the variable, empty when the spir-v was stripped */
+	};
+
+	struct ShaderSpecializationConstant
+	{
+		u32 id;					/**< Specialization constant id */
+		std::string name;		/**< Name of the constant, empty when the spir-v was stripped */
+	};
+
+	/**
+	 * Resources used by one or more shader stages, extracted from spir-v
+	 */
+	class ShaderReflection
+	{
+	public:
+		ShaderReflection();
+		~ShaderReflection();
+
+		/**
+		 * Reflect spir-v code
+		 * @param[in] code		Spir-v code
+		 * @param[in] stage		Shader stage of the code
+		 * @return				True if the code was reflected successfully, false otherwise
+		 */
+		b8 Reflect(const std::vector<u8>& code, ShaderType stage);
+		/**
+		 * Merge the reflection of another stage into this one
+		 * @param[in] reflection	Reflection of another stage
+		 * @return					True if the reflections were merged, false if a binding is declared with different types
+		 */
+		b8 Merge(const ShaderReflection& reflection);
+
+		/**
+		 * Get the bindings of a descriptor set, indexed by binding slot, unused slots have a count of 0
+		 * @param[in] set	Descriptor set index
+		 * @return			Descriptor set bindings
+		 * @note			Spir-v doesn't distinguish dynamic buffers and runtime array sizes, these need to be filled in by the caller
+		 */
+		std::vector<DescriptorSetBinding> GetSetBindings(u32 set) const;
+		/**
+		 * Get an input descriptor for the vertex inputs, with tightly packed elements in input slot 0
+		 * @return	Input descriptor
+		 * @note	Spir-v has no semantics, so elements use InputSemantic::None with the location as semantic index
+		 */
+		InputDescriptor GetInputDescriptor() const;
+
+		/**
+		 * Get all resource bindings, sorted by set and binding
+		 * @return	Resource bindings
+		 */
+		const std::vector<ShaderResourceBinding>& GetBindings() const { return m_Bindings; }
+		/**
+		 * Get the amount of descriptor sets (highest used set + 1)
+		 * @return	Amount of descriptor sets
+		 */
+		u32 GetSetCount() const;
+		/**
+		 * Get the vertex input variables, sorted by location
+		 * @return	Vertex input variables
+		 */
+		const std::vector<ShaderInputVariable>& GetInputs() const { return m_Inputs; }
+		/**
+		 * Get the specialization constants, sorted by id
+		 * @return	Specialization constants
+		 */
+		const std::vector<ShaderSpecializationConstant>& GetSpecializationConstants() const { return m_SpecializationConstants; }
+		/**
+		 * Get the size of the push constant block
+		 * @return	Size of the push constant block, 0 if there are no push constants
+		 */
+		u32 GetPushConstantSize() const { return m_PushConstantSize; }
+		/**
+		 * Get the stages using push constants
+		 * @return	Stages using push constants
+		 */
+		ShaderType GetPushConstantStages() const { return m_PushConstantStages; }
+		/**
+		 * Get the reflected stages
+		 * @return	Reflected stages
+		 */
+		ShaderType GetStages() const { return m_Stages; }
+
+	private:
+		std::vector<ShaderResourceBinding> m_Bindings;							/**< Resource bindings */
+		std::vector<ShaderInputVariable> m_Inputs;								/**< Vertex input variables */
+		std::vector<ShaderSpecializationConstant> m_SpecializationConstants;	/**< Specialization constants */
+		u32 m_PushConstantSize;													/**< Size of the push constant block */
+		ShaderType m_PushConstantStages;										/**< Stages using push constants */
+		ShaderType m_Stages;													/**< Reflected stages */
+	};
+
+}
@@ -0,0 +1,326 @@
+
+#include "SparseTextureResidency.h"
+#include <algorithm>
+#include "Buffer.h"
+#include "Texture.h"
+#include "RHIContext.h"
+#include "CommandList.h"
+#include "CommandListManager.h"
+
+namespace RHI {
+
+
+	SparseTextureResidency::SparseTextureResidency()
+		: m_pContext(nullptr)
+		, m_pTexture(nullptr)
+		, m_pFeedbackBuffers()
+		, m_pPageTableBuffers()
+		, m_PageTableVersion(0)
+		, m_PageTableVersions()
+		, m_MemoryBudget(0)
+		, m_TileMemorySize(0)
+		, m_TileWidth(0)
+		, m_TileHeight(0)
+		, m_SlotCount(0)
+		, m_TilesPerLayer(0)
+	{
+	}
+
+	SparseTextureResidency::~SparseTextureResidency()
+	{
+	}
+
+	b8 SparseTextureResidency::Update(const SparseTileLoadCallback& loadCallback, u32 maxTileLoads)
+	{
+		if (m_Levels.empty())
+			return true;
+
+		// The copies of the current frame were last used MaxFramesInFlight frames ago, so that frame completed
+		u64 frame = m_pContext->GetFrameIndex();
+		u32 copy = u32(frame % MaxFramesInFlight);
+		u64 bufferSize = u64(m_Feedback.size()) * sizeof(u32);
+		Buffer* pFeedbackBuffer = m_pFeedbackBuffers[copy];
+		if (!pFeedbackBuffer->Read(0, bufferSize, m_Feedback.data()) || !pFeedbackBuffer->Write(0, bufferSize, m_EmptyFeedback.data()))
+		{
+			//g_Logger.LogError("Failed to read back the sparse texture feedback!");
+			return false;
+		}
+
+		// The memory of evicted tiles is unbound once the frame that first left them out of its page table completed, all earlier frames completed as well
+		std::vector<TileBinding> unbindings;
+		while (!m_EvictedTiles.empty() && m_pContext->IsFrameComplete(m_Tiles[m_EvictedTiles.front()].evictFrame))
+		{
+			u32 tileIndex = m_EvictedTiles.front();
+			Tile& tile = m_Tiles[tileIndex];
+			unbindings.push_back({ tileIndex, InvalidSlot });
+			m_FreeSlots.push_back(tile.slot);
+			tile.slot = InvalidSlot;
+			tile.evicted = false;
+			m_EvictedTiles.pop_front();
+		}
+
+		// Mark the requested tiles and the coarser tiles of their mip chain as used, a tile that was already marked has its whole chain marked
+		u32 tileCountX = m_Levels[0].tileCountX;
+		u32 tileCountY = m_Levels[0].tileCountY;
+		m_Requests.clear();
+		for (u32 i = 0; i < u32(m_Feedback.size()); ++i)
+		{
+			u32 x = i % tileCountX;
+			u32 y = i / tileCountX % tileCountY;
+			u32 layerOffset = i / (tileCountX * tileCountY) * m_TilesPerLayer;
+			for (u32 mipLevel = m_Feedback[i]; mipLevel < u32(m_Levels.size()); ++mipLevel)
+			{
+				u32 tileIndex = GetTileIndex(layerOffset, mipLevel, x, y);
+				Tile& tile = m_Tiles[tileIndex];
+				if (tile.lastUseFrame == frame)
+					break;
+
+				tile.lastUseFrame = frame;
+				if (tile.slot == InvalidSlot)
+				{
+					m_Requests.push_back(tileIndex);
+				}
+				else if (tile.evicted)
+				{
+					// The memory of an evicted tile is still bound, so it only has to be put back in the page table
+					m_EvictedTiles.erase(tile.lruIt);
+					tile.lruIt = m_LruTiles.insert(m_LruTiles.end(), tileIndex);
+					tile.evicted = false;
+				}
+				else
+				{
+					m_LruTiles.splice(m_LruTiles.end(), m_LruTiles, tile.lruIt);
+				}
+			}
+		}
+
+		// Coarse tiles first, so the mip chains become usable as soon as possible
+		std::stable_sort(m_Requests.begin(), m_Requests.end(), [this](u32 a, u32 b)
+		{
+			return (a % m_TilesPerLayer) > (b % m_TilesPerLayer);
+		});
+		if (m_Requests.size() > maxTileLoads)
+			m_Requests.resize(maxTileLoads);
+
+		// Take free slots first, otherwise evict the least recently used tiles, which only frees their slots in a later update,
+		// requests that can wait for the slot of a tile that is already evicted don't evict another one
+		u32 pendingSlotCount = u32(m_EvictedTiles.size());
+		std::vector<TileBinding> bindings;
+		for (u32 tileIndex : m_Requests)
+		{
+			if (m_FreeSlots.empty())
+			{
+				if (pendingSlotCount > 0)
+				{
+					--pendingSlotCount;
+					continue;
+				}
+				if (m_LruTiles.empty())
+					break;
+				u32 evictedIndex = m_LruTiles.front();
+				Tile& evicted = m_Tiles[evictedIndex];
+				if (evicted.lastUseFrame == frame)
+					break;
+
+				m_LruTiles.pop_front();
+				evicted.evicted = true;
+				evicted.evictFrame = frame;
+				evicted.lruIt = m_EvictedTiles.insert(m_EvictedTiles.end(), evictedIndex);
+				continue;
+			}
+
+			u32 slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+			Tile& tile = m_Tiles[tileIndex];
+			tile.slot = slot;
+			tile.lruIt = m_LruTiles.insert(m_LruTiles.end(), tileIndex);
+			bindings.push_back({ tileIndex, slot });
+		}
+
+		// Unbind the released tiles before their memory is bound to other tiles
+		unbindings.insert(unbindings.end(), bindings.begin(), bindings.end());
+		if (!unbindings.empty() && !BindTiles(unbindings))
+		{
+			//g_Logger.LogError("Failed to bind sparse texture tiles!");
+			return false;
+		}
+
+		// Write the new tiles, tiles that couldn't be written are made non-resident again
+		b8 res = true;
+		TextureLayout layout = m_pTexture->GetLayout();
+		unbindings.clear();
+		for (const TileBinding& binding : bindings)
+		{
+			if (loadCallback(m_pTexture, GetTileRegion(binding.tile)))
+				continue;
+
+			Tile& tile = m_Tiles[binding.tile];
+			m_LruTiles.erase(tile.lruIt);
+			m_FreeSlots.push_back(tile.slot);
+			tile.slot = InvalidSlot;
+			unbindings.push_back({ binding.tile, InvalidSlot });
+		}
+		if (!unbindings.empty())
+			res &= BindTiles(unbindings);
+
+		// Writing tiles leaves the texture in the transfer layout
+		if (!bindings.empty() && layout != TextureLayout::Unknown && m_pTexture->GetLayout() != layout)
+		{
+			TextureLayoutTransition transition = {};
+			transition.layout = layout;
+			transition.baseArrayLayer = 0;
+			transition.layerCount = m_pTexture->GetLayerCount();
+			transition.baseMipLevel = 0;
+			transition.mipLevelCount = u8(m_pTexture->GetMipLevels());
+
+			CommandListManager* pManager = m_pContext->GetCommandListManager();
+			CommandList* pCommandList = pManager->CreateSingleTimeCommandList(m_pContext->GetQueue(QueueType::Graphics));
+			pCommandList->TransitionTextureLayout(PipelineStage::Transfer, PipelineStage::AllCommands, m_pTexture, transition);
+			res &= pManager->EndSingleTimeCommandList(pCommandList);
+		}
+
+		// Update the finest resident mip level of every tile of mip level 0, evicted tiles can't be sampled anymore
+		b8 pageTableChanged = false;
+		for (u32 i = 0; i < u32(m_PageTable.size()); ++i)
+		{
+			u32 x = i % tileCountX;
+			u32 y = i / tileCountX % tileCountY;
+			u32 layerOffset = i / (tileCountX * tileCountY) * m_TilesPerLayer;
+			u32 mipLevel = u32(m_Levels.size());
+			while (mipLevel > 0)
+			{
+				const Tile& tile = m_Tiles[GetTileIndex(layerOffset, mipLevel - 1, x, y)];
+				if (tile.slot == InvalidSlot || tile.evicted)
+					break;
+				--mipLevel;
+			}
+			pageTableChanged |= m_PageTable[i] != mipLevel;
+			m_PageTable[i] = mipLevel;
+		}
+		if (pageTableChanged)
+			++m_PageTableVersion;
+
+		// The copy of the current frame can still hold an older page table, even when nothing changed in this update
+		if (m_PageTableVersions[copy] != m_PageTableVersion)
+		{
+			if (m_pPageTableBuffers[copy]->Write(0, bufferSize, m_PageTable.data()))
+				m_PageTableVersions[copy] = m_PageTableVersion;
+			else
+				res = false;
+		}
+
+		return res;
+	}
+
+	Buffer* SparseTextureResidency::GetFeedbackBuffer() const
+	{
+		return m_pFeedbackBuffers[m_pContext->GetFrameIndex() % MaxFramesInFlight];
+	}
+
+	Buffer* SparseTextureResidency::GetPageTableBuffer() const
+	{
+		return m_pPageTableBuffers[m_pContext->GetFrameIndex() % MaxFramesInFlight];
+	}
+
+	void SparseTextureResidency::InitTiles(u32 tileWidth, u32 tileHeight, u32 mipTailStart, u32 slotCount, u64 tileMemorySize)
+	{
+		m_TileWidth = tileWidth;
+		m_TileHeight = tileHeight;
+		m_SlotCount = slotCount;
+		m_TileMemorySize = tileMemorySize;
+
+		m_TilesPerLayer = 0;
+		m_Levels.resize(mipTailStart);
+		for (u32 mipLevel = 0; mipLevel < mipTailStart; ++mipLevel)
+		{
+			Level& level = m_Levels[mipLevel];
+			level.firstTile = m_TilesPerLayer;
+			level.tileCountX = (std::max(m_pTexture->GetWidth() >> mipLevel, 1u) + tileWidth - 1) / tileWidth;
+			level.tileCountY = (std::max(m_pTexture->GetHeight() >> mipLevel, 1u) + tileHeight - 1) / tileHeight;
+			m_TilesPerLayer += level.tileCountX * level.tileCountY;
+		}
+
+		Tile tile;
+		tile.slot = InvalidSlot;
+		tile.lastUseFrame = u64(-1);
+		tile.evictFrame = 0;
+		tile.evicted = false;
+		m_Tiles.assign(sizeT(m_TilesPerLayer) * m_pTexture->GetLayerCount(), tile);
+
+		// Slots are taken from the back, so the tile memory fills from the front
+		m_FreeSlots.resize(slotCount);
+		for (u32 i = 0; i < slotCount; ++i)
+		{
+			m_FreeSlots[i] = slotCount - 1 - i;
+		}
+		m_LruTiles.clear();
+		m_EvictedTiles.clear();
+
+		sizeT entryCount = mipTailStart == 0 ? 0 : sizeT(m_Levels[0].tileCountX) * m_Levels[0].tileCountY * m_pTexture->GetLayerCount();
+		m_Feedback.assign(entryCount, 0xFFFF'FFFF);
+		m_EmptyFeedback.assign(entryCount, 0xFFFF'FFFF);
+		m_PageTable.assign(entryCount, mipTailStart);
+	}
+
+	void SparseTextureResidency::ReleaseTiles()
+	{
+		m_Levels.clear();
+		m_Tiles.clear();
+		m_FreeSlots.clear();
+		m_LruTiles.clear();
+		m_EvictedTiles.clear();
+		m_Feedback.clear();
+		m_EmptyFeedback.clear();
+		m_PageTable.clear();
+		m_Requests.clear();
+		m_SlotCount = 0;
+		m_TilesPerLayer = 0;
+	}
+
+	b8 SparseTextureResidency::ResetBuffers()
+	{
+		if (m_PageTable.empty())
+			return true;
+
+		u64 bufferSize = u64(m_PageTable.size()) * sizeof(u32);
+		for (u32 i = 0; i < MaxFramesInFlight; ++i)
+		{
+			if (!m_pFeedbackBuffers[i]->Write(0, bufferSize, m_EmptyFeedback.data()) || !m_pPageTableBuffers[i]->Write(0, bufferSize, m_PageTable.data()))
+				return false;
+			m_PageTableVersions[i] = m_PageTableVersion;
+		}
+		return true;
+	}
+
+	u32 SparseTextureResidency::GetTileIndex(u32 layerOffset, u32 mipLevel, u32 x, u32 y) const
+	{
+		// Rounding up the tile count of every level can leave a coarser level with less tiles than the shifted coordinates need
+		const Level& level = m_Levels[mipLevel];
+		u32 levelX = std::min(x >> mipLevel, level.tileCountX - 1);
+		u32 levelY = std::min(y >> mipLevel, level.tileCountY - 1);
+		return layerOffset + level.firstTile + levelY * level.tileCountX + levelX;
+	}
+
+	TextureRegion SparseTextureResidency::GetTileRegion(u32 tile) const
+	{
+		u32 layer = tile / m_TilesPerLayer;
+		u32 layerTile = tile % m_TilesPerLayer;
+		u32 mipLevel = u32(m_Levels.size()) - 1;
+		while (m_Levels[mipLevel].firstTile > layerTile)
+			--mipLevel;
+		const Level& level = m_Levels[mipLevel];
+		u32 x = (layerTile - level.firstTile) % level.tileCountX;
+		u32 y = (layerTile - level.firstTile) / level.tileCountX;
+
+		// Tiles at the edge of a mip level only cover the remaining texels
+		u32 width = std::max(m_pTexture->GetWidth() >> mipLevel, 1u);
+		u32 height = std::max(m_pTexture->GetHeight() >> mipLevel, 1u);
+		TextureRegion region = {};
+		region.mipLevel = u8(mipLevel);
+		region.baseArrayLayer = layer;
+		region.layerCount = 1;
+		region.offset = glm::uvec3(x * m_TileWidth, y * m_TileHeight, 0);
+		region.extent = glm::uvec3(std::min(m_TileWidth, width - x * m_TileWidth), std::min(m_TileHeight, height - y * m_TileHeight), 1);
+		return region;
+	}
+}
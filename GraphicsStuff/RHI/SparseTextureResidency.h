@@ -0,0 +1,225 @@
+// Copyright 2018 Jelte Meganck. All Rights Reserved.
+//
+// SparseTextureResidency.h: Tile residency of sparse textures
+#pragma once
+#include <functional>
+#include <list>
+#include <vector>
+#include "../General/TypesAndMacros.h"
+#include "RHICommon.h"
+#include "RHIContext.h"
+
+namespace RHI {
+	class Texture;
+	class Buffer;
+
+	/**
+	 * Tile load callback, called when a tile was made resident, to write its texels
+	 * @param[in] pTexture	Sparse texture
+	 * @param[in] region	Region of the tile
+	 * @return				True if the tile was written, false otherwise, the tile is made non-resident again when it couldn't be written
+	 * @note				The contents of a tile are undefined until they are written, e.g. with Texture::Write
+	 */
+	typedef std::function<b8(Texture* pTexture, const TextureRegion& region)> SparseTileLoadCallback;
+
+	/**
+	 * Tile residency of a sparse texture, only the tiles the gpu asks for are kept resident in a fixed memory budget,
+	 * the least recently used tiles are evicted when the budget is full.
+	 * The gpu communicates with 2 storage buffers, containing a u32 for each tile of mip level 0 of each layer, at index (layer * tileCountY + y) * tileCountX + x,
+	 * each has a copy per frame in flight, a frame should bind the copies returned after its update:
+	 * - Feedback buffer: shaders write the finest mip level they want to sample with atomicMin, a copy is reset to 0xFFFFFFFF after it was read
+	 * - Page table buffer: the finest mip level that can be sampled, all coarser mip levels of the tile are resident as well,
+	 *   a value of the mip tail start means only the mip tail can be sampled
+	 * @note	The mip tail (the mip levels smaller than a tile) is always resident, its levels should be written once the residency is created
+	 */
+	class SparseTextureResidency
+	{
+	public:
+		SparseTextureResidency();
+		virtual ~SparseTextureResidency();
+
+		/**
+		 * Create the residency of a sparse texture
+		 * @param[in] pContext		RHI context
+		 * @param[in] pTexture		Texture, created with TextureFlags::Sparse
+		 * @param[in] memoryBudget	Amount of memory the tiles and mip tail can use
+		 * @return					True if the residency was created successfully, false otherwise
+		 */
+		virtual b8 Create(RHIContext* pContext, Texture* pTexture, u64 memoryBudget) = 0;
+		/**
+		 * Destroy the residency, all memory is unbound from the texture
+		 * @return	True if the residency was destroyed successfully, false otherwise
+		 * @note	The texture may not be used by the gpu anymore, it can only be destroyed after the residency
+		 */
+		virtual b8 Destroy() = 0;
+
+		/**
+		 * Update the residency from the feedback buffer, should be called once per frame, before the buffers of the frame are bound
+		 * @param[in] loadCallback	Callback to write the tiles that were made resident
+		 * @param[in] maxTileLoads	Maximum amount of tiles to make resident in this update, coarser mip levels are made resident first
+		 * @return					True if the residency was updated successfully, false otherwise
+		 * @note					Only the feedback copy of a completed frame is read, so requests arrive MaxFramesInFlight frames late.
+		 *							Evicted tiles are removed from the page table first, their memory is unbound once the frames that could still sample them completed
+		 */
+		b8 Update(const SparseTileLoadCallback& loadCallback, u32 maxTileLoads);
+
+		/**
+		 * Get the sparse texture
+		 * @return	Texture
+		 */
+		Texture* GetTexture() { return m_pTexture; }
+		/**
+		 * Get the copy of the feedback buffer of the current frame
+		 * @return	Feedback buffer
+		 */
+		Buffer* GetFeedbackBuffer() const;
+		/**
+		 * Get the copy of the page table buffer of the current frame
+		 * @return	Page table buffer
+		 */
+		Buffer* GetPageTableBuffer() const;
+		/**
+		 * Get the width of a tile
+		 * @return	Tile width in texels
+		 */
+		u32 GetTileWidth() const { return m_TileWidth; }
+		/**
+		 * Get the height of a tile
+		 * @return	Tile height in texels
+		 */
+		u32 GetTileHeight() const { return m_TileHeight; }
+		/**
+		 * Get the amount of tiles in a row of mip level 0
+		 * @return	Horizontal tile count
+		 */
+		u32 GetTileCountX() const { return m_Levels.empty() ? 0 : m_Levels[0].tileCountX; }
+		/**
+		 * Get the amount of tiles in a column of mip level 0
+		 * @return	Vertical tile count
+		 */
+		u32 GetTileCountY() const { return m_Levels.empty() ? 0 : m_Levels[0].tileCountY; }
+		/**
+		 * Get the first mip level of the mip tail
+		 * @return	First mip level of the mip tail, the mip level count if there is no mip tail
+		 */
+		u32 GetMipTailStart() const { return u32(m_Levels.size()); }
+		/**
+		 * Get the size of the memory of a tile
+		 * @return	Tile memory size
+		 */
+		u64 GetTileMemorySize() const { return m_TileMemorySize; }
+		/**
+		 * Get the amount of tiles that are resident
+		 * @return	Resident tile count
+		 */
+		u32 GetResidentTileCount() const { return m_SlotCount - u32(m_FreeSlots.size()); }
+		/**
+		 * Get the amount of tiles that fit in the memory budget
+		 * @return	Maximum resident tile count
+		 */
+		u32 GetMaxResidentTileCount() const { return m_SlotCount; }
+		/**
+		 * Get the memory budget
+		 * @return	Memory budget
+		 */
+		u64 GetMemoryBudget() const { return m_MemoryBudget; }
+
+	protected:
+		static const u32 InvalidSlot = u32(-1);	/**< Slot of a tile that isn't resident */
+
+		/**
+		 * Binding of a tile to a slot in the tile memory
+		 */
+		struct TileBinding
+		{
+			u32 tile;	/**< Index of the tile */
+			u32 slot;	/**< Slot in the tile memory, InvalidSlot to unbind the tile */
+		};
+
+		/**
+		 * Set up the tiles and page table, the texture and memory budget should be set
+		 * @param[in] tileWidth			Tile width in texels
+		 * @param[in] tileHeight		Tile height in texels
+		 * @param[in] mipTailStart		First mip level of the mip tail
+		 * @param[in] slotCount			Amount of tiles that fit in the tile memory
+		 * @param[in] tileMemorySize	Size of the memory of a tile
+		 */
+		void InitTiles(u32 tileWidth, u32 tileHeight, u32 mipTailStart, u32 slotCount, u64 tileMemorySize);
+		/**
+		 * Release the tiles and page table
+		 */
+		void ReleaseTiles();
+		/**
+		 * Write the initial contents of all copies of the feedback and page table buffer
+		 * @return	True if the buffers were written successfully, false otherwise
+		 */
+		b8 ResetBuffers();
+		/**
+		 * Get the index of the tile of a mip level that covers a tile of mip level 0
+		 * @param[in] layerOffset	Index of the first tile of the layer
+		 * @param[in] mipLevel		Mip level, before the mip tail
+		 * @param[in] x				Horizontal tile coordinate in mip level 0
+		 * @param[in] y				Vertical tile coordinate in mip level 0
+		 * @return					Index of the tile
+		 */
+		u32 GetTileIndex(u32 layerOffset, u32 mipLevel, u32 x, u32 y) const;
+		/**
+		 * Get the region of a tile
+		 * @param[in] tile	Index of the tile
+		 * @return			Texture region
+		 */
+		TextureRegion GetTileRegion(u32 tile) const;
+
+		/**
+		 * Bind and unbind tiles, the bindings should be finished when the function returns
+		 * @param[in] bindings	Tile bindings
+		 * @return				True if the tiles were bound successfully, false otherwise
+		 */
+		virtual b8 BindTiles(const std::vector<TileBinding>& bindings) = 0;
+
+		/**
+		 * Tiles of a mip level
+		 */
+		struct Level
+		{
+			u32 firstTile;		/**< Index of the first tile of the level in a layer */
+			u32 tileCountX;		/**< Amount of tiles in a row */
+			u32 tileCountY;		/**< Amount of tiles in a column */
+		};
+
+		/**
+		 * Tile of a mip level of a layer
+		 */
+		struct Tile
+		{
+			u32 slot;						/**< Slot in the tile memory, InvalidSlot if the tile isn't resident */
+			u64 lastUseFrame;				/**< Last frame the tile was requested */
+			u64 evictFrame;					/**< Frame of which the page table first left out the tile, only valid when the tile is evicted */
+			b8 evicted;						/**< If the tile is left out of the page table, while its memory is still bound */
+			std::list<u32>::iterator lruIt;	/**< Position in the LRU list, or in the evicted list when the tile is evicted, only valid when the tile is resident */
+		};
+
+		RHIContext* m_pContext;				/**< RHI context */
+		Texture* m_pTexture;				/**< Sparse texture */
+		Buffer* m_pFeedbackBuffers[MaxFramesInFlight];	/**< Copies of the feedback buffer, one per frame in flight */
+		Buffer* m_pPageTableBuffers[MaxFramesInFlight];	/**< Copies of the page table buffer, one per frame in flight */
+		u64 m_PageTableVersion;							/**< Version of the page table, incremented every time it changes */
+		u64 m_PageTableVersions[MaxFramesInFlight];		/**< Version of the page table in each copy of the page table buffer */
+		u64 m_MemoryBudget;					/**< Memory budget */
+		u64 m_TileMemorySize;				/**< Size of the memory of a tile */
+		u32 m_TileWidth;					/**< Tile width in texels */
+		u32 m_TileHeight;					/**< Tile height in texels */
+		u32 m_SlotCount;					/**< Amount of tiles that fit in the tile memory */
+		u32 m_TilesPerLayer;				/**< Amount of tiles in a layer, excluding the mip tail */
+		std::vector<Level> m_Levels;		/**< Mip levels before the mip tail */
+		std::vector<Tile> m_Tiles;			/**< Tiles of all layers */
+		std::vector<u32> m_FreeSlots;		/**< Free slots in the tile memory */
+		std::list<u32> m_LruTiles;			/**< Resident tiles, least recently used first */
+		std::list<u32> m_EvictedTiles;		/**< Evicted tiles whose memory is still bound, in the order they were evicted */
+		std::vector<u32> m_Feedback;		/**< Feedback, as read from the feedback buffer */
+		std::vector<u32> m_EmptyFeedback;	/**< Feedback without any requests, to reset the feedback buffer */
+		std::vector<u32> m_PageTable;		/**< Page table, as written to the page table buffer */
+		std::vector<u32> m_Requests;		/**< Tiles to make resident in the current update */
+	};
+
+}
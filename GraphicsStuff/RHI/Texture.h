@@ -2,6 +2,7 @@
 //
 // Texture.h: Texture
 #pragma once
+#include <string>
 #include "../General/TypesAndMacros.h"
 #include "PixelFormat.h"
 #include "RHICommon.h"
@@ -10,6 +11,7 @@ namespace RHI {
 	class RHIContext;
 	class Buffer;
 	class CommandList;
+	class MemoryHeap;
 
 	/**
 	* Texture description
@@ -26,6 +28,8 @@ namespace RHI {
 		TextureFlags flags				= TextureFlags::None;		/**< Texture flags */
 		SampleCount samples				= SampleCount::Sample1;		/**< Sample count */
 		TextureLayout layout			= TextureLayout::Unknown;	/**< Texture layout */
+		MemoryHeap* pHeap				= nullptr;					/**< Heap to place the texture in, nullptr to allocate its own memory */
+		u64 heapOffset					= 0;						/**< Offset in the heap, a multiple of the alignment of the memory requirements */
 	};
 
 	/**
@@ -48,6 +52,10 @@ namespace RHI {
 		 * @note					A dynamic texture has some restrictions:
 		 *							- Only 1 array layer is supported
 		 *							- Only 1 mip level is supported
+		 *							A sparse texture has some restrictions:
+		 *							- Only 2D textures and 2D texture arrays are supported
+		 *							- Only 1 sample is supported
+		 *							- It is always static, memory is bound per tile by a SparseTextureResidency
 		 */
 		virtual b8 Create(RHI::RHIContext* pContext, const TextureDesc& desc, CommandList* pCommandList) = 0;
 
@@ -158,10 +166,22 @@ namespace RHI {
 		 */
 		u64 GetMemorySize() const { return m_MemorySize; }
 
+		/**
+		 * Set the debug name, used to identify the texture in memory statistics
+		 * @param[in] name	Debug name
+		 */
+		void SetDebugName(const std::string& name) { m_DebugName = name; }
+		/**
+		 * Get the debug name
+		 * @return	Debug name, empty if no name was set
+		 */
+		const std::string& GetDebugName() const { return m_DebugName; }
+
 	protected:
 		RHI::RHIContext* m_pContext;		/**< RHI context */
 		TextureDesc m_Desc;					/**< Texture description */
 		u64 m_MemorySize;					/**< Size of the texture on the GPU */
+		std::string m_DebugName;			/**< Debug name */
 	};
 
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "../RHI/IDynamicRHI.h"
 #include "../RHI/Shader.h"
 #include "../RHI/Sampler.h"
+#include "../RHI/Texture.h"
+#include "../RHI/CommandList.h"
 
 #include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -12,13 +14,16 @@
 #include "../RHI/SwapChain.h"
 #include "../RHI/RenderTarget.h"
 #include "../RHI/DescriptorSetManager.h"
+#include <cassert>
 
 
 BasicScene::BasicScene()
 	: m_pVertShader(nullptr)
 	, m_pFragShader(nullptr)
 	, m_pSampler(nullptr)
+	, m_pTexture(nullptr)
 	, m_pUniformBuffer(nullptr)
+	, m_pPipeline(nullptr)
 {
 }
 
@@ -46,6 +51,35 @@ b8 BasicScene::Init()
 
 	m_pSampler = m_pRhi->CreateSampler(samplerDesc);
 
+	// The fragment shader samples a texture at binding 1, a single white texel leaves the vertex colors unchanged
+	RHI::TextureDesc textureDesc = {};
+	textureDesc.format = PixelFormat(PixelFormatComponents::R8G8B8A8, PixelFormatTransform::UNORM);
+	textureDesc.type = RHI::TextureType::Tex2D;
+	textureDesc.flags = RHI::TextureFlags::Static;
+	textureDesc.layout = RHI::TextureLayout::ShaderReadOnly;
+	m_pTexture = m_pRhi->CreateTexture(textureDesc);
+	if (!m_pTexture)
+		return false;
+
+	u32 texel = 0xFFFF'FFFF;
+	RHI::TextureRegion texelRegion = {};
+	texelRegion.layerCount = 1;
+	texelRegion.extent = glm::uvec3(1, 1, 1);
+	if (!m_pTexture->Write(texelRegion, sizeof(u32), &texel))
+		return false;
+
+	// Writing leaves the texture in the transfer layout
+	RHI::TextureLayoutTransition transition = {};
+	transition.layout = RHI::TextureLayout::ShaderReadOnly;
+	transition.layerCount = 1;
+	transition.mipLevelCount = 1;
+	RHI::CommandListManager* pCommandListManager = m_pRhi->GetCommandListManager();
+	RHI::Queue* pQueue = m_pRhi->GetContext()->GetQueue(RHI::QueueType::Graphics);
+	RHI::CommandList* pTransitionList = pCommandListManager->CreateSingleTimeCommandList(pQueue);
+	pTransitionList->TransitionTextureLayout(RHI::PipelineStage::Transfer, RHI::PipelineStage::FragmentShader, m_pTexture, transition);
+	if (!pCommandListManager->EndSingleTimeCommandList(pTransitionList))
+		return false;
+
 	std::vector<Vertex> vertices = {
 		//   position       normal        color        uv
 		{ {-64,  64, 0} , {0, 0, 1} , {1, 0, 0, 1} , {0, 0} },
@@ -54,8 +88,11 @@ b8 BasicScene::Init()
 		{ { 64, -64, 0} , {0, 0, 1} , {1, 1, 1, 1} , {0, 0} },
 	};
 
-	m_pVertexBuffer = m_pRhi->CreateVertexBuffer(u32(vertices.size()), sizeof(Vertex), RHI::BufferFlags::Static);
-	m_pVertexBuffer->Write(0, vertices.size() * sizeof(Vertex), vertices.data());
+	m_VertexArena.Create(m_pRhi, RHI::BufferType::Vertex, RHI::BufferFlags::Static, 4 * 1024 * 1024);
+	m_IndexArena.Create(m_pRhi, RHI::BufferType::Index, RHI::BufferFlags::Static, 1024 * 1024);
+
+	m_Vertices = m_VertexArena.AllocateVertices(u32(vertices.size()), sizeof(Vertex));
+	m_Vertices.pBuffer->Write(m_Vertices.offset, vertices.size() * sizeof(Vertex), vertices.data());
 
 
 	std::vector<i16> indices = {
@@ -63,11 +100,12 @@ b8 BasicScene::Init()
 		2, 3, 1
 	};
 
-	m_pIndexBuffer = m_pRhi->CreateIndexBuffer(u32(indices.size()), RHI::IndexType::UShort, RHI::BufferFlags::Static);
-	m_pIndexBuffer->Write(0, indices.size() * sizeof(i16), indices.data());
+	m_Indices = m_IndexArena.AllocateIndices(u32(indices.size()), RHI::IndexType::UShort);
+	m_Indices.pBuffer->Write(m_Indices.offset, indices.size() * sizeof(i16), indices.data());
 
 
 	m_pUniformBuffer = m_pRhi->CreateBuffer(RHI::BufferType::Uniform, sizeof(glm::mat4) * 3, RHI::BufferFlags::Dynamic);
+	m_pUniformBuffer->SetDebugName("BasicScene uniforms");
 
 	int windowWidth;
 	int windowHeight;
@@ -79,21 +117,40 @@ b8 BasicScene::Init()
 
 	m_pUniformBuffer->Write(0, sizeof(UBO), &m_Ubo);
 
+	if (!m_GpuCulling.Create(m_pRhi, 1))
+		return false;
+
+	GpuCulling::InstanceBounds quadBounds = {};
+	quadBounds.boundsMin = glm::vec4(-64, -64, 0, 0);
+	quadBounds.boundsMax = glm::vec4(64, 64, 0, 0);
+	quadBounds.indexCount = u32(indices.size());
+	quadBounds.firstIndex = m_Indices.GetFirstIndex(RHI::IndexType::UShort);
+	quadBounds.vertexOffset = i32(m_Vertices.GetVertexOffset(sizeof(Vertex)));
+	m_GpuCulling.SetInstances({ quadBounds });
+
+	// The model matrix is the identity, so the world bounds of the quad are its mesh bounds
+	m_SceneBvh.Insert(glm::vec3(quadBounds.boundsMin), glm::vec3(quadBounds.boundsMax));
+	m_SceneBvh.Build();
+
 
 	RHI::DescriptorSetManager* pDescriptorSetManager = m_pRhi->GetDescriptorSetManager();
 
-	std::vector<RHI::DescriptorSetBinding> bindings;
-	bindings.push_back({ RHI::DescriptorSetBindingType::Uniform, RHI::ShaderType::Vertex | RHI::ShaderType::Fragment, 1 });
+	// Derive the descriptor set layout from the shaders, so they can't drift apart
+	RHI::ShaderReflection reflection = m_pVertShader->GetReflection();
+	reflection.Merge(m_pFragShader->GetReflection());
 
-	m_pDescriptorSetLayout = pDescriptorSetManager->CreateDescriptorSetLayout(bindings);
+	std::vector<RHI::DescriptorSetLayout*> layouts;
+	if (!pDescriptorSetManager->CreateDescriptorSetLayouts(reflection, layouts))
+		return false;
+	assert(layouts.size() == 1);
+	m_pDescriptorSetLayout = layouts[0];
 
 	m_pDescriptorSet = pDescriptorSetManager->CreateDescriptorSet(m_pDescriptorSetLayout);
 	m_pDescriptorSet->Write(0, m_pUniformBuffer);
+	m_pDescriptorSet->Write(1, m_pTexture, m_pSampler);
 
 
 
-	RHI::CommandListManager* pCommandListManager = m_pRhi->GetCommandListManager();
-	RHI::Queue* pQueue = m_pRhi->GetContext()->GetQueue(RHI::QueueType::Graphics);
 	for (i32 i = 0; i < 3; ++i)
 	{
 		m_pCommandLists[i] = pCommandListManager->CreateCommandList(pQueue);
@@ -120,17 +177,51 @@ void BasicScene::Render(f32 dt)
 	if (pCommandList->GetState() != RHI::CommandListState::Finished)
 		pCommandList->Wait();
 
+	// The previous frame using this index is done, so resources retired MaxFramesInFlight frames ago and its transient descriptor sets can be released
+	m_pRhi->GetContext()->NextFrame();
+	m_pRhi->GetDescriptorSetManager()->BeginFrame(u32(index));
+	m_pRhi->GetContext()->UpdateMemoryBudgets();
+	// Spread defragmentation over frames, so the copies don't cause hitches
+	m_pRhi->GetContext()->DefragmentMemory(8 * 1024 * 1024);
+
 	pCommandList->Begin();
 
-	pCommandList->BeginRenderPass(m_pRenderPass, m_pFrameBuffers[index]);
+	// The hierarchy rejects whole groups of meshes on the cpu, the gpu pass only runs when some of them can be visible
+	glm::vec4 planes[6];
+	GpuCulling::ExtractFrustumPlanes(m_Ubo.projMatrix * m_Ubo.viewMatrix, planes);
+	m_VisibleObjects.clear();
+	m_SceneBvh.Cull(planes, m_VisibleObjects);
+	assert(m_SceneBvh.ValidateCull(planes));
+	b8 anyVisible = !m_VisibleObjects.empty();
+
+	// Culling writes the indirect draws with a compute pass, so it has to be recorded before rendering begins
+	if (anyVisible)
+		m_GpuCulling.Cull(pCommandList, m_Ubo.projMatrix * m_Ubo.viewMatrix * m_Ubo.modelMatrix, u32(index));
+
+	// Render straight to the swapchain image, without render pass and framebuffer objects
+	RHI::RenderTarget* pColorRT = m_pSwapChain->GetRenderTarget(index);
+	RHI::RenderingDesc renderingDesc;
+	renderingDesc.colorAttachmentCount = 1;
+	renderingDesc.colorAttachments[0].pRenderTarget = pColorRT;
+	renderingDesc.colorAttachments[0].loadOp = RHI::LoadOp::Clear;
+	renderingDesc.colorAttachments[0].storeOp = RHI::StoreOp::Store;
+	renderingDesc.depthStencilAttachment.pRenderTarget = m_pDepthStencils[index];
+	renderingDesc.depthStencilAttachment.loadOp = RHI::LoadOp::Clear;
+	renderingDesc.depthStencilAttachment.storeOp = RHI::StoreOp::DontCare;
+	pCommandList->BeginRendering(renderingDesc);
+
+	pCommandList->SetViewport(RHI::Viewport(0.f, 0.f, f32(pColorRT->GetWidth()), f32(pColorRT->GetHeight())));
+	pCommandList->SetScissor(RHI::ScissorRect(0, 0, pColorRT->GetWidth(), pColorRT->GetHeight()));
 
 	pCommandList->BindPipeline(m_pPipeline);
-	pCommandList->BindVertexBuffer(0, m_pVertexBuffer, 0);
-	pCommandList->BindIndexBuffer(m_pIndexBuffer, 0, RHI::IndexType::UShort);
+	// The arena buffers are bound at offset 0, the culled draws select the mesh with its first index and vertex offset
+	pCommandList->BindVertexBuffer(0, m_Vertices.pBuffer, 0);
+	pCommandList->BindIndexBuffer(m_Indices.pBuffer, 0, RHI::IndexType::UShort);
 	pCommandList->BindDescriptorSets(0, m_pDescriptorSet);
 
-	pCommandList->DrawIndexed(6);
-	pCommandList->EndRenderPass();
+	if (anyVisible)
+		m_GpuCulling.Draw(pCommandList);
+	pCommandList->EndRendering();
 
 	pCommandList->End();
 
@@ -158,16 +249,21 @@ b8 BasicScene::Shutdown()
 
 
 	SizeDependDestroy(false);
+	m_pRhi->DestroyPipeline(m_pPipeline);
+	m_GpuCulling.Destroy();
 
 	RHI::DescriptorSetManager* pDescriptorSetManager = m_pRhi->GetDescriptorSetManager();
 
 	pDescriptorSetManager->DestroyDescriptorSet(m_pDescriptorSet);
 	pDescriptorSetManager->DestroyDescriptorSetLayout(m_pDescriptorSetLayout);
 
-	m_pRhi->DestroyBuffer(m_pVertexBuffer);
-	m_pRhi->DestroyBuffer(m_pIndexBuffer);
+	m_VertexArena.Free(m_Vertices);
+	m_IndexArena.Free(m_Indices);
+	m_VertexArena.Destroy();
+	m_IndexArena.Destroy();
 	m_pRhi->DestroyBuffer(m_pUniformBuffer);
 
+	m_pRhi->DestroyTexture(m_pTexture);
 	m_pRhi->DestroySampler(m_pSampler);
 	m_pRhi->DestroyShader(m_pVertShader);
 	m_pRhi->DestroyShader(m_pFragShader);
@@ -188,66 +284,57 @@ void BasicScene::SizeDependCreate()
 		m_pSwapChain = m_pRhi->CreateSwapChain(m_pWindow, RHI::VSyncMode::Tripple);
 	}
 
-	// Render pass
-	std::vector<RHI::RenderPassAttachment> attachments;
+	// The pipeline only depends on the attachment formats, so it survives resizes
+	if (!m_pPipeline)
+		CreatePipeline();
 
-	RHI::RenderPassAttachment attachment = {};
-	attachment.format = m_pSwapChain->GetCurrentRenderTarget()->GetTexture()->GetFormat();
-	attachment.type = RHI::RenderTargetType::Presentable;
-	attachment.samples = RHI::SampleCount::Sample1;
-	attachment.storeOp = RHI::StoreOp::Store;
-	attachment.loadOp = RHI::LoadOp::Clear;
-	attachments.push_back(attachment);
+	int windowWidth;
+	int windowHeight;
+	glfwGetWindowSize(m_pWindow, &windowWidth, &windowHeight);
 
-	RHI::RenderPassAttachmentRef attachmentRef;
-	attachmentRef.index = 0;
-	attachmentRef.type = RHI::RenderTargetType::Presentable;
+	// Depth stencils
+	RHI::RenderTargetDesc depthDesc = {};
+	depthDesc.type = RHI::RenderTargetType::DepthStencil;
+	depthDesc.width = windowWidth;
+	depthDesc.height = windowHeight;
+	depthDesc.samples = RHI::SampleCount::Sample1;
+	depthDesc.format = PixelFormat(PixelFormatComponents::D32, PixelFormatTransform::SFLOAT);
+	// Depth is cleared and discarded every frame, so it never needs to be stored in memory
+	depthDesc.transient = true;
 
-	RHI::SubRenderPass subpass;
-	subpass.attachments.push_back(attachmentRef);
+	for (i32 i = 0; i < 3; ++i)
+	{
+		m_pDepthStencils[i] = m_pRhi->CreateRenderTarget(depthDesc);
+		m_pDepthStencils[i]->GetTexture()->SetDebugName("BasicScene depth stencil");
+	}
 
-	attachment.format = PixelFormat(PixelFormatComponents::D32, PixelFormatTransform::SFLOAT);
-	attachment.type = RHI::RenderTargetType::DepthStencil;
-	attachment.samples = RHI::SampleCount::Sample1;
-	attachment.storeOp = RHI::StoreOp::DontCare;
-	attachment.loadOp = RHI::LoadOp::Clear;
-	attachments.push_back(attachment);
+}
 
-	attachmentRef.index = 1;
-	attachmentRef.type = RHI::RenderTargetType::DepthStencil;
-	subpass.attachments.push_back(attachmentRef);
+void BasicScene::SizeDependDestroy(b8 destroySwapChain)
+{
 
-	std::vector<RHI::SubRenderPass> subpasses;
-	subpasses.push_back(subpass);
+	for (i32 i = 0; i < 3; ++i)
+	{
+		m_pRhi->DestroyRenderTarget(m_pDepthStencils[i]);
+	}
 
-	m_pRenderPass = m_pRhi->CreateRenderPass(attachments, subpasses);
+	if (destroySwapChain)
+	{
+		m_pRhi->DestroySwapChain(m_pSwapChain);
+	}
+}
 
-	// Pipeline
-	int windowWidth;
-	int windowHeight;
-	glfwGetWindowSize(m_pWindow, &windowWidth, &windowHeight);
+void BasicScene::CreatePipeline()
+{
+	// Viewport and scissor are dynamic, so the pipeline doesn't depend on the window size
 	RHI::GraphicsPipelineDesc pipelineDesc = {};
-	pipelineDesc.viewport.x = 0.f;
-	pipelineDesc.viewport.y = 0.f;
-	pipelineDesc.viewport.width = f32(windowWidth);
-	pipelineDesc.viewport.height = f32(windowHeight);
-	pipelineDesc.viewport.minDepth = 0.f;
-	pipelineDesc.viewport.maxDepth = 1.f;
-	pipelineDesc.scissor.x = 0;
-	pipelineDesc.scissor.y = 0;
-	pipelineDesc.scissor.width = windowWidth;
-	pipelineDesc.scissor.height = windowHeight;
 
 	pipelineDesc.pVertexShader = m_pVertShader;
 	pipelineDesc.pFragmentShader = m_pFragShader;
 
-	// Vertex Layout
-	RHI::InputDescriptor inputDesc;
-	inputDesc.Append(RHI::InputElementDesc(RHI::InputSemantic::Position, 0, RHI::InputElementType::Float3, 0              , 0, 0));
-	inputDesc.Append(RHI::InputElementDesc(RHI::InputSemantic::Normal  , 0, RHI::InputElementType::Float3, 3  * sizeof(f32), 0, 0));
-	inputDesc.Append(RHI::InputElementDesc(RHI::InputSemantic::Color   , 0, RHI::InputElementType::Float4, 6  * sizeof(f32), 0, 0));
-	inputDesc.Append(RHI::InputElementDesc(RHI::InputSemantic::TexCoord, 0, RHI::InputElementType::Float2, 10 * sizeof(f32), 0, 0));
-	pipelineDesc.inputDescriptor = inputDesc;
+	// Vertex Layout, the vertex shader inputs are tightly packed in the same order as the Vertex members
+	pipelineDesc.inputDescriptor = m_pVertShader->GetReflection().GetInputDescriptor();
+	assert(pipelineDesc.inputDescriptor.GetInputSize(0) == sizeof(Vertex));
 
 	RHI::BlendAttachment blendAttachment = {};
 	blendAttachment.components = RHI::ColorComponentMask::R | RHI::ColorComponentMask::G | RHI::ColorComponentMask::B | RHI::ColorComponentMask::A;
@@ -259,7 +346,10 @@ void BasicScene::SizeDependCreate()
 
 	pipelineDesc.primitiveTopology = RHI::PrimitiveTopology::Triangle;
 
-	pipelineDesc.pRenderPass = m_pRenderPass;
+	pipelineDesc.pRenderPass = nullptr;
+	pipelineDesc.renderingFormats.colorFormatCount = 1;
+	pipelineDesc.renderingFormats.colorFormats[0] = m_pSwapChain->GetCurrentRenderTarget()->GetTexture()->GetFormat();
+	pipelineDesc.renderingFormats.depthStencilFormat = PixelFormat(PixelFormatComponents::D32, PixelFormatTransform::SFLOAT);
 
 	pipelineDesc.descriptorSetLayouts.push_back(m_pDescriptorSet->GetLayout());
 
@@ -269,42 +359,4 @@ void BasicScene::SizeDependCreate()
 	depthStencil.depthCompareOp = RHI::CompareOp::Greater;
 
 	m_pPipeline = m_pRhi->CreatePipeline(pipelineDesc);
-
-	// Framebuffers and depth stencils
-	RHI::RenderTargetDesc depthDesc = {};
-	depthDesc.type = RHI::RenderTargetType::DepthStencil;
-	depthDesc.width = windowWidth;
-	depthDesc.height = windowHeight;
-	depthDesc.samples = RHI::SampleCount::Sample1;
-	depthDesc.format = PixelFormat(PixelFormatComponents::D32, PixelFormatTransform::SFLOAT);
-
-	for (i32 i = 0; i < 3; ++i)
-	{
-		RHI::RenderTarget* pColorRT = m_pSwapChain->GetRenderTarget(i);
-
-		m_pDepthStencils[i] = m_pRhi->CreateRenderTarget(depthDesc);
-
-		std::vector<RHI::RenderTarget*> pRTs = { pColorRT, m_pDepthStencils[i] };
-
-		m_pFrameBuffers[i] = m_pRhi->CreateFramebuffer(pRTs, m_pRenderPass);
-	}
-
-}
-
-void BasicScene::SizeDependDestroy(b8 destroySwapChain)
-{
-
-	for (i32 i = 0; i < 3; ++i)
-	{
-		m_pRhi->DestroyFramebuffer(m_pFrameBuffers[i]);
-		m_pRhi->DestroyRenderTarget(m_pDepthStencils[i]);
-	}
-
-	m_pRhi->DestroyPipeline(m_pPipeline);
-	m_pRhi->DestroyRenderPass(m_pRenderPass);
-
-	if (destroySwapChain)
-	{
-		m_pRhi->DestroySwapChain(m_pSwapChain);
-	}
 }
@@ -1,18 +1,20 @@
 #pragma once
 #include "Scene.h"
 #include "../RHI/Buffer.h"
+#include "../RHI/BufferArena.h"
+#include "GpuCulling.h"
+#include "SceneBvh.h"
 
 #include <glm/glm.hpp>
 #include "../RHI/DescriptorSetLayout.h"
 
 namespace RHI {
-	class Framebuffer;
 	class Pipeline;
-	class RenderPass;
 	class DescriptorSet;
 	class RenderTarget;
 	class Sampler;
 	class Shader;
+	class Texture;
 }
 
 class BasicScene : public Scene
@@ -48,24 +50,33 @@ public:
 private:
 	void SizeDependCreate();
 	void SizeDependDestroy(b8 destroySwapChain);
+	void CreatePipeline();
 
 	RHI::Shader* m_pVertShader;
 	RHI::Shader* m_pFragShader;
 
 	RHI::Sampler* m_pSampler;
+	RHI::Texture* m_pTexture;
 
-	RHI::Buffer* m_pVertexBuffer;
-	RHI::Buffer* m_pIndexBuffer;
+	// Meshes sub-allocate their vertices and indices from shared buffers
+	RHI::BufferArena m_VertexArena;
+	RHI::BufferArena m_IndexArena;
+	RHI::BufferRange m_Vertices;
+	RHI::BufferRange m_Indices;
 	RHI::Buffer* m_pUniformBuffer;
 
 	RHI::DescriptorSet* m_pDescriptorSet;
 	RHI::DescriptorSetLayout* m_pDescriptorSetLayout;
 
-	RHI::RenderPass* m_pRenderPass;
 	RHI::Pipeline* m_pPipeline;
 
+	// Meshes are frustum culled on the gpu and drawn from the compacted indirect draws
+	GpuCulling m_GpuCulling;
+	// World bounds of the meshes, culled on the cpu to skip the gpu pass when nothing can be visible
+	SceneBvh m_SceneBvh;
+	std::vector<SceneBvh::ObjectId> m_VisibleObjects;
+
 	RHI::CommandList* m_pCommandLists[3];
-	RHI::Framebuffer* m_pFrameBuffers[3];
 	RHI::RenderTarget* m_pDepthStencils[3];
 
 	UBO m_Ubo;
@@ -0,0 +1,188 @@
+#include <cassert>
+#include "GpuCulling.h"
+#include "../RHI/IDynamicRHI.h"
+#include "../RHI/Shader.h"
+#include "../RHI/Buffer.h"
+#include "../RHI/CommandList.h"
+#include "../RHI/DescriptorSetManager.h"
+#include "../RHI/DescriptorSet.h"
+
+#define CULL_GROUP_SIZE 64
+
+GpuCulling::GpuCulling()
+	: m_pRhi(nullptr)
+	, m_MaxInstances(0)
+	, m_InstanceCount(0)
+	, m_pCullShader(nullptr)
+	, m_pCullPipeline(nullptr)
+	, m_pDescriptorSetLayout(nullptr)
+	, m_pDescriptorSets()
+	, m_pParamBuffers()
+	, m_pInstanceBuffer(nullptr)
+	, m_pDrawBuffer(nullptr)
+	, m_pCountBuffer(nullptr)
+{
+}
+
+GpuCulling::~GpuCulling()
+{
+}
+
+b8 GpuCulling::Create(RHI::IDynamicRHI* pRhi, u32 maxInstances)
+{
+	m_pRhi = pRhi;
+	m_MaxInstances = maxInstances;
+
+	RHI::ShaderDesc cullShader = { RHI::ShaderType::Compute, "Shaders/Cull_comp.spv", "main", RHI::ShaderLanguage::Spirv };
+	m_pCullShader = m_pRhi->CreateShader(cullShader);
+	if (!m_pCullShader)
+		return false;
+
+	// Buffers
+	for (i32 i = 0; i < 3; ++i)
+	{
+		m_pParamBuffers[i] = m_pRhi->CreateBuffer(RHI::BufferType::Uniform, sizeof(CullParams), RHI::BufferFlags::Dynamic);
+		m_pParamBuffers[i]->SetDebugName("GpuCulling params");
+	}
+	m_pInstanceBuffer = m_pRhi->CreateBuffer(RHI::BufferType::Storage, sizeof(InstanceBounds) * maxInstances, RHI::BufferFlags::None);
+	m_pDrawBuffer = m_pRhi->CreateBuffer(RHI::BufferType::Storage | RHI::BufferType::Indirect, sizeof(RHI::DrawIndexedIndirectCommand) * maxInstances, RHI::BufferFlags::Static);
+	m_pCountBuffer = m_pRhi->CreateBuffer(RHI::BufferType::Storage | RHI::BufferType::Indirect, sizeof(u32), RHI::BufferFlags::Static);
+	m_pInstanceBuffer->SetDebugName("GpuCulling instances");
+	m_pDrawBuffer->SetDebugName("GpuCulling draws");
+	m_pCountBuffer->SetDebugName("GpuCulling draw count");
+
+	// Descriptor sets
+	RHI::DescriptorSetManager* pDescriptorSetManager = m_pRhi->GetDescriptorSetManager();
+
+	std::vector<RHI::DescriptorSetBinding> bindings;
+	bindings.push_back({ RHI::DescriptorSetBindingType::Uniform, RHI::ShaderType::Compute, 1 });
+	bindings.push_back({ RHI::DescriptorSetBindingType::Storage, RHI::ShaderType::Compute, 1 });
+	bindings.push_back({ RHI::DescriptorSetBindingType::Storage, RHI::ShaderType::Compute, 1 });
+	bindings.push_back({ RHI::DescriptorSetBindingType::Storage, RHI::ShaderType::Compute, 1 });
+
+	m_pDescriptorSetLayout = pDescriptorSetManager->CreateDescriptorSetLayout(bindings);
+
+	// Only the param buffer differs between frames, so the packed data is shared
+	std::vector<u8> packedData(m_pDescriptorSetLayout->GetPackedDataSize());
+	m_pDescriptorSetLayout->PackBuffer(packedData.data(), 1, m_pInstanceBuffer);
+	m_pDescriptorSetLayout->PackBuffer(packedData.data(), 2, m_pDrawBuffer);
+	m_pDescriptorSetLayout->PackBuffer(packedData.data(), 3, m_pCountBuffer);
+
+	for (i32 i = 0; i < 3; ++i)
+	{
+		m_pDescriptorSets[i] = pDescriptorSetManager->CreateDescriptorSet(m_pDescriptorSetLayout);
+		m_pDescriptorSetLayout->PackBuffer(packedData.data(), 0, m_pParamBuffers[i]);
+		m_pDescriptorSets[i]->WriteAll(packedData.data());
+	}
+
+	// Pipeline
+	RHI::ComputePipelineDesc pipelineDesc = {};
+	pipelineDesc.pComputeShader = m_pCullShader;
+	pipelineDesc.descriptorSetLayouts.push_back(m_pDescriptorSetLayout);
+
+	m_pCullPipeline = m_pRhi->CreatePipeline(pipelineDesc);
+	if (!m_pCullPipeline)
+		return false;
+
+	return true;
+}
+
+void GpuCulling::Destroy()
+{
+	if (m_pCullPipeline)
+		m_pRhi->DestroyPipeline(m_pCullPipeline);
+
+	RHI::DescriptorSetManager* pDescriptorSetManager = m_pRhi->GetDescriptorSetManager();
+	for (i32 i = 0; i < 3; ++i)
+	{
+		if (m_pDescriptorSets[i])
+			pDescriptorSetManager->DestroyDescriptorSet(m_pDescriptorSets[i]);
+		if (m_pParamBuffers[i])
+			m_pRhi->DestroyBuffer(m_pParamBuffers[i]);
+	}
+	if (m_pDescriptorSetLayout)
+		pDescriptorSetManager->DestroyDescriptorSetLayout(m_pDescriptorSetLayout);
+
+	if (m_pInstanceBuffer)
+		m_pRhi->DestroyBuffer(m_pInstanceBuffer);
+	if (m_pDrawBuffer)
+		m_pRhi->DestroyBuffer(m_pDrawBuffer);
+	if (m_pCountBuffer)
+		m_pRhi->DestroyBuffer(m_pCountBuffer);
+
+	if (m_pCullShader)
+		m_pRhi->DestroyShader(m_pCullShader);
+}
+
+void GpuCulling::SetInstances(const std::vector<InstanceBounds>& instances)
+{
+	assert(instances.size() <= m_MaxInstances);
+	m_InstanceCount = u32(instances.size());
+	if (m_InstanceCount > 0)
+		m_pInstanceBuffer->Write(0, instances.size() * sizeof(InstanceBounds), (void*)instances.data());
+}
+
+void GpuCulling::Cull(RHI::CommandList* pCommandList, const glm::mat4& viewProj, u32 frameIndex)
+{
+	CullParams params = {};
+	ExtractFrustumPlanes(viewProj, params.planes);
+	params.instanceCount = m_InstanceCount;
+	m_pParamBuffers[frameIndex]->Write(0, sizeof(CullParams), &params);
+
+	b8 hasCountDraw = pCommandList->IsDrawIndirectCountSupported();
+
+	// The previous frame needs to be done reading the draws before they are reset
+	pCommandList->BufferBarrier(RHI::PipelineStage::DrawIndirect, RHI::PipelineStage::Transfer, m_pCountBuffer);
+	pCommandList->BufferBarrier(RHI::PipelineStage::DrawIndirect, RHI::PipelineStage::Transfer, m_pDrawBuffer);
+
+	pCommandList->FillBuffer(m_pCountBuffer, 0, u64(-1), 0);
+	// Without a count buffer, all draws are issued, so culled slots need to be empty draws
+	if (!hasCountDraw)
+		pCommandList->FillBuffer(m_pDrawBuffer, 0, u64(-1), 0);
+
+	pCommandList->BufferBarrier(RHI::PipelineStage::Transfer, RHI::PipelineStage::ComputeShader, m_pCountBuffer);
+	pCommandList->BufferBarrier(RHI::PipelineStage::Transfer, RHI::PipelineStage::ComputeShader, m_pDrawBuffer);
+
+	pCommandList->BindPipeline(m_pCullPipeline);
+	pCommandList->BindDescriptorSets(0, m_pDescriptorSets[frameIndex]);
+	pCommandList->Dispatch((m_InstanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+
+	pCommandList->BufferBarrier(RHI::PipelineStage::ComputeShader, RHI::PipelineStage::DrawIndirect, m_pDrawBuffer);
+	pCommandList->BufferBarrier(RHI::PipelineStage::ComputeShader, RHI::PipelineStage::DrawIndirect, m_pCountBuffer);
+}
+
+void GpuCulling::Draw(RHI::CommandList* pCommandList)
+{
+	if (m_InstanceCount == 0)
+		return;
+
+	if (pCommandList->IsDrawIndirectCountSupported())
+		pCommandList->DrawIndexedIndirectCount(m_pDrawBuffer, 0, m_pCountBuffer, 0, m_InstanceCount);
+	else
+		pCommandList->DrawIndexedIndirect(m_pDrawBuffer, 0, m_InstanceCount);
+}
+
+void GpuCulling::ExtractFrustumPlanes(const glm::mat4& viewProj, glm::vec4 planes[6])
+{
+	// glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+	glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+	glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+	glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+	planes[0] = row3 + row0;	// Left
+	planes[1] = row3 - row0;	// Right
+	planes[2] = row3 + row1;	// Bottom
+	planes[3] = row3 - row1;	// Top
+	planes[4] = row2;			// Near
+	planes[5] = row3 - row2;	// Far
+
+	for (i32 i = 0; i < 6; ++i)
+	{
+		f32 length = glm::length(glm::vec3(planes[i]));
+		if (length > 0.f)
+			planes[i] /= length;
+	}
+}
+
+#undef CULL_GROUP_SIZE
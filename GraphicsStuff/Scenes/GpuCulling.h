@@ -0,0 +1,100 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "../General/TypesAndMacros.h"
+
+namespace RHI {
+	class IDynamicRHI;
+	class Buffer;
+	class CommandList;
+	class DescriptorSet;
+	class DescriptorSetLayout;
+	class Pipeline;
+	class Shader;
+}
+
+/**
+ * GPU frustum culling
+ * A compute pass tests per-instance bounds against the camera frustum and writes a compacted DrawIndexedIndirectCommand stream and draw count,
+ * which the main pass consumes with a single indirect count draw
+ */
+class GpuCulling
+{
+public:
+	/**
+	 * Per-instance cull input (std430 layout, matches Cull.comp)
+	 */
+	struct InstanceBounds
+	{
+		glm::vec4 boundsMin;	/**< AABB min (w unused) */
+		glm::vec4 boundsMax;	/**< AABB max (w unused) */
+		u32 indexCount;			/**< Amount of indices to draw */
+		u32 firstIndex;			/**< Index of index to start drawing from */
+		i32 vertexOffset;		/**< Offset in vertex buffer */
+		u32 padding;
+	};
+
+	GpuCulling();
+	~GpuCulling();
+
+	/**
+	 * Create the culling resources
+	 * @param[in] pRhi			Dynamic RHI
+	 * @param[in] maxInstances	Maximum amount of instances that can be culled
+	 * @return					True if the culling resources were created successfully, false otherwise
+	 * @note					Shaders/Cull_comp.spv is compiled from Cull.comp by compile.bat, creation fails when it is missing
+	 */
+	b8 Create(RHI::IDynamicRHI* pRhi, u32 maxInstances);
+	/**
+	 * Destroy the culling resources
+	 */
+	void Destroy();
+
+	/**
+	 * Upload the instance bounds
+	 * @param[in] instances	Instance bounds
+	 */
+	void SetInstances(const std::vector<InstanceBounds>& instances);
+
+	/**
+	 * Record the culling pass (outside of a render pass)
+	 * @param[in] pCommandList	Command list to record to
+	 * @param[in] viewProj		View projection matrix of the camera
+	 * @param[in] frameIndex	Index of the frame in flight (0-2)
+	 */
+	void Cull(RHI::CommandList* pCommandList, const glm::mat4& viewProj, u32 frameIndex);
+	/**
+	 * Draw the visible instances (inside a render pass, with the pipeline and vertex/index buffers bound)
+	 * @param[in] pCommandList	Command list to record to
+	 */
+	void Draw(RHI::CommandList* pCommandList);
+
+	/**
+	 * Extract normalized frustum planes from a view projection matrix (depth range [0, 1])
+	 * @param[in] viewProj	View projection matrix
+	 * @param[out] planes	Left, right, bottom, top, near and far plane
+	 */
+	static void ExtractFrustumPlanes(const glm::mat4& viewProj, glm::vec4 planes[6]);
+
+private:
+	struct CullParams
+	{
+		glm::vec4 planes[6];
+		u32 instanceCount;
+		u32 padding[3];
+	};
+
+	RHI::IDynamicRHI* m_pRhi;
+	u32 m_MaxInstances;
+	u32 m_InstanceCount;
+
+	RHI::Shader* m_pCullShader;
+	RHI::Pipeline* m_pCullPipeline;
+	RHI::DescriptorSetLayout* m_pDescriptorSetLayout;
+	RHI::DescriptorSet* m_pDescriptorSets[3];
+
+	RHI::Buffer* m_pParamBuffers[3];
+	RHI::Buffer* m_pInstanceBuffer;
+	RHI::Buffer* m_pDrawBuffer;
+	RHI::Buffer* m_pCountBuffer;
+};
@@ -0,0 +1,556 @@
+#include "SceneBvh.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <immintrin.h>
+
+namespace {
+
+	/**
+	 * Frustum planes broadcast to SIMD registers, with the per plane selection of the AABB corners to test
+	 */
+	struct SimdFrustum
+	{
+		__m128 nx[6];
+		__m128 ny[6];
+		__m128 nz[6];
+		__m128 w[6];
+		b8 positive[6][3];
+#ifdef __AVX__
+		__m256 nx8[6];
+		__m256 ny8[6];
+		__m256 nz8[6];
+		__m256 w8[6];
+#endif
+
+		explicit SimdFrustum(const glm::vec4 planes[6])
+		{
+			for (u32 i = 0; i < 6; ++i)
+			{
+				nx[i] = _mm_set1_ps(planes[i].x);
+				ny[i] = _mm_set1_ps(planes[i].y);
+				nz[i] = _mm_set1_ps(planes[i].z);
+				w[i] = _mm_set1_ps(planes[i].w);
+				positive[i][0] = planes[i].x >= 0.f;
+				positive[i][1] = planes[i].y >= 0.f;
+				positive[i][2] = planes[i].z >= 0.f;
+#ifdef __AVX__
+				nx8[i] = _mm256_set1_ps(planes[i].x);
+				ny8[i] = _mm256_set1_ps(planes[i].y);
+				nz8[i] = _mm256_set1_ps(planes[i].z);
+				w8[i] = _mm256_set1_ps(planes[i].w);
+#endif
+			}
+		}
+	};
+
+	/**
+	 * Test 4 AABBs against the frustum
+	 * @param[out] insideMask	Mask of boxes completely inside the frustum
+	 * @return					Mask of boxes that are (partially) inside the frustum
+	 */
+	inline u32 TestBoxes4(const SimdFrustum& frustum, const f32* minX, const f32* minY, const f32* minZ, const f32* maxX, const f32* maxY, const f32* maxZ, u32& insideMask)
+	{
+		__m128 bMinX = _mm_loadu_ps(minX);
+		__m128 bMinY = _mm_loadu_ps(minY);
+		__m128 bMinZ = _mm_loadu_ps(minZ);
+		__m128 bMaxX = _mm_loadu_ps(maxX);
+		__m128 bMaxY = _mm_loadu_ps(maxY);
+		__m128 bMaxZ = _mm_loadu_ps(maxZ);
+
+		__m128 zero = _mm_setzero_ps();
+		__m128 outside = zero;
+		__m128 intersect = zero;
+		for (u32 i = 0; i < 6; ++i)
+		{
+			// Positive vertex (furthest along the normal) decides if the box is outside, the negative vertex if it is fully inside
+			__m128 px = frustum.positive[i][0] ? bMaxX : bMinX;
+			__m128 py = frustum.positive[i][1] ? bMaxY : bMinY;
+			__m128 pz = frustum.positive[i][2] ? bMaxZ : bMinZ;
+			__m128 nx = frustum.positive[i][0] ? bMinX : bMaxX;
+			__m128 ny = frustum.positive[i][1] ? bMinY : bMaxY;
+			__m128 nz = frustum.positive[i][2] ? bMinZ : bMaxZ;
+
+			__m128 pd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, frustum.nx[i]), _mm_mul_ps(py, frustum.ny[i])), _mm_add_ps(_mm_mul_ps(pz, frustum.nz[i]), frustum.w[i]));
+			__m128 nd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, frustum.nx[i]), _mm_mul_ps(ny, frustum.ny[i])), _mm_add_ps(_mm_mul_ps(nz, frustum.nz[i]), frustum.w[i]));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(pd, zero));
+			intersect = _mm_or_ps(intersect, _mm_cmplt_ps(nd, zero));
+		}
+
+		u32 outsideMask = u32(_mm_movemask_ps(outside));
+		insideMask = ~u32(_mm_movemask_ps(intersect)) & ~outsideMask & 0xF;
+		return ~outsideMask & 0xF;
+	}
+
+	/**
+	 * Test 8 AABBs against the frustum (no inside test, used for leaves)
+	 * @return	Mask of boxes that are (partially) inside the frustum
+	 */
+	inline u32 TestBoxes8(const SimdFrustum& frustum, const f32* minX, const f32* minY, const f32* minZ, const f32* maxX, const f32* maxY, const f32* maxZ)
+	{
+#ifdef __AVX__
+		__m256 bMinX = _mm256_loadu_ps(minX);
+		__m256 bMinY = _mm256_loadu_ps(minY);
+		__m256 bMinZ = _mm256_loadu_ps(minZ);
+		__m256 bMaxX = _mm256_loadu_ps(maxX);
+		__m256 bMaxY = _mm256_loadu_ps(maxY);
+		__m256 bMaxZ = _mm256_loadu_ps(maxZ);
+
+		__m256 zero = _mm256_setzero_ps();
+		__m256 outside = zero;
+		for (u32 i = 0; i < 6; ++i)
+		{
+			__m256 px = frustum.positive[i][0] ? bMaxX : bMinX;
+			__m256 py = frustum.positive[i][1] ? bMaxY : bMinY;
+			__m256 pz = frustum.positive[i][2] ? bMaxZ : bMinZ;
+
+			__m256 pd = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, frustum.nx8[i]), _mm256_mul_ps(py, frustum.ny8[i])), _mm256_add_ps(_mm256_mul_ps(pz, frustum.nz8[i]), frustum.w8[i]));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(pd, zero, _CMP_LT_OQ));
+		}
+		return ~u32(_mm256_movemask_ps(outside)) & 0xFF;
+#else
+		u32 insideMask;
+		u32 lo = TestBoxes4(frustum, minX, minY, minZ, maxX, maxY, maxZ, insideMask);
+		u32 hi = TestBoxes4(frustum, minX + 4, minY + 4, minZ + 4, maxX + 4, maxY + 4, maxZ + 4, insideMask);
+		return lo | (hi << 4);
+#endif
+	}
+}
+
+SceneBvh::SceneBvh()
+	: m_Root(EmptyChild)
+	, m_NeedsRebuild(false)
+{
+}
+
+SceneBvh::~SceneBvh()
+{
+}
+
+SceneBvh::ObjectId SceneBvh::Insert(const glm::vec3& min, const glm::vec3& max)
+{
+	ObjectId id;
+	if (m_FreeObjects.size() > 0)
+	{
+		id = m_FreeObjects.back();
+		m_FreeObjects.pop_back();
+	}
+	else
+	{
+		id = ObjectId(m_Objects.size());
+		m_Objects.push_back({});
+	}
+
+	Object& object = m_Objects[id];
+	object.min = min;
+	object.max = max;
+	object.leaf = u32(-1);
+	object.leafSlot = 0;
+	object.alive = true;
+
+	m_NeedsRebuild = true;
+	return id;
+}
+
+void SceneBvh::Remove(ObjectId id)
+{
+	assert(id < m_Objects.size() && m_Objects[id].alive);
+	Object& object = m_Objects[id];
+	object.alive = false;
+
+	// Make the object invisible until the next rebuild, the id is cleared as well, since it can be reused before then
+	if (object.leaf != u32(-1))
+	{
+		sizeT index = object.leaf * LeafSize + object.leafSlot;
+		m_LeafBounds.minX[index] = m_LeafBounds.minY[index] = m_LeafBounds.minZ[index] = FLT_MAX;
+		m_LeafBounds.maxX[index] = m_LeafBounds.maxY[index] = m_LeafBounds.maxZ[index] = -FLT_MAX;
+		m_LeafBounds.ids[index] = InvalidObject;
+		object.leaf = u32(-1);
+	}
+
+	m_FreeObjects.push_back(id);
+	m_NeedsRebuild = true;
+}
+
+void SceneBvh::Update(ObjectId id, const glm::vec3& min, const glm::vec3& max)
+{
+	assert(id < m_Objects.size() && m_Objects[id].alive);
+	Object& object = m_Objects[id];
+	object.min = min;
+	object.max = max;
+
+	if (object.leaf != u32(-1))
+	{
+		sizeT index = object.leaf * LeafSize + object.leafSlot;
+		m_LeafBounds.minX[index] = min.x;
+		m_LeafBounds.minY[index] = min.y;
+		m_LeafBounds.minZ[index] = min.z;
+		m_LeafBounds.maxX[index] = max.x;
+		m_LeafBounds.maxY[index] = max.y;
+		m_LeafBounds.maxZ[index] = max.z;
+
+		Leaf& leaf = m_Leaves[object.leaf];
+		if (!leaf.dirty)
+		{
+			leaf.dirty = true;
+			m_DirtyLeaves.push_back(object.leaf);
+		}
+	}
+}
+
+void SceneBvh::Build()
+{
+	std::vector<ObjectId> ids;
+	ids.reserve(m_Objects.size());
+	for (ObjectId id = 0; id < m_Objects.size(); ++id)
+	{
+		if (m_Objects[id].alive)
+			ids.push_back(id);
+	}
+
+	m_Nodes.clear();
+	m_Leaves.clear();
+	m_DirtyLeaves.clear();
+	m_LeafBounds.minX.clear();
+	m_LeafBounds.minY.clear();
+	m_LeafBounds.minZ.clear();
+	m_LeafBounds.maxX.clear();
+	m_LeafBounds.maxY.clear();
+	m_LeafBounds.maxZ.clear();
+	m_LeafBounds.ids.clear();
+
+	// A 4 wide tree with full leaves has about 1 node per 3 leaves
+	sizeT leafCount = (ids.size() + LeafSize - 1) / LeafSize;
+	m_Nodes.reserve(leafCount / 3 + 1);
+	m_Leaves.reserve(leafCount * 2);
+
+	m_Root = EmptyChild;
+	m_NeedsRebuild = false;
+	if (ids.empty())
+		return;
+
+	glm::vec3 min, max;
+	m_Root = BuildRecursive(ids, 0, ids.size(), -1, 0, min, max);
+}
+
+void SceneBvh::Refit()
+{
+	for (u32 leafIndex : m_DirtyLeaves)
+	{
+		Leaf& leaf = m_Leaves[leafIndex];
+		leaf.dirty = false;
+		if (leaf.parent < 0)
+			continue;
+
+		glm::vec3 min, max;
+		GetLeafBounds(leafIndex, min, max);
+		SetNodeSlot(leaf.parent, leaf.parentSlot, ~i32(leafIndex), min, max);
+
+		// Propagate upwards until the bounds stop changing
+		i32 nodeIndex = leaf.parent;
+		while (m_Nodes[nodeIndex].parent >= 0)
+		{
+			const Node& node = m_Nodes[nodeIndex];
+			GetNodeBounds(nodeIndex, min, max);
+
+			const Node& parent = m_Nodes[node.parent];
+			u32 slot = node.parentSlot;
+			if (parent.minX[slot] == min.x && parent.minY[slot] == min.y && parent.minZ[slot] == min.z &&
+				parent.maxX[slot] == max.x && parent.maxY[slot] == max.y && parent.maxZ[slot] == max.z)
+				break;
+
+			i32 parentIndex = node.parent;
+			SetNodeSlot(parentIndex, slot, nodeIndex, min, max);
+			nodeIndex = parentIndex;
+		}
+	}
+	m_DirtyLeaves.clear();
+}
+
+void SceneBvh::Cull(const glm::vec4 planes[6], std::vector<ObjectId>& visible) const
+{
+	if (m_Root == EmptyChild)
+		return;
+	CullSubtree(m_Root, planes, visible);
+}
+
+void SceneBvh::GetSubtrees(u32 minCount, std::vector<i32>& subtrees) const
+{
+	if (m_Root == EmptyChild)
+		return;
+
+	// Expand nodes breadth first until there are enough subtrees
+	sizeT first = subtrees.size();
+	subtrees.push_back(m_Root);
+	sizeT expand = first;
+	while (subtrees.size() - first < minCount && expand < subtrees.size())
+	{
+		i32 child = subtrees[expand];
+		if (child < 0)
+		{
+			++expand;
+			continue;
+		}
+
+		const Node& node = m_Nodes[child];
+		subtrees.erase(subtrees.begin() + expand);
+		for (u32 i = 0; i < 4; ++i)
+		{
+			if (node.children[i] != EmptyChild)
+				subtrees.push_back(node.children[i]);
+		}
+	}
+}
+
+void SceneBvh::CullSubtree(i32 subtree, const glm::vec4 planes[6], std::vector<ObjectId>& visible) const
+{
+	SimdFrustum frustum(planes);
+
+	i32 stack[64];
+	u32 stackSize = 0;
+	stack[stackSize++] = subtree;
+
+	while (stackSize > 0)
+	{
+		i32 child = stack[--stackSize];
+
+		if (child < 0)
+		{
+			u32 leafIndex = u32(~child);
+			sizeT base = leafIndex * LeafSize;
+			u32 mask = TestBoxes8(frustum, &m_LeafBounds.minX[base], &m_LeafBounds.minY[base], &m_LeafBounds.minZ[base],
+				&m_LeafBounds.maxX[base], &m_LeafBounds.maxY[base], &m_LeafBounds.maxZ[base]);
+			mask &= (1u << m_Leaves[leafIndex].count) - 1;
+
+			for (u32 i = 0; i < LeafSize; ++i)
+			{
+				if ((mask & (1u << i)) && m_LeafBounds.ids[base + i] != InvalidObject)
+					visible.push_back(m_LeafBounds.ids[base + i]);
+			}
+			continue;
+		}
+
+		const Node& node = m_Nodes[child];
+		u32 insideMask;
+		u32 mask = TestBoxes4(frustum, node.minX, node.minY, node.minZ, node.maxX, node.maxY, node.maxZ, insideMask);
+		for (u32 i = 0; i < 4; ++i)
+		{
+			if (!(mask & (1u << i)) || node.children[i] == EmptyChild)
+				continue;
+
+			// Fully inside subtrees don't need any further testing
+			if (insideMask & (1u << i))
+			{
+				AddSubtree(node.children[i], visible);
+			}
+			else
+			{
+				assert(stackSize < 64);
+				stack[stackSize++] = node.children[i];
+			}
+		}
+	}
+}
+
+b8 SceneBvh::ValidateCull(const glm::vec4 planes[6]) const
+{
+	std::vector<ObjectId> visible;
+	Cull(planes, visible);
+
+	// Same positive vertex test and summation order as the SIMD tests, so the results match exactly
+	std::vector<ObjectId> expected;
+	for (ObjectId id = 0; id < m_Objects.size(); ++id)
+	{
+		const Object& object = m_Objects[id];
+		if (!object.alive)
+			continue;
+
+		b8 outside = false;
+		for (u32 i = 0; i < 6 && !outside; ++i)
+		{
+			f32 px = planes[i].x >= 0.f ? object.max.x : object.min.x;
+			f32 py = planes[i].y >= 0.f ? object.max.y : object.min.y;
+			f32 pz = planes[i].z >= 0.f ? object.max.z : object.min.z;
+			outside = (px * planes[i].x + py * planes[i].y) + (pz * planes[i].z + planes[i].w) < 0.f;
+		}
+		if (!outside)
+			expected.push_back(id);
+	}
+
+	std::sort(visible.begin(), visible.end());
+	return visible == expected;
+}
+
+i32 SceneBvh::BuildRecursive(std::vector<ObjectId>& ids, sizeT begin, sizeT end, i32 parent, u32 parentSlot, glm::vec3& outMin, glm::vec3& outMax)
+{
+	sizeT count = end - begin;
+	if (count <= LeafSize)
+	{
+		u32 leafIndex = u32(m_Leaves.size());
+		m_Leaves.push_back({ u32(count), parent, parentSlot, false });
+
+		outMin = glm::vec3(FLT_MAX);
+		outMax = glm::vec3(-FLT_MAX);
+		for (u32 i = 0; i < LeafSize; ++i)
+		{
+			if (i < count)
+			{
+				ObjectId id = ids[begin + i];
+				Object& object = m_Objects[id];
+				object.leaf = leafIndex;
+				object.leafSlot = i;
+				outMin = glm::min(outMin, object.min);
+				outMax = glm::max(outMax, object.max);
+
+				m_LeafBounds.minX.push_back(object.min.x);
+				m_LeafBounds.minY.push_back(object.min.y);
+				m_LeafBounds.minZ.push_back(object.min.z);
+				m_LeafBounds.maxX.push_back(object.max.x);
+				m_LeafBounds.maxY.push_back(object.max.y);
+				m_LeafBounds.maxZ.push_back(object.max.z);
+				m_LeafBounds.ids.push_back(id);
+			}
+			else
+			{
+				// Inverted bounds are always culled
+				m_LeafBounds.minX.push_back(FLT_MAX);
+				m_LeafBounds.minY.push_back(FLT_MAX);
+				m_LeafBounds.minZ.push_back(FLT_MAX);
+				m_LeafBounds.maxX.push_back(-FLT_MAX);
+				m_LeafBounds.maxY.push_back(-FLT_MAX);
+				m_LeafBounds.maxZ.push_back(-FLT_MAX);
+				m_LeafBounds.ids.push_back(ObjectId(InvalidObject));
+			}
+		}
+		return ~i32(leafIndex);
+	}
+
+	i32 nodeIndex = i32(m_Nodes.size());
+	m_Nodes.push_back({});
+	{
+		Node& node = m_Nodes[nodeIndex];
+		node.parent = parent;
+		node.parentSlot = parentSlot;
+		for (u32 i = 0; i < 4; ++i)
+		{
+			node.children[i] = EmptyChild;
+			node.minX[i] = node.minY[i] = node.minZ[i] = FLT_MAX;
+			node.maxX[i] = node.maxY[i] = node.maxZ[i] = -FLT_MAX;
+		}
+	}
+
+	// Split the objects in 4 groups, using 2 levels of median splits along the longest centroid axis
+	auto split = [&](sizeT first, sizeT last) -> sizeT
+	{
+		glm::vec3 centroidMin(FLT_MAX);
+		glm::vec3 centroidMax(-FLT_MAX);
+		for (sizeT i = first; i < last; ++i)
+		{
+			const Object& object = m_Objects[ids[i]];
+			glm::vec3 centroid = (object.min + object.max) * 0.5f;
+			centroidMin = glm::min(centroidMin, centroid);
+			centroidMax = glm::max(centroidMax, centroid);
+		}
+		glm::vec3 extent = centroidMax - centroidMin;
+		u32 axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+		sizeT mid = first + (last - first) / 2;
+		std::nth_element(ids.begin() + first, ids.begin() + mid, ids.begin() + last, [&](ObjectId a, ObjectId b)
+		{
+			const Object& objA = m_Objects[a];
+			const Object& objB = m_Objects[b];
+			return objA.min[axis] + objA.max[axis] < objB.min[axis] + objB.max[axis];
+		});
+		return mid;
+	};
+
+	sizeT ranges[5];
+	ranges[0] = begin;
+	ranges[2] = split(begin, end);
+	ranges[4] = end;
+	ranges[1] = ranges[2] - begin > LeafSize ? split(begin, ranges[2]) : ranges[2];
+	ranges[3] = end - ranges[2] > LeafSize ? split(ranges[2], end) : end;
+
+	outMin = glm::vec3(FLT_MAX);
+	outMax = glm::vec3(-FLT_MAX);
+	u32 slot = 0;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		if (ranges[i] == ranges[i + 1])
+			continue;
+
+		glm::vec3 min, max;
+		i32 child = BuildRecursive(ids, ranges[i], ranges[i + 1], nodeIndex, slot, min, max);
+		SetNodeSlot(nodeIndex, slot, child, min, max);
+		outMin = glm::min(outMin, min);
+		outMax = glm::max(outMax, max);
+		++slot;
+	}
+
+	return nodeIndex;
+}
+
+void SceneBvh::SetNodeSlot(i32 nodeIndex, u32 slot, i32 child, const glm::vec3& min, const glm::vec3& max)
+{
+	Node& node = m_Nodes[nodeIndex];
+	node.children[slot] = child;
+	node.minX[slot] = min.x;
+	node.minY[slot] = min.y;
+	node.minZ[slot] = min.z;
+	node.maxX[slot] = max.x;
+	node.maxY[slot] = max.y;
+	node.maxZ[slot] = max.z;
+}
+
+void SceneBvh::GetLeafBounds(u32 leafIndex, glm::vec3& min, glm::vec3& max) const
+{
+	min = glm::vec3(FLT_MAX);
+	max = glm::vec3(-FLT_MAX);
+
+	sizeT base = leafIndex * LeafSize;
+	for (u32 i = 0; i < m_Leaves[leafIndex].count; ++i)
+	{
+		min = glm::min(min, glm::vec3(m_LeafBounds.minX[base + i], m_LeafBounds.minY[base + i], m_LeafBounds.minZ[base + i]));
+		max = glm::max(max, glm::vec3(m_LeafBounds.maxX[base + i], m_LeafBounds.maxY[base + i], m_LeafBounds.maxZ[base + i]));
+	}
+}
+
+void SceneBvh::GetNodeBounds(i32 nodeIndex, glm::vec3& min, glm::vec3& max) const
+{
+	const Node& node = m_Nodes[nodeIndex];
+	min = glm::vec3(FLT_MAX);
+	max = glm::vec3(-FLT_MAX);
+	for (u32 i = 0; i < 4; ++i)
+	{
+		if (node.children[i] == EmptyChild)
+			continue;
+		min = glm::min(min, glm::vec3(node.minX[i], node.minY[i], node.minZ[i]));
+		max = glm::max(max, glm::vec3(node.maxX[i], node.maxY[i], node.maxZ[i]));
+	}
+}
+
+void SceneBvh::AddSubtree(i32 child, std::vector<ObjectId>& visible) const
+{
+	if (child < 0)
+	{
+		u32 leafIndex = u32(~child);
+		sizeT base = leafIndex * LeafSize;
+		const Leaf& leaf = m_Leaves[leafIndex];
+		for (u32 i = 0; i < leaf.count; ++i)
+		{
+			// Removed objects leave an empty slot in the leaf until the next rebuild
+			ObjectId id = m_LeafBounds.ids[base + i];
+			if (id != InvalidObject)
+				visible.push_back(id);
+		}
+		return;
+	}
+
+	const Node& node = m_Nodes[child];
+	for (u32 i = 0; i < 4; ++i)
+	{
+		if (node.children[i] != EmptyChild)
+			AddSubtree(node.children[i], visible);
+	}
+}
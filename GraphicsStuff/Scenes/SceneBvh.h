@@ -0,0 +1,160 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "../General/TypesAndMacros.h"
+
+/**
+ * Bounding volume hierarchy over object AABBs, used for CPU frustum culling
+ * Nodes are 4 wide and store their child bounds as SoA, so a single SSE test handles all children of a node.
+ * Leaves hold up to 8 objects, which are tested with 1 AVX or 2 SSE tests.
+ * @note	Inserting or removing objects requires a Build(), moving objects only requires an Update() followed by a Refit()
+ */
+class SceneBvh
+{
+public:
+	typedef u32 ObjectId;
+	static const ObjectId InvalidObject = u32(-1);
+
+	SceneBvh();
+	~SceneBvh();
+
+	/**
+	 * Add an object to the hierarchy
+	 * @param[in] min	AABB min
+	 * @param[in] max	AABB max
+	 * @return			Object id
+	 * @note			The object is only taken into account after the next Build()
+	 */
+	ObjectId Insert(const glm::vec3& min, const glm::vec3& max);
+	/**
+	 * Remove an object from the hierarchy
+	 * @param[in] id	Object id
+	 * @note			The object is only removed from the tree after the next Build()
+	 */
+	void Remove(ObjectId id);
+	/**
+	 * Update the bounds of a moving object
+	 * @param[in] id	Object id
+	 * @param[in] min	AABB min
+	 * @param[in] max	AABB max
+	 * @note			The tree bounds are only updated after the next Refit()
+	 */
+	void Update(ObjectId id, const glm::vec3& min, const glm::vec3& max);
+
+	/**
+	 * Rebuild the hierarchy from all live objects
+	 */
+	void Build();
+	/**
+	 * Refit the bounds of all nodes above updated objects
+	 */
+	void Refit();
+	/**
+	 * Check if the hierarchy needs to be rebuild because objects were inserted or removed
+	 * @return	True if a rebuild is needed, false otherwise
+	 */
+	b8 NeedsRebuild() const { return m_NeedsRebuild; }
+
+	/**
+	 * Cull the hierarchy against a frustum
+	 * @param[in] planes	Normalized frustum planes (pointing inwards)
+	 * @param[out] visible	Visible objects, appended to the array
+	 */
+	void Cull(const glm::vec4 planes[6], std::vector<ObjectId>& visible) const;
+
+	/**
+	 * Get independent subtrees, which can be culled in parallel with CullSubtree
+	 * @param[in] minCount	Minimum amount of subtrees to return (if the tree is big enough)
+	 * @param[out] subtrees	Subtree roots
+	 * @note				The hierarchy doesn't own any threads, the subtrees are meant to be spread over the workers of the caller
+	 */
+	void GetSubtrees(u32 minCount, std::vector<i32>& subtrees) const;
+	/**
+	 * Cull a single subtree against a frustum
+	 * @param[in] subtree	Subtree root, as returned by GetSubtrees
+	 * @param[in] planes	Normalized frustum planes (pointing inwards)
+	 * @param[out] visible	Visible objects, appended to the array
+	 */
+	void CullSubtree(i32 subtree, const glm::vec4 planes[6], std::vector<ObjectId>& visible) const;
+	/**
+	 * Check if Cull finds exactly the live objects that pass the frustum test one by one, meant to be asserted in debug builds
+	 * @param[in] planes	Normalized frustum planes (pointing inwards)
+	 * @return				True if the results match, false otherwise
+	 * @note				Only valid after a Build() and Refit(), the tree doesn't know about changes before that
+	 */
+	b8 ValidateCull(const glm::vec4 planes[6]) const;
+
+	/**
+	 * Get the amount of live objects
+	 * @return	Amount of live objects
+	 */
+	u32 GetObjectCount() const { return u32(m_Objects.size() - m_FreeObjects.size()); }
+
+private:
+	static const u32 LeafSize = 8;
+	static const i32 EmptyChild = i32(0x8000'0000);
+
+	struct Object
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		u32 leaf;		/**< Leaf containing the object (u32(-1) if not in the tree) */
+		u32 leafSlot;	/**< Slot inside of the leaf */
+		b8 alive;
+	};
+
+	/**
+	 * 4 wide node, children >= 0 are nodes, children < 0 are leaves (~index)
+	 */
+	struct Node
+	{
+		f32 minX[4];
+		f32 minY[4];
+		f32 minZ[4];
+		f32 maxX[4];
+		f32 maxY[4];
+		f32 maxZ[4];
+		i32 children[4];
+		i32 parent;
+		u32 parentSlot;
+	};
+
+	struct Leaf
+	{
+		u32 count;
+		i32 parent;
+		u32 parentSlot;
+		b8 dirty;
+	};
+
+	/**
+	 * Leaf object bounds in SoA layout, LeafSize entries per leaf
+	 */
+	struct LeafBounds
+	{
+		std::vector<f32> minX;
+		std::vector<f32> minY;
+		std::vector<f32> minZ;
+		std::vector<f32> maxX;
+		std::vector<f32> maxY;
+		std::vector<f32> maxZ;
+		std::vector<ObjectId> ids;
+	};
+
+	i32 BuildRecursive(std::vector<ObjectId>& ids, sizeT begin, sizeT end, i32 parent, u32 parentSlot, glm::vec3& outMin, glm::vec3& outMax);
+	void SetNodeSlot(i32 node, u32 slot, i32 child, const glm::vec3& min, const glm::vec3& max);
+	void GetLeafBounds(u32 leaf, glm::vec3& min, glm::vec3& max) const;
+	void GetNodeBounds(i32 node, glm::vec3& min, glm::vec3& max) const;
+	void AddSubtree(i32 child, std::vector<ObjectId>& visible) const;
+
+	std::vector<Object> m_Objects;
+	std::vector<ObjectId> m_FreeObjects;
+
+	std::vector<Node> m_Nodes;
+	std::vector<Leaf> m_Leaves;
+	LeafBounds m_LeafBounds;
+	std::vector<u32> m_DirtyLeaves;
+	i32 m_Root;
+
+	b8 m_NeedsRebuild;
+};
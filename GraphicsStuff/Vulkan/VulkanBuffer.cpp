@@ -2,6 +2,8 @@
 #include "VulkanDevice.h"
 #include "VulkanContext.h"
 #include "VulkanHelpers.h"
+#include "VulkanMemoryHeap.h"
+#include "VulkanDefragmenter.h"
 
 namespace Vulkan {
 
@@ -20,6 +22,24 @@ namespace Vulkan {
 
 	b8 VulkanBuffer::Create(RHI::RHIContext* pContext, RHI::BufferType type, u64 size,
 		RHI::BufferFlags flags, PixelFormat format)
+	{
+		return CreateInternal(pContext, type, size, flags, format, nullptr, 0);
+	}
+
+	b8 VulkanBuffer::CreatePlaced(RHI::RHIContext* pContext, RHI::BufferType type, u64 size, RHI::BufferFlags flags,
+		RHI::MemoryHeap* pHeap, u64 heapOffset, PixelFormat format)
+	{
+		// Heaps are gpu only memory, which can't be mapped
+		if ((flags & (RHI::BufferFlags::Dynamic | RHI::BufferFlags::Readback)) != RHI::BufferFlags::None || type == RHI::BufferType::Staging)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "Dynamic, readback and staging buffers can't be placed in a memory heap!");
+			return false;
+		}
+		return CreateInternal(pContext, type, size, flags, format, (VulkanMemoryHeap*)pHeap, heapOffset);
+	}
+
+	b8 VulkanBuffer::CreateInternal(RHI::RHIContext* pContext, RHI::BufferType type, u64 size,
+		RHI::BufferFlags flags, PixelFormat format, VulkanMemoryHeap* pHeap, u64 heapOffset)
 	{
 		m_pContext = pContext;
 		m_Type = type;
@@ -29,10 +49,7 @@ namespace Vulkan {
 		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
 
 		VkBufferCreateInfo bufferInfo = {};
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = m_Size;
-		bufferInfo.usage = Helpers::GetBufferUsage(m_Type, m_Flags);
-		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // TODO: Concurent?
+		GetCreateInfo(bufferInfo);
 
 		VkResult vkres = pDevice->vkCreateBuffer(bufferInfo, m_Buffer);
 		if (vkres != VK_SUCCESS)
@@ -41,16 +58,32 @@ namespace Vulkan {
 			return vkres;
 		}
 
-		VkMemoryRequirements memReqs = {};
-		pDevice->vkGetBufferMemoryRequirements(m_Buffer, memReqs);
-		m_MemorySize = memReqs.size;
-
-		VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-		if ((m_Flags & RHI::BufferFlags::Dynamic) != RHI::BufferFlags::None || m_Type == RHI::BufferType::Staging)
-			memProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		VulkanMemoryUsage memUsage = VulkanMemoryUsage::GpuOnly;
+		if ((m_Flags & RHI::BufferFlags::Readback) != RHI::BufferFlags::None && ((m_Flags & RHI::BufferFlags::Dynamic) != RHI::BufferFlags::None || m_Type == RHI::BufferType::Staging))
+			memUsage = VulkanMemoryUsage::Readback;
+		else if (m_Type == RHI::BufferType::Staging)
+			memUsage = VulkanMemoryUsage::Upload;
+		else if ((m_Flags & RHI::BufferFlags::Dynamic) != RHI::BufferFlags::None)
+			memUsage = VulkanMemoryUsage::DynamicGpuRead;
 
-		VulkanAllocator* pAllocator = ((VulkanContext*)m_pContext)->GetAllocator();
-		m_pAllocation = pAllocator->Allocate(memReqs, memProps);
+		if (pHeap)
+		{
+			VkMemoryRequirements requirements = {};
+			pDevice->vkGetBufferMemoryRequirements(m_Buffer, requirements);
+			m_pAllocation = pHeap->AllocatePlaced(heapOffset, requirements);
+		}
+		else
+		{
+			VulkanAllocator* pAllocator = ((VulkanContext*)m_pContext)->GetAllocator();
+			m_pAllocation = pAllocator->AllocateForBuffer(m_Buffer, memUsage);
+		}
+		if (!m_pAllocation)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "Failed to allocate a vulkan allocation!");
+			return false;
+		}
+		m_MemorySize = m_pAllocation->GetSize();
+		m_pAllocation->SetOwner(this);
 
 		vkres = pDevice->vkBindBufferMemory(m_Buffer, m_pAllocation->GetMemory(), m_pAllocation->GetOffset());
 		if (vkres != VK_SUCCESS)
@@ -62,15 +95,7 @@ namespace Vulkan {
 		if (m_Type == RHI::BufferType::StorageTexel || m_Type == RHI::BufferType::UniformTexel)
 		{
 			m_TexelBufferFormat = format;
-			// TODO Buffer view as seperate class (maybe texture view too)???
-			VkBufferViewCreateInfo viewInfo = {};
-			viewInfo.sType = VK_STRUCTURE_TYPE_BUFFER_VIEW_CREATE_INFO;
-			viewInfo.buffer = m_Buffer;
-			viewInfo.offset = 0;
-			viewInfo.range = m_Size;
-			viewInfo.format = Helpers::GetFormat(format);
-
-			vkres = pDevice->vkCreateBufferView(viewInfo, m_View);
+			vkres = CreateView(m_Buffer, m_View);
 			if (vkres != VK_SUCCESS)
 			{
 				//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to bind memory to a vulkan buffer view (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
@@ -81,7 +106,7 @@ namespace Vulkan {
 		if ((m_Flags & (RHI::BufferFlags::Dynamic | RHI::BufferFlags::Static)) == RHI::BufferFlags::None && m_Type != RHI::BufferType::Staging)
 		{
 			m_pStagingBuffer = new VulkanBuffer();
-			b8 res = m_pStagingBuffer->Create(m_pContext, RHI::BufferType::Staging, m_Size, RHI::BufferFlags::None);
+			b8 res = m_pStagingBuffer->Create(m_pContext, RHI::BufferType::Staging, m_Size, m_Flags & RHI::BufferFlags::Readback);
 			if (!res)
 			{
 				//g_Logger.LogError(LogVulkanRHI(), "Failed to create staging buffer for buffer");
@@ -125,6 +150,14 @@ namespace Vulkan {
 			m_View = VK_NULL_HANDLE;
 		}
 
+		// A pending defragmentation copy still reads the buffer, the defragmenter releases it once the copy is done
+		VulkanDefragmenter* pDefragmenter = ((VulkanContext*)m_pContext)->GetDefragmenter();
+		if (pDefragmenter && pDefragmenter->CancelMoves(this))
+		{
+			m_pAllocation = nullptr;
+			m_Buffer = VK_NULL_HANDLE;
+		}
+
 		if (m_pAllocation)
 		{
 			VulkanAllocator* pAllocator = ((VulkanContext*)m_pContext)->GetAllocator();
@@ -141,6 +174,79 @@ namespace Vulkan {
 		return true;
 	}
 
+	VkResult VulkanBuffer::CreateMoveTarget(VkBuffer& buffer)
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		GetCreateInfo(bufferInfo);
+		return ((VulkanContext*)m_pContext)->GetDevice()->vkCreateBuffer(bufferInfo, buffer);
+	}
+
+	b8 VulkanBuffer::Move(VkBuffer buffer, VulkanAllocation* pAllocation, VkBuffer& oldBuffer, VkBufferView& oldView,
+		VulkanAllocation*& pOldAllocation)
+	{
+		VkBufferView view = VK_NULL_HANDLE;
+		if (m_View)
+		{
+			VkResult vkres = CreateView(buffer, view);
+			if (vkres != VK_SUCCESS)
+			{
+				//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to create the vulkan buffer view of a moved buffer (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+				return false;
+			}
+		}
+
+		oldBuffer = m_Buffer;
+		oldView = m_View;
+		pOldAllocation = m_pAllocation;
+
+		m_Buffer = buffer;
+		m_View = view;
+		m_pAllocation = pAllocation;
+		m_pAllocation->SetOwner(this);
+		pOldAllocation->SetOwner((VulkanBuffer*)nullptr);
+		return true;
+	}
+
+	b8 VulkanBuffer::GetMemoryRequirements(VulkanContext* pContext, RHI::BufferType type, u64 size, RHI::BufferFlags flags,
+		VkMemoryRequirements& requirements)
+	{
+		// Create an unbound buffer with the same create info as the buffer would use
+		VulkanBuffer buffer;
+		buffer.m_pContext = pContext;
+		buffer.m_Type = type;
+		buffer.m_Size = size;
+		buffer.m_Flags = flags;
+		VkBuffer vkBuffer;
+		if (buffer.CreateMoveTarget(vkBuffer) != VK_SUCCESS)
+			return false;
+
+		VulkanDevice* pDevice = pContext->GetDevice();
+		pDevice->vkGetBufferMemoryRequirements(vkBuffer, requirements);
+		pDevice->vkDestroyBuffer(vkBuffer);
+		return true;
+	}
+
+	void VulkanBuffer::GetCreateInfo(VkBufferCreateInfo& bufferInfo)
+	{
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = m_Size;
+		bufferInfo.usage = Helpers::GetBufferUsage(m_Type, m_Flags);
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // TODO: Concurent?
+	}
+
+	VkResult VulkanBuffer::CreateView(VkBuffer buffer, VkBufferView& view)
+	{
+		// TODO Buffer view as seperate class (maybe texture view too)???
+		VkBufferViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_BUFFER_VIEW_CREATE_INFO;
+		viewInfo.buffer = buffer;
+		viewInfo.offset = 0;
+		viewInfo.range = m_Size;
+		viewInfo.format = Helpers::GetFormat(m_TexelBufferFormat);
+
+		return ((VulkanContext*)m_pContext)->GetDevice()->vkCreateBufferView(viewInfo, view);
+	}
+
 	b8 VulkanBuffer::Write(u64 offset, u64 size, void* pData, RHI::BufferWriteFlags flags,
 		RHI::CommandList* pCommandList)
 	{
@@ -238,7 +344,7 @@ namespace Vulkan {
 
 		if ((m_Flags & RHI::BufferFlags::Dynamic) != RHI::BufferFlags::None || m_Type == RHI::BufferType::Staging)
 		{
-			void* pMappedData = m_pAllocation->Map(offset, size, VulkanAllocationMapMode::Write);
+			void* pMappedData = m_pAllocation->Map(offset, size, VulkanAllocationMapMode::Read);
 			if (!pMappedData)
 			{
 				//g_Logger.LogError(LogVulkanRHI(), "Failed to map the vulkan buffer memory!");
@@ -253,7 +359,7 @@ namespace Vulkan {
 
 			// Create staging buffer
 			VulkanBuffer* pStagingBuffer = new VulkanBuffer();
-			b8 res = pStagingBuffer->Create(m_pContext, RHI::BufferType::Staging, size, RHI::BufferFlags::None);
+			b8 res = pStagingBuffer->Create(m_pContext, RHI::BufferType::Staging, size, RHI::BufferFlags::Readback);
 			if (!res)
 			{
 				//g_Logger.LogError(LogVulkanRHI(), "Failed to create temporary staging buffer for static buffer!");
@@ -5,6 +5,8 @@
 #include "../RHI/Buffer.h"
 
 namespace Vulkan {
+	class VulkanContext;
+	class VulkanMemoryHeap;
 	
 	class VulkanBuffer final : public RHI::Buffer
 	{
@@ -41,6 +43,18 @@ namespace Vulkan {
 		 * @return					True if the buffer was created successfully, false otherwise
 		 */
 		b8 CreateIndexBuffer(RHI::RHIContext* pContext, u32 indexCount, RHI::IndexType indexType, RHI::BufferFlags flags) override final;
+		/**
+		 * Create a buffer placed in a memory heap
+		 * @param[in] pContext		RHI context
+		 * @param[in] type			Buffer type
+		 * @param[in] size			Buffer size
+		 * @param[in] flags			Buffer flags, dynamic and readback buffers can't be placed in a heap
+		 * @param[in] pHeap			Memory heap
+		 * @param[in] heapOffset	Offset in the heap, a multiple of the alignment of the memory requirements
+		 * @param[in] format		Buffer data format (texel buffers only)
+		 * @return					True if the buffer was created successfully, false otherwise
+		 */
+		b8 CreatePlaced(RHI::RHIContext* pContext, RHI::BufferType type, u64 size, RHI::BufferFlags flags, RHI::MemoryHeap* pHeap, u64 heapOffset, PixelFormat format = PixelFormat()) override final;
 
 		/**
 		 * Detroy a buffer
@@ -112,8 +126,71 @@ namespace Vulkan {
 		* @return	Vulkan buffer view
 		*/
 		VkBufferView GetBufferView() { return m_View; }
+		/**
+		 * Get the memory allocation
+		 * @return	Memory allocation
+		 */
+		VulkanAllocation* GetAllocation() { return m_pAllocation; }
+		/**
+		 * Mark the buffer as written by the gpu in the current frame
+		 */
+		void MarkWritten() { if (m_pAllocation) m_pAllocation->MarkWritten(); }
+
+		/**
+		 * Create an unbound vulkan buffer with the same description, to move the buffer to other memory
+		 * @param[out] buffer	Vulkan buffer
+		 * @return				Vulkan result
+		 */
+		VkResult CreateMoveTarget(VkBuffer& buffer);
+		/**
+		 * Switch the buffer to a new vulkan buffer, which already contains a copy of the buffer's data
+		 * @param[in] buffer			New vulkan buffer
+		 * @param[in] pAllocation		Allocation bound to the new vulkan buffer
+		 * @param[out] oldBuffer		Previous vulkan buffer
+		 * @param[out] oldView			Previous vulkan buffer view
+		 * @param[out] pOldAllocation	Previous allocation
+		 * @return						True if the buffer was moved, false otherwise
+		 * @note						The previous handles and allocation can only be released once no command list uses them anymore
+		 */
+		b8 Move(VkBuffer buffer, VulkanAllocation* pAllocation, VkBuffer& oldBuffer, VkBufferView& oldView, VulkanAllocation*& pOldAllocation);
+
+		/**
+		 * Get the memory requirements of a buffer, without creating it
+		 * @param[in] pContext		Vulkan context
+		 * @param[in] type			Buffer type
+		 * @param[in] size			Buffer size
+		 * @param[in] flags			Buffer flags
+		 * @param[out] requirements	Memory requirements
+		 * @return					True if the requirements were retrieved, false if the vulkan buffer can't be created
+		 */
+		static b8 GetMemoryRequirements(VulkanContext* pContext, RHI::BufferType type, u64 size, RHI::BufferFlags flags, VkMemoryRequirements& requirements);
 
 	private:
+		/**
+		 * Create a buffer
+		 * @param[in] pContext		RHI context
+		 * @param[in] type			Buffer type
+		 * @param[in] size			Buffer size
+		 * @param[in] flags			Buffer flags
+		 * @param[in] format		Buffer data format (texel buffers only)
+		 * @param[in] pHeap			Memory heap to place the buffer in, nullptr to allocate its own memory
+		 * @param[in] heapOffset	Offset in the heap
+		 * @return					True if the buffer was created successfully, false otherwise
+		 */
+		b8 CreateInternal(RHI::RHIContext* pContext, RHI::BufferType type, u64 size, RHI::BufferFlags flags, PixelFormat format, VulkanMemoryHeap* pHeap, u64 heapOffset);
+		/**
+		 * Get the create info of the vulkan buffer
+		 * @param[out] bufferInfo	Buffer create info
+		 */
+		void GetCreateInfo(VkBufferCreateInfo& bufferInfo);
+		/**
+		 * Create a view for texel buffers
+		 * @param[in] buffer	Vulkan buffer
+		 * @param[out] view		Vulkan buffer view
+		 * @return				Vulkan result
+		 */
+		VkResult CreateView(VkBuffer buffer, VkBufferView& view);
+
 		VkBuffer m_Buffer;					/**< Vulkan buffer */
 		VkBufferView m_View;				/**< Vulkan buffer view */
 		VulkanAllocation* m_pAllocation;	/**< Memory allocation */
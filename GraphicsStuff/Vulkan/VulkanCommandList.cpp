@@ -11,13 +11,16 @@
 #include "VulkanHelpers.h"
 #include "VulkanRenderPass.h"
 #include "VulkanFramebuffer.h"
+#include "VulkanTexture.h"
 #include "../RHI/ClearValue.h"
 #include "../RHI/RenderTarget.h"
+#include "../RHI/RenderPassCache.h"
 #include "VulkanBuffer.h"
 #include "VulkanQueue.h"
 #include "VulkanFence.h"
 #include "VulkanSemaphore.h"
 #include "VulkanDevice.h"
+#include "VulkanPhysicalDevice.h"
 #include "VulkanContext.h"
 
 namespace Vulkan {
@@ -26,6 +29,22 @@ namespace Vulkan {
 		: m_CommandBuffer(VK_NULL_HANDLE)
 		, m_SrcStage(RHI::PipelineStage::None)
 		, m_DstStage(RHI::PipelineStage::None)
+		, m_DynamicRendering(false)
+		, m_pPresentableTextures{}
+		, m_PresentableImageCount(0)
+		, m_ValidDynamicState(RHI::DynamicState::None)
+		, m_CullMode(RHI::CullMode::None)
+		, m_FrontFace(RHI::FrontFace::CounterClockWise)
+		, m_PrimitiveTopology(RHI::PrimitiveTopology::None)
+		, m_DepthTestEnable(false)
+		, m_DepthWriteEnable(false)
+		, m_DepthCompareOp(RHI::CompareOp::Never)
+		, m_StencilTestEnable(false)
+		, m_StencilFront()
+		, m_StencilBack()
+		, m_BoundIndexBuffer(VK_NULL_HANDLE)
+		, m_BoundIndexOffset(0)
+		, m_BoundIndexType(VK_INDEX_TYPE_UINT16)
 	{
 	}
 
@@ -60,6 +79,9 @@ namespace Vulkan {
 		}
 
 		m_BoundInputSlots.clear();
+		m_ValidDynamicState = RHI::DynamicState::None;
+		m_BoundVertexBuffers.clear();
+		m_BoundIndexBuffer = VK_NULL_HANDLE;
 
 		m_Status = RHI::CommandListState::Recording;
 		return true;
@@ -75,7 +97,7 @@ namespace Vulkan {
 			return false;
 		}
 
-		if (m_pRenderPass)
+		if (m_pRenderPass || m_DynamicRendering)
 		{
 			//g_Logger.LogError(LogVulkanRHI(), "Failed to end the command list, command list is still inside renderpass!");
 			return false;
@@ -101,6 +123,10 @@ namespace Vulkan {
 		VkPipelineBindPoint bindPoint = Helpers::GetPipelineBindPoint(pPipeline->GetType());
 
 		vkCmdBindPipeline(m_CommandBuffer, bindPoint, pVulkanPipeline->GetPipeline());
+
+		// States baked into the pipeline overwrite the dynamic state
+		if (pPipeline->GetType() == RHI::PipelineType::Graphics)
+			m_ValidDynamicState &= pPipeline->GetGraphicsDesc().dynamicState;
 	}
 
 	void VulkanCommandList::BeginRenderPass(RHI::RenderPass* pRenderPass, RHI::Framebuffer* pFramebuffer)
@@ -165,14 +191,224 @@ namespace Vulkan {
 		}
 	}
 
+	void VulkanCommandList::BeginRendering(const RHI::RenderingDesc& desc)
+	{
+		CHECK_RECORDING;
+		assert(desc.colorAttachmentCount <= RHI::MaxRenderingColorAttachments);
+		assert(desc.colorAttachmentCount > 0 || desc.depthStencilAttachment.pRenderTarget);
+		UpdateBarriers();
+		DiscardTransientAttachments(desc);
+
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+
+		if (!pDevice->IsDynamicRenderingSupported())
+		{
+			// Emulate dynamic rendering with a cached render pass and framebuffer
+			std::vector<RHI::RenderPassAttachment> attachments;
+			std::vector<RHI::RenderTarget*> renderTargets;
+			RHI::SubRenderPass subpass;
+			for (u32 i = 0; i < desc.colorAttachmentCount + 1; ++i)
+			{
+				const RHI::RenderingAttachment& renderingAttachment = i < desc.colorAttachmentCount ? desc.colorAttachments[i] : desc.depthStencilAttachment;
+				if (!renderingAttachment.pRenderTarget)
+					continue;
+
+				RHI::Texture* pTexture = renderingAttachment.pRenderTarget->GetTexture();
+				RHI::RenderPassAttachment attachment;
+				attachment.format = pTexture->GetFormat();
+				attachment.samples = pTexture->GetSampleCount();
+				attachment.type = renderingAttachment.pRenderTarget->GetType();
+				attachment.loadOp = renderingAttachment.loadOp;
+				attachment.storeOp = renderingAttachment.storeOp;
+				attachment.stencilLoadOp = renderingAttachment.stencilLoadOp;
+				attachment.stencilStoreOp = renderingAttachment.stencilStoreOp;
+
+				RHI::RenderPassAttachmentRef attachmentRef;
+				attachmentRef.index = u32(attachments.size());
+				attachmentRef.type = attachment.type;
+				subpass.attachments.push_back(attachmentRef);
+
+				attachments.push_back(attachment);
+				renderTargets.push_back(renderingAttachment.pRenderTarget);
+			}
+
+			RHI::RenderPassCache* pCache = m_pContext->GetRenderPassCache();
+			RHI::RenderPass* pRenderPass = pCache->GetPersistentRenderPass(attachments, { subpass });
+			RHI::Framebuffer* pFramebuffer = pRenderPass ? pCache->GetFramebuffer(renderTargets, pRenderPass) : nullptr;
+			if (!pFramebuffer)
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "Failed to get a render pass and framebuffer to emulate dynamic rendering!");
+				return;
+			}
+
+			BeginRenderPass(pRenderPass, pFramebuffer);
+			return;
+		}
+
+#ifdef VK_KHR_dynamic_rendering
+		VkRenderingAttachmentInfoKHR colorAttachments[RHI::MaxRenderingColorAttachments] = {};
+		VkImageLayout presentableLayouts[RHI::MaxRenderingColorAttachments] = {};
+		m_PresentableImageCount = 0;
+		for (u32 i = 0; i < desc.colorAttachmentCount; ++i)
+		{
+			const RHI::RenderingAttachment& renderingAttachment = desc.colorAttachments[i];
+			VulkanTexture* pTexture = (VulkanTexture*)renderingAttachment.pRenderTarget->GetTexture();
+			RHI::ClearValue value = renderingAttachment.pRenderTarget->GetClearValue();
+
+			VkRenderingAttachmentInfoKHR& attachment = colorAttachments[i];
+			attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+			attachment.imageView = pTexture->GetImageView();
+			attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachment.resolveMode = VK_RESOLVE_MODE_NONE_KHR;
+			attachment.loadOp = Helpers::GetLoadOp(renderingAttachment.loadOp);
+			attachment.storeOp = Helpers::GetStoreOp(renderingAttachment.storeOp);
+			attachment.clearValue.color.float32[0] = value.color[0];
+			attachment.clearValue.color.float32[1] = value.color[1];
+			attachment.clearValue.color.float32[2] = value.color[2];
+			attachment.clearValue.color.float32[3] = value.color[3];
+
+			// Without a render pass, presentable images need to be transitioned explicitly, their content only has to be kept when it's loaded
+			if (renderingAttachment.pRenderTarget->GetType() == RHI::RenderTargetType::Presentable)
+			{
+				RHI::TextureLayout layout = pTexture->GetLayout();
+				if (renderingAttachment.loadOp != RHI::LoadOp::Load)
+					presentableLayouts[m_PresentableImageCount] = VK_IMAGE_LAYOUT_UNDEFINED;
+				else if (layout != RHI::TextureLayout::Unknown)
+					presentableLayouts[m_PresentableImageCount] = Helpers::GetImageLayout(layout);
+				else
+					presentableLayouts[m_PresentableImageCount] = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+				m_pPresentableTextures[m_PresentableImageCount++] = pTexture;
+			}
+		}
+
+		if (m_PresentableImageCount > 0)
+		{
+			VkImageMemoryBarrier barriers[RHI::MaxRenderingColorAttachments] = {};
+			for (u32 i = 0; i < m_PresentableImageCount; ++i)
+			{
+				VkImageMemoryBarrier& barrier = barriers[i];
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				barrier.oldLayout = presentableLayouts[i];
+				barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = m_pPresentableTextures[i]->GetImage();
+				barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				barrier.subresourceRange.levelCount = 1;
+				barrier.subresourceRange.layerCount = 1;
+			}
+			vkCmdPipelineBarrier(m_CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+				0, nullptr, 0, nullptr, m_PresentableImageCount, barriers);
+		}
+
+		VkRenderingAttachmentInfoKHR depthAttachment = {};
+		VkRenderingAttachmentInfoKHR stencilAttachment = {};
+		const RHI::RenderingAttachment& depthStencil = desc.depthStencilAttachment;
+		PixelFormat depthStencilFormat;
+		if (depthStencil.pRenderTarget)
+		{
+			VulkanTexture* pTexture = (VulkanTexture*)depthStencil.pRenderTarget->GetTexture();
+			RHI::ClearValue value = depthStencil.pRenderTarget->GetClearValue();
+			depthStencilFormat = pTexture->GetFormat();
+
+			depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+			depthAttachment.imageView = pTexture->GetImageView();
+			depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			depthAttachment.resolveMode = VK_RESOLVE_MODE_NONE_KHR;
+			depthAttachment.loadOp = Helpers::GetLoadOp(depthStencil.loadOp);
+			depthAttachment.storeOp = Helpers::GetStoreOp(depthStencil.storeOp);
+			depthAttachment.clearValue.depthStencil.depth = value.depth;
+			depthAttachment.clearValue.depthStencil.stencil = value.stencil;
+
+			stencilAttachment = depthAttachment;
+			stencilAttachment.loadOp = Helpers::GetLoadOp(depthStencil.stencilLoadOp);
+			stencilAttachment.storeOp = Helpers::GetStoreOp(depthStencil.stencilStoreOp);
+		}
+
+		RHI::RenderTarget* pFirstRT = desc.colorAttachmentCount > 0 ? desc.colorAttachments[0].pRenderTarget : depthStencil.pRenderTarget;
+		VkRenderingInfoKHR renderingInfo = {};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		renderingInfo.renderArea.extent.width = pFirstRT->GetWidth();
+		renderingInfo.renderArea.extent.height = pFirstRT->GetHeight();
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = desc.colorAttachmentCount;
+		renderingInfo.pColorAttachments = colorAttachments;
+		renderingInfo.pDepthAttachment = depthStencilFormat.HasDepthComponent() ? &depthAttachment : nullptr;
+		renderingInfo.pStencilAttachment = depthStencilFormat.HasStencilComponent() ? &stencilAttachment : nullptr;
+
+		pDevice->vkCmdBeginRendering(m_CommandBuffer, renderingInfo);
+		m_DynamicRendering = true;
+#endif
+	}
+
+	void VulkanCommandList::EndRendering()
+	{
+		CHECK_RECORDING;
+		UpdateBarriers();
+
+		if (!m_DynamicRendering)
+		{
+			// Emulated with a render pass, the cache keeps the framebuffer alive after it's released
+			RHI::Framebuffer* pFramebuffer = m_pFramebuffer;
+			EndRenderPass();
+			if (pFramebuffer)
+				m_pContext->GetRenderPassCache()->ReleaseFramebuffer(pFramebuffer);
+			m_pFramebuffer = nullptr;
+			return;
+		}
+
+#ifdef VK_KHR_dynamic_rendering
+		((VulkanContext*)m_pContext)->GetDevice()->vkCmdEndRendering(m_CommandBuffer);
+		m_DynamicRendering = false;
+
+		if (m_PresentableImageCount > 0)
+		{
+			VkImageMemoryBarrier barriers[RHI::MaxRenderingColorAttachments] = {};
+			for (u32 i = 0; i < m_PresentableImageCount; ++i)
+			{
+				VkImageMemoryBarrier& barrier = barriers[i];
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				barrier.dstAccessMask = 0;
+				barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = m_pPresentableTextures[i]->GetImage();
+				m_pPresentableTextures[i]->SetLayout(RHI::TextureLayout::Present);
+				barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				barrier.subresourceRange.levelCount = 1;
+				barrier.subresourceRange.layerCount = 1;
+			}
+			vkCmdPipelineBarrier(m_CommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, nullptr, 0, nullptr, m_PresentableImageCount, barriers);
+			m_PresentableImageCount = 0;
+		}
+#endif
+	}
+
+	b8 VulkanCommandList::IsDynamicRenderingSupported() const
+	{
+		return ((VulkanContext*)m_pContext)->GetDevice()->IsDynamicRenderingSupported();
+	}
+
 	void VulkanCommandList::BindVertexBuffer(u16 inputSlot, RHI::Buffer* pBuffer, u64 offset)
 	{
 		CHECK_RECORDING;
 		assert(pBuffer->GetType() == RHI::BufferType::Vertex || pBuffer->GetType() == RHI::BufferType::Default);
-		UpdateBarriers();
 
-		m_BoundInputSlots.push_back(inputSlot);
 		VkBuffer buffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
+		if (inputSlot < m_BoundVertexBuffers.size() && m_BoundVertexBuffers[inputSlot].first == buffer && m_BoundVertexBuffers[inputSlot].second == offset)
+			return;
+		UpdateBarriers();
+
+		if (inputSlot >= m_BoundVertexBuffers.size())
+			m_BoundVertexBuffers.resize(inputSlot + 1, std::make_pair(VkBuffer(VK_NULL_HANDLE), VkDeviceSize(0)));
+		m_BoundVertexBuffers[inputSlot] = std::make_pair(buffer, offset);
+		if (std::find(m_BoundInputSlots.begin(), m_BoundInputSlots.end(), inputSlot) == m_BoundInputSlots.end())
+			m_BoundInputSlots.push_back(inputSlot);
 		vkCmdBindVertexBuffers(m_CommandBuffer, inputSlot, 1, &buffer, &offset);
 	}
 
@@ -184,12 +420,17 @@ namespace Vulkan {
 
 		std::vector<VkBuffer> vkBuffers;
 		vkBuffers.reserve(buffers.size());
+		if (inputSlot + buffers.size() > m_BoundVertexBuffers.size())
+			m_BoundVertexBuffers.resize(inputSlot + buffers.size(), std::make_pair(VkBuffer(VK_NULL_HANDLE), VkDeviceSize(0)));
 		u16 slot = inputSlot;
 		for (RHI::Buffer* pBuffer : buffers)
 		{
 			assert(pBuffer->GetType() == RHI::BufferType::Vertex || pBuffer->GetType() == RHI::BufferType::Default);
-			m_BoundInputSlots.push_back(slot++);
+			if (std::find(m_BoundInputSlots.begin(), m_BoundInputSlots.end(), slot) == m_BoundInputSlots.end())
+				m_BoundInputSlots.push_back(slot);
 			vkBuffers.push_back(((VulkanBuffer*)pBuffer)->GetBuffer());
+			m_BoundVertexBuffers[slot] = std::make_pair(vkBuffers.back(), offsets[slot - inputSlot]);
+			++slot;
 		}
 		vkCmdBindVertexBuffers(m_CommandBuffer, inputSlot, u32(vkBuffers.size()), vkBuffers.data(), offsets.data());
 	}
@@ -197,21 +438,25 @@ namespace Vulkan {
 	void VulkanCommandList::BindIndexBuffer(RHI::Buffer* pBuffer, u64 offset)
 	{
 		CHECK_RECORDING;
-		UpdateBarriers();
-
 		assert(pBuffer->GetType() == RHI::BufferType::Index);
-		VkBuffer buffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
-		vkCmdBindIndexBuffer(m_CommandBuffer, buffer, offset, Helpers::GetIndexType(pBuffer->GetIndexType()));
+		BindIndexBuffer(pBuffer, offset, pBuffer->GetIndexType());
 	}
 
 	void VulkanCommandList::BindIndexBuffer(RHI::Buffer* pBuffer, u64 offset, RHI::IndexType type)
 	{
 		CHECK_RECORDING;
-		UpdateBarriers();
-
 		assert(pBuffer->GetType() == RHI::BufferType::Index || pBuffer->GetType() == RHI::BufferType::Default);
+
 		VkBuffer buffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
-		vkCmdBindIndexBuffer(m_CommandBuffer, buffer, offset, Helpers::GetIndexType(type));
+		VkIndexType indexType = Helpers::GetIndexType(type);
+		if (buffer == m_BoundIndexBuffer && offset == m_BoundIndexOffset && indexType == m_BoundIndexType)
+			return;
+		UpdateBarriers();
+
+		m_BoundIndexBuffer = buffer;
+		m_BoundIndexOffset = offset;
+		m_BoundIndexType = indexType;
+		vkCmdBindIndexBuffer(m_CommandBuffer, buffer, offset, indexType);
 	}
 
 	void VulkanCommandList::BindDescriptorSets(u32 firstSet, RHI::DescriptorSet* pSet)
@@ -223,6 +468,7 @@ namespace Vulkan {
 		VkPipelineBindPoint bindpoint = Helpers::GetPipelineBindPoint(m_pPipeline->GetType());
 		VkPipelineLayout layout = ((VulkanPipeline*)m_pPipeline)->GetLayout();
 		VkDescriptorSet vulkanSet = ((VulkanDescriptorSet*)pSet)->GetDescriptorSet();
+		((VulkanDescriptorSet*)pSet)->MarkBound();
 
 		vkCmdBindDescriptorSets(m_CommandBuffer, bindpoint, layout, firstSet, 1, &vulkanSet, 0, nullptr);
 	}
@@ -236,6 +482,7 @@ namespace Vulkan {
 		VkPipelineBindPoint bindpoint = Helpers::GetPipelineBindPoint(m_pPipeline->GetType());
 		VkPipelineLayout layout = ((VulkanPipeline*)m_pPipeline)->GetLayout();
 		VkDescriptorSet vulkanSet = ((VulkanDescriptorSet*)pSet)->GetDescriptorSet();
+		((VulkanDescriptorSet*)pSet)->MarkBound();
 
 		vkCmdBindDescriptorSets(m_CommandBuffer, bindpoint, layout, firstSet, 1, &vulkanSet, 1, &dynamicOffset);
 	}
@@ -251,9 +498,10 @@ namespace Vulkan {
 
 		std::vector<VkDescriptorSet> vulkanSets;
 		vulkanSets.reserve(sets.size());
-		for (const RHI::DescriptorSet* pSet : sets)
+		for (RHI::DescriptorSet* pSet : sets)
 		{
 			vulkanSets.push_back(((VulkanDescriptorSet*)pSet)->GetDescriptorSet());
+			((VulkanDescriptorSet*)pSet)->MarkBound();
 		}
 
 		vkCmdBindDescriptorSets(m_CommandBuffer, bindpoint, layout, firstSet, u32(vulkanSets.size()), vulkanSets.data(), 0, nullptr);
@@ -271,15 +519,26 @@ namespace Vulkan {
 
 		std::vector<VkDescriptorSet> vulkanSets;
 		vulkanSets.reserve(sets.size());
-		for (const RHI::DescriptorSet* pSet : sets)
+		for (RHI::DescriptorSet* pSet : sets)
 		{
 			vulkanSets.push_back(((VulkanDescriptorSet*)pSet)->GetDescriptorSet());
+			((VulkanDescriptorSet*)pSet)->MarkBound();
 		}
 
 		vkCmdBindDescriptorSets(m_CommandBuffer, bindpoint, layout, firstSet, u32(vulkanSets.size()), vulkanSets.data(), u32(dynamicOffsets.size()), dynamicOffsets.data());
 	}
 
-	void VulkanCommandList::SetViewport(RHI::Viewport& viewport)
+	void VulkanCommandList::PushConstants(u32 offset, u32 size, const void* pData)
+	{
+		CHECK_RECORDING;
+
+		assert(m_pPipeline);
+		VkPipelineLayout layout = ((VulkanPipeline*)m_pPipeline)->GetLayout();
+
+		vkCmdPushConstants(m_CommandBuffer, layout, VK_SHADER_STAGE_ALL, offset, size, pData);
+	}
+
+	void VulkanCommandList::SetViewport(const RHI::Viewport& viewport)
 	{
 		CHECK_RECORDING;
 		UpdateBarriers();
@@ -294,7 +553,7 @@ namespace Vulkan {
 		vkCmdSetViewport(m_CommandBuffer, 0, 1, &vp);
 	}
 
-	void VulkanCommandList::SetScissor(RHI::ScissorRect& scissor)
+	void VulkanCommandList::SetScissor(const RHI::ScissorRect& scissor)
 	{
 		CHECK_RECORDING;
 		UpdateBarriers();
@@ -307,6 +566,131 @@ namespace Vulkan {
 		vkCmdSetScissor(m_CommandBuffer, 0, 1, &rect);
 	}
 
+	void VulkanCommandList::SetCullMode(RHI::CullMode cullMode)
+	{
+		CHECK_RECORDING;
+		if (!IsExtendedDynamicStateSupported() || (IsDynamicStateValid(RHI::DynamicState::CullMode) && m_CullMode == cullMode))
+			return;
+		UpdateBarriers();
+
+		m_CullMode = cullMode;
+		m_ValidDynamicState |= RHI::DynamicState::CullMode;
+#ifdef VK_EXT_extended_dynamic_state
+		((VulkanContext*)m_pContext)->GetDevice()->vkCmdSetCullMode(m_CommandBuffer, Helpers::GetCullMode(cullMode));
+#endif
+	}
+
+	void VulkanCommandList::SetFrontFace(RHI::FrontFace frontFace)
+	{
+		CHECK_RECORDING;
+		if (!IsExtendedDynamicStateSupported() || (IsDynamicStateValid(RHI::DynamicState::FrontFace) && m_FrontFace == frontFace))
+			return;
+		UpdateBarriers();
+
+		m_FrontFace = frontFace;
+		m_ValidDynamicState |= RHI::DynamicState::FrontFace;
+#ifdef VK_EXT_extended_dynamic_state
+		((VulkanContext*)m_pContext)->GetDevice()->vkCmdSetFrontFace(m_CommandBuffer, Helpers::GetFrontFace(frontFace));
+#endif
+	}
+
+	void VulkanCommandList::SetPrimitiveTopology(RHI::PrimitiveTopology topology)
+	{
+		CHECK_RECORDING;
+		if (!IsExtendedDynamicStateSupported() || (IsDynamicStateValid(RHI::DynamicState::PrimitiveTopology) && m_PrimitiveTopology == topology))
+			return;
+		UpdateBarriers();
+
+		m_PrimitiveTopology = topology;
+		m_ValidDynamicState |= RHI::DynamicState::PrimitiveTopology;
+#ifdef VK_EXT_extended_dynamic_state
+		((VulkanContext*)m_pContext)->GetDevice()->vkCmdSetPrimitiveTopology(m_CommandBuffer, Helpers::GetPrimitiveTopology(topology));
+#endif
+	}
+
+	void VulkanCommandList::SetDepthTest(b8 enableTest, b8 enableWrite, RHI::CompareOp compareOp)
+	{
+		CHECK_RECORDING;
+		if (!IsExtendedDynamicStateSupported())
+			return;
+
+		// Each part of the depth state is filtered separately
+		b8 valid = IsDynamicStateValid(RHI::DynamicState::DepthTest);
+		if (valid && m_DepthTestEnable == enableTest && m_DepthWriteEnable == enableWrite && m_DepthCompareOp == compareOp)
+			return;
+		UpdateBarriers();
+
+#ifdef VK_EXT_extended_dynamic_state
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		if (!valid || m_DepthTestEnable != enableTest)
+			pDevice->vkCmdSetDepthTestEnable(m_CommandBuffer, enableTest);
+		if (!valid || m_DepthWriteEnable != enableWrite)
+			pDevice->vkCmdSetDepthWriteEnable(m_CommandBuffer, enableWrite);
+		if (!valid || m_DepthCompareOp != compareOp)
+			pDevice->vkCmdSetDepthCompareOp(m_CommandBuffer, Helpers::GetCompareOp(compareOp));
+#endif
+
+		m_DepthTestEnable = enableTest;
+		m_DepthWriteEnable = enableWrite;
+		m_DepthCompareOp = compareOp;
+		m_ValidDynamicState |= RHI::DynamicState::DepthTest;
+	}
+
+	void VulkanCommandList::SetStencilTest(b8 enableTest, const RHI::StencilOpState& front, const RHI::StencilOpState& back)
+	{
+		CHECK_RECORDING;
+		if (!IsExtendedDynamicStateSupported())
+			return;
+
+		// Only the ops are dynamic here, masks and reference have their own dynamic states
+		auto opsEqual = [](const RHI::StencilOpState& a, const RHI::StencilOpState& b)
+		{
+			return a.failOp == b.failOp && a.passOp == b.passOp && a.depthFailOp == b.depthFailOp && a.compareOp == b.compareOp;
+		};
+
+		b8 valid = IsDynamicStateValid(RHI::DynamicState::StencilTest);
+		b8 setEnable = !valid || m_StencilTestEnable != enableTest;
+		b8 setFront = !valid || !opsEqual(m_StencilFront, front);
+		b8 setBack = !valid || !opsEqual(m_StencilBack, back);
+		if (!setEnable && !setFront && !setBack)
+			return;
+		UpdateBarriers();
+
+#ifdef VK_EXT_extended_dynamic_state
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		if (setEnable)
+			pDevice->vkCmdSetStencilTestEnable(m_CommandBuffer, enableTest);
+		if (setFront && setBack && opsEqual(front, back))
+		{
+			pDevice->vkCmdSetStencilOp(m_CommandBuffer, VK_STENCIL_FACE_FRONT_AND_BACK, Helpers::GetStencilOp(front.failOp), Helpers::GetStencilOp(front.passOp),
+				Helpers::GetStencilOp(front.depthFailOp), Helpers::GetCompareOp(front.compareOp));
+		}
+		else
+		{
+			if (setFront)
+			{
+				pDevice->vkCmdSetStencilOp(m_CommandBuffer, VK_STENCIL_FACE_FRONT_BIT, Helpers::GetStencilOp(front.failOp), Helpers::GetStencilOp(front.passOp),
+					Helpers::GetStencilOp(front.depthFailOp), Helpers::GetCompareOp(front.compareOp));
+			}
+			if (setBack)
+			{
+				pDevice->vkCmdSetStencilOp(m_CommandBuffer, VK_STENCIL_FACE_BACK_BIT, Helpers::GetStencilOp(back.failOp), Helpers::GetStencilOp(back.passOp),
+					Helpers::GetStencilOp(back.depthFailOp), Helpers::GetCompareOp(back.compareOp));
+			}
+		}
+#endif
+
+		m_StencilTestEnable = enableTest;
+		m_StencilFront = front;
+		m_StencilBack = back;
+		m_ValidDynamicState |= RHI::DynamicState::StencilTest;
+	}
+
+	b8 VulkanCommandList::IsExtendedDynamicStateSupported() const
+	{
+		return ((VulkanContext*)m_pContext)->GetDevice()->IsExtendedDynamicStateSupported();
+	}
+
 	void VulkanCommandList::Draw(u32 vertexCount, u32 instanceCount, u32 firstVertex, u32 firstInstance)
 	{
 		CHECK_RECORDING;
@@ -324,6 +708,104 @@ namespace Vulkan {
 		vkCmdDrawIndexed(m_CommandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 	}
 
+	void VulkanCommandList::DrawIndirect(RHI::Buffer* pBuffer, u64 offset, u32 drawCount, u32 stride)
+	{
+		CHECK_RECORDING;
+		assert((pBuffer->GetType() & RHI::BufferType::Indirect) != RHI::BufferType::Default);
+		UpdateBarriers();
+
+		VkBuffer buffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		if (drawCount <= 1 || pDevice->GetPhysicalDevice()->GetFeatures().multiDrawIndirect)
+		{
+			vkCmdDrawIndirect(m_CommandBuffer, buffer, offset, drawCount, stride);
+		}
+		else
+		{
+			// Without multiDrawIndirect, each draw needs to be recorded separately
+			for (u32 i = 0; i < drawCount; ++i)
+			{
+				vkCmdDrawIndirect(m_CommandBuffer, buffer, offset + u64(i) * stride, 1, stride);
+			}
+		}
+	}
+
+	void VulkanCommandList::DrawIndexedIndirect(RHI::Buffer* pBuffer, u64 offset, u32 drawCount, u32 stride)
+	{
+		CHECK_RECORDING;
+		assert((pBuffer->GetType() & RHI::BufferType::Indirect) != RHI::BufferType::Default);
+		UpdateBarriers();
+
+		VkBuffer buffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		if (drawCount <= 1 || pDevice->GetPhysicalDevice()->GetFeatures().multiDrawIndirect)
+		{
+			vkCmdDrawIndexedIndirect(m_CommandBuffer, buffer, offset, drawCount, stride);
+		}
+		else
+		{
+			// Without multiDrawIndirect, each draw needs to be recorded separately
+			for (u32 i = 0; i < drawCount; ++i)
+			{
+				vkCmdDrawIndexedIndirect(m_CommandBuffer, buffer, offset + u64(i) * stride, 1, stride);
+			}
+		}
+	}
+
+	void VulkanCommandList::DrawIndirectCount(RHI::Buffer* pBuffer, u64 offset, RHI::Buffer* pCountBuffer, u64 countOffset,
+		u32 maxDrawCount, u32 stride)
+	{
+		CHECK_RECORDING;
+		assert((pBuffer->GetType() & RHI::BufferType::Indirect) != RHI::BufferType::Default);
+		assert((pCountBuffer->GetType() & RHI::BufferType::Indirect) != RHI::BufferType::Default);
+		UpdateBarriers();
+
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		if (!pDevice->IsDrawIndirectCountSupported())
+		{
+			//g_Logger.LogWarning(LogVulkanRHI(), "Can't record an indirect count draw, VK_KHR_draw_indirect_count is not enabled!");
+			return;
+		}
+
+		VkBuffer buffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
+		VkBuffer countBuffer = ((VulkanBuffer*)pCountBuffer)->GetBuffer();
+		pDevice->vkCmdDrawIndirectCount(m_CommandBuffer, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+	}
+
+	void VulkanCommandList::DrawIndexedIndirectCount(RHI::Buffer* pBuffer, u64 offset, RHI::Buffer* pCountBuffer, u64 countOffset,
+		u32 maxDrawCount, u32 stride)
+	{
+		CHECK_RECORDING;
+		assert((pBuffer->GetType() & RHI::BufferType::Indirect) != RHI::BufferType::Default);
+		assert((pCountBuffer->GetType() & RHI::BufferType::Indirect) != RHI::BufferType::Default);
+		UpdateBarriers();
+
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		if (!pDevice->IsDrawIndirectCountSupported())
+		{
+			//g_Logger.LogWarning(LogVulkanRHI(), "Can't record an indirect count draw, VK_KHR_draw_indirect_count is not enabled!");
+			return;
+		}
+
+		VkBuffer buffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
+		VkBuffer countBuffer = ((VulkanBuffer*)pCountBuffer)->GetBuffer();
+		pDevice->vkCmdDrawIndexedIndirectCount(m_CommandBuffer, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+	}
+
+	b8 VulkanCommandList::IsDrawIndirectCountSupported() const
+	{
+		return ((VulkanContext*)m_pContext)->GetDevice()->IsDrawIndirectCountSupported();
+	}
+
+	void VulkanCommandList::Dispatch(u32 groupCountX, u32 groupCountY, u32 groupCountZ)
+	{
+		CHECK_RECORDING;
+		assert(m_pPipeline && m_pPipeline->GetType() == RHI::PipelineType::Compute);
+		UpdateBarriers();
+
+		vkCmdDispatch(m_CommandBuffer, groupCountX, groupCountY, groupCountZ);
+	}
+
 	void VulkanCommandList::CopyBuffer(RHI::Buffer* pSrcBuffer, u64 srcOffset,
 		RHI::Buffer* pDstBuffer, u64 dstOffset, u64 size)
 	{
@@ -338,6 +820,7 @@ namespace Vulkan {
 		region.size = size;
 
 		vkCmdCopyBuffer(m_CommandBuffer, vkSrcBuffer, vkDstBuffer, 1, &region);
+		((VulkanBuffer*)pDstBuffer)->MarkWritten();
 	}
 
 	void VulkanCommandList::CopyBuffer(RHI::Buffer* pSrcBuffer, RHI::Buffer* pDstBuffer,
@@ -361,6 +844,7 @@ namespace Vulkan {
 		VkBuffer vkSrcBuffer = ((VulkanBuffer*)pSrcBuffer)->GetBuffer();
 		VkBuffer vkDstBuffer = ((VulkanBuffer*)pDstBuffer)->GetBuffer();
 		vkCmdCopyBuffer(m_CommandBuffer, vkSrcBuffer, vkDstBuffer, u32(copies.size()), copies.data());
+		((VulkanBuffer*)pDstBuffer)->MarkWritten();
 	}
 
 	void VulkanCommandList::CopyTexture(RHI::Texture* pSrcTex, RHI::Texture* pDstTex,
@@ -403,6 +887,7 @@ namespace Vulkan {
 		VkImage dstImage = ((VulkanTexture*)pDstTex)->GetImage();
 		VkImageLayout dstLayout = Helpers::GetImageLayout(pDstTex->GetLayout());
 		vkCmdCopyImage(m_CommandBuffer, srcImage, srcLayout, dstImage, dstLayout, 1, &copyRegion);
+		((VulkanTexture*)pDstTex)->MarkWritten();
 	}
 
 	void VulkanCommandList::CopyTexture(RHI::Texture* pSrcTex, RHI::Texture* pDstTex,
@@ -453,6 +938,7 @@ namespace Vulkan {
 		VkImage dstImage = ((VulkanTexture*)pDstTex)->GetImage();
 		VkImageLayout dstLayout = Helpers::GetImageLayout(pDstTex->GetLayout());
 		vkCmdCopyImage(m_CommandBuffer, srcImage, srcLayout, dstImage, dstLayout, u32(copyRegions.size()), copyRegions.data());
+		((VulkanTexture*)pDstTex)->MarkWritten();
 	}
 
 	void VulkanCommandList::CopyBufferToTexture(RHI::Buffer* pBuffer, RHI::Texture* pTexture,
@@ -487,6 +973,7 @@ namespace Vulkan {
 		VkImageLayout imageLayout = Helpers::GetImageLayout(pTexture->GetLayout());
 
 		vkCmdCopyBufferToImage(m_CommandBuffer, vkBuffer, vkImage, imageLayout, 1, &copyRegion);
+		((VulkanTexture*)pTexture)->MarkWritten();
 	}
 
 	void VulkanCommandList::CopyBufferToTexture(RHI::Buffer* pBuffer, RHI::Texture* pTexture,
@@ -529,6 +1016,7 @@ namespace Vulkan {
 		VkImageLayout imageLayout = Helpers::GetImageLayout(pTexture->GetLayout());
 
 		vkCmdCopyBufferToImage(m_CommandBuffer, vkBuffer, vkImage, imageLayout, u32(copyRegions.size()), copyRegions.data());
+		((VulkanTexture*)pTexture)->MarkWritten();
 	}
 
 	void VulkanCommandList::CopyTextureToBuffer(RHI::Texture* pTexture, RHI::Buffer* pBuffer,
@@ -563,6 +1051,7 @@ namespace Vulkan {
 		VkImageLayout imageLayout = Helpers::GetImageLayout(pTexture->GetLayout());
 
 		vkCmdCopyImageToBuffer(m_CommandBuffer, vkImage, imageLayout, vkBuffer, 1, &copyRegion);
+		((VulkanBuffer*)pBuffer)->MarkWritten();
 	}
 
 	void VulkanCommandList::CopyTextureToBuffer(RHI::Texture* pTexture, RHI::Buffer* pBuffer,
@@ -605,6 +1094,19 @@ namespace Vulkan {
 		VkImageLayout imageLayout = Helpers::GetImageLayout(pTexture->GetLayout());
 
 		vkCmdCopyImageToBuffer(m_CommandBuffer, vkImage, imageLayout, vkBuffer, u32(copyRegions.size()), copyRegions.data());
+		((VulkanBuffer*)pBuffer)->MarkWritten();
+	}
+
+	void VulkanCommandList::FillBuffer(RHI::Buffer* pBuffer, u64 offset, u64 size, u32 value)
+	{
+		CHECK_RECORDING;
+		assert((offset & 3) == 0);
+		assert(size == u64(-1) || (size & 3) == 0);
+		UpdateBarriers();
+
+		VkBuffer vkBuffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
+		vkCmdFillBuffer(m_CommandBuffer, vkBuffer, offset, size == u64(-1) ? VK_WHOLE_SIZE : size, value);
+		((VulkanBuffer*)pBuffer)->MarkWritten();
 	}
 
 	void VulkanCommandList::TransitionTextureLayout(RHI::PipelineStage srcStage, RHI::PipelineStage dstStage, RHI::Texture* pTexture,
@@ -648,6 +1150,95 @@ namespace Vulkan {
 
 		pTexture->SetLayout(transition.layout);
 		((VulkanTexture*)pTexture)->SetOwningQueueFamily(queueFamily);
+		// Layout transitions rewrite the image, so the texture can't be moved while they execute
+		((VulkanTexture*)pTexture)->MarkWritten();
+	}
+
+	void VulkanCommandList::BufferBarrier(RHI::PipelineStage srcStage, RHI::PipelineStage dstStage, RHI::Buffer* pBuffer, u64 offset,
+		u64 size)
+	{
+		CHECK_RECORDING;
+
+		if (srcStage != m_SrcStage || dstStage != m_DstStage)
+		{
+			UpdateBarriers();
+		}
+
+		m_SrcStage = srcStage;
+		m_DstStage = dstStage;
+
+		VkBufferMemoryBarrier bufferBarrier = {};
+		bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		bufferBarrier.srcAccessMask = Helpers::GetBufferBarrierAccessMode(srcStage, true);
+		bufferBarrier.dstAccessMask = Helpers::GetBufferBarrierAccessMode(dstStage, false);
+		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.buffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
+		bufferBarrier.offset = offset;
+		bufferBarrier.size = size == u64(-1) ? VK_WHOLE_SIZE : size;
+
+		m_BufferBarriers.push_back(bufferBarrier);
+	}
+
+	void VulkanCommandList::AliasingBarrier(RHI::PipelineStage srcStage, RHI::PipelineStage dstStage, RHI::Texture* pTexture,
+		RHI::TextureLayout layout)
+	{
+		CHECK_RECORDING;
+
+		if (srcStage != m_SrcStage || dstStage != m_DstStage)
+		{
+			UpdateBarriers();
+		}
+
+		m_SrcStage = srcStage;
+		m_DstStage = dstStage;
+
+		// The previous contents belong to another resource, so the image starts from an undefined layout, which also means no queue family ownership transfer is needed
+		VkImageMemoryBarrier imageBarrier = {};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = Helpers::GetAliasingBarrierAccessMode(srcStage, true);
+		imageBarrier.dstAccessMask = Helpers::GetAliasingBarrierAccessMode(dstStage, false) | Helpers::GetImageTransitionAccessMode(dstStage, layout, false);
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageBarrier.newLayout = Helpers::GetImageLayout(layout);
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = ((VulkanTexture*)pTexture)->GetImage();
+
+		VkImageAspectFlags aspect = pTexture->GetFormat().HasDepthComponent() ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		if (pTexture->GetFormat().HasStencilComponent())
+			aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		imageBarrier.subresourceRange.aspectMask = aspect;
+		imageBarrier.subresourceRange.baseArrayLayer = 0;
+		imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		imageBarrier.subresourceRange.baseMipLevel = 0;
+		imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+
+		m_ImageBarriers.push_back(imageBarrier);
+
+		pTexture->SetLayout(layout);
+		((VulkanTexture*)pTexture)->SetOwningQueueFamily(((VulkanQueue*)m_pQueue)->GetQueueFamily());
+		((VulkanTexture*)pTexture)->MarkWritten();
+	}
+
+	void VulkanCommandList::AliasingBarrier(RHI::PipelineStage srcStage, RHI::PipelineStage dstStage, RHI::Buffer* pBuffer)
+	{
+		CHECK_RECORDING;
+
+		if (srcStage != m_SrcStage || dstStage != m_DstStage)
+		{
+			UpdateBarriers();
+		}
+
+		m_SrcStage = srcStage;
+		m_DstStage = dstStage;
+
+		// The previous resource can be a texture, which a buffer barrier doesn't cover, so the barrier covers all memory
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = Helpers::GetAliasingBarrierAccessMode(srcStage, true);
+		memoryBarrier.dstAccessMask = Helpers::GetAliasingBarrierAccessMode(dstStage, false);
+
+		m_GlobalBarriers.push_back(memoryBarrier);
 	}
 
 	b8 VulkanCommandList::Submit()
@@ -837,6 +1428,56 @@ namespace Vulkan {
 			m_DstStage = RHI::PipelineStage::None;
 		}
 	}
+
+	void VulkanCommandList::DiscardTransientAttachments(const RHI::RenderingDesc& desc)
+	{
+		VkImageMemoryBarrier barriers[RHI::MaxRenderingColorAttachments + 1] = {};
+		u32 barrierCount = 0;
+		VkPipelineStageFlags stages = 0;
+		for (u32 i = 0; i < desc.colorAttachmentCount + 1; ++i)
+		{
+			const RHI::RenderingAttachment& renderingAttachment = i < desc.colorAttachmentCount ? desc.colorAttachments[i] : desc.depthStencilAttachment;
+			if (!renderingAttachment.pRenderTarget)
+				continue;
+
+			VulkanTexture* pTexture = (VulkanTexture*)renderingAttachment.pRenderTarget->GetTexture();
+			if ((pTexture->GetFlags() & RHI::TextureFlags::Transient) == RHI::TextureFlags::None)
+				continue;
+
+			// Waiting on earlier writes to the attachment also orders them against this pass, when the memory is shared
+			VkImageMemoryBarrier& barrier = barriers[barrierCount++];
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = pTexture->GetImage();
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.layerCount = 1;
+			if (i < desc.colorAttachmentCount)
+			{
+				barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				stages |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			}
+			else
+			{
+				PixelFormat format = pTexture->GetFormat();
+				barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+				barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				if (format.HasDepthComponent())
+					barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_DEPTH_BIT;
+				if (format.HasStencilComponent())
+					barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+				stages |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			}
+		}
+
+		if (barrierCount > 0)
+			vkCmdPipelineBarrier(m_CommandBuffer, stages, stages, 0, 0, nullptr, 0, nullptr, barrierCount, barriers);
+	}
 }
 
 #undef CHECK_RECORDING
@@ -4,6 +4,7 @@
 #include "../RHI/CommandList.h"
 
 namespace Vulkan {
+	class VulkanTexture;
 	
 	class VulkanCommandList final : public RHI::CommandList
 	{
@@ -38,6 +39,21 @@ namespace Vulkan {
 		 * End the current render pass
 		 */
 		void EndRenderPass() override final;
+		/**
+		 * Begin rendering to a set of render targets, without a render pass or framebuffer object
+		 * @param[in] desc	Rendering description
+		 * @note			Uses VK_KHR_dynamic_rendering when available, a cached render pass and framebuffer otherwise
+		 */
+		void BeginRendering(const RHI::RenderingDesc& desc) override final;
+		/**
+		 * End rendering started with BeginRendering
+		 */
+		void EndRendering() override final;
+		/**
+		 * Check if rendering without render pass and framebuffer objects is natively supported
+		 * @return	True if VK_KHR_dynamic_rendering is enabled, false otherwise
+		 */
+		b8 IsDynamicRenderingSupported() const override final;
 
 		/**
 		* Bind a vertex buffer
@@ -97,17 +113,63 @@ namespace Vulkan {
 		 * @note						Use this function when using a combined buffer (vertices, indices, etc. in same buffer)
 		 */
 		void BindDescriptorSets(u32 firstSet, const std::vector<RHI::DescriptorSet*>& sets, const std::vector<u32>& dynamicOffsets) override final;
+		/**
+		 * Update push constants of the bound pipeline
+		 * @param[in] offset	Offset in the push constant range
+		 * @param[in] size		Size of the data
+		 * @param[in] pData		Data to push
+		 */
+		void PushConstants(u32 offset, u32 size, const void* pData) override final;
 
 		/**
 		 * Set the viewport
 		 * @param[in] viewport	Viewport
 		 */
-		void SetViewport(RHI::Viewport& viewport) override final;
+		void SetViewport(const RHI::Viewport& viewport) override final;
 		/**
 		 * Set the scissor rect
 		 * @param[in] scissor	Scissor rect
 		 */
-		void SetScissor(RHI::ScissorRect& scissor) override final;
+		void SetScissor(const RHI::ScissorRect& scissor) override final;
+		/**
+		 * Set the cull mode
+		 * @param[in] cullMode	Cull mode
+		 * @note				Requires VK_EXT_extended_dynamic_state, redundant changes are filtered out
+		 */
+		void SetCullMode(RHI::CullMode cullMode) override final;
+		/**
+		 * Set the front face
+		 * @param[in] frontFace	Front face
+		 * @note				Requires VK_EXT_extended_dynamic_state, redundant changes are filtered out
+		 */
+		void SetFrontFace(RHI::FrontFace frontFace) override final;
+		/**
+		 * Set the primitive topology
+		 * @param[in] topology	Primitive topology
+		 * @note				Requires VK_EXT_extended_dynamic_state, redundant changes are filtered out
+		 */
+		void SetPrimitiveTopology(RHI::PrimitiveTopology topology) override final;
+		/**
+		 * Set the depth test state
+		 * @param[in] enableTest	If a depth test needs to be used
+		 * @param[in] enableWrite	If the depth needs to be written to
+		 * @param[in] compareOp		Depth compare op
+		 * @note					Requires VK_EXT_extended_dynamic_state, redundant changes are filtered out
+		 */
+		void SetDepthTest(b8 enableTest, b8 enableWrite, RHI::CompareOp compareOp) override final;
+		/**
+		 * Set the stencil test state
+		 * @param[in] enableTest	If a stencil test needs to be used
+		 * @param[in] front			Stencil op state for front face
+		 * @param[in] back			Stencil op state for back face
+		 * @note					Requires VK_EXT_extended_dynamic_state, redundant changes are filtered out
+		 */
+		void SetStencilTest(b8 enableTest, const RHI::StencilOpState& front, const RHI::StencilOpState& back) override final;
+		/**
+		 * Check if extended dynamic state is supported
+		 * @return	True if VK_EXT_extended_dynamic_state is enabled, false otherwise
+		 */
+		b8 IsExtendedDynamicStateSupported() const override final;
 
 		/**
 		 * Draw a number of vertices and instances
@@ -126,6 +188,57 @@ namespace Vulkan {
 		 * @param[in] firstInstance		Index of instance to start drawing from
 		 */
 		void DrawIndexed(u32 indexCount, u32 instanceCount = 1, u32 firstIndex = 0, u32 vertexOffset = 0, u32 firstInstance = 0) override final;
+		/**
+		 * Draw using parameters read from a buffer
+		 * @param[in] pBuffer		Buffer containing DrawIndirectCommand structures
+		 * @param[in] offset		Offset in buffer of the first command
+		 * @param[in] drawCount		Amount of draws to execute
+		 * @param[in] stride		Stride in bytes between consecutive commands
+		 */
+		void DrawIndirect(RHI::Buffer* pBuffer, u64 offset, u32 drawCount = 1, u32 stride = sizeof(RHI::DrawIndirectCommand)) override final;
+		/**
+		 * Draw using parameters read from a buffer (indexed)
+		 * @param[in] pBuffer		Buffer containing DrawIndexedIndirectCommand structures
+		 * @param[in] offset		Offset in buffer of the first command
+		 * @param[in] drawCount		Amount of draws to execute
+		 * @param[in] stride		Stride in bytes between consecutive commands
+		 */
+		void DrawIndexedIndirect(RHI::Buffer* pBuffer, u64 offset, u32 drawCount = 1, u32 stride = sizeof(RHI::DrawIndexedIndirectCommand)) override final;
+		/**
+		 * Draw using parameters read from a buffer, with the amount of draws read from a second buffer
+		 * @param[in] pBuffer		Buffer containing DrawIndirectCommand structures
+		 * @param[in] offset		Offset in buffer of the first command
+		 * @param[in] pCountBuffer	Buffer containing the draw count
+		 * @param[in] countOffset	Offset in the count buffer
+		 * @param[in] maxDrawCount	Maximum amount of draws to execute
+		 * @param[in] stride		Stride in bytes between consecutive commands
+		 * @note					Requires VK_KHR_draw_indirect_count
+		 */
+		void DrawIndirectCount(RHI::Buffer* pBuffer, u64 offset, RHI::Buffer* pCountBuffer, u64 countOffset, u32 maxDrawCount, u32 stride = sizeof(RHI::DrawIndirectCommand)) override final;
+		/**
+		 * Draw using parameters read from a buffer, with the amount of draws read from a second buffer (indexed)
+		 * @param[in] pBuffer		Buffer containing DrawIndexedIndirectCommand structures
+		 * @param[in] offset		Offset in buffer of the first command
+		 * @param[in] pCountBuffer	Buffer containing the draw count
+		 * @param[in] countOffset	Offset in the count buffer
+		 * @param[in] maxDrawCount	Maximum amount of draws to execute
+		 * @param[in] stride		Stride in bytes between consecutive commands
+		 * @note					Requires VK_KHR_draw_indirect_count
+		 */
+		void DrawIndexedIndirectCount(RHI::Buffer* pBuffer, u64 offset, RHI::Buffer* pCountBuffer, u64 countOffset, u32 maxDrawCount, u32 stride = sizeof(RHI::DrawIndexedIndirectCommand)) override final;
+		/**
+		 * Check if the count variants of the indirect draws are supported
+		 * @return	True if VK_KHR_draw_indirect_count is enabled, false otherwise
+		 */
+		b8 IsDrawIndirectCountSupported() const override final;
+
+		/**
+		 * Dispatch compute work groups
+		 * @param[in] groupCountX	Amount of work groups in the x dimension
+		 * @param[in] groupCountY	Amount of work groups in the y dimension
+		 * @param[in] groupCountZ	Amount of work groups in the z dimension
+		 */
+		void Dispatch(u32 groupCountX, u32 groupCountY = 1, u32 groupCountZ = 1) override final;
 
 		/**
 		* Copy data from one buffer to another
@@ -201,6 +314,14 @@ namespace Vulkan {
 		 *							(make sure you know what you are doing!)
 		 */
 		void CopyTextureToBuffer(RHI::Texture* pTexture, RHI::Buffer* pBuffer, const std::vector<RHI::TextureBufferCopyRegion>& regions) override final;
+		/**
+		 * Fill a region of a buffer with a repeated 32-bit value
+		 * @param[in] pBuffer		Buffer to fill
+		 * @param[in] offset		Offset in buffer (multiple of 4)
+		 * @param[in] size			Amount of bytes to fill (multiple of 4), u64(-1) fills until the end of the buffer
+		 * @param[in] value			Value to fill with
+		 */
+		void FillBuffer(RHI::Buffer* pBuffer, u64 offset, u64 size, u32 value) override final;
 
 		/**
 		* Transition the layout of a texture
@@ -208,6 +329,30 @@ namespace Vulkan {
 		* @param[in] transition	Texture layout transition info
 		*/
 		void TransitionTextureLayout(RHI::PipelineStage srcStage, RHI::PipelineStage dstStage, RHI::Texture* pTexture, const RHI::TextureLayoutTransition& transition) override final;
+		/**
+		* Make writes to a buffer in the source stage visible to the destination stage
+		* @param[in] srcStage		Source stage
+		* @param[in] dstStage		Destination stage
+		* @param[in] pBuffer		Buffer
+		* @param[in] offset			Offset of the region in the buffer
+		* @param[in] size			Size of the region, u64(-1) covers the rest of the buffer
+		*/
+		void BufferBarrier(RHI::PipelineStage srcStage, RHI::PipelineStage dstStage, RHI::Buffer* pBuffer, u64 offset = 0, u64 size = u64(-1)) override final;
+		/**
+		* Hand the memory of a heap over to a texture, after it was used by other resources placed at an overlapping offset
+		* @param[in] srcStage		Stage in which the previous resource was last used
+		* @param[in] dstStage		Stage in which the texture is first used
+		* @param[in] pTexture		Texture that starts using the memory
+		* @param[in] layout			Layout to transition the texture to
+		*/
+		void AliasingBarrier(RHI::PipelineStage srcStage, RHI::PipelineStage dstStage, RHI::Texture* pTexture, RHI::TextureLayout layout) override final;
+		/**
+		* Hand the memory of a heap over to a buffer, after it was used by other resources placed at an overlapping offset
+		* @param[in] srcStage		Stage in which the previous resource was last used
+		* @param[in] dstStage		Stage in which the buffer is first used
+		* @param[in] pBuffer		Buffer that starts using the memory
+		*/
+		void AliasingBarrier(RHI::PipelineStage srcStage, RHI::PipelineStage dstStage, RHI::Buffer* pBuffer) override final;
 
 		/**
 		 * Submit the command buffer to its queue
@@ -228,6 +373,12 @@ namespace Vulkan {
 		 */
 		b8 Wait(u64 timeout = u64(-1)) override final;
 
+		/**
+		 * Get the vulkan command buffer
+		 * @return	Vulkan command buffer
+		 */
+		VkCommandBuffer GetCommandBuffer() { return m_CommandBuffer; }
+
 	private:
 		friend class VulkanCommandListManager;
 
@@ -249,6 +400,17 @@ namespace Vulkan {
 		 * Update the barriers
 		 */
 		void UpdateBarriers();
+		/**
+		 * Transition the transient attachments from an undefined layout, since their memory may be shared with other transient attachments
+		 * @param[in] desc	Rendering description
+		 */
+		void DiscardTransientAttachments(const RHI::RenderingDesc& desc);
+		/**
+		 * Check if an extended dynamic state was already set to a known value
+		 * @param[in] state	Dynamic state
+		 * @return			True if the state is known, false otherwise
+		 */
+		b8 IsDynamicStateValid(RHI::DynamicState state) const { return (m_ValidDynamicState & state) != RHI::DynamicState::None; }
 
 		VkCommandBuffer m_CommandBuffer;	/**< Vulkan command buffer */
 
@@ -257,6 +419,29 @@ namespace Vulkan {
 		std::vector<VkMemoryBarrier> m_GlobalBarriers;
 		std::vector<VkBufferMemoryBarrier> m_BufferBarriers;
 		std::vector<VkImageMemoryBarrier> m_ImageBarriers;
+
+		// Dynamic rendering
+		b8 m_DynamicRendering;												/**< If rendering was begun with vkCmdBeginRenderingKHR */
+		VulkanTexture* m_pPresentableTextures[RHI::MaxRenderingColorAttachments];	/**< Presentable textures to transition when rendering ends */
+		u32 m_PresentableImageCount;										/**< Amount of presentable images */
+
+		// Last set extended dynamic state, to filter out redundant changes
+		RHI::DynamicState m_ValidDynamicState;		/**< Dynamic states with a known value, reset on begin and when a pipeline with the state baked in is bound */
+		RHI::CullMode m_CullMode;					/**< Cull mode */
+		RHI::FrontFace m_FrontFace;					/**< Front face */
+		RHI::PrimitiveTopology m_PrimitiveTopology;	/**< Primitive topology */
+		b8 m_DepthTestEnable;						/**< Depth test enable */
+		b8 m_DepthWriteEnable;						/**< Depth write enable */
+		RHI::CompareOp m_DepthCompareOp;			/**< Depth compare op */
+		b8 m_StencilTestEnable;						/**< Stencil test enable */
+		RHI::StencilOpState m_StencilFront;			/**< Front face stencil ops */
+		RHI::StencilOpState m_StencilBack;			/**< Back face stencil ops */
+
+		// Last bound vertex and index buffers, to filter out redundant binds of buffers shared by many meshes
+		std::vector<std::pair<VkBuffer, VkDeviceSize>> m_BoundVertexBuffers;	/**< Bound vertex buffer and offset by input slot */
+		VkBuffer m_BoundIndexBuffer;				/**< Bound index buffer */
+		VkDeviceSize m_BoundIndexOffset;			/**< Bound index buffer offset */
+		VkIndexType m_BoundIndexType;				/**< Bound index type */
 	};
 
 }
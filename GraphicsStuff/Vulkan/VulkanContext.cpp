@@ -6,42 +6,18 @@
 #include "VulkanPhysicalDevice.h"
 #include "VulkanDevice.h"
 #include "VulkanDescriptorSetManager.h"
+#include "VulkanSamplerCache.h"
+#include "VulkanRenderPassCache.h"
+#include "VulkanPipelineLibraryCache.h"
+#include "VulkanDefragmenter.h"
+#include "VulkanHostAllocator.h"
 #include "../RHI/GpuInfo.h"
 
 #include <iostream>
+#include <algorithm>
 
 namespace Vulkan {
 
-	// Vulkan allocation callbacks
-	// TODO: _aligned_... is MSVC
-	void* VulkanAlloc(void* pUserData, sizeT size, sizeT alignment, VkSystemAllocationScope scope)
-	{
-		//return g_Alloctor.Allocate(size, u16(alignment), HV_ALLOC_CONTEXT(Memory::AllocCategory::RHI));
-		return _aligned_malloc(size, alignment);
-	}
-
-	void* VulkanRealloc(void* pUserData, void* pOriginal, sizeT size, sizeT alignment, VkSystemAllocationScope scope)
-	{
-		//return g_Alloctor.Reallocate(pOriginal, size, u16(alignment), HV_ALLOC_CONTEXT(Memory::AllocCategory::RHI));
-		return _aligned_realloc(pOriginal, size, alignment);
-	}
-
-	void VulkanFree(void* pUserData, void* pMemory)
-	{
-		//g_Alloctor.Free(pMemory);
-		_aligned_free(pMemory);
-	}
-
-	void VulkanInterAlloc(void* pUserdata, sizeT size, VkInternalAllocationType type, VkSystemAllocationScope scope)
-	{
-		// don't do anything for now, this is just a notification
-	}
-
-	void VulkanInternFree(void* pUserdata, sizeT size, VkInternalAllocationType type, VkSystemAllocationScope scope)
-	{
-		// don't do anything for now, this is just a notification
-	}
-
 	VkBool32 VulkanDebugReportCallback(
 		VkDebugReportFlagsEXT                       flags,
 		VkDebugReportObjectTypeEXT                  objectType,
@@ -66,18 +42,17 @@ namespace Vulkan {
 		, m_pInstance(nullptr)
 		, m_pDevice(nullptr)
 		, m_pAllocator(nullptr)
+		, m_pPipelineLibraryCache(nullptr)
+		, m_pDefragmenter(nullptr)
 		, m_pSelectedPhysicalDevice(nullptr)
 	{
-		m_AllocationCallbacks.pUserData = nullptr;
-		m_AllocationCallbacks.pfnAllocation = &VulkanAlloc;
-		m_AllocationCallbacks.pfnReallocation = &VulkanRealloc;
-		m_AllocationCallbacks.pfnFree = &VulkanFree;
-		m_AllocationCallbacks.pfnInternalAllocation = &VulkanInterAlloc;
-		m_AllocationCallbacks.pfnInternalFree = &VulkanInternFree;
+		m_pHostAllocator = new VulkanHostAllocator();
+		m_pHostAllocator->GetCallbacks(m_AllocationCallbacks);
 	}
 
 	VulkanContext::~VulkanContext()
 	{
+		delete m_pHostAllocator;
 	}
 
 	b8 VulkanContext::Init(const RHI::RHIDesc& desc, GLFWwindow* pMainWindow)
@@ -95,6 +70,8 @@ namespace Vulkan {
 		requestedInstanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #else
 #endif
+		// Needed to query extended device features (only enabled when available)
+		requestedInstanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 
 		if (desc.validationLevel != RHI::RHIValidationLevel::None)
 		{
@@ -198,6 +175,52 @@ namespace Vulkan {
 			deviceQueues.push_back(queueInfo);
 		}
 
+		// Optional device extensions
+		if (pPhysicalDevice->IsExtensionAvailable(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+			requestedDeviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		if (pPhysicalDevice->IsExtensionAvailable(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME))
+			requestedDeviceExtensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+		if (pPhysicalDevice->IsExtensionAvailable(VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME) &&
+			pPhysicalDevice->IsExtensionAvailable(VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME))
+		{
+			requestedDeviceExtensions.push_back(VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME);
+			requestedDeviceExtensions.push_back(VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME);
+		}
+		if (pPhysicalDevice->IsBindlessSupported())
+		{
+			requestedDeviceExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+			requestedDeviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		}
+#ifdef VK_EXT_extended_dynamic_state
+		if (pPhysicalDevice->IsExtendedDynamicStateSupported())
+			requestedDeviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+#endif
+#ifdef VK_KHR_dynamic_rendering
+		if (pPhysicalDevice->IsDynamicRenderingSupported())
+		{
+			// Multiview and maintenance2 are core in 1.1, but are still dependencies on 1.0 devices
+			if (pPhysicalDevice->IsExtensionAvailable(VK_KHR_MULTIVIEW_EXTENSION_NAME))
+				requestedDeviceExtensions.push_back(VK_KHR_MULTIVIEW_EXTENSION_NAME);
+			if (pPhysicalDevice->IsExtensionAvailable(VK_KHR_MAINTENANCE2_EXTENSION_NAME))
+				requestedDeviceExtensions.push_back(VK_KHR_MAINTENANCE2_EXTENSION_NAME);
+			requestedDeviceExtensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+			requestedDeviceExtensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+			requestedDeviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		}
+#endif
+#ifdef VK_EXT_memory_budget
+		if (pPhysicalDevice->IsExtensionAvailable(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) &&
+			m_pInstance->IsExtensionEnabled(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+			requestedDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+#endif
+#ifdef VK_EXT_graphics_pipeline_library
+		if (pPhysicalDevice->IsGraphicsPipelineLibrarySupported())
+		{
+			requestedDeviceExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+			requestedDeviceExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+		}
+#endif
+
 		// Use all available device features for now
 		features = pPhysicalDevice->GetFeatures();
 		Helpers::DisableUnsupportedDeviceFeatures(pPhysicalDevice->GetFeatures(), features);
@@ -222,6 +245,7 @@ namespace Vulkan {
 			Destroy();
 			return false;
 		}
+		UpdateMemoryBudgets();
 
 		// Create command list manager
 		m_pCommandListManager = new VulkanCommandListManager();
@@ -241,11 +265,71 @@ namespace Vulkan {
 			return false;
 		}
 
+		// Create sampler cache
+		m_pSamplerCache = new VulkanSamplerCache();
+		res = m_pSamplerCache->Create(this);
+		if (!res)
+		{
+			Destroy();
+			return false;
+		}
+
+		// Create render pass cache
+		m_pRenderPassCache = new VulkanRenderPassCache();
+		res = m_pRenderPassCache->Create(this);
+		if (!res)
+		{
+			Destroy();
+			return false;
+		}
+
+		// Create pipeline library cache, only when pipelines can be linked from libraries
+		if (pPhysicalDevice->IsGraphicsPipelineLibrarySupported())
+		{
+			m_pPipelineLibraryCache = new VulkanPipelineLibraryCache();
+			res = m_pPipelineLibraryCache->Create(this);
+			if (!res)
+			{
+				Destroy();
+				return false;
+			}
+		}
+
+		// Create defragmenter
+		m_pDefragmenter = new VulkanDefragmenter();
+		res = m_pDefragmenter->Create(this);
+		if (!res)
+		{
+			Destroy();
+			return false;
+		}
+
 		return true;
 	}
 
 	b8 VulkanContext::Destroy()
 	{
+		if (m_pDefragmenter)
+		{
+			m_pDefragmenter->Destroy();
+			delete m_pDefragmenter;
+			m_pDefragmenter = nullptr;
+		}
+
+		if (m_pPipelineLibraryCache)
+		{
+			m_pPipelineLibraryCache->Destroy();
+			delete m_pPipelineLibraryCache;
+			m_pPipelineLibraryCache = nullptr;
+		}
+
+		if (m_pRenderPassCache)
+		{
+			m_pRenderPassCache->Destroy();
+			delete m_pRenderPassCache;
+			m_pRenderPassCache = nullptr;
+		}
+
 		if (m_pDescriptorSetManager)
 		{
 			m_pDescriptorSetManager->Destroy();
@@ -253,6 +337,14 @@ namespace Vulkan {
 			m_pDescriptorSetManager = nullptr;
 		}
 
+		// Destroyed after the descriptor set manager, as layouts and the bindless set can still reference samplers
+		if (m_pSamplerCache)
+		{
+			m_pSamplerCache->Destroy();
+			delete m_pSamplerCache;
+			m_pSamplerCache = nullptr;
+		}
+
 		if (m_pCommandListManager)
 		{
 			m_pCommandListManager->Destroy();
@@ -302,6 +394,47 @@ namespace Vulkan {
 		return true;
 	}
 
+	void VulkanContext::UpdateMemoryBudgets()
+	{
+		m_pAllocator->UpdateBudgets();
+
+		const std::vector<HeapInfo>& heapInfo = m_pAllocator->GetHeapInfo();
+		m_MemoryBudgets.resize(heapInfo.size());
+		for (u32 i = 0; i < heapInfo.size(); ++i)
+		{
+			RHI::MemoryHeapBudget& budget = m_MemoryBudgets[i];
+			budget.size = heapInfo[i].totalSize;
+			budget.budget = heapInfo[i].budget;
+			budget.usage = m_pAllocator->GetHeapUsage(i);
+			budget.allocated = heapInfo[i].usedSize;
+			budget.deviceLocal = (heapInfo[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		}
+	}
+
+	void VulkanContext::DefragmentMemory(u64 maxBytes)
+	{
+		m_pDefragmenter->Step(maxBytes);
+	}
+
+	b8 VulkanContext::DumpMemoryJson(const std::string& filePath)
+	{
+		return m_pAllocator->DumpJson(filePath);
+	}
+
+	u64 VulkanContext::GetBufferOffsetAlignment(RHI::BufferType type)
+	{
+		// All alignments are powers of 2, so the largest one satisfies all of them
+		const VkPhysicalDeviceLimits& limits = m_pSelectedPhysicalDevice->GetLimits();
+		u64 alignment = 1;
+		if ((type & RHI::BufferType::Uniform) != RHI::BufferType::Default)
+			alignment = std::max(alignment, u64(limits.minUniformBufferOffsetAlignment));
+		if ((type & RHI::BufferType::Storage) != RHI::BufferType::Default)
+			alignment = std::max(alignment, u64(limits.minStorageBufferOffsetAlignment));
+		if ((type & (RHI::BufferType::UniformTexel | RHI::BufferType::StorageTexel)) != RHI::BufferType::Default)
+			alignment = std::max(alignment, u64(limits.minTexelBufferOffsetAlignment));
+		return alignment;
+	}
+
 	VkResult VulkanContext::UpdateSurfaceSupport(VkSurfaceKHR surface)
 	{
 		for (VulkanPhysicalDevice* pDevice : m_PhysicalDevices)
@@ -8,6 +8,9 @@
 namespace Vulkan {
 	class VulkanDevice;
 	class VulkanPhysicalDevice;
+	class VulkanPipelineLibraryCache;
+	class VulkanDefragmenter;
+	class VulkanHostAllocator;
 
 	class VulkanInstance;
 	
@@ -30,6 +33,28 @@ namespace Vulkan {
 		 */
 		b8 Destroy() override;
 
+		/**
+		 * Update the memory heap usage and budgets, should be called once per frame
+		 */
+		void UpdateMemoryBudgets() override final;
+		/**
+		 * Move resources out of sparsely used memory blocks, should be called once per frame
+		 * @param[in] maxBytes	Maximum amount of bytes to copy this frame
+		 */
+		void DefragmentMemory(u64 maxBytes) override final;
+		/**
+		 * Write the memory statistics and a listing of all allocations to a json file
+		 * @param[in] filePath	Path of the json file
+		 * @return				True if the file was written successfully, false otherwise
+		 */
+		b8 DumpMemoryJson(const std::string& filePath) override final;
+		/**
+		 * Get the minimum alignment of an offset in a buffer when binding it in a descriptor set
+		 * @param[in] type	Buffer type
+		 * @return			Minimum offset alignment, a power of 2
+		 */
+		u64 GetBufferOffsetAlignment(RHI::BufferType type) override final;
+
 		/**
 		 * Update the physical device surface support
 		 * @param[in] surface	Vulkan surface
@@ -53,6 +78,11 @@ namespace Vulkan {
 		 * @return	Vulkan allocation callbacks
 		 */
 		VkAllocationCallbacks* GetAllocationCallbacks() { return &m_AllocationCallbacks; }
+		/**
+		 * Get the host allocator backing the vulkan allocation callbacks
+		 * @return	Host allocator
+		 */
+		VulkanHostAllocator* GetHostAllocator() { return m_pHostAllocator; }
 
 		/**
 		 * Get the vulkan instance
@@ -74,14 +104,27 @@ namespace Vulkan {
 		 * @return	Vulkan memory allocator
 		 */
 		VulkanAllocator* GetAllocator() { return m_pAllocator; }
+		/**
+		 * Get the pipeline library cache
+		 * @return	Pipeline library cache, nullptr when graphics pipeline libraries are unsupported
+		 */
+		VulkanPipelineLibraryCache* GetPipelineLibraryCache() { return m_pPipelineLibraryCache; }
+		/**
+		 * Get the memory defragmenter
+		 * @return	Memory defragmenter
+		 */
+		VulkanDefragmenter* GetDefragmenter() { return m_pDefragmenter; }
 
 	private:
 		VkAllocationCallbacks m_AllocationCallbacks;		/**< Vulkan allocation callbacks */
+		VulkanHostAllocator* m_pHostAllocator;				/**< Host allocator backing the allocation callbacks */
 		VulkanInstance* m_pInstance;						/**< Vulkan instance */
 		std::vector<VulkanPhysicalDevice*> m_PhysicalDevices;	/**< Vulkan physical devices */
 		VulkanPhysicalDevice* m_pSelectedPhysicalDevice;
 		VulkanDevice* m_pDevice;							/**< Vulkan device */
 		VulkanAllocator* m_pAllocator;						/**< Vulkan memory allocator */
+		VulkanPipelineLibraryCache* m_pPipelineLibraryCache;	/**< Pipeline library cache */
+		VulkanDefragmenter* m_pDefragmenter;				/**< Memory defragmenter */
 	};
 
 }
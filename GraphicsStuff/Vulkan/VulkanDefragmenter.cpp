@@ -0,0 +1,529 @@
+
+#include "VulkanDefragmenter.h"
+#include <algorithm>
+#include "VulkanContext.h"
+#include "VulkanDevice.h"
+#include "VulkanMemory.h"
+#include "VulkanBuffer.h"
+#include "VulkanTexture.h"
+#include "VulkanQueue.h"
+#include "VulkanCommandList.h"
+#include "VulkanHelpers.h"
+#include "VulkanDescriptorSetManager.h"
+#include "../RHI/CommandListManager.h"
+
+namespace Vulkan {
+
+	VulkanDefragmenter::VulkanDefragmenter()
+		: m_pContext(nullptr)
+		, m_pBufferCommandList(nullptr)
+		, m_pTextureCommandList(nullptr)
+		, m_MoveFrame(0)
+		, m_MaxOccupancy(0.5f)
+	{
+	}
+
+	VulkanDefragmenter::~VulkanDefragmenter()
+	{
+	}
+
+	b8 VulkanDefragmenter::Create(VulkanContext* pContext)
+	{
+		m_pContext = pContext;
+		return true;
+	}
+
+	b8 VulkanDefragmenter::Destroy()
+	{
+		if (m_pBufferCommandList)
+			m_pBufferCommandList->Wait();
+		if (m_pTextureCommandList)
+			m_pTextureCommandList->Wait();
+		CancelCommandList(m_pBufferCommandList);
+		CancelCommandList(m_pTextureCommandList);
+		ReleaseRetired(true);
+		return true;
+	}
+
+	void VulkanDefragmenter::Step(u64 maxBytes)
+	{
+		VulkanAllocator* pAllocator = m_pContext->GetAllocator();
+
+		ReleaseRetired(false);
+		// Only start new copies once the previous ones are done, so a resource is never moved twice at the same time
+		if (!FinishMoves() || maxBytes == 0)
+			return;
+
+		// Empty the sparsest blocks first
+		std::vector<VulkanMemoryBlock*> srcBlocks;
+		for (VulkanMemoryBlock* pBlock : pAllocator->GetBlocks())
+		{
+			if (f32(pBlock->usedSize) < f32(pBlock->size) * m_MaxOccupancy)
+				srcBlocks.push_back(pBlock);
+		}
+		std::sort(srcBlocks.begin(), srcBlocks.end(), [](VulkanMemoryBlock* pA, VulkanMemoryBlock* pB)
+		{
+			return f32(pA->usedSize) / f32(pA->size) < f32(pB->usedSize) / f32(pB->size);
+		});
+
+		m_MoveFrame = m_pContext->GetFrameIndex();
+		u64 budget = maxBytes;
+		for (VulkanMemoryBlock* pBlock : srcBlocks)
+		{
+			std::vector<VulkanMemoryBlock*> dstBlocks = GetDestinationBlocks(pBlock);
+			if (dstBlocks.empty())
+				continue;
+
+			// New allocations only go into the destination blocks, so the allocations of the source block don't change while iterating
+			for (VulkanAllocation* pAllocation : pBlock->allocations)
+			{
+				if (pAllocation->GetSize() > budget || !IsMovable(pAllocation))
+					continue;
+
+				b8 recorded;
+				if (pAllocation->GetOwningBuffer())
+					recorded = RecordBufferMove(pAllocation->GetOwningBuffer(), dstBlocks);
+				else
+					recorded = RecordTextureMove(pAllocation->GetOwningTexture(), dstBlocks);
+				if (recorded)
+					budget -= pAllocation->GetSize();
+			}
+		}
+
+		SubmitCommandList(m_pBufferCommandList);
+		SubmitCommandList(m_pTextureCommandList);
+	}
+
+	b8 VulkanDefragmenter::CancelMoves(VulkanBuffer* pBuffer)
+	{
+		std::vector<Move>::iterator it = std::find_if(m_Moves.begin(), m_Moves.end(), [pBuffer](const Move& move) { return move.pBuffer == pBuffer; });
+		if (it == m_Moves.end())
+			return false;
+
+		// The copy still reads the buffer, so it's released with the new buffer
+		RetireMove(*it);
+		RetiredResource retired = {};
+		retired.buffer = pBuffer->GetBuffer();
+		retired.pAllocation = it->pSrcAllocation;
+		retired.pAllocation->SetOwner((VulkanBuffer*)nullptr);
+		retired.frame = m_MoveFrame;
+		m_Retired.push_back(retired);
+		m_Moves.erase(it);
+		return true;
+	}
+
+	b8 VulkanDefragmenter::CancelMoves(VulkanTexture* pTexture)
+	{
+		std::vector<Move>::iterator it = std::find_if(m_Moves.begin(), m_Moves.end(), [pTexture](const Move& move) { return move.pTexture == pTexture; });
+		if (it == m_Moves.end())
+			return false;
+
+		// The copy still reads the image, so it's released with the new image
+		RetireMove(*it);
+		RetiredResource retired = {};
+		retired.image = pTexture->GetImage();
+		retired.pAllocation = it->pSrcAllocation;
+		retired.pAllocation->SetOwner((VulkanTexture*)nullptr);
+		retired.frame = m_MoveFrame;
+		m_Retired.push_back(retired);
+		m_Moves.erase(it);
+		return true;
+	}
+
+	b8 VulkanDefragmenter::FinishMoves()
+	{
+		// Poll the command lists, the copies are never waited on
+		if (m_pBufferCommandList && (!m_pBufferCommandList->Wait(0) || m_pBufferCommandList->GetState() != RHI::CommandListState::Finished))
+			return false;
+		if (m_pTextureCommandList && (!m_pTextureCommandList->Wait(0) || m_pTextureCommandList->GetState() != RHI::CommandListState::Finished))
+			return false;
+
+		RHI::CommandListManager* pCommandListManager = m_pContext->GetCommandListManager();
+		if (m_pBufferCommandList)
+		{
+			pCommandListManager->DestroyCommandList(m_pBufferCommandList);
+			m_pBufferCommandList = nullptr;
+		}
+		if (m_pTextureCommandList)
+		{
+			pCommandListManager->DestroyCommandList(m_pTextureCommandList);
+			m_pTextureCommandList = nullptr;
+		}
+
+		VulkanDescriptorSetManager* pDescriptorSetManager = (VulkanDescriptorSetManager*)m_pContext->GetDescriptorSetManager();
+		u32 graphicsFamily = ((VulkanQueue*)m_pContext->GetQueue(RHI::QueueType::Graphics))->GetQueueFamily();
+		u64 frame = m_pContext->GetFrameIndex();
+		for (const Move& move : m_Moves)
+		{
+			// The copy is outdated when the resource was written after the copy was recorded
+			u64 lastWriteFrame = move.pSrcAllocation->GetLastWriteFrame();
+			if (lastWriteFrame != u64(-1) && lastWriteFrame >= m_MoveFrame)
+			{
+				CancelMove(move);
+				continue;
+			}
+
+			RetiredResource retired = {};
+			retired.frame = frame;
+			b8 moved = false;
+			if (move.pBuffer)
+			{
+				if (pDescriptorSetManager->CanRewriteDescriptors(move.pBuffer))
+				{
+					moved = move.pBuffer->Move(move.buffer, move.pAllocation, retired.buffer, retired.bufferView, retired.pAllocation);
+					if (moved)
+						pDescriptorSetManager->RewriteDescriptors(move.pBuffer, retired.buffer, retired.bufferView);
+				}
+			}
+			else
+			{
+				if (pDescriptorSetManager->CanRewriteDescriptors(move.pTexture))
+				{
+					moved = move.pTexture->Move(move.image, move.pAllocation, retired.image, retired.imageView, retired.pAllocation);
+					if (moved)
+					{
+						// The copy was done on the graphics queue, which now owns the new image
+						move.pTexture->SetOwningQueueFamily(graphicsFamily);
+						pDescriptorSetManager->RewriteDescriptors(move.pTexture, retired.imageView);
+					}
+				}
+			}
+
+			if (moved)
+				m_Retired.push_back(retired);
+			else
+				CancelMove(move);
+		}
+		m_Moves.clear();
+		return true;
+	}
+
+	void VulkanDefragmenter::SubmitCommandList(RHI::CommandList*& pCommandList)
+	{
+		if (!pCommandList)
+			return;
+
+		if (!pCommandList->End())
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "Failed to end a defragmentation command list!");
+			CancelCommandList(pCommandList);
+		}
+		else if (!pCommandList->Submit())
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "Failed to submit a defragmentation command list!");
+			CancelCommandList(pCommandList);
+		}
+	}
+
+	void VulkanDefragmenter::CancelCommandList(RHI::CommandList*& pCommandList)
+	{
+		if (!pCommandList)
+			return;
+
+		b8 textures = pCommandList == m_pTextureCommandList;
+		for (std::vector<Move>::iterator it = m_Moves.begin(); it != m_Moves.end();)
+		{
+			if ((it->pTexture != nullptr) == textures)
+			{
+				CancelMove(*it);
+				it = m_Moves.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		m_pContext->GetCommandListManager()->DestroyCommandList(pCommandList);
+		pCommandList = nullptr;
+	}
+
+	void VulkanDefragmenter::ReleaseRetired(b8 force)
+	{
+		VulkanDevice* pDevice = m_pContext->GetDevice();
+		VulkanAllocator* pAllocator = m_pContext->GetAllocator();
+		// Resources of cancelled moves stay in use until the pending copies complete
+		b8 copiesPending = m_pBufferCommandList || m_pTextureCommandList;
+		for (std::vector<RetiredResource>::iterator it = m_Retired.begin(); it != m_Retired.end();)
+		{
+			if (!force && (!m_pContext->IsFrameComplete(it->frame) || (copiesPending && it->frame >= m_MoveFrame)))
+			{
+				++it;
+				continue;
+			}
+
+			if (it->bufferView != VK_NULL_HANDLE)
+				pDevice->vkDestroyBufferView(it->bufferView);
+			if (it->buffer != VK_NULL_HANDLE)
+				pDevice->vkDestroyBuffer(it->buffer);
+			if (it->imageView != VK_NULL_HANDLE)
+				pDevice->vkDestroyImageView(it->imageView);
+			if (it->image != VK_NULL_HANDLE)
+				pDevice->vkDestroyImage(it->image);
+			pAllocator->Free(it->pAllocation);
+			it = m_Retired.erase(it);
+		}
+	}
+
+	void VulkanDefragmenter::CancelMove(const Move& move)
+	{
+		VulkanDevice* pDevice = m_pContext->GetDevice();
+		if (move.buffer != VK_NULL_HANDLE)
+			pDevice->vkDestroyBuffer(move.buffer);
+		if (move.image != VK_NULL_HANDLE)
+			pDevice->vkDestroyImage(move.image);
+		m_pContext->GetAllocator()->Free(move.pAllocation);
+	}
+
+	void VulkanDefragmenter::RetireMove(const Move& move)
+	{
+		RetiredResource retired = {};
+		retired.buffer = move.buffer;
+		retired.image = move.image;
+		retired.pAllocation = move.pAllocation;
+		retired.frame = m_MoveFrame;
+		m_Retired.push_back(retired);
+	}
+
+	b8 VulkanDefragmenter::IsMovable(VulkanAllocation* pAllocation)
+	{
+		// Aliased memory is shared by multiple resources and mapped memory has pointers into it held by the cpu
+		if (pAllocation->IsAliased() || pAllocation->IsMapped() || pAllocation->IsBeingWritten())
+			return false;
+
+		VulkanDescriptorSetManager* pDescriptorSetManager = (VulkanDescriptorSetManager*)m_pContext->GetDescriptorSetManager();
+		VulkanBuffer* pBuffer = pAllocation->GetOwningBuffer();
+		if (pBuffer)
+		{
+			// Shaders write to storage buffers without going through the command list, so those writes can't be tracked
+			const RHI::BufferType unmovableTypes = RHI::BufferType::Storage | RHI::BufferType::StorageTexel | RHI::BufferType::Staging;
+			if ((pBuffer->GetType() & unmovableTypes) != RHI::BufferType::Default)
+				return false;
+			// Dynamic buffers are written by the cpu and the copy needs both transfer usages
+			const RHI::BufferFlags unmovableFlags = RHI::BufferFlags::Dynamic | RHI::BufferFlags::NoRead | RHI::BufferFlags::NoWrite;
+			if ((pBuffer->GetFlags() & unmovableFlags) != RHI::BufferFlags::None)
+				return false;
+			return pDescriptorSetManager->CanRewriteDescriptors(pBuffer);
+		}
+
+		VulkanTexture* pTexture = pAllocation->GetOwningTexture();
+		if (!pTexture)
+			return false;
+
+		// Attachments and storage textures are written by the gpu almost every frame, so moving them would rarely succeed
+		const RHI::TextureFlags unmovableFlags = RHI::TextureFlags::Dynamic | RHI::TextureFlags::Storage | RHI::TextureFlags::RenderTargetable |
+			RHI::TextureFlags::Color | RHI::TextureFlags::DepthStencil | RHI::TextureFlags::Transient;
+		if ((pTexture->GetFlags() & unmovableFlags) != RHI::TextureFlags::None)
+			return false;
+		// The contents of an image in an undefined layout can't be copied
+		if (pTexture->GetLayout() == RHI::TextureLayout::Unknown)
+			return false;
+		// Images are copied on the graphics queue, without a queue family ownership transfer
+		u32 graphicsFamily = ((VulkanQueue*)m_pContext->GetQueue(RHI::QueueType::Graphics))->GetQueueFamily();
+		if (pTexture->GetOwningQueueFamily() != graphicsFamily)
+			return false;
+		return pDescriptorSetManager->CanRewriteDescriptors(pTexture);
+	}
+
+	std::vector<VulkanMemoryBlock*> VulkanDefragmenter::GetDestinationBlocks(VulkanMemoryBlock* pSrcBlock)
+	{
+		std::vector<VulkanMemoryBlock*> dstBlocks;
+		for (VulkanMemoryBlock* pBlock : m_pContext->GetAllocator()->GetBlocks())
+		{
+			if (pBlock != pSrcBlock &&
+				pBlock->memoryTypeIndex == pSrcBlock->memoryTypeIndex &&
+				pBlock->forImages == pSrcBlock->forImages &&
+				pBlock->usedSize >= pSrcBlock->usedSize)
+			{
+				dstBlocks.push_back(pBlock);
+			}
+		}
+		// Fill up the fullest blocks first
+		std::sort(dstBlocks.begin(), dstBlocks.end(), [](VulkanMemoryBlock* pA, VulkanMemoryBlock* pB)
+		{
+			return pA->size - pA->usedSize < pB->size - pB->usedSize;
+		});
+		return dstBlocks;
+	}
+
+	b8 VulkanDefragmenter::RecordBufferMove(VulkanBuffer* pBuffer, const std::vector<VulkanMemoryBlock*>& dstBlocks)
+	{
+		if (!m_pBufferCommandList)
+		{
+			RHI::CommandListManager* pCommandListManager = m_pContext->GetCommandListManager();
+			m_pBufferCommandList = pCommandListManager->CreateCommandList(m_pContext->GetQueue(RHI::QueueType::Transfer));
+			if (!m_pBufferCommandList)
+				return false;
+			if (!m_pBufferCommandList->Begin())
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "Failed to begin the defragmentation command list for buffers!");
+				pCommandListManager->DestroyCommandList(m_pBufferCommandList);
+				m_pBufferCommandList = nullptr;
+				return false;
+			}
+		}
+
+		VulkanDevice* pDevice = m_pContext->GetDevice();
+		VulkanAllocator* pAllocator = m_pContext->GetAllocator();
+
+		Move move = {};
+		move.pBuffer = pBuffer;
+		move.pSrcAllocation = pBuffer->GetAllocation();
+		VkResult vkres = pBuffer->CreateMoveTarget(move.buffer);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to create the vulkan buffer to move a buffer to (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return false;
+		}
+
+		VkMemoryRequirements memRequirements;
+		pDevice->vkGetBufferMemoryRequirements(move.buffer, memRequirements);
+		for (VulkanMemoryBlock* pBlock : dstBlocks)
+		{
+			move.pAllocation = pAllocator->AllocateInBlock(pBlock, memRequirements);
+			if (move.pAllocation)
+				break;
+		}
+		if (!move.pAllocation)
+		{
+			pDevice->vkDestroyBuffer(move.buffer);
+			return false;
+		}
+
+		vkres = pDevice->vkBindBufferMemory(move.buffer, move.pAllocation->GetMemory(), move.pAllocation->GetOffset());
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to bind the memory of a moved buffer (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			CancelMove(move);
+			return false;
+		}
+
+		VkBufferCopy region = {};
+		region.srcOffset = 0;
+		region.dstOffset = 0;
+		region.size = pBuffer->GetSize();
+		vkCmdCopyBuffer(((VulkanCommandList*)m_pBufferCommandList)->GetCommandBuffer(), pBuffer->GetBuffer(), move.buffer, 1, &region);
+
+		m_Moves.push_back(move);
+		return true;
+	}
+
+	b8 VulkanDefragmenter::RecordTextureMove(VulkanTexture* pTexture, const std::vector<VulkanMemoryBlock*>& dstBlocks)
+	{
+		if (!m_pTextureCommandList)
+		{
+			RHI::CommandListManager* pCommandListManager = m_pContext->GetCommandListManager();
+			m_pTextureCommandList = pCommandListManager->CreateCommandList(m_pContext->GetQueue(RHI::QueueType::Graphics));
+			if (!m_pTextureCommandList)
+				return false;
+			if (!m_pTextureCommandList->Begin())
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "Failed to begin the defragmentation command list for textures!");
+				pCommandListManager->DestroyCommandList(m_pTextureCommandList);
+				m_pTextureCommandList = nullptr;
+				return false;
+			}
+		}
+
+		VulkanDevice* pDevice = m_pContext->GetDevice();
+		VulkanAllocator* pAllocator = m_pContext->GetAllocator();
+
+		Move move = {};
+		move.pTexture = pTexture;
+		move.pSrcAllocation = pTexture->GetAllocation();
+		VkResult vkres = pTexture->CreateMoveTarget(move.image);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to create the vulkan image to move a texture to (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return false;
+		}
+
+		VkMemoryRequirements memRequirements;
+		pDevice->vkGetImageMemoryRequirements(move.image, memRequirements);
+		for (VulkanMemoryBlock* pBlock : dstBlocks)
+		{
+			move.pAllocation = pAllocator->AllocateInBlock(pBlock, memRequirements);
+			if (move.pAllocation)
+				break;
+		}
+		if (!move.pAllocation)
+		{
+			pDevice->vkDestroyImage(move.image);
+			return false;
+		}
+
+		vkres = pDevice->vkBindImageMemory(move.image, move.pAllocation->GetMemory(), move.pAllocation->GetOffset());
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to bind the memory of a moved texture (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			CancelMove(move);
+			return false;
+		}
+
+		VkCommandBuffer commandBuffer = ((VulkanCommandList*)m_pTextureCommandList)->GetCommandBuffer();
+		VkImageLayout layout = Helpers::GetImageLayout(pTexture->GetLayout());
+		VkImageAspectFlags aspect = pTexture->GetFormat().HasDepthComponent() ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		if (pTexture->GetFormat().HasStencilComponent())
+			aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+		VkImageMemoryBarrier barriers[2] = {};
+		for (VkImageMemoryBarrier& barrier : barriers)
+		{
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.subresourceRange.aspectMask = aspect;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = pTexture->GetMipLevels();
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = pTexture->GetLayerCount();
+		}
+		// The contents of the new image are undefined until the copy
+		barriers[0].image = pTexture->GetImage();
+		barriers[0].oldLayout = layout;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[0].srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barriers[1].image = move.image;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[1].srcAccessMask = 0;
+		barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 2, barriers);
+
+		std::vector<VkImageCopy> regions(pTexture->GetMipLevels());
+		for (u32 i = 0; i < u32(regions.size()); ++i)
+		{
+			VkImageCopy& region = regions[i];
+			region.srcSubresource.aspectMask = aspect;
+			region.srcSubresource.mipLevel = i;
+			region.srcSubresource.baseArrayLayer = 0;
+			region.srcSubresource.layerCount = pTexture->GetLayerCount();
+			region.dstSubresource = region.srcSubresource;
+			region.srcOffset = { 0, 0, 0 };
+			region.dstOffset = { 0, 0, 0 };
+			region.extent.width = std::max(pTexture->GetWidth() >> i, 1u);
+			region.extent.height = std::max(pTexture->GetHeight() >> i, 1u);
+			region.extent.depth = std::max(pTexture->GetDepth() >> i, 1u);
+		}
+		vkCmdCopyImage(commandBuffer, pTexture->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, move.image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, u32(regions.size()), regions.data());
+
+		// Both images go back to the layout of the texture, the old image stays in use until the move finishes
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[0].newLayout = layout;
+		barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[1].newLayout = layout;
+		barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			0, nullptr, 0, nullptr, 2, barriers);
+
+		m_Moves.push_back(move);
+		return true;
+	}
+
+}
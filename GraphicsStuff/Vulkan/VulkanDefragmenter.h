@@ -0,0 +1,162 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "../General/TypesAndMacros.h"
+
+namespace RHI {
+	class CommandList;
+}
+
+namespace Vulkan {
+	class VulkanContext;
+	class VulkanAllocation;
+	class VulkanBuffer;
+	class VulkanTexture;
+	struct VulkanMemoryBlock;
+
+	/**
+	 * Incremental defragmenter, moves resources out of sparsely used memory blocks into fuller blocks of the same memory type,
+	 * so the sparse blocks can be released. Copies are spread over multiple frames and are never waited on.
+	 */
+	class VulkanDefragmenter final
+	{
+	public:
+		VulkanDefragmenter();
+		~VulkanDefragmenter();
+
+		/**
+		 * Create the defragmenter
+		 * @param[in] pContext	Vulkan context
+		 * @return				True if the defragmenter was created successfully, false otherwise
+		 */
+		b8 Create(VulkanContext* pContext);
+		/**
+		 * Destroy the defragmenter, waits for pending copies, cancels their moves and releases all replaced resources
+		 * @return	True if the defragmenter was destroyed successfully, false otherwise
+		 */
+		b8 Destroy();
+
+		/**
+		 * Run a defragmentation step: finish the moves of copies that completed, release resources that are no longer in use and start new copies
+		 * @param[in] maxBytes	Maximum amount of bytes to copy in this step
+		 * @note				Should be called once per frame, after the frame counter of the context was advanced
+		 */
+		void Step(u64 maxBytes);
+		/**
+		 * Cancel the pending move of a buffer that is being destroyed, the vulkan buffer and allocation are retired until the copy completed
+		 * @param[in] pBuffer	Buffer
+		 * @return				True if a move was cancelled and the buffer's vulkan buffer and allocation were retired, false if the buffer isn't being moved
+		 */
+		b8 CancelMoves(VulkanBuffer* pBuffer);
+		/**
+		 * Cancel the pending move of a texture that is being destroyed, the vulkan image and allocation are retired until the copy completed
+		 * @param[in] pTexture	Texture
+		 * @return				True if a move was cancelled and the texture's vulkan image and allocation were retired, false if the texture isn't being moved
+		 */
+		b8 CancelMoves(VulkanTexture* pTexture);
+
+		/**
+		 * Set the occupancy below which blocks are emptied
+		 * @param[in] occupancy	Used size of a block divided by its size
+		 */
+		void SetMaxOccupancy(f32 occupancy) { m_MaxOccupancy = occupancy; }
+		/**
+		 * Get the occupancy below which blocks are emptied
+		 * @return	Used size of a block divided by its size
+		 */
+		f32 GetMaxOccupancy() const { return m_MaxOccupancy; }
+
+	private:
+		/**
+		 * Resource being copied to a new allocation
+		 */
+		struct Move
+		{
+			VulkanBuffer* pBuffer;				/**< Moved buffer, nullptr when a texture is moved */
+			VulkanTexture* pTexture;			/**< Moved texture, nullptr when a buffer is moved */
+			VulkanAllocation* pSrcAllocation;	/**< Allocation the resource is moved out of */
+			VulkanAllocation* pAllocation;		/**< Allocation the resource is moved to */
+			VkBuffer buffer;					/**< New vulkan buffer */
+			VkImage image;						/**< New vulkan image */
+		};
+
+		/**
+		 * Handles and memory replaced by a move, which the gpu might still use
+		 */
+		struct RetiredResource
+		{
+			VkBuffer buffer;					/**< Previous vulkan buffer */
+			VkBufferView bufferView;			/**< Previous vulkan buffer view */
+			VkImage image;						/**< Previous vulkan image */
+			VkImageView imageView;				/**< Previous vulkan image view */
+			VulkanAllocation* pAllocation;		/**< Previous allocation */
+			u64 frame;							/**< Frame in which the resource was replaced */
+		};
+
+		/**
+		 * Check if the pending copies finished and switch the resources to their new allocations
+		 * @return	True if no copies are pending anymore, false otherwise
+		 */
+		b8 FinishMoves();
+		/**
+		 * End and submit a command list with pending copies, the moves recorded in it are cancelled when it can't be submitted
+		 * @param[inout] pCommandList	Command list, set to nullptr when it was destroyed
+		 */
+		void SubmitCommandList(RHI::CommandList*& pCommandList);
+		/**
+		 * Destroy a command list and cancel the moves recorded in it
+		 * @param[inout] pCommandList	Command list, set to nullptr
+		 */
+		void CancelCommandList(RHI::CommandList*& pCommandList);
+		/**
+		 * Release the retired resources the gpu doesn't use anymore
+		 * @param[in] force	If all retired resources should be released, only allowed when the device is idle
+		 */
+		void ReleaseRetired(b8 force);
+		/**
+		 * Destroy the new resource of a move and free its allocation
+		 * @param[in] move	Move
+		 */
+		void CancelMove(const Move& move);
+		/**
+		 * Retire the new resource of a pending move, its copy might still be executing
+		 * @param[in] move	Move
+		 */
+		void RetireMove(const Move& move);
+		/**
+		 * Check if an allocation can be moved
+		 * @param[in] pAllocation	Allocation
+		 * @return					True if the allocation can be moved, false otherwise
+		 */
+		b8 IsMovable(VulkanAllocation* pAllocation);
+		/**
+		 * Find the blocks an allocation can be moved to: the other blocks of the same memory type that are at least as full as the source block
+		 * @param[in] pSrcBlock		Block the allocation is in
+		 * @return					Destination blocks, sorted from fullest to emptiest
+		 */
+		std::vector<VulkanMemoryBlock*> GetDestinationBlocks(VulkanMemoryBlock* pSrcBlock);
+		/**
+		 * Record the copy of a buffer to a new allocation
+		 * @param[in] pBuffer		Buffer
+		 * @param[in] dstBlocks		Blocks to try to move the buffer to
+		 * @return					True if the copy was recorded, false otherwise
+		 */
+		b8 RecordBufferMove(VulkanBuffer* pBuffer, const std::vector<VulkanMemoryBlock*>& dstBlocks);
+		/**
+		 * Record the copy of a texture to a new allocation
+		 * @param[in] pTexture		Texture
+		 * @param[in] dstBlocks		Blocks to try to move the texture to
+		 * @return					True if the copy was recorded, false otherwise
+		 */
+		b8 RecordTextureMove(VulkanTexture* pTexture, const std::vector<VulkanMemoryBlock*>& dstBlocks);
+
+		VulkanContext* m_pContext;						/**< Vulkan context */
+		RHI::CommandList* m_pBufferCommandList;			/**< Transfer queue command list of the pending buffer copies, nullptr if no buffers are copied */
+		RHI::CommandList* m_pTextureCommandList;		/**< Graphics queue command list of the pending texture copies, nullptr if no textures are copied */
+		std::vector<Move> m_Moves;						/**< Moves of the pending copies */
+		u64 m_MoveFrame;								/**< Frame in which the pending copies were recorded */
+		std::vector<RetiredResource> m_Retired;			/**< Resources replaced by moves */
+		f32 m_MaxOccupancy;								/**< Occupancy below which blocks are emptied */
+	};
+
+}
@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include "VulkanDescriptorSet.h"
 #include "VulkanDescriptorSetManager.h"
 #include "VulkanDescriptorSetLayout.h"
@@ -12,6 +13,8 @@ namespace Vulkan {
 	VulkanDescriptorSet::VulkanDescriptorSet()
 		: m_DescriptorSet(VK_NULL_HANDLE)
 		, m_Pool(VK_NULL_HANDLE)
+		, m_LastBindFrame(u64(-1))
+		, m_TrackReferences(false)
 	{
 	}
 
@@ -24,7 +27,25 @@ namespace Vulkan {
 		m_pContext = pContext;
 		m_pManager = pManager;
 		m_pLayout = pLayout;
-		m_Pool = ((VulkanDescriptorSetManager*)m_pManager)->GetDescriptorPool();
+
+		// Let the manager pick a pool from its persistent pool chain
+		VkResult vkres = ((VulkanDescriptorSetManager*)m_pManager)->AllocateDescriptorSet(m_pLayout, m_DescriptorSet, m_Pool);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to allocate the vulkan descriptor set (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return false;
+		}
+
+		pLayout->IncRefs();
+		return true;
+	}
+
+	b8 VulkanDescriptorSet::Create(RHI::RHIContext* pContext, RHI::DescriptorSetManager* pManager, RHI::DescriptorSetLayout* pLayout, VkDescriptorPool pool)
+	{
+		m_pContext = pContext;
+		m_pManager = pManager;
+		m_pLayout = pLayout;
+		m_Pool = pool;
 
 		VkDescriptorSetLayout layout = ((VulkanDescriptorSetLayout*)m_pLayout)->GetLayout();
 
@@ -47,13 +68,29 @@ namespace Vulkan {
 		return true;
 	}
 
-	b8 VulkanDescriptorSet::Destroy()
+	void VulkanDescriptorSet::Init(RHI::RHIContext* pContext, RHI::DescriptorSetManager* pManager, RHI::DescriptorSetLayout* pLayout, VkDescriptorSet set, VkDescriptorPool pool)
 	{
-		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		m_pContext = pContext;
+		m_pManager = pManager;
+		m_pLayout = pLayout;
+		m_DescriptorSet = set;
+		m_Pool = pool;
+
+		// Transient set objects are reused every frame
+		UntrackAll();
+		m_LastBindFrame = u64(-1);
 
+		pLayout->IncRefs();
+	}
+
+	b8 VulkanDescriptorSet::Destroy()
+	{
+		UntrackAll();
 		if (m_DescriptorSet)
 		{
-			pDevice->vkFreeDescriptorSet(m_Pool, m_DescriptorSet);
+			// Transient sets are released when their pool is reset
+			if (m_Pool)
+				((VulkanDescriptorSetManager*)m_pManager)->FreeDescriptorSet(m_DescriptorSet, m_Pool);
 			m_DescriptorSet = VK_NULL_HANDLE;
 			m_pLayout->DecRefs();
 		}
@@ -63,7 +100,7 @@ namespace Vulkan {
 
 	b8 VulkanDescriptorSet::Write(u32 binding, RHI::Buffer* pBuffer, u64 offset, u64 range, u32 arrayElement)
 	{
-		std::vector<RHI::DescriptorSetBinding> bindings = m_pLayout->GetBindings();
+		const std::vector<RHI::DescriptorSetBinding>& bindings = m_pLayout->GetBindings();
 
 		assert(binding < bindings.size());
 		assert(arrayElement < bindings[binding].count);
@@ -93,12 +130,13 @@ namespace Vulkan {
 		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
 		pDevice->vkUpdateDescriptorSets(1, &writeInfo, 0, nullptr);
 
+		Track({ binding, arrayElement, pBuffer, offset, range });
 		return true;
 	}
 
 	b8 VulkanDescriptorSet::Write(u32 binding, RHI::Texture* pTexture, RHI::Sampler* pSampler, u32 arrayElement)
 	{
-		std::vector<RHI::DescriptorSetBinding> bindings = m_pLayout->GetBindings();
+		const std::vector<RHI::DescriptorSetBinding>& bindings = m_pLayout->GetBindings();
 
 		assert(binding < bindings.size());
 
@@ -110,9 +148,13 @@ namespace Vulkan {
 		writeInfo.dstArrayElement = arrayElement;
 
 		VkDescriptorImageInfo imageInfo = {};
-		imageInfo.imageLayout = Helpers::GetImageLayout(pTexture->GetLayout());
-		imageInfo.imageView = ((VulkanTexture*)pTexture)->GetImageView();
-		imageInfo.sampler = ((VulkanSampler*)pSampler)->GetSampler();
+		if (pTexture)
+		{
+			imageInfo.imageLayout = Helpers::GetImageLayout(pTexture->GetLayout());
+			imageInfo.imageView = ((VulkanTexture*)pTexture)->GetImageView();
+		}
+		if (pSampler)
+			imageInfo.sampler = ((VulkanSampler*)pSampler)->GetSampler();
 
 		writeInfo.descriptorCount = 1;
 		writeInfo.pImageInfo = &imageInfo;
@@ -120,6 +162,10 @@ namespace Vulkan {
 		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
 		pDevice->vkUpdateDescriptorSets(1, &writeInfo, 0, nullptr);
 
+		if (pTexture)
+			Track({ binding, arrayElement, pTexture, pSampler });
+		else
+			Untrack(binding, arrayElement);
 		return true;
 	}
 
@@ -135,7 +181,7 @@ namespace Vulkan {
 		bufferInfos.reserve(buffers.size());
 		imageInfos.reserve(texAndSamplers.size());
 
-		std::vector<RHI::DescriptorSetBinding> bindings = m_pLayout->GetBindings();
+		const std::vector<RHI::DescriptorSetBinding>& bindings = m_pLayout->GetBindings();
 
 		for (const RHI::DescriptorSetBufferInfo& info : buffers)
 		{
@@ -158,6 +204,7 @@ namespace Vulkan {
 					VulkanBuffer* pBuffer = (VulkanBuffer*)info.buffers[i];
 
 					texelBuffers.push_back(pBuffer->GetBufferView());
+					Track({ info.binding, info.arrayElement + u32(i), pBuffer, info.offsets[i], info.ranges[i] });
 				}
 
 				writeInfo.descriptorCount = u32(info.buffers.size());
@@ -184,6 +231,7 @@ namespace Vulkan {
 					bufferInfo.range = range;
 
 					bufferInfos.push_back(bufferInfo);
+					Track({ info.binding, info.arrayElement + u32(i), pBuffer, offset, range });
 				}
 
 				writeInfo.descriptorCount = u32(info.buffers.size());
@@ -212,6 +260,7 @@ namespace Vulkan {
 					imageInfo.sampler = ((VulkanSampler*)pSampler)->GetSampler();
 
 					imageInfos.push_back(imageInfo);
+					Track({ info.binding, info.arrayElement + u32(i), pTexture, pSampler });
 				}
 			}
 			else if (type == RHI::DescriptorSetBindingType::Sampler)
@@ -237,6 +286,7 @@ namespace Vulkan {
 					imageInfo.imageView = ((VulkanTexture*)pTexture)->GetImageView();
 
 					imageInfos.push_back(imageInfo);
+					Track({ info.binding, info.arrayElement + u32(i), pTexture, nullptr });
 				}
 			}
 
@@ -258,4 +308,266 @@ namespace Vulkan {
 
 		return true;
 	}
+
+	b8 VulkanDescriptorSet::WriteAll(const void* pPackedData)
+	{
+		VulkanDescriptorSetLayout* pLayout = (VulkanDescriptorSetLayout*)m_pLayout;
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+
+		TrackPackedData(pPackedData);
+
+		VkDescriptorUpdateTemplate updateTemplate = pLayout->GetUpdateTemplate();
+		if (updateTemplate)
+		{
+			pDevice->vkUpdateDescriptorSetWithTemplate(m_DescriptorSet, updateTemplate, pPackedData);
+			return true;
+		}
+
+		// Without templates, the packed data already contains the vulkan descriptor infos, so only the writes need to be set up
+		const std::vector<RHI::DescriptorSetBinding>& bindings = m_pLayout->GetBindings();
+		std::vector<VkWriteDescriptorSet> writeInfos;
+		writeInfos.reserve(bindings.size());
+
+		for (u32 i = 0; i < bindings.size(); ++i)
+		{
+			// Reserved binding slots have no descriptors to write
+			if (bindings[i].count == 0)
+				continue;
+
+			const u8* pData = (const u8*)pPackedData + pLayout->GetPackedOffset(i);
+
+			VkWriteDescriptorSet writeInfo = {};
+			writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeInfo.dstSet = m_DescriptorSet;
+			writeInfo.descriptorType = Helpers::GetDescriptorType(bindings[i].type);
+			writeInfo.dstBinding = i;
+			writeInfo.dstArrayElement = 0;
+			writeInfo.descriptorCount = bindings[i].count;
+
+			switch (bindings[i].type)
+			{
+			case RHI::DescriptorSetBindingType::Sampler:
+			case RHI::DescriptorSetBindingType::CombinedImageSampler:
+			case RHI::DescriptorSetBindingType::SampledImage:
+			case RHI::DescriptorSetBindingType::StorageImage:
+			case RHI::DescriptorSetBindingType::InputAttachment:
+				writeInfo.pImageInfo = (const VkDescriptorImageInfo*)pData;
+				break;
+			case RHI::DescriptorSetBindingType::UniformTexelBuffer:
+			case RHI::DescriptorSetBindingType::StorageTexelBuffer:
+				writeInfo.pTexelBufferView = (const VkBufferView*)pData;
+				break;
+			default:
+				writeInfo.pBufferInfo = (const VkDescriptorBufferInfo*)pData;
+				break;
+			}
+
+			writeInfos.push_back(writeInfo);
+		}
+
+		pDevice->vkUpdateDescriptorSets(u32(writeInfos.size()), writeInfos.data(), 0, nullptr);
+		return true;
+	}
+
+	void VulkanDescriptorSet::MarkBound()
+	{
+		m_LastBindFrame = m_pContext->GetFrameIndex();
+	}
+
+	b8 VulkanDescriptorSet::IsInUse() const
+	{
+		return m_LastBindFrame != u64(-1) && !m_pContext->IsFrameComplete(m_LastBindFrame);
+	}
+
+	void VulkanDescriptorSet::EnableReferenceTracking()
+	{
+		if (m_TrackReferences)
+			return;
+
+		m_TrackReferences = true;
+		VulkanDescriptorSetManager* pManager = (VulkanDescriptorSetManager*)m_pManager;
+		for (const std::pair<const u64, BufferDescriptor>& pair : m_BufferDescriptors)
+		{
+			pManager->AddReference(pair.second.pBuffer, this);
+		}
+		for (const std::pair<const u64, TextureDescriptor>& pair : m_TextureDescriptors)
+		{
+			pManager->AddReference(pair.second.pTexture, this);
+		}
+		for (u64 handle : m_PackedHandles)
+		{
+			pManager->AddHandleReference(handle, this);
+		}
+	}
+
+	void VulkanDescriptorSet::RewriteDescriptors(RHI::Buffer* pBuffer)
+	{
+		const std::vector<RHI::DescriptorSetBinding>& bindings = m_pLayout->GetBindings();
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+
+		for (const std::pair<const u64, BufferDescriptor>& pair : m_BufferDescriptors)
+		{
+			const BufferDescriptor& descriptor = pair.second;
+			if (descriptor.pBuffer != pBuffer)
+				continue;
+
+			VkWriteDescriptorSet writeInfo = {};
+			writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeInfo.dstSet = m_DescriptorSet;
+			writeInfo.descriptorType = Helpers::GetDescriptorType(bindings[descriptor.binding].type);
+			writeInfo.dstBinding = descriptor.binding;
+			writeInfo.dstArrayElement = descriptor.arrayElement;
+			writeInfo.descriptorCount = 1;
+
+			VkBufferView view = ((VulkanBuffer*)pBuffer)->GetBufferView();
+			VkDescriptorBufferInfo bufferInfo = {};
+			RHI::DescriptorSetBindingType type = bindings[descriptor.binding].type;
+			if (type == RHI::DescriptorSetBindingType::StorageTexelBuffer || type == RHI::DescriptorSetBindingType::UniformTexelBuffer)
+			{
+				writeInfo.pTexelBufferView = &view;
+			}
+			else
+			{
+				bufferInfo.buffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
+				bufferInfo.offset = descriptor.offset;
+				bufferInfo.range = descriptor.range;
+				writeInfo.pBufferInfo = &bufferInfo;
+			}
+
+			pDevice->vkUpdateDescriptorSets(1, &writeInfo, 0, nullptr);
+		}
+	}
+
+	void VulkanDescriptorSet::RewriteDescriptors(RHI::Texture* pTexture)
+	{
+		const std::vector<RHI::DescriptorSetBinding>& bindings = m_pLayout->GetBindings();
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+
+		for (const std::pair<const u64, TextureDescriptor>& pair : m_TextureDescriptors)
+		{
+			const TextureDescriptor& descriptor = pair.second;
+			if (descriptor.pTexture != pTexture)
+				continue;
+
+			VkWriteDescriptorSet writeInfo = {};
+			writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeInfo.dstSet = m_DescriptorSet;
+			writeInfo.descriptorType = Helpers::GetDescriptorType(bindings[descriptor.binding].type);
+			writeInfo.dstBinding = descriptor.binding;
+			writeInfo.dstArrayElement = descriptor.arrayElement;
+			writeInfo.descriptorCount = 1;
+
+			VkDescriptorImageInfo imageInfo = {};
+			imageInfo.imageLayout = Helpers::GetImageLayout(pTexture->GetLayout());
+			imageInfo.imageView = ((VulkanTexture*)pTexture)->GetImageView();
+			if (descriptor.pSampler)
+				imageInfo.sampler = ((VulkanSampler*)descriptor.pSampler)->GetSampler();
+			writeInfo.pImageInfo = &imageInfo;
+
+			pDevice->vkUpdateDescriptorSets(1, &writeInfo, 0, nullptr);
+		}
+	}
+
+	void VulkanDescriptorSet::Untrack(u32 binding, u32 arrayElement)
+	{
+		u64 key = GetDescriptorKey(binding, arrayElement);
+		VulkanDescriptorSetManager* pManager = (VulkanDescriptorSetManager*)m_pManager;
+
+		auto bufferIt = m_BufferDescriptors.find(key);
+		if (bufferIt != m_BufferDescriptors.end())
+		{
+			if (m_TrackReferences)
+				pManager->RemoveReference(bufferIt->second.pBuffer, this);
+			m_BufferDescriptors.erase(bufferIt);
+		}
+		auto textureIt = m_TextureDescriptors.find(key);
+		if (textureIt != m_TextureDescriptors.end())
+		{
+			if (m_TrackReferences)
+				pManager->RemoveReference(textureIt->second.pTexture, this);
+			m_TextureDescriptors.erase(textureIt);
+		}
+	}
+
+	void VulkanDescriptorSet::UntrackAll()
+	{
+		if (m_TrackReferences)
+		{
+			VulkanDescriptorSetManager* pManager = (VulkanDescriptorSetManager*)m_pManager;
+			for (const std::pair<const u64, BufferDescriptor>& pair : m_BufferDescriptors)
+			{
+				pManager->RemoveReference(pair.second.pBuffer, this);
+			}
+			for (const std::pair<const u64, TextureDescriptor>& pair : m_TextureDescriptors)
+			{
+				pManager->RemoveReference(pair.second.pTexture, this);
+			}
+			for (u64 handle : m_PackedHandles)
+			{
+				pManager->RemoveHandleReference(handle, this);
+			}
+		}
+		m_BufferDescriptors.clear();
+		m_TextureDescriptors.clear();
+		m_PackedHandles.clear();
+	}
+
+	void VulkanDescriptorSet::Track(const BufferDescriptor& descriptor)
+	{
+		Untrack(descriptor.binding, descriptor.arrayElement);
+		m_BufferDescriptors.insert({ GetDescriptorKey(descriptor.binding, descriptor.arrayElement), descriptor });
+		if (m_TrackReferences)
+			((VulkanDescriptorSetManager*)m_pManager)->AddReference(descriptor.pBuffer, this);
+	}
+
+	void VulkanDescriptorSet::Track(const TextureDescriptor& descriptor)
+	{
+		Untrack(descriptor.binding, descriptor.arrayElement);
+		m_TextureDescriptors.insert({ GetDescriptorKey(descriptor.binding, descriptor.arrayElement), descriptor });
+		if (m_TrackReferences)
+			((VulkanDescriptorSetManager*)m_pManager)->AddReference(descriptor.pTexture, this);
+	}
+
+	void VulkanDescriptorSet::TrackPackedData(const void* pPackedData)
+	{
+		// WriteAll overwrites every binding
+		UntrackAll();
+
+		VulkanDescriptorSetLayout* pLayout = (VulkanDescriptorSetLayout*)m_pLayout;
+		const std::vector<RHI::DescriptorSetBinding>& bindings = m_pLayout->GetBindings();
+		for (u32 i = 0; i < bindings.size(); ++i)
+		{
+			const u8* pData = (const u8*)pPackedData + pLayout->GetPackedOffset(i);
+			for (u32 j = 0; j < bindings[i].count; ++j)
+			{
+				switch (bindings[i].type)
+				{
+				case RHI::DescriptorSetBindingType::Sampler:
+					break;
+				case RHI::DescriptorSetBindingType::CombinedImageSampler:
+				case RHI::DescriptorSetBindingType::SampledImage:
+				case RHI::DescriptorSetBindingType::StorageImage:
+				case RHI::DescriptorSetBindingType::InputAttachment:
+					m_PackedHandles.push_back((u64)((const VkDescriptorImageInfo*)pData)[j].imageView);
+					break;
+				case RHI::DescriptorSetBindingType::UniformTexelBuffer:
+				case RHI::DescriptorSetBindingType::StorageTexelBuffer:
+					m_PackedHandles.push_back((u64)((const VkBufferView*)pData)[j]);
+					break;
+				default:
+					m_PackedHandles.push_back((u64)((const VkDescriptorBufferInfo*)pData)[j].buffer);
+					break;
+				}
+			}
+		}
+
+		if (m_TrackReferences)
+		{
+			VulkanDescriptorSetManager* pManager = (VulkanDescriptorSetManager*)m_pManager;
+			for (u64 handle : m_PackedHandles)
+			{
+				pManager->AddHandleReference(handle, this);
+			}
+		}
+	}
 }
@@ -1,4 +1,6 @@
 #pragma once
+#include <vector>
+#include <unordered_map>
 #include <vulkan/vulkan.h>
 #include "../RHI/DescriptorSet.h"
 
@@ -18,6 +20,24 @@ namespace Vulkan {
 		 * @return				True if the descriptor set was created successfully, false otherwise
 		 */
 		b8 Create(RHI::RHIContext* pContext, RHI::DescriptorSetManager* pManager, RHI::DescriptorSetLayout* pLayout) override final;
+		/**
+		 * Create the descriptor set from a specific pool
+		 * @param[in] pContext	RHI context
+		 * @param[in] pManager	Descriptor set manager
+		 * @param[in] pLayout	Descriptor set layout
+		 * @param[in] pool		Vulkan descriptor pool to allocate from
+		 * @return				True if the descriptor set was created successfully, false otherwise
+		 */
+		b8 Create(RHI::RHIContext* pContext, RHI::DescriptorSetManager* pManager, RHI::DescriptorSetLayout* pLayout, VkDescriptorPool pool);
+		/**
+		 * Initialize the descriptor set from an already allocated vulkan descriptor set
+		 * @param[in] pContext	RHI context
+		 * @param[in] pManager	Descriptor set manager
+		 * @param[in] pLayout	Descriptor set layout
+		 * @param[in] set		Vulkan descriptor set
+		 * @param[in] pool		Vulkan descriptor pool the set is freed to on destruction (VK_NULL_HANDLE when the pool is reset in bulk)
+		 */
+		void Init(RHI::RHIContext* pContext, RHI::DescriptorSetManager* pManager, RHI::DescriptorSetLayout* pLayout, VkDescriptorSet set, VkDescriptorPool pool);
 		/**
 		 * Destroy the descriptor set
 		 * @return	True if the descriptor set was destroyed successfully, false otherwise
@@ -46,6 +66,12 @@ namespace Vulkan {
 		 * @param[in] texAndSamplers		Texture and sampler write info
 		 */
 		b8 Write(const std::vector<RHI::DescriptorSetBufferInfo>& buffers, const std::vector<RHI::DescriptorSetTextureSamplerInfo>& texAndSamplers) override final;
+		/**
+		 * Write all bindings of the descriptor set at once
+		 * @param[in] pPackedData	Packed descriptor data, filled in with DescriptorSetLayout::PackBuffer and DescriptorSetLayout::PackTexture
+		 * @note					Uses a descriptor update template when available, which needs no allocations
+		 */
+		b8 WriteAll(const void* pPackedData) override final;
 
 		/**
 		 * Get the vulkan descriptor set
@@ -53,9 +79,99 @@ namespace Vulkan {
 		 */
 		VkDescriptorSet GetDescriptorSet() { return m_DescriptorSet; }
 
+		/**
+		 * Mark the descriptor set as bound in the current frame
+		 */
+		void MarkBound();
+		/**
+		 * Check if the gpu might still use the descriptor set
+		 * @return	True if the set was bound in one of the last frames in flight, false otherwise
+		 */
+		b8 IsInUse() const;
+
+		/**
+		 * Register the resources and vulkan handles written to the set with the manager, so it can find the set when a resource moves
+		 * @note	Only persistent and bindless sets are registered, transient and cached sets are never rewritten
+		 */
+		void EnableReferenceTracking();
+		/**
+		 * Rewrite the descriptors of a buffer, after the buffer moved to a new vulkan buffer
+		 * @param[in] pBuffer	Buffer
+		 * @note				The set can't be in use by the gpu
+		 */
+		void RewriteDescriptors(RHI::Buffer* pBuffer);
+		/**
+		 * Rewrite the descriptors of a texture, after the texture moved to a new vulkan image
+		 * @param[in] pTexture	Texture
+		 * @note				The set can't be in use by the gpu
+		 */
+		void RewriteDescriptors(RHI::Texture* pTexture);
+
 	private:
+		/**
+		 * Buffer written to the set, kept to rewrite the descriptor when the buffer moves
+		 */
+		struct BufferDescriptor
+		{
+			u32 binding;			/**< Binding */
+			u32 arrayElement;		/**< Array element */
+			RHI::Buffer* pBuffer;	/**< Buffer */
+			u64 offset;				/**< Offset in the buffer */
+			u64 range;				/**< Range of the buffer */
+		};
+
+		/**
+		 * Texture written to the set, kept to rewrite the descriptor when the texture moves
+		 */
+		struct TextureDescriptor
+		{
+			u32 binding;			/**< Binding */
+			u32 arrayElement;		/**< Array element */
+			RHI::Texture* pTexture;	/**< Texture */
+			RHI::Sampler* pSampler;	/**< Sampler, nullptr if the descriptor has no sampler */
+		};
+
+		/**
+		 * Get the key of a descriptor in the tracked descriptors
+		 * @param[in] binding		Binding
+		 * @param[in] arrayElement	Array element
+		 * @return					Descriptor key
+		 */
+		static u64 GetDescriptorKey(u32 binding, u32 arrayElement) { return (u64(binding) << 32) | arrayElement; }
+		/**
+		 * Remove the tracked resource of a descriptor
+		 * @param[in] binding		Binding
+		 * @param[in] arrayElement	Array element
+		 */
+		void Untrack(u32 binding, u32 arrayElement);
+		/**
+		 * Remove all tracked resources and vulkan handles
+		 */
+		void UntrackAll();
+		/**
+		 * Track the buffer written to a descriptor
+		 * @param[in] descriptor	Buffer descriptor
+		 */
+		void Track(const BufferDescriptor& descriptor);
+		/**
+		 * Track the texture written to a descriptor
+		 * @param[in] descriptor	Texture descriptor
+		 */
+		void Track(const TextureDescriptor& descriptor);
+		/**
+		 * Track the vulkan handles in packed descriptor data, replacing all tracked resources
+		 * @param[in] pPackedData	Packed descriptor data
+		 */
+		void TrackPackedData(const void* pPackedData);
+
 		VkDescriptorSet m_DescriptorSet;	/**< Vulkan descriptor set */
-		VkDescriptorPool m_Pool;			/**< Vulkan descriptor pool */
+		VkDescriptorPool m_Pool;			/**< Vulkan descriptor pool (VK_NULL_HANDLE for transient sets) */
+
+		std::unordered_map<u64, BufferDescriptor> m_BufferDescriptors;		/**< Buffers written with Write, by descriptor key */
+		std::unordered_map<u64, TextureDescriptor> m_TextureDescriptors;	/**< Textures written with Write, by descriptor key */
+		std::vector<u64> m_PackedHandles;									/**< Vulkan handles written with WriteAll */
+		u64 m_LastBindFrame;												/**< Last frame the set was bound in, u64(-1) if never bound */
+		b8 m_TrackReferences;												/**< If the tracked resources are registered with the manager */
 	};
 
 }
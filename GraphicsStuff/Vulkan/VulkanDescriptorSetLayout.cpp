@@ -2,11 +2,16 @@
 #include "VulkanHelpers.h"
 #include "VulkanContext.h"
 #include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanTexture.h"
+#include "VulkanSampler.h"
+#include "../RHI/SamplerCache.h"
 
 namespace Vulkan {
 
 	VulkanDescriptorSetLayout::VulkanDescriptorSetLayout()
 		: m_Layout(VK_NULL_HANDLE)
+		, m_UpdateTemplate(VK_NULL_HANDLE)
 	{
 	}
 
@@ -16,17 +21,39 @@ namespace Vulkan {
 
 	b8 VulkanDescriptorSetLayout::Create(RHI::RHIContext* pContext, RHI::DescriptorSetManager* pManager,
 		const std::vector<RHI::DescriptorSetBinding>& bindings)
+	{
+		return Create(pContext, pManager, bindings, false);
+	}
+
+	b8 VulkanDescriptorSetLayout::Create(RHI::RHIContext* pContext, RHI::DescriptorSetManager* pManager,
+		const std::vector<RHI::DescriptorSetBinding>& bindings, b8 updateAfterBind)
 	{
 		m_pContext = pContext;
 		m_pManager = pManager;
 		m_Bindings = bindings;
+		m_UpdateAfterBind = updateAfterBind;
+		m_Hash = HashBindings(bindings, updateAfterBind);
 
 		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
 		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		// flags???
+
+		std::vector<VkDescriptorBindingFlagsEXT> bindingFlags;
+		VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+		if (updateAfterBind)
+		{
+			bindingFlags.resize(bindings.size(), VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT);
+
+			bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+			bindingFlagsInfo.bindingCount = u32(bindingFlags.size());
+			bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+			layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+			layoutInfo.pNext = &bindingFlagsInfo;
+		}
 
 		std::vector<VkDescriptorSetLayoutBinding> vulkanBindings;
 		vulkanBindings.reserve(bindings.size());
+		std::vector<std::vector<VkSampler>> immutableSamplers(bindings.size());
 
 		for (u32 i = 0; i < bindings.size(); ++i)
 		{
@@ -36,7 +63,12 @@ namespace Vulkan {
 			vulkanBinding.descriptorCount = binding.count;
 			vulkanBinding.descriptorType = Helpers::GetDescriptorType(binding.type);
 			vulkanBinding.stageFlags = Helpers::GetShaderStage(binding.shadertype);
-			// TODO: pImmutableSamplers?
+			if (binding.pImmutableSampler)
+			{
+				assert(binding.type == RHI::DescriptorSetBindingType::Sampler || binding.type == RHI::DescriptorSetBindingType::CombinedImageSampler);
+				immutableSamplers[i].resize(binding.count, ((VulkanSampler*)binding.pImmutableSampler)->GetSampler());
+				vulkanBinding.pImmutableSamplers = immutableSamplers[i].data();
+			}
 
 			vulkanBindings.push_back(vulkanBinding);
 		}
@@ -51,6 +83,57 @@ namespace Vulkan {
 			return false;
 		}
 
+		// Immutable samplers need to outlive the layout
+		for (const RHI::DescriptorSetBinding& binding : bindings)
+		{
+			if (binding.pImmutableSampler)
+				binding.pImmutableSampler->IncRefs();
+		}
+
+		// Packed data stores the vulkan descriptor infos of all bindings back to back
+		m_PackedOffsets.resize(bindings.size());
+		m_PackedDataSize = 0;
+		for (u32 i = 0; i < bindings.size(); ++i)
+		{
+			m_PackedOffsets[i] = m_PackedDataSize;
+			m_PackedDataSize += GetPackedStride(i) * bindings[i].count;
+		}
+
+		// Update after bind layouts are only written partially, so they don't get a template
+		if (!updateAfterBind && pDevice->IsDescriptorUpdateTemplateSupported() && bindings.size() > 0)
+		{
+			std::vector<VkDescriptorUpdateTemplateEntry> entries;
+			entries.reserve(bindings.size());
+			for (u32 i = 0; i < bindings.size(); ++i)
+			{
+				if (bindings[i].count == 0)
+					continue;
+
+				VkDescriptorUpdateTemplateEntry entry = {};
+				entry.dstBinding = i;
+				entry.dstArrayElement = 0;
+				entry.descriptorCount = bindings[i].count;
+				entry.descriptorType = Helpers::GetDescriptorType(bindings[i].type);
+				entry.offset = m_PackedOffsets[i];
+				entry.stride = GetPackedStride(i);
+				entries.push_back(entry);
+			}
+
+			VkDescriptorUpdateTemplateCreateInfo templateInfo = {};
+			templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+			templateInfo.descriptorUpdateEntryCount = u32(entries.size());
+			templateInfo.pDescriptorUpdateEntries = entries.data();
+			templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+			templateInfo.descriptorSetLayout = m_Layout;
+
+			vkres = pDevice->vkCreateDescriptorUpdateTemplate(templateInfo, m_UpdateTemplate);
+			if (vkres != VK_SUCCESS)
+			{
+				//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Warning, "Failed to create the vulkan descriptor update template (VkResult: %s), falling back to regular writes!", Helpers::GetResultstd::string(vkres));
+				m_UpdateTemplate = VK_NULL_HANDLE;
+			}
+		}
+
 		return true;
 	}
 
@@ -58,12 +141,83 @@ namespace Vulkan {
 	{
 		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
 
+		if (m_UpdateTemplate)
+		{
+			pDevice->vkDestroyDescriptorUpdateTemplate(m_UpdateTemplate);
+			m_UpdateTemplate = VK_NULL_HANDLE;
+		}
 		if (m_Layout)
 		{
 			pDevice->vkDestroyDescriptorSetLayout(m_Layout);
 			m_Layout = VK_NULL_HANDLE;
+
+			for (const RHI::DescriptorSetBinding& binding : m_Bindings)
+			{
+				if (binding.pImmutableSampler)
+					m_pContext->GetSamplerCache()->ReleaseSampler(binding.pImmutableSampler);
+			}
 		}
 
 		return true;
 	}
+
+	void VulkanDescriptorSetLayout::PackBuffer(void* pPackedData, u32 binding, RHI::Buffer* pBuffer, u64 offset, u64 range, u32 arrayElement)
+	{
+		assert(binding < m_Bindings.size());
+		assert(arrayElement < m_Bindings[binding].count);
+
+		u8* pData = (u8*)pPackedData + m_PackedOffsets[binding] + GetPackedStride(binding) * arrayElement;
+
+		RHI::DescriptorSetBindingType type = m_Bindings[binding].type;
+		if (type == RHI::DescriptorSetBindingType::StorageTexelBuffer || type == RHI::DescriptorSetBindingType::UniformTexelBuffer)
+		{
+			*(VkBufferView*)pData = ((VulkanBuffer*)pBuffer)->GetBufferView();
+			return;
+		}
+
+		assert(offset < pBuffer->GetSize());
+		if (range == u64(-1) || range > pBuffer->GetSize() - offset)
+		{
+			range = pBuffer->GetSize() - offset;
+		}
+
+		VkDescriptorBufferInfo* pBufferInfo = (VkDescriptorBufferInfo*)pData;
+		pBufferInfo->buffer = ((VulkanBuffer*)pBuffer)->GetBuffer();
+		pBufferInfo->offset = offset;
+		pBufferInfo->range = range;
+	}
+
+	void VulkanDescriptorSetLayout::PackTexture(void* pPackedData, u32 binding, RHI::Texture* pTexture, RHI::Sampler* pSampler, u32 arrayElement)
+	{
+		assert(binding < m_Bindings.size());
+		assert(arrayElement < m_Bindings[binding].count);
+
+		VkDescriptorImageInfo* pImageInfo = (VkDescriptorImageInfo*)((u8*)pPackedData + m_PackedOffsets[binding] + GetPackedStride(binding) * arrayElement);
+		*pImageInfo = {};
+		if (pTexture)
+		{
+			pImageInfo->imageLayout = Helpers::GetImageLayout(pTexture->GetLayout());
+			pImageInfo->imageView = ((VulkanTexture*)pTexture)->GetImageView();
+		}
+		if (pSampler)
+			pImageInfo->sampler = ((VulkanSampler*)pSampler)->GetSampler();
+	}
+
+	sizeT VulkanDescriptorSetLayout::GetPackedStride(u32 binding) const
+	{
+		switch (m_Bindings[binding].type)
+		{
+		case RHI::DescriptorSetBindingType::Sampler:
+		case RHI::DescriptorSetBindingType::CombinedImageSampler:
+		case RHI::DescriptorSetBindingType::SampledImage:
+		case RHI::DescriptorSetBindingType::StorageImage:
+		case RHI::DescriptorSetBindingType::InputAttachment:
+			return sizeof(VkDescriptorImageInfo);
+		case RHI::DescriptorSetBindingType::UniformTexelBuffer:
+		case RHI::DescriptorSetBindingType::StorageTexelBuffer:
+			return sizeof(VkBufferView);
+		default:
+			return sizeof(VkDescriptorBufferInfo);
+		}
+	}
 }
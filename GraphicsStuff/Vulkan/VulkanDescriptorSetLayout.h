@@ -18,20 +18,68 @@ namespace Vulkan {
 		 * @return				True if the descriptor set was created successfully, false otherwise
 		 */
 		virtual b8 Create(RHI::RHIContext* pContext, RHI::DescriptorSetManager* pManager, const std::vector<RHI::DescriptorSetBinding>& bindings);
+		/**
+		 * Create the descriptor set
+		 * @param[in] pContext			RHI context
+		 * @param[in] pManager			Descriptor set manager
+		 * @param[in] bindings			Descriptor set bindings
+		 * @param[in] updateAfterBind	Whether the bindings are partially bound and can be updated after being bound (requires VK_EXT_descriptor_indexing)
+		 * @return						True if the descriptor set was created successfully, false otherwise
+		 */
+		b8 Create(RHI::RHIContext* pContext, RHI::DescriptorSetManager* pManager, const std::vector<RHI::DescriptorSetBinding>& bindings, b8 updateAfterBind);
 		/**
 		 * Destroy the descriptor set
 		 * @return	True if the descriptor set was destroyed successfully, false otherwise
 		 */
 		virtual b8 Destroy();
 
+		/**
+		 * Pack a buffer into packed descriptor data
+		 * @param[in] pPackedData	Packed descriptor data (GetPackedDataSize() bytes)
+		 * @param[in] binding		Binding to pack to
+		 * @param[in] pBuffer		Buffer to pack
+		 * @param[in] offset		Offset in buffer
+		 * @param[in] range			Range in buffer
+		 * @param[in] arrayElement	Element of the array to pack the buffer to
+		 */
+		virtual void PackBuffer(void* pPackedData, u32 binding, RHI::Buffer* pBuffer, u64 offset = 0, u64 range = u64(-1), u32 arrayElement = 0);
+		/**
+		 * Pack a texture and a sampler into packed descriptor data
+		 * @param[in] pPackedData	Packed descriptor data (GetPackedDataSize() bytes)
+		 * @param[in] binding		Binding to pack to
+		 * @param[in] pTexture		Texture to pack (may be nullptr for sampler bindings)
+		 * @param[in] pSampler		Sampler to pack (may be nullptr for image bindings)
+		 * @param[in] arrayElement	Element of the array to pack the texture and sampler to
+		 */
+		virtual void PackTexture(void* pPackedData, u32 binding, RHI::Texture* pTexture, RHI::Sampler* pSampler, u32 arrayElement = 0);
+
 		/**
 		 * Get the vulkan descriptor set layout
 		 * @return	Vulkan descriptor set layout
 		 */
 		VkDescriptorSetLayout GetLayout() { return m_Layout; }
+		/**
+		 * Get the vulkan descriptor update template
+		 * @return	Vulkan descriptor update template, VK_NULL_HANDLE if templates are unsupported
+		 */
+		VkDescriptorUpdateTemplate GetUpdateTemplate() { return m_UpdateTemplate; }
+		/**
+		 * Get the offset of a binding in the packed descriptor data
+		 * @param[in] binding	Binding
+		 * @return				Offset of the binding
+		 */
+		sizeT GetPackedOffset(u32 binding) const { return m_PackedOffsets[binding]; }
+		/**
+		 * Get the stride between array elements in the packed descriptor data
+		 * @param[in] binding	Binding
+		 * @return				Stride of the binding
+		 */
+		sizeT GetPackedStride(u32 binding) const;
 
 	private:
 		VkDescriptorSetLayout m_Layout;
+		VkDescriptorUpdateTemplate m_UpdateTemplate;	/**< Template writing all bindings from packed data */
+		std::vector<sizeT> m_PackedOffsets;				/**< Offset of each binding in the packed data */
 	};
 
 }
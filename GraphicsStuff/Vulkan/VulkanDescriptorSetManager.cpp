@@ -1,16 +1,33 @@
 
-#define MAX_DESC_SETS 1024 // Enough for now
+#define INITIAL_POOL_SETS 256
+#define MAX_POOL_SETS 4096
+#define CACHE_MAX_SETS 4096 // Cached sets beyond this amount are evicted LRU
+#define CACHE_MAX_AGE 120 // Cached sets unused for this many frames are evicted
+#include <algorithm>
+#include <cstring>
 #include "VulkanDescriptorSetManager.h"
 #include "VulkanContext.h"
 #include "../RHI/DescriptorSet.h"
 #include "VulkanDevice.h"
 #include "VulkanDescriptorSetLayout.h"
+#include "VulkanPhysicalDevice.h"
+#include "VulkanHelpers.h"
+#include "VulkanBuffer.h"
+#include "VulkanTexture.h"
+#include "VulkanSampler.h"
+#include "VulkanPipelineLibraryCache.h"
+#include "../General/Hash.h"
 
 namespace Vulkan {
 
 
 	VulkanDescriptorSetManager::VulkanDescriptorSetManager()
-		: m_DescriptorPool(VK_NULL_HANDLE)
+		: m_PersistentPools()
+		, m_Frames()
+		, m_FrameIndex(0)
+		, m_DescriptorUsage()
+		, m_SetUsage(0)
+		, m_BindlessPool(VK_NULL_HANDLE)
 	{
 	}
 
@@ -22,49 +39,14 @@ namespace Vulkan {
 	{
 		m_pContext = pContext;
 
-		// for now, create 1 large descriptor pool
-		// TODO: Improve this
-		std::vector<VkDescriptorPoolSize> poolSizes;
-		poolSizes.reserve(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1);
-
-		VkDescriptorPoolSize poolSize;
-		poolSize.descriptorCount = MAX_DESC_SETS;
-		poolSize.type = VK_DESCRIPTOR_TYPE_SAMPLER;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-		poolSizes.push_back(poolSize);
-
-		VkDescriptorPoolCreateInfo createInfo = {};
-		createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-		createInfo.maxSets = MAX_DESC_SETS;
-		createInfo.poolSizeCount = u32(poolSizes.size());
-		createInfo.pPoolSizes = poolSizes.data();
-
-		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
-		VkResult vkres = pDevice->vkCreateDescriptorPool(createInfo, m_DescriptorPool);
-		if (vkres != VK_SUCCESS)
+		// Pools are created on demand, sized from the descriptors that are actually allocated
+		m_PersistentPools.current = 0;
+		m_PersistentPools.nextMaxSets = INITIAL_POOL_SETS;
+		for (FrameData& frame : m_Frames)
 		{
-			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to create the vulkan descriptor pool (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
-			return false;
+			frame.pools.current = 0;
+			frame.pools.nextMaxSets = INITIAL_POOL_SETS;
+			frame.usedSets = 0;
 		}
 
 		return true;
@@ -72,6 +54,19 @@ namespace Vulkan {
 
 	b8 VulkanDescriptorSetManager::Destroy()
 	{
+		while (!m_Cache.empty())
+		{
+			EvictCacheEntry(m_Cache.begin(), false);
+		}
+
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		for (std::pair<const u64, PipelineLayoutEntry>& pair : m_PipelineLayouts)
+		{
+			pDevice->vkDestroyPipelineLayout(pair.second.layout);
+		}
+		m_PipelineLayouts.clear();
+		m_PipelineLayoutHashes.clear();
+
 		for (RHI::DescriptorSet* set : m_DescriptorSets)
 		{
 			set->Destroy();
@@ -79,11 +74,42 @@ namespace Vulkan {
 		}
 		m_DescriptorSets.clear();
 
-		if (m_DescriptorPool)
+		for (FrameData& frame : m_Frames)
 		{
-			VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
-			pDevice->vkDestroyDescriptorPool(m_DescriptorPool);
+			for (u32 i = 0; i < frame.usedSets; ++i)
+			{
+				frame.sets[i]->Destroy();
+			}
+			for (VulkanDescriptorSet* pSet : frame.sets)
+			{
+				delete pSet;
+			}
+			frame.sets.clear();
+			frame.usedSets = 0;
+			DestroyChain(frame.pools);
 		}
+		ReleaseRetiredSets(true);
+
+		ReleaseRetiredBindlessIndices(true);
+		if (m_pBindlessSet)
+		{
+			m_pBindlessSet->Destroy();
+			delete m_pBindlessSet;
+			m_pBindlessSet = nullptr;
+		}
+		if (m_pBindlessLayout)
+		{
+			m_pBindlessLayout->Destroy();
+			delete m_pBindlessLayout;
+			m_pBindlessLayout = nullptr;
+		}
+		if (m_BindlessPool)
+		{
+			pDevice->vkDestroyDescriptorPool(m_BindlessPool);
+			m_BindlessPool = VK_NULL_HANDLE;
+		}
+
+		DestroyChain(m_PersistentPools);
 
 		return true;
 	}
@@ -92,10 +118,12 @@ namespace Vulkan {
 		const std::vector<RHI::DescriptorSetBinding>& bindings)
 	{
 		// Try to reuse layouts, if it already exists
-		for (RHI::DescriptorSetLayout* pLayout : m_Layouts)
+		u64 hash = RHI::DescriptorSetLayout::HashBindings(bindings);
+		auto range = m_LayoutLookup.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
 		{
-			if (pLayout->Matches(bindings))
-				return pLayout;
+			if (it->second->Matches(bindings))
+				return it->second;
 		}
 
 		// Else create a new layout
@@ -110,17 +138,12 @@ namespace Vulkan {
 		}
 
 		m_Layouts.push_back(pLayout);
+		m_LayoutLookup.insert({ hash, pLayout });
 		return pLayout;
 	}
 
 	RHI::DescriptorSet* VulkanDescriptorSetManager::CreateDescriptorSet(RHI::DescriptorSetLayout* pLayout)
 	{
-		if (m_DescriptorSets.size() == MAX_DESC_SETS)
-		{
-			//g_Logger.LogError("Failed to create descriptor set, reach the max amount of allowed sets!");
-			return nullptr;
-		}
-
 		VulkanDescriptorSet* pDescriptorSet = new VulkanDescriptorSet();
 
 		b8 res = pDescriptorSet->Create(m_pContext, this, pLayout);
@@ -131,13 +154,27 @@ namespace Vulkan {
 			return nullptr;
 		}
 
+		// Persistent sets are rewritten when a resource they reference moves
+		pDescriptorSet->EnableReferenceTracking();
 		m_DescriptorSets.push_back(pDescriptorSet);
 		return pDescriptorSet;
 	}
 
 	b8 VulkanDescriptorSetManager::DestroyDescriptorSetLayout(RHI::DescriptorSetLayout* pLayout)
 	{
-		if (pLayout->GetReferenceCount() > 0)
+		// Cached sets keep a reference to their layout, frames in flight might still use them, so they are retired
+		u32 retiredCount = 0;
+		for (CacheIterator it = m_Cache.begin(); it != m_Cache.end();)
+		{
+			CacheIterator cur = it++;
+			if (cur->pLayout == pLayout)
+			{
+				EvictCacheEntry(cur, true);
+				++retiredCount;
+			}
+		}
+
+		if (pLayout->GetReferenceCount() > retiredCount)
 		{
 			//g_Logger.LogError(LogVulkanRHI(), "Can't destroy a descriptor set layout that is still being used!");
 			return false;
@@ -150,6 +187,24 @@ namespace Vulkan {
 			return false;
 		}
 
+		auto range = m_LayoutLookup.equal_range(pLayout->GetHash());
+		for (auto lookupIt = range.first; lookupIt != range.second; ++lookupIt)
+		{
+			if (lookupIt->second == pLayout)
+			{
+				m_LayoutLookup.erase(lookupIt);
+				break;
+			}
+		}
+		m_Layouts.erase(it);
+
+		// The retired sets release their reference when they are freed, the layout is destroyed after them
+		if (retiredCount > 0)
+		{
+			m_RetiredLayouts.push_back({ pLayout, m_pContext->GetFrameIndex() });
+			return true;
+		}
+
 		b8 res = pLayout->Destroy();
 		if (!res)
 		{
@@ -157,8 +212,6 @@ namespace Vulkan {
 		}
 
 		delete pLayout;
-
-		m_Layouts.erase(it);
 		return true;
 	}
 
@@ -182,6 +235,698 @@ namespace Vulkan {
 		m_DescriptorSets.erase(it);
 		return true;
 	}
+
+	RHI::DescriptorSet* VulkanDescriptorSetManager::CreateTransientDescriptorSet(RHI::DescriptorSetLayout* pLayout)
+	{
+		FrameData& frame = m_Frames[m_FrameIndex];
+
+		VkDescriptorSet set;
+		VkDescriptorPool pool;
+		VkResult vkres = AllocateFromChain(frame.pools, false, pLayout, set, pool);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to allocate a transient vulkan descriptor set (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return nullptr;
+		}
+
+		// Reuse the set objects of previous frames, so transient sets don't cause heap allocations in the steady state
+		if (frame.usedSets == frame.sets.size())
+			frame.sets.push_back(new VulkanDescriptorSet());
+
+		VulkanDescriptorSet* pDescriptorSet = frame.sets[frame.usedSets++];
+		pDescriptorSet->Init(m_pContext, this, pLayout, set, VK_NULL_HANDLE);
+		return pDescriptorSet;
+	}
+
+	void VulkanDescriptorSetManager::BeginFrame(u32 frameIndex)
+	{
+		assert(frameIndex < 3);
+		m_FrameIndex = frameIndex;
+
+		FrameData& frame = m_Frames[frameIndex];
+		for (u32 i = 0; i < frame.usedSets; ++i)
+		{
+			frame.sets[i]->Destroy();
+		}
+		frame.usedSets = 0;
+		ReleaseRetiredSets(false);
+
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		for (VkDescriptorPool pool : frame.pools.pools)
+		{
+			pDevice->vkResetDescriptorPool(pool);
+		}
+		frame.pools.current = 0;
+
+		ReleaseRetiredBindlessIndices(false);
+
+		// Evict cached sets that stayed unused, sets used by frames in flight are never evicted
+		u64 currentFrame = m_pContext->GetFrameIndex();
+		while (!m_Cache.empty())
+		{
+			u64 lastUsedFrame = m_Cache.back().lastUsedFrame;
+			if (!m_pContext->IsFrameComplete(lastUsedFrame) || (currentFrame - lastUsedFrame < CACHE_MAX_AGE && m_Cache.size() <= CACHE_MAX_SETS))
+				break;
+			EvictCacheEntry(std::prev(m_Cache.end()), false);
+		}
+	}
+
+	RHI::DescriptorSet* VulkanDescriptorSetManager::GetCachedDescriptorSet(RHI::DescriptorSetLayout* pLayout, const void* pPackedData)
+	{
+		sizeT size = pLayout->GetPackedDataSize();
+		u64 hash = Hash::Fnv1a(pPackedData, size, Hash::Combine(0xCBF2'9CE4'8422'2325, pLayout));
+
+		auto range = m_CacheLookup.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			CacheIterator entry = it->second;
+			if (entry->pLayout == pLayout && memcmp(entry->packedData.data(), pPackedData, size) == 0)
+			{
+				++m_CacheHits;
+				entry->lastUsedFrame = m_pContext->GetFrameIndex();
+				m_Cache.splice(m_Cache.begin(), m_Cache, entry);
+				return entry->pSet;
+			}
+		}
+		++m_CacheMisses;
+
+		VkDescriptorSet set;
+		VkDescriptorPool pool;
+		VkResult vkres = AllocateDescriptorSet(pLayout, set, pool);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to allocate a cached vulkan descriptor set (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return nullptr;
+		}
+
+		VulkanDescriptorSet* pSet = new VulkanDescriptorSet();
+		pSet->Init(m_pContext, this, pLayout, set, pool);
+		pSet->WriteAll(pPackedData);
+
+		m_Cache.push_front({});
+		CacheIterator entry = m_Cache.begin();
+		entry->pLayout = pLayout;
+		entry->hash = hash;
+		entry->packedData.assign((const u8*)pPackedData, (const u8*)pPackedData + size);
+		entry->pSet = pSet;
+		entry->lastUsedFrame = m_pContext->GetFrameIndex();
+
+		// Collect the referenced handles, so the set can be invalidated when one of them is destroyed
+		VulkanDescriptorSetLayout* pVulkanLayout = (VulkanDescriptorSetLayout*)pLayout;
+		const std::vector<RHI::DescriptorSetBinding>& bindings = pLayout->GetBindings();
+		for (u32 i = 0; i < bindings.size(); ++i)
+		{
+			const u8* pData = (const u8*)pPackedData + pVulkanLayout->GetPackedOffset(i);
+			sizeT stride = pVulkanLayout->GetPackedStride(i);
+			for (u32 j = 0; j < bindings[i].count; ++j, pData += stride)
+			{
+				switch (bindings[i].type)
+				{
+				case RHI::DescriptorSetBindingType::Sampler:
+				case RHI::DescriptorSetBindingType::CombinedImageSampler:
+				case RHI::DescriptorSetBindingType::SampledImage:
+				case RHI::DescriptorSetBindingType::StorageImage:
+				case RHI::DescriptorSetBindingType::InputAttachment:
+				{
+					const VkDescriptorImageInfo* pInfo = (const VkDescriptorImageInfo*)pData;
+					if (pInfo->imageView)
+						entry->resources.push_back((u64)pInfo->imageView);
+					if (pInfo->sampler)
+						entry->resources.push_back((u64)pInfo->sampler);
+					break;
+				}
+				case RHI::DescriptorSetBindingType::UniformTexelBuffer:
+				case RHI::DescriptorSetBindingType::StorageTexelBuffer:
+					entry->resources.push_back((u64)*(const VkBufferView*)pData);
+					break;
+				default:
+					entry->resources.push_back((u64)((const VkDescriptorBufferInfo*)pData)->buffer);
+					break;
+				}
+			}
+		}
+
+		m_CacheLookup.insert({ hash, entry });
+		for (u64 handle : entry->resources)
+		{
+			m_CacheResources.insert({ handle, entry });
+		}
+
+		return pSet;
+	}
+
+	void VulkanDescriptorSetManager::InvalidateCachedDescriptorSets(RHI::Buffer* pBuffer)
+	{
+		InvalidateCachedDescriptorSets((u64)((VulkanBuffer*)pBuffer)->GetBuffer());
+		InvalidateCachedDescriptorSets((u64)((VulkanBuffer*)pBuffer)->GetBufferView());
+	}
+
+	void VulkanDescriptorSetManager::InvalidateCachedDescriptorSets(RHI::Texture* pTexture)
+	{
+		InvalidateCachedDescriptorSets((u64)((VulkanTexture*)pTexture)->GetImageView());
+	}
+
+	void VulkanDescriptorSetManager::InvalidateCachedDescriptorSets(RHI::Sampler* pSampler)
+	{
+		InvalidateCachedDescriptorSets((u64)((VulkanSampler*)pSampler)->GetSampler());
+	}
+
+	void VulkanDescriptorSetManager::InvalidateCachedDescriptorSets(u64 handle)
+	{
+		if (handle == 0)
+			return;
+
+		auto it = m_CacheResources.find(handle);
+		while (it != m_CacheResources.end())
+		{
+			EvictCacheEntry(it->second, true);
+			it = m_CacheResources.find(handle);
+		}
+	}
+
+	b8 VulkanDescriptorSetManager::IsHandleLocked(u64 handle)
+	{
+		if (handle == 0)
+			return false;
+
+		if (m_HandleSets.find(handle) != m_HandleSets.end())
+			return true;
+
+		// Cached sets are evicted instead of rewritten, which is only allowed when the gpu is done with them
+		auto range = m_CacheResources.equal_range(handle);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second->pSet->IsInUse())
+				return true;
+		}
+		return false;
+	}
+
+	b8 VulkanDescriptorSetManager::IsReferencedByUsedSet(const void* pResource)
+	{
+		auto range = m_ResourceSets.equal_range(pResource);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second->IsInUse())
+				return true;
+		}
+		return false;
+	}
+
+	std::vector<VulkanDescriptorSet*> VulkanDescriptorSetManager::GetReferencingSets(const void* pResource)
+	{
+		// A set is registered once per descriptor referencing the resource
+		std::vector<VulkanDescriptorSet*> sets;
+		auto range = m_ResourceSets.equal_range(pResource);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (std::find(sets.begin(), sets.end(), it->second) == sets.end())
+				sets.push_back(it->second);
+		}
+		return sets;
+	}
+
+	b8 VulkanDescriptorSetManager::CanRewriteDescriptors(RHI::Buffer* pBuffer)
+	{
+		VulkanBuffer* pVulkanBuffer = (VulkanBuffer*)pBuffer;
+		if (IsHandleLocked((u64)pVulkanBuffer->GetBuffer()) || IsHandleLocked((u64)pVulkanBuffer->GetBufferView()))
+			return false;
+		return !IsReferencedByUsedSet(pBuffer);
+	}
+
+	b8 VulkanDescriptorSetManager::CanRewriteDescriptors(RHI::Texture* pTexture)
+	{
+		if (IsHandleLocked((u64)((VulkanTexture*)pTexture)->GetImageView()))
+			return false;
+		return !IsReferencedByUsedSet(pTexture);
+	}
+
+	void VulkanDescriptorSetManager::RewriteDescriptors(RHI::Buffer* pBuffer, VkBuffer oldBuffer, VkBufferView oldView)
+	{
+		InvalidateCachedDescriptorSets((u64)oldBuffer);
+		InvalidateCachedDescriptorSets((u64)oldView);
+
+		for (VulkanDescriptorSet* pSet : GetReferencingSets(pBuffer))
+		{
+			pSet->RewriteDescriptors(pBuffer);
+		}
+	}
+
+	void VulkanDescriptorSetManager::RewriteDescriptors(RHI::Texture* pTexture, VkImageView oldView)
+	{
+		InvalidateCachedDescriptorSets((u64)oldView);
+
+		for (VulkanDescriptorSet* pSet : GetReferencingSets(pTexture))
+		{
+			pSet->RewriteDescriptors(pTexture);
+		}
+	}
+
+	void VulkanDescriptorSetManager::AddReference(const void* pResource, VulkanDescriptorSet* pSet)
+	{
+		m_ResourceSets.insert({ pResource, pSet });
+	}
+
+	void VulkanDescriptorSetManager::RemoveReference(const void* pResource, VulkanDescriptorSet* pSet)
+	{
+		auto range = m_ResourceSets.equal_range(pResource);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second == pSet)
+			{
+				m_ResourceSets.erase(it);
+				return;
+			}
+		}
+	}
+
+	void VulkanDescriptorSetManager::AddHandleReference(u64 handle, VulkanDescriptorSet* pSet)
+	{
+		if (handle != 0)
+			m_HandleSets.insert({ handle, pSet });
+	}
+
+	void VulkanDescriptorSetManager::RemoveHandleReference(u64 handle, VulkanDescriptorSet* pSet)
+	{
+		auto range = m_HandleSets.equal_range(handle);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second == pSet)
+			{
+				m_HandleSets.erase(it);
+				return;
+			}
+		}
+	}
+
+	void VulkanDescriptorSetManager::EvictCacheEntry(CacheIterator entry, b8 retire)
+	{
+		auto range = m_CacheLookup.equal_range(entry->hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second == entry)
+			{
+				m_CacheLookup.erase(it);
+				break;
+			}
+		}
+
+		for (u64 handle : entry->resources)
+		{
+			auto resRange = m_CacheResources.equal_range(handle);
+			for (auto it = resRange.first; it != resRange.second; ++it)
+			{
+				if (it->second == entry)
+				{
+					m_CacheResources.erase(it);
+					break;
+				}
+			}
+		}
+
+		if (retire)
+		{
+			m_RetiredSets.push_back({ entry->pSet, m_pContext->GetFrameIndex() });
+		}
+		else
+		{
+			entry->pSet->Destroy();
+			delete entry->pSet;
+		}
+		m_Cache.erase(entry);
+	}
+
+	void VulkanDescriptorSetManager::ReleaseRetiredSets(b8 force)
+	{
+		// Sets are retired in frame order, so the completed ones are at the front
+		sizeT count = 0;
+		while (count < m_RetiredSets.size() && (force || m_pContext->IsFrameComplete(m_RetiredSets[count].frame)))
+		{
+			m_RetiredSets[count].pSet->Destroy();
+			delete m_RetiredSets[count].pSet;
+			++count;
+		}
+		m_RetiredSets.erase(m_RetiredSets.begin(), m_RetiredSets.begin() + count);
+
+		// Layouts are retired together with their sets, so those were freed above
+		count = 0;
+		while (count < m_RetiredLayouts.size() && (force || m_pContext->IsFrameComplete(m_RetiredLayouts[count].frame)))
+		{
+			m_RetiredLayouts[count].pLayout->Destroy();
+			delete m_RetiredLayouts[count].pLayout;
+			++count;
+		}
+		m_RetiredLayouts.erase(m_RetiredLayouts.begin(), m_RetiredLayouts.begin() + count);
+	}
+
+	VkResult VulkanDescriptorSetManager::AcquirePipelineLayout(const std::vector<RHI::DescriptorSetLayout*>& setLayouts, u32 pushConstantSize, VkPipelineLayout& layout)
+	{
+		u64 hash = Hash::Combine(0xCBF2'9CE4'8422'2325, pushConstantSize);
+		hash = Hash::Fnv1a(setLayouts.data(), setLayouts.size() * sizeof(RHI::DescriptorSetLayout*), hash);
+
+		auto range = m_PipelineLayouts.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			PipelineLayoutEntry& entry = it->second;
+			if (entry.pushConstantSize == pushConstantSize && entry.setLayouts == setLayouts)
+			{
+				++entry.refCount;
+				layout = entry.layout;
+				return VK_SUCCESS;
+			}
+		}
+
+		VkPipelineLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+		std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+		for (RHI::DescriptorSetLayout* pLayout : setLayouts)
+		{
+			descriptorSetLayouts.push_back(((VulkanDescriptorSetLayout*)pLayout)->GetLayout());
+		}
+
+		layoutInfo.setLayoutCount = u32(descriptorSetLayouts.size());
+		layoutInfo.pSetLayouts = descriptorSetLayouts.data();
+
+		// Push constants are visible to all stages, so they can be pushed without knowing the stages using them
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_ALL;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = pushConstantSize;
+		if (pushConstantSize > 0)
+		{
+			layoutInfo.pushConstantRangeCount = 1;
+			layoutInfo.pPushConstantRanges = &pushConstantRange;
+		}
+
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		VkResult vkres = pDevice->vkCreatePipelineLayout(layoutInfo, layout);
+		if (vkres != VK_SUCCESS)
+			return vkres;
+
+		// The entry is keyed on the set layouts, so they need to outlive it
+		for (RHI::DescriptorSetLayout* pLayout : setLayouts)
+		{
+			pLayout->IncRefs();
+		}
+
+		PipelineLayoutEntry entry;
+		entry.setLayouts = setLayouts;
+		entry.pushConstantSize = pushConstantSize;
+		entry.layout = layout;
+		entry.refCount = 1;
+		m_PipelineLayouts.insert({ hash, entry });
+		m_PipelineLayoutHashes.insert({ layout, hash });
+		return VK_SUCCESS;
+	}
+
+	void VulkanDescriptorSetManager::ReleasePipelineLayout(VkPipelineLayout layout)
+	{
+		auto hashIt = m_PipelineLayoutHashes.find(layout);
+		if (hashIt == m_PipelineLayoutHashes.end())
+			return;
+
+		auto range = m_PipelineLayouts.equal_range(hashIt->second);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			PipelineLayoutEntry& entry = it->second;
+			if (entry.layout != layout)
+				continue;
+
+			if (--entry.refCount == 0)
+			{
+				// Libraries compiled with the layout would match a new layout reusing the handle
+				VulkanPipelineLibraryCache* pLibraryCache = ((VulkanContext*)m_pContext)->GetPipelineLibraryCache();
+				if (pLibraryCache)
+					pLibraryCache->InvalidateLibraries(u64(entry.layout));
+
+				VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+				pDevice->vkDestroyPipelineLayout(entry.layout);
+				for (RHI::DescriptorSetLayout* pLayout : entry.setLayouts)
+				{
+					pLayout->DecRefs();
+				}
+				m_PipelineLayouts.erase(it);
+				m_PipelineLayoutHashes.erase(hashIt);
+			}
+			return;
+		}
+	}
+
+	VkResult VulkanDescriptorSetManager::AllocateDescriptorSet(RHI::DescriptorSetLayout* pLayout, VkDescriptorSet& set, VkDescriptorPool& pool)
+	{
+		return AllocateFromChain(m_PersistentPools, true, pLayout, set, pool);
+	}
+
+	void VulkanDescriptorSetManager::FreeDescriptorSet(VkDescriptorSet set, VkDescriptorPool pool)
+	{
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		pDevice->vkFreeDescriptorSet(pool, set);
+
+		// The pool has space again, so allocate from it before moving on to later pools
+		for (u32 i = 0; i < m_PersistentPools.current && i < m_PersistentPools.pools.size(); ++i)
+		{
+			if (m_PersistentPools.pools[i] == pool)
+			{
+				m_PersistentPools.current = i;
+				break;
+			}
+		}
+	}
+
+	VkResult VulkanDescriptorSetManager::AllocateFromChain(PoolChain& chain, b8 freeable, RHI::DescriptorSetLayout* pLayout, VkDescriptorSet& set, VkDescriptorPool& pool)
+	{
+		// Track usage, so new pools match the descriptor mix that is actually used
+		for (const RHI::DescriptorSetBinding& binding : pLayout->GetBindings())
+		{
+			m_DescriptorUsage[u8(binding.type)] += binding.count;
+		}
+		++m_SetUsage;
+
+		VkDescriptorSetLayout layout = ((VulkanDescriptorSetLayout*)pLayout)->GetLayout();
+
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		VkResult vkres;
+		for (; chain.current < chain.pools.size(); ++chain.current)
+		{
+			allocInfo.descriptorPool = chain.pools[chain.current];
+			vkres = pDevice->vkAllocateDescriptorSet(allocInfo, set);
+			if (vkres == VK_SUCCESS)
+			{
+				pool = allocInfo.descriptorPool;
+				return VK_SUCCESS;
+			}
+			// Full or fragmented pools are skipped (drivers without maintenance1 may report other errors)
+		}
+
+		// All pools are full, so grow the chain
+		VkDescriptorPool newPool;
+		vkres = CreatePool(chain.nextMaxSets, freeable, pLayout, newPool);
+		if (vkres != VK_SUCCESS)
+			return vkres;
+		chain.pools.push_back(newPool);
+		chain.current = u32(chain.pools.size() - 1);
+		chain.nextMaxSets = std::min(chain.nextMaxSets * 2, u32(MAX_POOL_SETS));
+
+		allocInfo.descriptorPool = newPool;
+		vkres = pDevice->vkAllocateDescriptorSet(allocInfo, set);
+		if (vkres == VK_SUCCESS)
+			pool = newPool;
+		return vkres;
+	}
+
+	VkResult VulkanDescriptorSetManager::CreatePool(u32 maxSets, b8 freeable, RHI::DescriptorSetLayout* pLayout, VkDescriptorPool& pool)
+	{
+		// Layouts with more descriptors than the average, e.g. large arrays, would never fit in a pool sized from the averages
+		u64 layoutCounts[u8(RHI::DescriptorSetBindingType::Count)] = {};
+		for (const RHI::DescriptorSetBinding& binding : pLayout->GetBindings())
+		{
+			layoutCounts[u8(binding.type)] += binding.count;
+		}
+
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		poolSizes.reserve(u8(RHI::DescriptorSetBindingType::Count));
+
+		for (u8 i = u8(RHI::DescriptorSetBindingType::None) + 1; i < u8(RHI::DescriptorSetBindingType::Count); ++i)
+		{
+			// Size for the average descriptors per set seen so far, with some headroom,
+			// unused types get a small amount, so they don't immediately need a new pool
+			u64 count = maxSets / 8;
+			if (m_SetUsage > 0)
+				count = std::max(count, (m_DescriptorUsage[i] * maxSets * 5) / (m_SetUsage * 4));
+			else
+				count = maxSets;
+			count = std::max(count, layoutCounts[i]);
+
+			VkDescriptorPoolSize poolSize;
+			poolSize.type = Helpers::GetDescriptorType(RHI::DescriptorSetBindingType(i));
+			poolSize.descriptorCount = u32(std::max(count, u64(1)));
+			poolSizes.push_back(poolSize);
+		}
+
+		VkDescriptorPoolCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		createInfo.flags = freeable ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+		createInfo.maxSets = maxSets;
+		createInfo.poolSizeCount = u32(poolSizes.size());
+		createInfo.pPoolSizes = poolSizes.data();
+
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		VkResult vkres = pDevice->vkCreateDescriptorPool(createInfo, pool);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to create the vulkan descriptor pool (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+		}
+		return vkres;
+	}
+
+	void VulkanDescriptorSetManager::DestroyChain(PoolChain& chain)
+	{
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		for (VkDescriptorPool pool : chain.pools)
+		{
+			pDevice->vkDestroyDescriptorPool(pool);
+		}
+		chain.pools.clear();
+		chain.current = 0;
+	}
+
+	b8 VulkanDescriptorSetManager::IsBindlessSupported()
+	{
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		return pDevice->IsExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+	}
+
+	b8 VulkanDescriptorSetManager::EnableBindless(const RHI::BindlessDesc& desc)
+	{
+		if (IsBindlessEnabled())
+			return true;
+		if (!IsBindlessSupported())
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "Bindless descriptors are not supported (VK_EXT_descriptor_indexing is unavailable)!");
+			return false;
+		}
+
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& properties = pDevice->GetPhysicalDevice()->GetDescriptorIndexingProperties();
+
+		m_BindlessDesc = desc;
+		m_BindlessDesc.maxTextures = std::min(desc.maxTextures, properties.maxDescriptorSetUpdateAfterBindSampledImages);
+		m_BindlessDesc.maxSamplers = std::min(desc.maxSamplers, properties.maxDescriptorSetUpdateAfterBindSamplers);
+		m_BindlessDesc.maxBuffers = std::min(desc.maxBuffers, properties.maxDescriptorSetUpdateAfterBindStorageBuffers);
+
+		VkDescriptorPoolSize poolSizes[3];
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		poolSizes[0].descriptorCount = m_BindlessDesc.maxTextures;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+		poolSizes[1].descriptorCount = m_BindlessDesc.maxSamplers;
+		poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes[2].descriptorCount = m_BindlessDesc.maxBuffers;
+
+		VkDescriptorPoolCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+		createInfo.maxSets = 1;
+		createInfo.poolSizeCount = 3;
+		createInfo.pPoolSizes = poolSizes;
+
+		VkResult vkres = pDevice->vkCreateDescriptorPool(createInfo, m_BindlessPool);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to create the vulkan bindless descriptor pool (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return false;
+		}
+
+		RHI::ShaderType stages = RHI::ShaderType::Vertex | RHI::ShaderType::Fragment | RHI::ShaderType::Compute;
+		std::vector<RHI::DescriptorSetBinding> bindings;
+		bindings.push_back({ RHI::DescriptorSetBindingType::SampledImage, stages, m_BindlessDesc.maxTextures });
+		bindings.push_back({ RHI::DescriptorSetBindingType::Sampler, stages, m_BindlessDesc.maxSamplers });
+		bindings.push_back({ RHI::DescriptorSetBindingType::Storage, stages, m_BindlessDesc.maxBuffers });
+
+		VulkanDescriptorSetLayout* pLayout = new VulkanDescriptorSetLayout();
+		b8 res = pLayout->Create(m_pContext, this, bindings, true);
+		if (!res)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "Failed to create the bindless descriptor set layout!");
+			delete pLayout;
+			pDevice->vkDestroyDescriptorPool(m_BindlessPool);
+			m_BindlessPool = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VulkanDescriptorSet* pSet = new VulkanDescriptorSet();
+		res = pSet->Create(m_pContext, this, pLayout, m_BindlessPool);
+		if (!res)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "Failed to create the bindless descriptor set!");
+			delete pSet;
+			pLayout->Destroy();
+			delete pLayout;
+			pDevice->vkDestroyDescriptorPool(m_BindlessPool);
+			m_BindlessPool = VK_NULL_HANDLE;
+			return false;
+		}
+
+		pSet->EnableReferenceTracking();
+		m_pBindlessLayout = pLayout;
+		m_pBindlessSet = pSet;
+		return true;
+	}
+
+	RHI::BindlessIndex VulkanDescriptorSetManager::RegisterBindlessTexture(RHI::Texture* pTexture)
+	{
+		assert(IsBindlessEnabled());
+		RHI::BindlessIndex index = AllocateBindlessIndex(m_FreeBindlessTextures, m_BindlessTextureCount, m_BindlessDesc.maxTextures);
+		if (index != RHI::InvalidBindlessIndex)
+			m_pBindlessSet->Write(0, pTexture, nullptr, index);
+		return index;
+	}
+
+	RHI::BindlessIndex VulkanDescriptorSetManager::RegisterBindlessSampler(RHI::Sampler* pSampler)
+	{
+		assert(IsBindlessEnabled());
+
+		// Samplers are shared through the sampler cache, so identical samplers share an index
+		auto it = m_BindlessSamplerIndices.find(pSampler);
+		if (it != m_BindlessSamplerIndices.end())
+		{
+			++m_BindlessSamplerRefs[it->second];
+			return it->second;
+		}
+
+		RHI::BindlessIndex index = AllocateBindlessIndex(m_FreeBindlessSamplers, m_BindlessSamplerCount, m_BindlessDesc.maxSamplers);
+		if (index == RHI::InvalidBindlessIndex)
+			return index;
+
+		m_pBindlessSet->Write(1, nullptr, pSampler, index);
+		if (index >= m_BindlessSamplers.size())
+		{
+			m_BindlessSamplers.resize(index + 1, nullptr);
+			m_BindlessSamplerRefs.resize(index + 1, 0);
+		}
+		m_BindlessSamplers[index] = pSampler;
+		m_BindlessSamplerRefs[index] = 1;
+		m_BindlessSamplerIndices[pSampler] = index;
+		pSampler->IncRefs();
+		return index;
+	}
+
+	RHI::BindlessIndex VulkanDescriptorSetManager::RegisterBindlessBuffer(RHI::Buffer* pBuffer)
+	{
+		assert(IsBindlessEnabled());
+		RHI::BindlessIndex index = AllocateBindlessIndex(m_FreeBindlessBuffers, m_BindlessBufferCount, m_BindlessDesc.maxBuffers);
+		if (index != RHI::InvalidBindlessIndex)
+			m_pBindlessSet->Write(2, pBuffer, 0, u64(-1), index);
+		return index;
+	}
 }
 
-#undef MAX_DESC_SETS
\ No newline at end of file
+#undef INITIAL_POOL_SETS
+#undef MAX_POOL_SETS
+#undef CACHE_MAX_SETS
+#undef CACHE_MAX_AGE
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 #include <vector>
+#include <list>
+#include <unordered_map>
 #include <vulkan/vulkan.h>
 #include "../RHI/DescriptorSetManager.h"
+#include "VulkanDescriptorSet.h"
 
 namespace Vulkan {
 	
@@ -49,13 +52,295 @@ namespace Vulkan {
 		b8 DestroyDescriptorSet(RHI::DescriptorSet* pDescriptorSet) override final;
 
 		/**
-		 * Get the vulkan descriptor pool
-		 * @return	Vulkan descriptor pool
+		 * Create a transient descriptor set, only valid during the current frame
+		 * @param[in] pLayout	Descriptor set layout
+		 * @return				Pointer to a descriptor set, nullptr if the creation failed
 		 */
-		VkDescriptorPool GetDescriptorPool() { return m_DescriptorPool; }
+		RHI::DescriptorSet* CreateTransientDescriptorSet(RHI::DescriptorSetLayout* pLayout) override final;
+		/**
+		 * Begin a new frame, releasing all transient descriptor sets previously created for the frame index
+		 * @param[in] frameIndex	Index of the frame in flight (0-2)
+		 */
+		void BeginFrame(u32 frameIndex) override final;
+
+		/**
+		 * Get a descriptor set with the given contents, reusing an identical set when one is cached
+		 * @param[in] pLayout		Descriptor set layout
+		 * @param[in] pPackedData	Packed descriptor data, filled in with DescriptorSetLayout::PackBuffer and DescriptorSetLayout::PackTexture
+		 * @return					Pointer to a descriptor set, nullptr if the creation failed
+		 */
+		RHI::DescriptorSet* GetCachedDescriptorSet(RHI::DescriptorSetLayout* pLayout, const void* pPackedData) override final;
+		/**
+		 * Remove all cached descriptor sets referencing a buffer
+		 * @param[in] pBuffer	Buffer that is about to be destroyed
+		 */
+		void InvalidateCachedDescriptorSets(RHI::Buffer* pBuffer) override final;
+		/**
+		 * Remove all cached descriptor sets referencing a texture
+		 * @param[in] pTexture	Texture that is about to be destroyed
+		 */
+		void InvalidateCachedDescriptorSets(RHI::Texture* pTexture) override final;
+		/**
+		 * Remove all cached descriptor sets referencing a sampler
+		 * @param[in] pSampler	Sampler that is about to be destroyed
+		 */
+		void InvalidateCachedDescriptorSets(RHI::Sampler* pSampler) override final;
+
+		/**
+		 * Check if bindless descriptors are supported
+		 * @return	True if bindless descriptors are supported, false otherwise
+		 */
+		b8 IsBindlessSupported() override final;
+		/**
+		 * Enable bindless descriptors, creating the bindless descriptor set
+		 * @param[in] desc	Bindless description
+		 * @return			True if bindless descriptors were enabled successfully, false otherwise
+		 */
+		b8 EnableBindless(const RHI::BindlessDesc& desc) override final;
+
+		/**
+		 * Register a texture in the bindless set
+		 * @param[in] pTexture	Texture to register
+		 * @return				Index of the texture in the bindless texture array, InvalidBindlessIndex if the array is full
+		 */
+		RHI::BindlessIndex RegisterBindlessTexture(RHI::Texture* pTexture) override final;
+		/**
+		 * Register a sampler in the bindless set
+		 * @param[in] pSampler	Sampler to register
+		 * @return				Index of the sampler in the bindless sampler array, InvalidBindlessIndex if the array is full
+		 */
+		RHI::BindlessIndex RegisterBindlessSampler(RHI::Sampler* pSampler) override final;
+		/**
+		 * Register a storage buffer in the bindless set
+		 * @param[in] pBuffer	Buffer to register
+		 * @return				Index of the buffer in the bindless buffer array, InvalidBindlessIndex if the array is full
+		 */
+		RHI::BindlessIndex RegisterBindlessBuffer(RHI::Buffer* pBuffer) override final;
+
+		/**
+		 * Allocate a vulkan descriptor set from the persistent pool chain, growing the chain when all pools are full
+		 * @param[in] pLayout	Descriptor set layout
+		 * @param[out] set		Vulkan descriptor set
+		 * @param[out] pool		Vulkan descriptor pool the set was allocated from
+		 * @return				Vulkan result
+		 */
+		VkResult AllocateDescriptorSet(RHI::DescriptorSetLayout* pLayout, VkDescriptorSet& set, VkDescriptorPool& pool);
+		/**
+		 * Free a vulkan descriptor set
+		 * @param[in] set	Vulkan descriptor set
+		 * @param[in] pool	Vulkan descriptor pool the set was allocated from
+		 */
+		void FreeDescriptorSet(VkDescriptorSet set, VkDescriptorPool pool);
+
+		/**
+		 * Get a pipeline layout, reusing an existing layout with the same descriptor set layouts and push constants
+		 * @param[in] setLayouts		Descriptor set layouts
+		 * @param[in] pushConstantSize	Size of the push constant range
+		 * @param[out] layout			Vulkan pipeline layout
+		 * @return						Vulkan result
+		 */
+		VkResult AcquirePipelineLayout(const std::vector<RHI::DescriptorSetLayout*>& setLayouts, u32 pushConstantSize, VkPipelineLayout& layout);
+		/**
+		 * Release a pipeline layout, the layout is destroyed when it's no longer used
+		 * @param[in] layout	Vulkan pipeline layout
+		 */
+		void ReleasePipelineLayout(VkPipelineLayout layout);
+
+		/**
+		 * Check if the descriptors referencing a buffer can be rewritten, which isn't possible while the gpu might use a set referencing it
+		 * @param[in] pBuffer	Buffer
+		 * @return				True if the descriptors can be rewritten, false otherwise
+		 */
+		b8 CanRewriteDescriptors(RHI::Buffer* pBuffer);
+		/**
+		 * Check if the descriptors referencing a texture can be rewritten, which isn't possible while the gpu might use a set referencing it
+		 * @param[in] pTexture	Texture
+		 * @return				True if the descriptors can be rewritten, false otherwise
+		 */
+		b8 CanRewriteDescriptors(RHI::Texture* pTexture);
+		/**
+		 * Rewrite the descriptors referencing a buffer that moved to a new vulkan buffer, cached sets referencing the old handles are evicted
+		 * @param[in] pBuffer	Buffer
+		 * @param[in] oldBuffer	Previous vulkan buffer
+		 * @param[in] oldView	Previous vulkan buffer view
+		 */
+		void RewriteDescriptors(RHI::Buffer* pBuffer, VkBuffer oldBuffer, VkBufferView oldView);
+		/**
+		 * Rewrite the descriptors referencing a texture that moved to a new vulkan image, cached sets referencing the old view are evicted
+		 * @param[in] pTexture	Texture
+		 * @param[in] oldView	Previous vulkan image view
+		 */
+		void RewriteDescriptors(RHI::Texture* pTexture, VkImageView oldView);
+
+		/**
+		 * Register a buffer or texture written to a descriptor of a set, once per descriptor
+		 * @param[in] pResource	Buffer or texture
+		 * @param[in] pSet		Descriptor set
+		 */
+		void AddReference(const void* pResource, VulkanDescriptorSet* pSet);
+		/**
+		 * Unregister a buffer or texture written to a descriptor of a set
+		 * @param[in] pResource	Buffer or texture
+		 * @param[in] pSet		Descriptor set
+		 */
+		void RemoveReference(const void* pResource, VulkanDescriptorSet* pSet);
+		/**
+		 * Register a vulkan handle written to a set with WriteAll, once per descriptor
+		 * @param[in] handle	Vulkan buffer, buffer view or image view handle
+		 * @param[in] pSet		Descriptor set
+		 */
+		void AddHandleReference(u64 handle, VulkanDescriptorSet* pSet);
+		/**
+		 * Unregister a vulkan handle written to a set with WriteAll
+		 * @param[in] handle	Vulkan buffer, buffer view or image view handle
+		 * @param[in] pSet		Descriptor set
+		 */
+		void RemoveHandleReference(u64 handle, VulkanDescriptorSet* pSet);
 
 	private:
-		VkDescriptorPool m_DescriptorPool;
+		/**
+		 * Chain of descriptor pools, new pools are added when all pools are full
+		 */
+		struct PoolChain
+		{
+			std::vector<VkDescriptorPool> pools;	/**< Descriptor pools */
+			u32 current;							/**< Index of the first pool that may have space left */
+			u32 nextMaxSets;						/**< Max sets of the next pool in the chain */
+		};
+
+		/**
+		 * Transient descriptor sets of a frame in flight
+		 */
+		struct FrameData
+		{
+			PoolChain pools;							/**< Transient pools, reset in bulk */
+			std::vector<VulkanDescriptorSet*> sets;		/**< Transient descriptor set objects, reused every frame */
+			u32 usedSets;								/**< Amount of sets used this frame */
+		};
+
+		/**
+		 * Invalidated cached set, which frames in flight might still use
+		 */
+		struct RetiredSet
+		{
+			VulkanDescriptorSet* pSet;	/**< Descriptor set */
+			u64 frame;					/**< Frame in which the set was invalidated */
+		};
+
+		/**
+		 * Destroyed descriptor set layout, which retired sets still use
+		 */
+		struct RetiredLayout
+		{
+			RHI::DescriptorSetLayout* pLayout;	/**< Descriptor set layout */
+			u64 frame;							/**< Frame in which the layout was destroyed */
+		};
+
+		/**
+		 * Cached descriptor set
+		 */
+		struct CacheEntry
+		{
+			RHI::DescriptorSetLayout* pLayout;	/**< Descriptor set layout */
+			u64 hash;							/**< Hash of the layout and packed data */
+			std::vector<u8> packedData;			/**< Packed descriptor data, for exact matching */
+			std::vector<u64> resources;			/**< Vulkan handles referenced by the set */
+			VulkanDescriptorSet* pSet;			/**< Descriptor set */
+			u64 lastUsedFrame;					/**< Last frame the set was requested in */
+		};
+		typedef std::list<CacheEntry>::iterator CacheIterator;
+
+		/**
+		 * Shared pipeline layout
+		 */
+		struct PipelineLayoutEntry
+		{
+			std::vector<RHI::DescriptorSetLayout*> setLayouts;	/**< Descriptor set layouts */
+			u32 pushConstantSize;								/**< Size of the push constant range */
+			VkPipelineLayout layout;							/**< Vulkan pipeline layout */
+			u32 refCount;										/**< Amount of pipelines using the layout */
+		};
+
+		/**
+		 * Remove an entry from the descriptor set cache and free its set
+		 * @param[in] it		Cache entry
+		 * @param[in] retire	If frames in flight might still use the set, it is then freed once the current frame completed
+		 */
+		void EvictCacheEntry(CacheIterator it, b8 retire);
+		/**
+		 * Free the retired cached sets and layouts of completed frames
+		 * @param[in] force	If all retired sets and layouts should be freed, only allowed when the device is idle
+		 */
+		void ReleaseRetiredSets(b8 force);
+		/**
+		 * Remove all cached descriptor sets referencing a vulkan handle
+		 * @param[in] handle	Vulkan handle
+		 */
+		void InvalidateCachedDescriptorSets(u64 handle);
+		/**
+		 * Check if a vulkan handle is referenced by packed descriptor data that can't be rewritten: a set written with WriteAll or a cached set that the gpu might use
+		 * @param[in] handle	Vulkan handle
+		 * @return				True if the handle can't be replaced, false otherwise
+		 */
+		b8 IsHandleLocked(u64 handle);
+		/**
+		 * Check if a set referencing a buffer or texture might be used by the gpu
+		 * @param[in] pResource	Buffer or texture
+		 * @return				True if a referencing set is in use, false otherwise
+		 */
+		b8 IsReferencedByUsedSet(const void* pResource);
+		/**
+		 * Get the sets referencing a buffer or texture, each set once
+		 * @param[in] pResource	Buffer or texture
+		 * @return				Descriptor sets
+		 */
+		std::vector<VulkanDescriptorSet*> GetReferencingSets(const void* pResource);
+
+		/**
+		 * Allocate a vulkan descriptor set from a pool chain
+		 * @param[in] chain		Pool chain
+		 * @param[in] freeable	If sets from new pools can be freed individually
+		 * @param[in] pLayout	Descriptor set layout
+		 * @param[out] set		Vulkan descriptor set
+		 * @param[out] pool		Vulkan descriptor pool the set was allocated from
+		 * @return				Vulkan result
+		 */
+		VkResult AllocateFromChain(PoolChain& chain, b8 freeable, RHI::DescriptorSetLayout* pLayout, VkDescriptorSet& set, VkDescriptorPool& pool);
+		/**
+		 * Create a descriptor pool, sized from the observed descriptor usage
+		 * @param[in] maxSets	Max amount of sets in the pool
+		 * @param[in] freeable	If sets can be freed individually
+		 * @param[in] pLayout	Layout of the set the pool is created for, the pool always has room for at least 1 set of it
+		 * @param[out] pool		Vulkan descriptor pool
+		 * @return				Vulkan result
+		 */
+		VkResult CreatePool(u32 maxSets, b8 freeable, RHI::DescriptorSetLayout* pLayout, VkDescriptorPool& pool);
+		/**
+		 * Destroy all pools in a pool chain
+		 * @param[in] chain	Pool chain
+		 */
+		void DestroyChain(PoolChain& chain);
+
+		PoolChain m_PersistentPools;											/**< Pools for persistent sets */
+		FrameData m_Frames[3];													/**< Transient sets per frame in flight */
+		u32 m_FrameIndex;														/**< Current frame index */
+
+		u64 m_DescriptorUsage[u8(RHI::DescriptorSetBindingType::Count)];		/**< Amount of descriptors allocated per type */
+		u64 m_SetUsage;															/**< Amount of sets allocated */
+
+		std::list<CacheEntry> m_Cache;											/**< Cached descriptor sets, most recently used first */
+		std::unordered_multimap<u64, CacheIterator> m_CacheLookup;				/**< Cached descriptor sets by hash */
+		std::unordered_multimap<u64, CacheIterator> m_CacheResources;			/**< Cached descriptor sets by referenced vulkan handle */
+		std::vector<RetiredSet> m_RetiredSets;									/**< Invalidated cached sets, in invalidation order */
+		std::vector<RetiredLayout> m_RetiredLayouts;							/**< Destroyed layouts of retired cached sets, in destruction order */
+
+		std::unordered_multimap<const void*, VulkanDescriptorSet*> m_ResourceSets;	/**< Persistent and bindless sets by buffer or texture written with Write */
+		std::unordered_multimap<u64, VulkanDescriptorSet*> m_HandleSets;			/**< Persistent and bindless sets by vulkan handle written with WriteAll */
+
+		std::unordered_multimap<u64, PipelineLayoutEntry> m_PipelineLayouts;	/**< Pipeline layouts by hash of their set layouts and push constants */
+		std::unordered_map<VkPipelineLayout, u64> m_PipelineLayoutHashes;		/**< Hash of each pipeline layout, to find its entry on release */
+
+		VkDescriptorPool m_BindlessPool;	/**< Update after bind pool for the bindless set */
 	};
 
 }
@@ -12,6 +12,27 @@ namespace Vulkan {
 		, m_pPhysicalDevice(nullptr)
 		, m_pAllocCallbacks(nullptr)
 		, m_Device(VK_NULL_HANDLE)
+		, m_pfnCmdDrawIndirectCount(nullptr)
+		, m_pfnCmdDrawIndexedIndirectCount(nullptr)
+		, m_pfnCreateDescriptorUpdateTemplate(nullptr)
+		, m_pfnDestroyDescriptorUpdateTemplate(nullptr)
+		, m_pfnUpdateDescriptorSetWithTemplate(nullptr)
+		, m_pfnGetBufferMemoryRequirements2(nullptr)
+		, m_pfnGetImageMemoryRequirements2(nullptr)
+#ifdef VK_EXT_extended_dynamic_state
+		, m_pfnCmdSetCullMode(nullptr)
+		, m_pfnCmdSetFrontFace(nullptr)
+		, m_pfnCmdSetPrimitiveTopology(nullptr)
+		, m_pfnCmdSetDepthTestEnable(nullptr)
+		, m_pfnCmdSetDepthWriteEnable(nullptr)
+		, m_pfnCmdSetDepthCompareOp(nullptr)
+		, m_pfnCmdSetStencilTestEnable(nullptr)
+		, m_pfnCmdSetStencilOp(nullptr)
+#endif
+#ifdef VK_KHR_dynamic_rendering
+		, m_pfnCmdBeginRendering(nullptr)
+		, m_pfnCmdEndRendering(nullptr)
+#endif
 	{
 	}
 
@@ -32,6 +53,42 @@ namespace Vulkan {
 
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+
+		// Enable all supported descriptor indexing features
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = m_pPhysicalDevice->GetDescriptorIndexingFeatures();
+		if (IsExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+		{
+			descriptorIndexingFeatures.pNext = (void*)createInfo.pNext;
+			createInfo.pNext = &descriptorIndexingFeatures;
+		}
+#ifdef VK_EXT_extended_dynamic_state
+		// Enable extended dynamic state
+		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures = m_pPhysicalDevice->GetExtendedDynamicStateFeatures();
+		if (IsExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+		{
+			extendedDynamicStateFeatures.pNext = (void*)createInfo.pNext;
+			createInfo.pNext = &extendedDynamicStateFeatures;
+		}
+#endif
+#ifdef VK_KHR_dynamic_rendering
+		// Enable dynamic rendering
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = m_pPhysicalDevice->GetDynamicRenderingFeatures();
+		if (IsExtensionEnabled(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+		{
+			dynamicRenderingFeatures.pNext = (void*)createInfo.pNext;
+			createInfo.pNext = &dynamicRenderingFeatures;
+		}
+#endif
+#ifdef VK_EXT_graphics_pipeline_library
+		// Enable graphics pipeline libraries
+		VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures = m_pPhysicalDevice->GetGraphicsPipelineLibraryFeatures();
+		if (IsExtensionEnabled(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+		{
+			graphicsPipelineLibraryFeatures.pNext = (void*)createInfo.pNext;
+			createInfo.pNext = &graphicsPipelineLibraryFeatures;
+		}
+#endif
+
 		createInfo.enabledExtensionCount = u32(m_EnabledExtensions.size());
 		createInfo.ppEnabledExtensionNames = m_EnabledExtensions.data();
 		createInfo.enabledLayerCount = u32(m_EnabledLayers.size());
@@ -47,6 +104,57 @@ namespace Vulkan {
 			return vkres;
 		}
 
+		// Load extension entry points
+		if (IsExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+		{
+			m_pfnCmdDrawIndirectCount = (PFN_vkCmdDrawIndirectCountKHR)vkGetDeviceProcAddr(m_Device, "vkCmdDrawIndirectCountKHR");
+			m_pfnCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(m_Device, "vkCmdDrawIndexedIndirectCountKHR");
+		}
+		// Descriptor update templates are core in 1.1, but both the instance and device need to support 1.1
+		if (m_pContext->GetInstance()->GetApiVersion() >= VK_API_VERSION_1_1 && m_pPhysicalDevice->GetProperties().apiVersion >= VK_API_VERSION_1_1)
+		{
+			m_pfnCreateDescriptorUpdateTemplate = (PFN_vkCreateDescriptorUpdateTemplate)vkGetDeviceProcAddr(m_Device, "vkCreateDescriptorUpdateTemplate");
+			m_pfnDestroyDescriptorUpdateTemplate = (PFN_vkDestroyDescriptorUpdateTemplate)vkGetDeviceProcAddr(m_Device, "vkDestroyDescriptorUpdateTemplate");
+			m_pfnUpdateDescriptorSetWithTemplate = (PFN_vkUpdateDescriptorSetWithTemplate)vkGetDeviceProcAddr(m_Device, "vkUpdateDescriptorSetWithTemplate");
+		}
+		else if (IsExtensionEnabled(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME))
+		{
+			m_pfnCreateDescriptorUpdateTemplate = (PFN_vkCreateDescriptorUpdateTemplate)vkGetDeviceProcAddr(m_Device, "vkCreateDescriptorUpdateTemplateKHR");
+			m_pfnDestroyDescriptorUpdateTemplate = (PFN_vkDestroyDescriptorUpdateTemplate)vkGetDeviceProcAddr(m_Device, "vkDestroyDescriptorUpdateTemplateKHR");
+			m_pfnUpdateDescriptorSetWithTemplate = (PFN_vkUpdateDescriptorSetWithTemplate)vkGetDeviceProcAddr(m_Device, "vkUpdateDescriptorSetWithTemplateKHR");
+		}
+		// Memory requirements 2 and dedicated allocations are core in 1.1, the allocator only uses them when both are available
+		if (m_pContext->GetInstance()->GetApiVersion() >= VK_API_VERSION_1_1 && m_pPhysicalDevice->GetProperties().apiVersion >= VK_API_VERSION_1_1)
+		{
+			m_pfnGetBufferMemoryRequirements2 = (PFN_vkGetBufferMemoryRequirements2)vkGetDeviceProcAddr(m_Device, "vkGetBufferMemoryRequirements2");
+			m_pfnGetImageMemoryRequirements2 = (PFN_vkGetImageMemoryRequirements2)vkGetDeviceProcAddr(m_Device, "vkGetImageMemoryRequirements2");
+		}
+		else if (IsExtensionEnabled(VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME) && IsExtensionEnabled(VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME))
+		{
+			m_pfnGetBufferMemoryRequirements2 = (PFN_vkGetBufferMemoryRequirements2)vkGetDeviceProcAddr(m_Device, "vkGetBufferMemoryRequirements2KHR");
+			m_pfnGetImageMemoryRequirements2 = (PFN_vkGetImageMemoryRequirements2)vkGetDeviceProcAddr(m_Device, "vkGetImageMemoryRequirements2KHR");
+		}
+#ifdef VK_EXT_extended_dynamic_state
+		if (IsExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+		{
+			m_pfnCmdSetCullMode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(m_Device, "vkCmdSetCullModeEXT");
+			m_pfnCmdSetFrontFace = (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(m_Device, "vkCmdSetFrontFaceEXT");
+			m_pfnCmdSetPrimitiveTopology = (PFN_vkCmdSetPrimitiveTopologyEXT)vkGetDeviceProcAddr(m_Device, "vkCmdSetPrimitiveTopologyEXT");
+			m_pfnCmdSetDepthTestEnable = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(m_Device, "vkCmdSetDepthTestEnableEXT");
+			m_pfnCmdSetDepthWriteEnable = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(m_Device, "vkCmdSetDepthWriteEnableEXT");
+			m_pfnCmdSetDepthCompareOp = (PFN_vkCmdSetDepthCompareOpEXT)vkGetDeviceProcAddr(m_Device, "vkCmdSetDepthCompareOpEXT");
+			m_pfnCmdSetStencilTestEnable = (PFN_vkCmdSetStencilTestEnableEXT)vkGetDeviceProcAddr(m_Device, "vkCmdSetStencilTestEnableEXT");
+			m_pfnCmdSetStencilOp = (PFN_vkCmdSetStencilOpEXT)vkGetDeviceProcAddr(m_Device, "vkCmdSetStencilOpEXT");
+		}
+#endif
+#ifdef VK_KHR_dynamic_rendering
+		if (IsExtensionEnabled(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+		{
+			m_pfnCmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(m_Device, "vkCmdBeginRenderingKHR");
+			m_pfnCmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(m_Device, "vkCmdEndRenderingKHR");
+		}
+#endif
+
 		return VK_SUCCESS;
 	}
 
@@ -181,6 +289,22 @@ namespace Vulkan {
 		::vkGetImageMemoryRequirements(m_Device, image, &requirements);
 	}
 
+	void VulkanDevice::vkGetImageMemoryRequirements2(const VkImageMemoryRequirementsInfo2& info,
+		VkMemoryRequirements2& requirements)
+	{
+		assert(m_pfnGetImageMemoryRequirements2);
+		m_pfnGetImageMemoryRequirements2(m_Device, &info, &requirements);
+	}
+
+	void VulkanDevice::vkGetImageSparseMemoryRequirements(VkImage image,
+		std::vector<VkSparseImageMemoryRequirements>& requirements)
+	{
+		u32 count = 0;
+		::vkGetImageSparseMemoryRequirements(m_Device, image, &count, nullptr);
+		requirements.resize(count);
+		::vkGetImageSparseMemoryRequirements(m_Device, image, &count, requirements.data());
+	}
+
 	VkResult VulkanDevice::vkBindImageMemory(VkImage image, VkDeviceMemory memory, VkDeviceSize offset)
 	{
 		return ::vkBindImageMemory(m_Device, image, memory, offset);
@@ -278,6 +402,92 @@ namespace Vulkan {
 		::vkFreeCommandBuffers(m_Device, commandPool, u32(commandBuffers.size()), commandBuffers.data());
 	}
 
+	void VulkanDevice::vkCmdDrawIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer,
+		VkDeviceSize countOffset, u32 maxDrawCount, u32 stride)
+	{
+		m_pfnCmdDrawIndirectCount(commandBuffer, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+	}
+
+	void VulkanDevice::vkCmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer,
+		VkDeviceSize countOffset, u32 maxDrawCount, u32 stride)
+	{
+		m_pfnCmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+	}
+
+	b8 VulkanDevice::IsExtendedDynamicStateSupported() const
+	{
+#ifdef VK_EXT_extended_dynamic_state
+		return m_pfnCmdSetCullMode && m_pfnCmdSetFrontFace && m_pfnCmdSetPrimitiveTopology &&
+			   m_pfnCmdSetDepthTestEnable && m_pfnCmdSetDepthWriteEnable && m_pfnCmdSetDepthCompareOp &&
+			   m_pfnCmdSetStencilTestEnable && m_pfnCmdSetStencilOp;
+#else
+		return false;
+#endif
+	}
+
+#ifdef VK_EXT_extended_dynamic_state
+	void VulkanDevice::vkCmdSetCullMode(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode)
+	{
+		m_pfnCmdSetCullMode(commandBuffer, cullMode);
+	}
+
+	void VulkanDevice::vkCmdSetFrontFace(VkCommandBuffer commandBuffer, VkFrontFace frontFace)
+	{
+		m_pfnCmdSetFrontFace(commandBuffer, frontFace);
+	}
+
+	void VulkanDevice::vkCmdSetPrimitiveTopology(VkCommandBuffer commandBuffer, VkPrimitiveTopology topology)
+	{
+		m_pfnCmdSetPrimitiveTopology(commandBuffer, topology);
+	}
+
+	void VulkanDevice::vkCmdSetDepthTestEnable(VkCommandBuffer commandBuffer, VkBool32 enable)
+	{
+		m_pfnCmdSetDepthTestEnable(commandBuffer, enable);
+	}
+
+	void VulkanDevice::vkCmdSetDepthWriteEnable(VkCommandBuffer commandBuffer, VkBool32 enable)
+	{
+		m_pfnCmdSetDepthWriteEnable(commandBuffer, enable);
+	}
+
+	void VulkanDevice::vkCmdSetDepthCompareOp(VkCommandBuffer commandBuffer, VkCompareOp compareOp)
+	{
+		m_pfnCmdSetDepthCompareOp(commandBuffer, compareOp);
+	}
+
+	void VulkanDevice::vkCmdSetStencilTestEnable(VkCommandBuffer commandBuffer, VkBool32 enable)
+	{
+		m_pfnCmdSetStencilTestEnable(commandBuffer, enable);
+	}
+
+	void VulkanDevice::vkCmdSetStencilOp(VkCommandBuffer commandBuffer, VkStencilFaceFlags faceMask, VkStencilOp failOp, VkStencilOp passOp, VkStencilOp depthFailOp, VkCompareOp compareOp)
+	{
+		m_pfnCmdSetStencilOp(commandBuffer, faceMask, failOp, passOp, depthFailOp, compareOp);
+	}
+#endif
+
+	b8 VulkanDevice::IsDynamicRenderingSupported() const
+	{
+#ifdef VK_KHR_dynamic_rendering
+		return m_pfnCmdBeginRendering && m_pfnCmdEndRendering;
+#else
+		return false;
+#endif
+	}
+
+#ifdef VK_KHR_dynamic_rendering
+	void VulkanDevice::vkCmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR& renderingInfo)
+	{
+		m_pfnCmdBeginRendering(commandBuffer, &renderingInfo);
+	}
+
+	void VulkanDevice::vkCmdEndRendering(VkCommandBuffer commandBuffer)
+	{
+		m_pfnCmdEndRendering(commandBuffer);
+	}
+#endif
+
 	VkResult VulkanDevice::vkAllocateMemory(const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory& memory)
 	{
 		return ::vkAllocateMemory(m_Device, &allocInfo, m_pAllocCallbacks, &memory);
@@ -344,6 +554,13 @@ namespace Vulkan {
 		::vkGetBufferMemoryRequirements(m_Device, buffer, &requirements);
 	}
 
+	void VulkanDevice::vkGetBufferMemoryRequirements2(const VkBufferMemoryRequirementsInfo2& info,
+		VkMemoryRequirements2& requirements)
+	{
+		assert(m_pfnGetBufferMemoryRequirements2);
+		m_pfnGetBufferMemoryRequirements2(m_Device, &info, &requirements);
+	}
+
 	VkResult VulkanDevice::vkBindBufferMemory(VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize offset)
 	{
 		return ::vkBindBufferMemory(m_Device, buffer, memory, offset);
@@ -371,6 +588,11 @@ namespace Vulkan {
 		::vkDestroyDescriptorPool(m_Device, descriptorPool, m_pAllocCallbacks);
 	}
 
+	VkResult VulkanDevice::vkResetDescriptorPool(VkDescriptorPool descriptorPool)
+	{
+		return ::vkResetDescriptorPool(m_Device, descriptorPool, 0);
+	}
+
 	VkResult VulkanDevice::vkAllocateDescriptorSet(const VkDescriptorSetAllocateInfo& allocInfo,
 		VkDescriptorSet& descriptorPool)
 	{
@@ -389,6 +611,26 @@ namespace Vulkan {
 		::vkUpdateDescriptorSets(m_Device, numWrites, writes, numCopies, copies);
 	}
 
+	VkResult VulkanDevice::vkCreateDescriptorUpdateTemplate(const VkDescriptorUpdateTemplateCreateInfo& createInfo,
+		VkDescriptorUpdateTemplate& updateTemplate)
+	{
+		assert(m_pfnCreateDescriptorUpdateTemplate);
+		return m_pfnCreateDescriptorUpdateTemplate(m_Device, &createInfo, m_pAllocCallbacks, &updateTemplate);
+	}
+
+	void VulkanDevice::vkDestroyDescriptorUpdateTemplate(VkDescriptorUpdateTemplate updateTemplate)
+	{
+		assert(m_pfnDestroyDescriptorUpdateTemplate);
+		m_pfnDestroyDescriptorUpdateTemplate(m_Device, updateTemplate, m_pAllocCallbacks);
+	}
+
+	void VulkanDevice::vkUpdateDescriptorSetWithTemplate(VkDescriptorSet set, VkDescriptorUpdateTemplate updateTemplate,
+		const void* pData)
+	{
+		assert(m_pfnUpdateDescriptorSetWithTemplate);
+		m_pfnUpdateDescriptorSetWithTemplate(m_Device, set, updateTemplate, pData);
+	}
+
 	VkResult VulkanDevice::vkCreateSemapore(const VkSemaphoreCreateInfo& createInfo, VkSemaphore& semaphore)
 	{
 		return ::vkCreateSemaphore(m_Device, &createInfo, m_pAllocCallbacks, &semaphore);
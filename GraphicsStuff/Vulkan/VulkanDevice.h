@@ -172,6 +172,19 @@ namespace Vulkan {
 		 * @param[in] requirements	Memory requirement
 		 */
 		void vkGetImageMemoryRequirements(VkImage image, VkMemoryRequirements& requirements);
+		/**
+		 * Get the extended memory requirements for a vk image
+		 * @param[in] info			Requirements info
+		 * @param[in] requirements	Memory requirement, with optional extension structs chained
+		 * @note					Requires IsMemoryRequirements2Supported()
+		 */
+		void vkGetImageMemoryRequirements2(const VkImageMemoryRequirementsInfo2& info, VkMemoryRequirements2& requirements);
+		/**
+		 * Get the sparse memory requirements for a vk image
+		 * @param[in] image			Image, created with sparse residency
+		 * @param[out] requirements	Sparse memory requirements, one for each aspect
+		 */
+		void vkGetImageSparseMemoryRequirements(VkImage image, std::vector<VkSparseImageMemoryRequirements>& requirements);
 		/**
 		* Bind vk memory to a vk buffer
 		* @param[in] image		Image
@@ -299,6 +312,113 @@ namespace Vulkan {
 		 */
 		void vkFreeCommandBuffers(VkCommandPool commandPool, const std::vector<VkCommandBuffer> commandBuffers);
 
+		/**
+		 * Record an indirect draw with the draw count read from a buffer (VK_KHR_draw_indirect_count)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] buffer		Buffer with draw commands
+		 * @param[in] offset		Offset in the buffer
+		 * @param[in] countBuffer	Buffer with the draw count
+		 * @param[in] countOffset	Offset in the count buffer
+		 * @param[in] maxDrawCount	Maximum draw count
+		 * @param[in] stride		Stride between draw commands
+		 */
+		void vkCmdDrawIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countOffset, u32 maxDrawCount, u32 stride);
+		/**
+		 * Record an indexed indirect draw with the draw count read from a buffer (VK_KHR_draw_indirect_count)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] buffer		Buffer with draw commands
+		 * @param[in] offset		Offset in the buffer
+		 * @param[in] countBuffer	Buffer with the draw count
+		 * @param[in] countOffset	Offset in the count buffer
+		 * @param[in] maxDrawCount	Maximum draw count
+		 * @param[in] stride		Stride between draw commands
+		 */
+		void vkCmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countOffset, u32 maxDrawCount, u32 stride);
+		/**
+		 * Check if the indirect count draw entry points were loaded
+		 * @return	True if VK_KHR_draw_indirect_count is enabled, false otherwise
+		 */
+		b8 IsDrawIndirectCountSupported() const { return m_pfnCmdDrawIndirectCount && m_pfnCmdDrawIndexedIndirectCount; }
+
+#ifdef VK_EXT_extended_dynamic_state
+		/**
+		 * Set the dynamic cull mode (VK_EXT_extended_dynamic_state)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] cullMode		Cull mode
+		 */
+		void vkCmdSetCullMode(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode);
+		/**
+		 * Set the dynamic front face (VK_EXT_extended_dynamic_state)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] frontFace		Front face
+		 */
+		void vkCmdSetFrontFace(VkCommandBuffer commandBuffer, VkFrontFace frontFace);
+		/**
+		 * Set the dynamic primitive topology (VK_EXT_extended_dynamic_state)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] topology		Primitive topology
+		 */
+		void vkCmdSetPrimitiveTopology(VkCommandBuffer commandBuffer, VkPrimitiveTopology topology);
+		/**
+		 * Set the dynamic depth test enable (VK_EXT_extended_dynamic_state)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] enable		Enable the depth test
+		 */
+		void vkCmdSetDepthTestEnable(VkCommandBuffer commandBuffer, VkBool32 enable);
+		/**
+		 * Set the dynamic depth write enable (VK_EXT_extended_dynamic_state)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] enable		Enable depth writes
+		 */
+		void vkCmdSetDepthWriteEnable(VkCommandBuffer commandBuffer, VkBool32 enable);
+		/**
+		 * Set the dynamic depth compare op (VK_EXT_extended_dynamic_state)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] compareOp		Depth compare op
+		 */
+		void vkCmdSetDepthCompareOp(VkCommandBuffer commandBuffer, VkCompareOp compareOp);
+		/**
+		 * Set the dynamic stencil test enable (VK_EXT_extended_dynamic_state)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] enable		Enable the stencil test
+		 */
+		void vkCmdSetStencilTestEnable(VkCommandBuffer commandBuffer, VkBool32 enable);
+		/**
+		 * Set the dynamic stencil ops (VK_EXT_extended_dynamic_state)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] faceMask		Faces to set the ops for
+		 * @param[in] failOp		Action on stencil test fail
+		 * @param[in] passOp		Action on stencil test pass
+		 * @param[in] depthFailOp	Action on depth test fail
+		 * @param[in] compareOp		Stencil compare op
+		 */
+		void vkCmdSetStencilOp(VkCommandBuffer commandBuffer, VkStencilFaceFlags faceMask, VkStencilOp failOp, VkStencilOp passOp, VkStencilOp depthFailOp, VkCompareOp compareOp);
+#endif
+		/**
+		 * Check if the extended dynamic state entry points were loaded
+		 * @return	True if VK_EXT_extended_dynamic_state is enabled, false otherwise
+		 */
+		b8 IsExtendedDynamicStateSupported() const;
+
+#ifdef VK_KHR_dynamic_rendering
+		/**
+		 * Begin rendering without a render pass (VK_KHR_dynamic_rendering)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 * @param[in] renderingInfo	Rendering info
+		 */
+		void vkCmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR& renderingInfo);
+		/**
+		 * End rendering without a render pass (VK_KHR_dynamic_rendering)
+		 * @param[in] commandBuffer	Command buffer to record to
+		 */
+		void vkCmdEndRendering(VkCommandBuffer commandBuffer);
+#endif
+		/**
+		 * Check if the dynamic rendering entry points were loaded
+		 * @return	True if VK_KHR_dynamic_rendering is enabled, false otherwise
+		 */
+		b8 IsDynamicRenderingSupported() const;
+
 		/**
 		 * Allocate vulkan memory
 		 * @param[in] allocInfo		Allocation info
@@ -376,6 +496,18 @@ namespace Vulkan {
 		 * @param[in] requirements	Memory requirement
 		 */
 		void vkGetBufferMemoryRequirements(VkBuffer buffer, VkMemoryRequirements& requirements);
+		/**
+		 * Get the extended memory requirements for a vk buffer
+		 * @param[in] info			Requirements info
+		 * @param[in] requirements	Memory requirement, with optional extension structs chained
+		 * @note					Requires IsMemoryRequirements2Supported()
+		 */
+		void vkGetBufferMemoryRequirements2(const VkBufferMemoryRequirementsInfo2& info, VkMemoryRequirements2& requirements);
+		/**
+		 * Check if the extended memory requirement entry points were loaded, dedicated allocations are available with them
+		 * @return	True if extended memory requirements are supported (Vulkan 1.1 or VK_KHR_get_memory_requirements2 and VK_KHR_dedicated_allocation), false otherwise
+		 */
+		b8 IsMemoryRequirements2Supported() const { return m_pfnGetBufferMemoryRequirements2 && m_pfnGetImageMemoryRequirements2; }
 		/**
 		 * Bind vk memory to a vk buffer
 		 * @param[in] buffer		Buffer
@@ -409,6 +541,12 @@ namespace Vulkan {
 		 * @param[in] descriptorPool		Descriptor pool
 		 */
 		void vkDestroyDescriptorPool(VkDescriptorPool descriptorPool);
+		/**
+		 * Reset a vk descriptor pool, freeing all sets allocated from it
+		 * @param[in] descriptorPool		Descriptor pool
+		 * @return						Vulkan result
+		 */
+		VkResult vkResetDescriptorPool(VkDescriptorPool descriptorPool);
 		/**
 		 * Create a vk descriptor pool
 		 * @param[in] allocInfo			Allocation info
@@ -430,6 +568,30 @@ namespace Vulkan {
 		* @param[in] writes		Copy descriptor sets
 		*/
 		void vkUpdateDescriptorSets(u32 numWrites, VkWriteDescriptorSet* writes, u32 numCopies, VkCopyDescriptorSet* copies);
+		/**
+		 * Create a vk descriptor update template
+		 * @param[in] createInfo	Create info
+		 * @param[out] updateTemplate	Descriptor update template
+		 * @return						Vulkan result
+		 */
+		VkResult vkCreateDescriptorUpdateTemplate(const VkDescriptorUpdateTemplateCreateInfo& createInfo, VkDescriptorUpdateTemplate& updateTemplate);
+		/**
+		 * Destroy a vk descriptor update template
+		 * @param[in] updateTemplate	Descriptor update template
+		 */
+		void vkDestroyDescriptorUpdateTemplate(VkDescriptorUpdateTemplate updateTemplate);
+		/**
+		 * Update a vk descriptor set with a descriptor update template
+		 * @param[in] set				Descriptor set
+		 * @param[in] updateTemplate	Descriptor update template
+		 * @param[in] pData				Packed descriptor data
+		 */
+		void vkUpdateDescriptorSetWithTemplate(VkDescriptorSet set, VkDescriptorUpdateTemplate updateTemplate, const void* pData);
+		/**
+		 * Check if the descriptor update template entry points were loaded
+		 * @return	True if descriptor update templates are supported (Vulkan 1.1 or VK_KHR_descriptor_update_template), false otherwise
+		 */
+		b8 IsDescriptorUpdateTemplateSupported() const { return m_pfnCreateDescriptorUpdateTemplate && m_pfnDestroyDescriptorUpdateTemplate && m_pfnUpdateDescriptorSetWithTemplate; }
 
 		/**
 		 * Create a vk semaphore
@@ -501,6 +663,28 @@ namespace Vulkan {
 		std::vector<const char*> m_EnabledExtensions;			/**< Enabled extensions */
 		std::vector<const char*> m_EnabledLayers;				/**< Enabled extensions */
 		std::vector<RHI::Queue*> m_Queues;				/**< Device queues */
+
+		PFN_vkCmdDrawIndirectCountKHR m_pfnCmdDrawIndirectCount;				/**< vkCmdDrawIndirectCountKHR entry point */
+		PFN_vkCmdDrawIndexedIndirectCountKHR m_pfnCmdDrawIndexedIndirectCount;	/**< vkCmdDrawIndexedIndirectCountKHR entry point */
+		PFN_vkCreateDescriptorUpdateTemplate m_pfnCreateDescriptorUpdateTemplate;	/**< vkCreateDescriptorUpdateTemplate entry point */
+		PFN_vkDestroyDescriptorUpdateTemplate m_pfnDestroyDescriptorUpdateTemplate;	/**< vkDestroyDescriptorUpdateTemplate entry point */
+		PFN_vkUpdateDescriptorSetWithTemplate m_pfnUpdateDescriptorSetWithTemplate;	/**< vkUpdateDescriptorSetWithTemplate entry point */
+		PFN_vkGetBufferMemoryRequirements2 m_pfnGetBufferMemoryRequirements2;		/**< vkGetBufferMemoryRequirements2 entry point */
+		PFN_vkGetImageMemoryRequirements2 m_pfnGetImageMemoryRequirements2;			/**< vkGetImageMemoryRequirements2 entry point */
+#ifdef VK_EXT_extended_dynamic_state
+		PFN_vkCmdSetCullModeEXT m_pfnCmdSetCullMode;							/**< vkCmdSetCullModeEXT entry point */
+		PFN_vkCmdSetFrontFaceEXT m_pfnCmdSetFrontFace;							/**< vkCmdSetFrontFaceEXT entry point */
+		PFN_vkCmdSetPrimitiveTopologyEXT m_pfnCmdSetPrimitiveTopology;			/**< vkCmdSetPrimitiveTopologyEXT entry point */
+		PFN_vkCmdSetDepthTestEnableEXT m_pfnCmdSetDepthTestEnable;				/**< vkCmdSetDepthTestEnableEXT entry point */
+		PFN_vkCmdSetDepthWriteEnableEXT m_pfnCmdSetDepthWriteEnable;			/**< vkCmdSetDepthWriteEnableEXT entry point */
+		PFN_vkCmdSetDepthCompareOpEXT m_pfnCmdSetDepthCompareOp;				/**< vkCmdSetDepthCompareOpEXT entry point */
+		PFN_vkCmdSetStencilTestEnableEXT m_pfnCmdSetStencilTestEnable;			/**< vkCmdSetStencilTestEnableEXT entry point */
+		PFN_vkCmdSetStencilOpEXT m_pfnCmdSetStencilOp;							/**< vkCmdSetStencilOpEXT entry point */
+#endif
+#ifdef VK_KHR_dynamic_rendering
+		PFN_vkCmdBeginRenderingKHR m_pfnCmdBeginRendering;						/**< vkCmdBeginRenderingKHR entry point */
+		PFN_vkCmdEndRenderingKHR m_pfnCmdEndRendering;							/**< vkCmdEndRenderingKHR entry point */
+#endif
 	};
 
 }
@@ -8,9 +8,35 @@
 #include "VulkanSampler.h"
 #include "VulkanTexture.h"
 #include "VulkanRenderTarget.h"
+#include "VulkanBuffer.h"
+#include "VulkanMemoryHeap.h"
+#include "VulkanPhysicalDevice.h"
+#include "VulkanSparseTextureResidency.h"
+#include "../RHI/DescriptorSetManager.h"
+#include "../RHI/SamplerCache.h"
+#include "../RHI/RenderPassCache.h"
+#include <algorithm>
 
 namespace Vulkan {
 
+	namespace {
+
+		/**
+		 * Convert vulkan memory requirements to the requirements of a resource placed in a heap
+		 */
+		RHI::MemoryRequirements GetPlacedRequirements(VulkanContext* pContext, const VkMemoryRequirements& vkRequirements)
+		{
+			// Buffers and images that don't alias each other can't share a page of buffer image granularity,
+			// so resources are padded to whole pages, which makes any offset that is a multiple of the alignment safe
+			VkDeviceSize granularity = pContext->GetSelectedPhysicalDevice()->GetLimits().bufferImageGranularity;
+			RHI::MemoryRequirements requirements;
+			requirements.alignment = std::max(vkRequirements.alignment, granularity);
+			requirements.size = (vkRequirements.size + granularity - 1) / granularity * granularity;
+			return requirements;
+		}
+
+	}
+
 	VulkanDynamicRHI::VulkanDynamicRHI()
 		: IDynamicRHI()
 	{
@@ -107,22 +133,12 @@ namespace Vulkan {
 		const std::vector<RHI::RenderPassAttachment>& attachments,
 		const std::vector<RHI::SubRenderPass>& subpasses)
 	{
-		VulkanRenderPass* pRenderPass = new VulkanRenderPass();
-		b8 res = pRenderPass->Create(m_pContext, attachments, subpasses);
-		if (!res)
-		{
-			pRenderPass->Destroy();
-			delete pRenderPass;
-			return nullptr;
-		}
-		return pRenderPass;
+		return m_pContext->GetRenderPassCache()->GetRenderPass(attachments, subpasses);
 	}
 
 	b8 VulkanDynamicRHI::DestroyRenderPass(RHI::RenderPass* pRenderPass)
 	{
-		b8 res = pRenderPass->Destroy();
-		delete pRenderPass;
-		return res;
+		return m_pContext->GetRenderPassCache()->ReleaseRenderPass(pRenderPass);
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -164,42 +180,22 @@ namespace Vulkan {
 	RHI::Framebuffer* VulkanDynamicRHI::CreateFramebuffer(
 		const std::vector<RHI::RenderTarget*>& renderTargets, RHI::RenderPass* pRenderPass)
 	{
-		VulkanFramebuffer* pFramebuffer = new VulkanFramebuffer();
-		b8 res = pFramebuffer->Create(m_pContext, renderTargets, pRenderPass);
-		if (!res)
-		{
-			pFramebuffer->Destroy();
-			delete pFramebuffer;
-			return nullptr;
-		}
-		return pFramebuffer;
+		return m_pContext->GetRenderPassCache()->GetFramebuffer(renderTargets, pRenderPass);
 	}
 
 	b8 VulkanDynamicRHI::DestroyFramebuffer(RHI::Framebuffer* pFramebuffer)
 	{
-		b8 res = pFramebuffer->Destroy();
-		delete pFramebuffer;
-		return res;
+		return m_pContext->GetRenderPassCache()->ReleaseFramebuffer(pFramebuffer);
 	}
 
 	RHI::Sampler* VulkanDynamicRHI::CreateSampler(const RHI::SamplerDesc& desc)
 	{
-		VulkanSampler* pSampler = new VulkanSampler();
-		b8 res = pSampler->Create(m_pContext, desc);
-		if (!res)
-		{
-			pSampler->Destroy();
-			delete pSampler;
-			return nullptr;
-		}
-		return pSampler;
+		return m_pContext->GetSamplerCache()->GetSampler(desc);
 	}
 
 	b8 VulkanDynamicRHI::DestroySampler(RHI::Sampler* pSampler)
 	{
-		b8 res = pSampler->Destroy();
-		delete pSampler;
-		return res;
+		return m_pContext->GetSamplerCache()->ReleaseSampler(pSampler);
 	}
 
 	RHI::Texture* VulkanDynamicRHI::CreateTexture(const RHI::TextureDesc& desc, RHI::CommandList* pCommandList)
@@ -217,6 +213,8 @@ namespace Vulkan {
 
 	b8 VulkanDynamicRHI::DestroyTexture(RHI::Texture* pTexture)
 	{
+		if (GetDescriptorSetManager())
+			GetDescriptorSetManager()->InvalidateCachedDescriptorSets(pTexture);
 		b8 res = pTexture->Destroy();
 		delete pTexture;
 		return res;
@@ -291,6 +289,8 @@ namespace Vulkan {
 			//g_Logger.LogError("Buffer can't be a nullptr!");
 			return false;
 		}
+		if (GetDescriptorSetManager())
+			GetDescriptorSetManager()->InvalidateCachedDescriptorSets(pBuffer);
 		b8 res = pBuffer->Destroy();
 		if (!res)
 		{
@@ -301,6 +301,106 @@ namespace Vulkan {
 		return true;
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	// Memory heaps																  //
+	////////////////////////////////////////////////////////////////////////////////
+	RHI::MemoryHeap* VulkanDynamicRHI::CreateMemoryHeap(u64 size)
+	{
+		VulkanMemoryHeap* pHeap = new VulkanMemoryHeap();
+		b8 res = pHeap->Create(m_pContext, size);
+		if (!res)
+		{
+			delete pHeap;
+			//g_Logger.LogError("Failed to create memory heap");
+			return nullptr;
+		}
+		return pHeap;
+	}
+
+	b8 VulkanDynamicRHI::DestroyMemoryHeap(RHI::MemoryHeap* pHeap)
+	{
+		if (!pHeap)
+		{
+			//g_Logger.LogError("Memory heap can't be a nullptr!");
+			return false;
+		}
+		b8 res = pHeap->Destroy();
+		if (!res)
+		{
+			//g_Logger.LogError("Failed to destroy memory heap!");
+			return false;
+		}
+		delete pHeap;
+		return true;
+	}
+
+	RHI::Buffer* VulkanDynamicRHI::CreatePlacedBuffer(RHI::BufferType type, u64 size, RHI::BufferFlags flags, RHI::MemoryHeap* pHeap, u64 heapOffset)
+	{
+		VulkanBuffer* pBuffer = new VulkanBuffer();
+		b8 res = pBuffer->CreatePlaced(m_pContext, type, size, flags, pHeap, heapOffset);
+		if (!res)
+		{
+			delete pBuffer;
+			//g_Logger.LogError("Failed to create buffer");
+			return nullptr;
+		}
+		return pBuffer;
+	}
+
+	RHI::MemoryRequirements VulkanDynamicRHI::GetMemoryRequirements(const RHI::TextureDesc& desc)
+	{
+		VkMemoryRequirements requirements = {};
+		if (!VulkanTexture::GetMemoryRequirements((VulkanContext*)m_pContext, desc, requirements))
+			return RHI::MemoryRequirements();
+		return GetPlacedRequirements((VulkanContext*)m_pContext, requirements);
+	}
+
+	RHI::MemoryRequirements VulkanDynamicRHI::GetMemoryRequirements(const RHI::RenderTargetDesc& desc)
+	{
+		return GetMemoryRequirements(VulkanRenderTarget::GetTextureDesc((VulkanContext*)m_pContext, desc));
+	}
+
+	RHI::MemoryRequirements VulkanDynamicRHI::GetMemoryRequirements(RHI::BufferType type, u64 size, RHI::BufferFlags flags)
+	{
+		VkMemoryRequirements requirements = {};
+		if (!VulkanBuffer::GetMemoryRequirements((VulkanContext*)m_pContext, type, size, flags, requirements))
+			return RHI::MemoryRequirements();
+		return GetPlacedRequirements((VulkanContext*)m_pContext, requirements);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	// Sparse textures															  //
+	////////////////////////////////////////////////////////////////////////////////
+	RHI::SparseTextureResidency* VulkanDynamicRHI::CreateSparseTextureResidency(RHI::Texture* pTexture, u64 memoryBudget)
+	{
+		VulkanSparseTextureResidency* pResidency = new VulkanSparseTextureResidency();
+		b8 res = pResidency->Create(m_pContext, pTexture, memoryBudget);
+		if (!res)
+		{
+			delete pResidency;
+			//g_Logger.LogError("Failed to create sparse texture residency");
+			return nullptr;
+		}
+		return pResidency;
+	}
+
+	b8 VulkanDynamicRHI::DestroySparseTextureResidency(RHI::SparseTextureResidency* pResidency)
+	{
+		if (!pResidency)
+		{
+			//g_Logger.LogError("Sparse texture residency can't be a nullptr!");
+			return false;
+		}
+		b8 res = pResidency->Destroy();
+		if (!res)
+		{
+			//g_Logger.LogError("Failed to destroy sparse texture residency!");
+			return false;
+		}
+		delete pResidency;
+		return true;
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 	// Other																	  //
 	////////////////////////////////////////////////////////////////////////////////
@@ -65,14 +65,14 @@ namespace Vulkan {
 		// Render pass																  //
 		////////////////////////////////////////////////////////////////////////////////
 		/**
-		 * Create a render pass
+		 * Create a render pass, render passes with the same signature share a single render pass object
 		 * @param[in] attachments	Render pass attachments
 		 * @param[in] subpasses		Sub render passes
 		 * @return					Pointer to the render pass, nullptr if the creation failed
 		 */
 		RHI::RenderPass* CreateRenderPass(const std::vector<RHI::RenderPassAttachment>& attachments, const std::vector<RHI::SubRenderPass>& subpasses) override final;
 		/**
-		 * Destroy a render pass
+		 * Destroy a render pass, the render pass object is only destroyed when it's no longer shared
 		 * @param[in] pRenderPass	Render pass to destroy
 		 * @return					True if the render pass was destroyed successfully, false otherwise
 		 */
@@ -104,13 +104,13 @@ namespace Vulkan {
 		// Framebuffers																  //
 		////////////////////////////////////////////////////////////////////////////////
 		/**
-		 * Create a framebuffer
+		 * Create a framebuffer, framebuffers with the same render pass and render targets are shared
 		 * @param[in] renderTargets		Render targets
 		 * @return						Pointer to the framebuffer, nullptr if the creation failed
 		 */
 		RHI::Framebuffer* CreateFramebuffer(const std::vector<RHI::RenderTarget*>& renderTargets, RHI::RenderPass* pRenderPass) override final;
 		/**
-		 * Destroy a framebuffer
+		 * Destroy a framebuffer, the framebuffer stays cached until one of its render targets or its render pass is destroyed
 		 * @param[in] pFramebuffer	Framebuffer to destroy
 		 * @return					True if the framebuffer was destroyed successfully, false otherwise
 		 */
@@ -120,13 +120,13 @@ namespace Vulkan {
 		// Samplers																	  //
 		////////////////////////////////////////////////////////////////////////////////
 		/**
-		 * Create a sampler
+		 * Create a sampler, samplers with the same description share a single sampler object
 		 * @param[in] desc	Sampler description
 		 * @return			Pointer to the sampler, nullptr if the creation failed
 		 */
 		RHI::Sampler* CreateSampler(const RHI::SamplerDesc& desc) override final;
 		/**
-		 * Destroy a sampler
+		 * Destroy a sampler, the sampler object is only destroyed when it's no longer shared
 		 * @param[in] pSampler	Sampler to destroy
 		 * @return				True if the sampler was destroyed successfully, false otherwise
 		 */
@@ -199,6 +199,69 @@ namespace Vulkan {
 		 */
 		b8 DestroyBuffer(RHI::Buffer* pBuffer) override final;
 
+		////////////////////////////////////////////////////////////////////////////////
+		// Memory heaps																  //
+		////////////////////////////////////////////////////////////////////////////////
+		/**
+		 * Create a memory heap, to place resources that are never used at the same time in the same memory
+		 * @param[in] size	Size of the heap
+		 * @return			Pointer to the memory heap, nullptr if the creation failed
+		 */
+		RHI::MemoryHeap* CreateMemoryHeap(u64 size) override final;
+		/**
+		 * Destroy a memory heap
+		 * @param[in] pHeap	Memory heap to destroy
+		 * @return			True if the memory heap was destroyed successfully, false otherwise
+		 */
+		b8 DestroyMemoryHeap(RHI::MemoryHeap* pHeap) override final;
+		/**
+		 * Create a buffer placed in a memory heap
+		 * @param[in] type			Buffer type
+		 * @param[in] size			Buffer size
+		 * @param[in] flags			Buffer flags, dynamic and readback buffers can't be placed in a heap
+		 * @param[in] pHeap			Memory heap
+		 * @param[in] heapOffset	Offset in the heap, a multiple of the alignment of the memory requirements
+		 * @return					Pointer to the buffer, nullptr if the creation failed
+		 */
+		RHI::Buffer* CreatePlacedBuffer(RHI::BufferType type, u64 size, RHI::BufferFlags flags, RHI::MemoryHeap* pHeap, u64 heapOffset) override final;
+		/**
+		 * Get the memory requirements of a texture placed in a memory heap
+		 * @param[in] desc	Texture description
+		 * @return			Memory requirements, a size of 0 if the texture can't be created
+		 */
+		RHI::MemoryRequirements GetMemoryRequirements(const RHI::TextureDesc& desc) override final;
+		/**
+		 * Get the memory requirements of a render target placed in a memory heap
+		 * @param[in] desc	Render target description
+		 * @return			Memory requirements, a size of 0 if the render target can't be created
+		 */
+		RHI::MemoryRequirements GetMemoryRequirements(const RHI::RenderTargetDesc& desc) override final;
+		/**
+		 * Get the memory requirements of a buffer placed in a memory heap
+		 * @param[in] type	Buffer type
+		 * @param[in] size	Buffer size
+		 * @param[in] flags	Buffer flags
+		 * @return			Memory requirements, a size of 0 if the buffer can't be created
+		 */
+		RHI::MemoryRequirements GetMemoryRequirements(RHI::BufferType type, u64 size, RHI::BufferFlags flags) override final;
+
+		////////////////////////////////////////////////////////////////////////////////
+		// Sparse textures															  //
+		////////////////////////////////////////////////////////////////////////////////
+		/**
+		 * Create the tile residency of a sparse texture
+		 * @param[in] pTexture		Texture, created with TextureFlags::Sparse
+		 * @param[in] memoryBudget	Amount of memory the resident tiles and mip tail can use
+		 * @return					Pointer to the sparse texture residency, nullptr if the creation failed
+		 */
+		RHI::SparseTextureResidency* CreateSparseTextureResidency(RHI::Texture* pTexture, u64 memoryBudget) override final;
+		/**
+		 * Destroy the tile residency of a sparse texture
+		 * @param[in] pResidency	Sparse texture residency to destroy
+		 * @return					True if the sparse texture residency was destroyed successfully, false otherwise
+		 */
+		b8 DestroySparseTextureResidency(RHI::SparseTextureResidency* pResidency) override final;
+
 		////////////////////////////////////////////////////////////////////////////////
 		// Other																	  //
 		////////////////////////////////////////////////////////////////////////////////
@@ -369,6 +369,25 @@ namespace Vulkan { namespace Helpers {
 			states.push_back(VK_DYNAMIC_STATE_STENCIL_WRITE_MASK);
 		if ((dynamicState & RHI::DynamicState::StencilReference) != RHI::DynamicState::None)
 			states.push_back(VK_DYNAMIC_STATE_STENCIL_REFERENCE);
+#ifdef VK_EXT_extended_dynamic_state
+		if ((dynamicState & RHI::DynamicState::CullMode) != RHI::DynamicState::None)
+			states.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+		if ((dynamicState & RHI::DynamicState::FrontFace) != RHI::DynamicState::None)
+			states.push_back(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+		if ((dynamicState & RHI::DynamicState::PrimitiveTopology) != RHI::DynamicState::None)
+			states.push_back(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT);
+		if ((dynamicState & RHI::DynamicState::DepthTest) != RHI::DynamicState::None)
+		{
+			states.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+			states.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+			states.push_back(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT);
+		}
+		if ((dynamicState & RHI::DynamicState::StencilTest) != RHI::DynamicState::None)
+		{
+			states.push_back(VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT);
+			states.push_back(VK_DYNAMIC_STATE_STENCIL_OP_EXT);
+		}
+#endif
 
 		return states;
 	}
@@ -453,6 +472,35 @@ namespace Vulkan { namespace Helpers {
 		}
 	}
 
+	VkAccessFlags GetBufferBarrierAccessMode(RHI::PipelineStage stage, bool src)
+	{
+		const RHI::PipelineStage shaderStages = RHI::PipelineStage::VertexShader | RHI::PipelineStage::HullShader | RHI::PipelineStage::DomainShader |
+			RHI::PipelineStage::GeometryShader | RHI::PipelineStage::FragmentShader | RHI::PipelineStage::ComputeShader;
+
+		VkAccessFlags access = 0;
+		if (!src && (stage & RHI::PipelineStage::DrawIndirect) != RHI::PipelineStage::None)
+			access |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		if (!src && (stage & RHI::PipelineStage::VertexInput) != RHI::PipelineStage::None)
+			access |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+		if ((stage & shaderStages) != RHI::PipelineStage::None)
+			access |= src ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+		if ((stage & RHI::PipelineStage::Transfer) != RHI::PipelineStage::None)
+			access |= src ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		if ((stage & RHI::PipelineStage::Host) != RHI::PipelineStage::None)
+			access |= src ? VK_ACCESS_HOST_WRITE_BIT : VK_ACCESS_HOST_READ_BIT;
+		return access;
+	}
+
+	VkAccessFlags GetAliasingBarrierAccessMode(RHI::PipelineStage stage, bool src)
+	{
+		VkAccessFlags access = GetBufferBarrierAccessMode(stage, src);
+		if ((stage & RHI::PipelineStage::ColorAttachmentOutput) != RHI::PipelineStage::None)
+			access |= src ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		if ((stage & (RHI::PipelineStage::EarlyFragmentTest | RHI::PipelineStage::LastFragmentTest)) != RHI::PipelineStage::None)
+			access |= src ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		return access;
+	}
+
 	VkFilter GetFilter(RHI::FilterMode filter)
 	{
 		assert(u8(filter) < u8(RHI::FilterMode::Count));
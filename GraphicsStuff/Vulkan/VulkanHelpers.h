@@ -251,6 +251,20 @@ namespace Vulkan { namespace Helpers {
 	 * @return				Corresponding vulkan access mode
 	 */
 	VkAccessFlags GetImageTransitionAccessMode(RHI::PipelineStage stage, RHI::TextureLayout layout, bool src);
+	/**
+	 * Get the vulkan access mode of a buffer barrier from the pipeline stages on either side of it
+	 * @param[in] stage		Pipeline stage(s)
+	 * @param[in] src		If the stage is the source stage of the barrier (writes), or the destination stage (reads)
+	 * @return				Corresponding vulkan access mode
+	 */
+	VkAccessFlags GetBufferBarrierAccessMode(RHI::PipelineStage stage, bool src);
+	/**
+	 * Get the vulkan access mode of an aliasing barrier, which covers every access to the memory, including attachments
+	 * @param[in] stage		Pipeline stage(s)
+	 * @param[in] src		If the stage is the source stage of the barrier (writes), or the destination stage (reads and writes)
+	 * @return				Corresponding vulkan access mode
+	 */
+	VkAccessFlags GetAliasingBarrierAccessMode(RHI::PipelineStage stage, bool src);
 
 	////////////////////////////////////////////////////////////////////////////////
 	// Sampler																	  //
@@ -0,0 +1,296 @@
+
+#include "VulkanHostAllocator.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace Vulkan {
+
+	namespace {
+
+		/**
+		 * Where an allocation's memory came from
+		 */
+		enum class AllocationOrigin : u8
+		{
+			System,			/**< System allocator */
+			Pool,			/**< Size class pool */
+			CommandArena,	/**< Per thread command scope arena */
+		};
+
+		/**
+		 * Header in front of every allocation, so the memory can be returned to where it came from
+		 */
+		struct AllocationHeader
+		{
+			void* pBase;				/**< Block the allocation was placed in, or the command arena it came from */
+			sizeT size;					/**< Requested size */
+			AllocationOrigin origin;	/**< Origin of the memory */
+			u8 sizeClass;				/**< Size class of pool allocations */
+			u8 scope;					/**< Index of the allocation scope */
+		};
+
+		/**
+		 * Bump arena for command scope allocations, one per thread
+		 */
+		struct CommandArena
+		{
+			CommandArena() : pMemory(nullptr), capacity(0), offset(0), liveCount(0) {}
+			~CommandArena() { free(pMemory); }
+
+			u8* pMemory;		/**< Arena memory */
+			sizeT capacity;		/**< Size of the arena memory */
+			sizeT offset;		/**< Offset of the next allocation */
+			u32 liveCount;		/**< Amount of allocations that weren't freed yet */
+		};
+
+		thread_local CommandArena g_CommandArena;
+
+		const sizeT CommandArenaMinCapacity = 16 * 1024;	/**< Initial size of a command arena */
+		const sizeT CommandArenaMaxCapacity = 256 * 1024;	/**< Size a command arena can grow to, larger command allocations use the pools or system allocator */
+
+		/**
+		 * Place an allocation and its header in a block
+		 * @return	Pointer to the allocation
+		 */
+		void* PlaceAllocation(u8* pBlock, void* pBase, sizeT size, sizeT alignment, AllocationOrigin origin, u8 sizeClass, u8 scope)
+		{
+			// Vulkan alignments are powers of 2
+			u8* pMemory = (u8*)((uintptr_t(pBlock + sizeof(AllocationHeader)) + alignment - 1) & ~(uintptr_t(alignment) - 1));
+			AllocationHeader* pHeader = (AllocationHeader*)pMemory - 1;
+			pHeader->pBase = pBase;
+			pHeader->size = size;
+			pHeader->origin = origin;
+			pHeader->sizeClass = sizeClass;
+			pHeader->scope = scope;
+			return pMemory;
+		}
+
+	}
+
+	VulkanHostAllocator::VulkanHostAllocator()
+	{
+		for (SizeClass& sizeClass : m_SizeClasses)
+		{
+			sizeClass.pFreeList = nullptr;
+		}
+		for (ScopeStats& stats : m_Stats)
+		{
+			stats.allocationCount.store(0);
+			stats.allocatedSize.store(0);
+			stats.totalAllocationCount.store(0);
+			stats.internalAllocatedSize.store(0);
+		}
+	}
+
+	VulkanHostAllocator::~VulkanHostAllocator()
+	{
+		for (SizeClass& sizeClass : m_SizeClasses)
+		{
+			for (void* pSlab : sizeClass.slabs)
+			{
+				free(pSlab);
+			}
+			sizeClass.slabs.clear();
+			sizeClass.pFreeList = nullptr;
+		}
+	}
+
+	void VulkanHostAllocator::GetCallbacks(VkAllocationCallbacks& callbacks)
+	{
+		callbacks.pUserData = this;
+		callbacks.pfnAllocation = &VulkanAlloc;
+		callbacks.pfnReallocation = &VulkanRealloc;
+		callbacks.pfnFree = &VulkanFree;
+		callbacks.pfnInternalAllocation = &VulkanInternAlloc;
+		callbacks.pfnInternalFree = &VulkanInternFree;
+	}
+
+	VulkanHostAllocationStats VulkanHostAllocator::GetStats(VkSystemAllocationScope scope) const
+	{
+		const ScopeStats& scopeStats = m_Stats[u32(scope) < ScopeCount ? u32(scope) : ScopeCount - 1];
+		VulkanHostAllocationStats stats;
+		stats.allocationCount = scopeStats.allocationCount.load();
+		stats.allocatedSize = scopeStats.allocatedSize.load();
+		stats.totalAllocationCount = scopeStats.totalAllocationCount.load();
+		stats.internalAllocatedSize = scopeStats.internalAllocatedSize.load();
+		return stats;
+	}
+
+	void* VulkanHostAllocator::Allocate(sizeT size, sizeT alignment, VkSystemAllocationScope scope)
+	{
+		if (size == 0)
+			return nullptr;
+
+		alignment = std::max(alignment, sizeT(alignof(AllocationHeader)));
+		sizeT blockSize = size + sizeof(AllocationHeader) + alignment - 1;
+		u8 scopeIndex = u8(u32(scope) < ScopeCount ? u32(scope) : ScopeCount - 1);
+
+		void* pMemory = nullptr;
+		if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+		{
+			// An empty arena can be replaced by a larger one, so it grows to fit the largest command allocations
+			CommandArena& arena = g_CommandArena;
+			if (arena.liveCount == 0 && arena.capacity < blockSize && blockSize <= CommandArenaMaxCapacity)
+			{
+				sizeT capacity = std::max(std::max(arena.capacity * 2, CommandArenaMinCapacity), blockSize);
+				u8* pArenaMemory = (u8*)malloc(capacity);
+				if (pArenaMemory)
+				{
+					free(arena.pMemory);
+					arena.pMemory = pArenaMemory;
+					arena.capacity = capacity;
+					arena.offset = 0;
+				}
+			}
+			if (arena.offset + blockSize <= arena.capacity)
+			{
+				pMemory = PlaceAllocation(arena.pMemory + arena.offset, &arena, size, alignment, AllocationOrigin::CommandArena, 0, scopeIndex);
+				arena.offset = (u8*)pMemory + size - arena.pMemory;
+				++arena.liveCount;
+			}
+		}
+
+		if (!pMemory)
+		{
+			u32 sizeClass = 0;
+			while (sizeClass < SizeClassCount && (sizeT(1) << (MinSizeClassShift + sizeClass)) < blockSize)
+				++sizeClass;
+
+			if (sizeClass < SizeClassCount)
+			{
+				void* pBlock = TakeBlock(sizeClass);
+				if (!pBlock)
+					return nullptr;
+				pMemory = PlaceAllocation((u8*)pBlock, pBlock, size, alignment, AllocationOrigin::Pool, u8(sizeClass), scopeIndex);
+			}
+			else
+			{
+				void* pBlock = malloc(blockSize);
+				if (!pBlock)
+					return nullptr;
+				pMemory = PlaceAllocation((u8*)pBlock, pBlock, size, alignment, AllocationOrigin::System, 0, scopeIndex);
+			}
+		}
+
+		ScopeStats& stats = m_Stats[scopeIndex];
+		++stats.allocationCount;
+		stats.allocatedSize += size;
+		++stats.totalAllocationCount;
+		return pMemory;
+	}
+
+	void VulkanHostAllocator::Free(void* pMemory)
+	{
+		if (!pMemory)
+			return;
+
+		AllocationHeader* pHeader = (AllocationHeader*)pMemory - 1;
+		ScopeStats& stats = m_Stats[pHeader->scope];
+		--stats.allocationCount;
+		stats.allocatedSize -= pHeader->size;
+
+		switch (pHeader->origin)
+		{
+		case AllocationOrigin::CommandArena:
+		{
+			// Command scope allocations are freed before the vulkan call returns, so the arena is empty again after every call
+			CommandArena* pArena = (CommandArena*)pHeader->pBase;
+			if (--pArena->liveCount == 0)
+				pArena->offset = 0;
+			break;
+		}
+		case AllocationOrigin::Pool:
+			ReturnBlock(pHeader->sizeClass, pHeader->pBase);
+			break;
+		default:
+			free(pHeader->pBase);
+			break;
+		}
+	}
+
+	sizeT VulkanHostAllocator::GetSize(void* pMemory)
+	{
+		return ((AllocationHeader*)pMemory - 1)->size;
+	}
+
+	void* VulkanHostAllocator::TakeBlock(u32 sizeClass)
+	{
+		SizeClass& pool = m_SizeClasses[sizeClass];
+		std::lock_guard<std::mutex> lock(pool.mutex);
+
+		if (!pool.pFreeList)
+		{
+			u8* pSlab = (u8*)malloc(SlabSize);
+			if (!pSlab)
+				return nullptr;
+			pool.slabs.push_back(pSlab);
+
+			// Link all blocks of the new slab into the free list
+			sizeT blockSize = sizeT(1) << (MinSizeClassShift + sizeClass);
+			for (sizeT offset = 0; offset + blockSize <= SlabSize; offset += blockSize)
+			{
+				void* pBlock = pSlab + offset;
+				*(void**)pBlock = pool.pFreeList;
+				pool.pFreeList = pBlock;
+			}
+		}
+
+		void* pBlock = pool.pFreeList;
+		pool.pFreeList = *(void**)pBlock;
+		return pBlock;
+	}
+
+	void VulkanHostAllocator::ReturnBlock(u32 sizeClass, void* pBlock)
+	{
+		SizeClass& pool = m_SizeClasses[sizeClass];
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		*(void**)pBlock = pool.pFreeList;
+		pool.pFreeList = pBlock;
+	}
+
+	VKAPI_ATTR void* VKAPI_CALL VulkanHostAllocator::VulkanAlloc(void* pUserData, sizeT size, sizeT alignment, VkSystemAllocationScope scope)
+	{
+		return ((VulkanHostAllocator*)pUserData)->Allocate(size, alignment, scope);
+	}
+
+	VKAPI_ATTR void* VKAPI_CALL VulkanHostAllocator::VulkanRealloc(void* pUserData, void* pOriginal, sizeT size, sizeT alignment, VkSystemAllocationScope scope)
+	{
+		VulkanHostAllocator* pAllocator = (VulkanHostAllocator*)pUserData;
+		if (!pOriginal)
+			return pAllocator->Allocate(size, alignment, scope);
+		if (size == 0)
+		{
+			pAllocator->Free(pOriginal);
+			return nullptr;
+		}
+
+		// The original allocation stays valid when the new allocation fails
+		void* pMemory = pAllocator->Allocate(size, alignment, scope);
+		if (!pMemory)
+			return nullptr;
+		memcpy(pMemory, pOriginal, std::min(size, GetSize(pOriginal)));
+		pAllocator->Free(pOriginal);
+		return pMemory;
+	}
+
+	VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::VulkanFree(void* pUserData, void* pMemory)
+	{
+		((VulkanHostAllocator*)pUserData)->Free(pMemory);
+	}
+
+	VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::VulkanInternAlloc(void* pUserData, sizeT size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+	{
+		// Notification of memory the driver allocated itself
+		VulkanHostAllocator* pAllocator = (VulkanHostAllocator*)pUserData;
+		pAllocator->m_Stats[u32(scope) < ScopeCount ? u32(scope) : ScopeCount - 1].internalAllocatedSize += size;
+	}
+
+	VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::VulkanInternFree(void* pUserData, sizeT size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+	{
+		VulkanHostAllocator* pAllocator = (VulkanHostAllocator*)pUserData;
+		pAllocator->m_Stats[u32(scope) < ScopeCount ? u32(scope) : ScopeCount - 1].internalAllocatedSize -= size;
+	}
+
+}
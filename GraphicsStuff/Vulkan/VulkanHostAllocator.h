@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "../General/TypesAndMacros.h"
+
+namespace Vulkan {
+
+	/**
+	 * Host memory statistics of an allocation scope
+	 */
+	struct VulkanHostAllocationStats
+	{
+		u64 allocationCount;		/**< Amount of live allocations */
+		u64 allocatedSize;			/**< Size of the live allocations, as requested by the driver */
+		u64 totalAllocationCount;	/**< Amount of allocations made since creation */
+		u64 internalAllocatedSize;	/**< Size of the live internal allocations the driver made itself and reported */
+	};
+
+	/**
+	 * Host allocator used for the vulkan allocation callbacks, allocations are served depending on their scope:
+	 * - command scope allocations only live during a single vulkan call and come from a per thread bump arena, which is reset when all its allocations are freed
+	 * - other scopes come from thread safe size-class pools, large allocations go to the system allocator
+	 */
+	class VulkanHostAllocator final
+	{
+	public:
+		VulkanHostAllocator();
+		~VulkanHostAllocator();
+
+		/**
+		 * Fill in vulkan allocation callbacks that allocate from this allocator
+		 * @param[out] callbacks	Vulkan allocation callbacks
+		 */
+		void GetCallbacks(VkAllocationCallbacks& callbacks);
+		/**
+		 * Get the statistics of an allocation scope
+		 * @param[in] scope	Allocation scope
+		 * @return			Allocation statistics
+		 */
+		VulkanHostAllocationStats GetStats(VkSystemAllocationScope scope) const;
+
+	private:
+		static const u32 ScopeCount = 5;			/**< Amount of allocation scopes (command, object, cache, device, instance) */
+		static const u32 MinSizeClassShift = 5;		/**< Log2 of the smallest size class */
+		static const u32 SizeClassCount = 9;		/**< Amount of size classes, from 32 bytes to 8 KiB */
+		static const sizeT SlabSize = 64 * 1024;	/**< Size of a slab that pool blocks are carved from */
+
+		/**
+		 * Pool of fixed size blocks
+		 */
+		struct SizeClass
+		{
+			std::mutex mutex;				/**< Guards the free list and slabs */
+			void* pFreeList;				/**< First free block, each free block stores a pointer to the next one */
+			std::vector<void*> slabs;		/**< Slabs the blocks were carved from */
+		};
+
+		/**
+		 * Per scope statistics
+		 */
+		struct ScopeStats
+		{
+			std::atomic<u64> allocationCount;		/**< Amount of live allocations */
+			std::atomic<u64> allocatedSize;			/**< Size of the live allocations */
+			std::atomic<u64> totalAllocationCount;	/**< Amount of allocations made since creation */
+			std::atomic<u64> internalAllocatedSize;	/**< Size of the live internal allocations */
+		};
+
+		/**
+		 * Allocate host memory
+		 * @param[in] size		Size of the allocation
+		 * @param[in] alignment	Alignment of the allocation
+		 * @param[in] scope		Allocation scope
+		 * @return				Pointer to the memory, nullptr if the allocation failed
+		 */
+		void* Allocate(sizeT size, sizeT alignment, VkSystemAllocationScope scope);
+		/**
+		 * Free host memory
+		 * @param[in] pMemory	Memory to free, may be nullptr
+		 */
+		void Free(void* pMemory);
+		/**
+		 * Get the size of the memory returned by an allocation
+		 * @param[in] pMemory	Memory
+		 * @return				Size of the memory, as requested
+		 */
+		static sizeT GetSize(void* pMemory);
+
+		/**
+		 * Take a block from a size class, a new slab is allocated when the free list is empty
+		 * @param[in] sizeClass	Index of the size class
+		 * @return				Block, nullptr if the allocation failed
+		 */
+		void* TakeBlock(u32 sizeClass);
+		/**
+		 * Return a block to its size class
+		 * @param[in] sizeClass	Index of the size class
+		 * @param[in] pBlock	Block
+		 */
+		void ReturnBlock(u32 sizeClass, void* pBlock);
+
+		// Vulkan allocation callbacks, the user data is the host allocator
+		static VKAPI_ATTR void* VKAPI_CALL VulkanAlloc(void* pUserData, sizeT size, sizeT alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void* VKAPI_CALL VulkanRealloc(void* pUserData, void* pOriginal, sizeT size, sizeT alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL VulkanFree(void* pUserData, void* pMemory);
+		static VKAPI_ATTR void VKAPI_CALL VulkanInternAlloc(void* pUserData, sizeT size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL VulkanInternFree(void* pUserData, sizeT size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+		SizeClass m_SizeClasses[SizeClassCount];	/**< Size class pools */
+		ScopeStats m_Stats[ScopeCount];				/**< Statistics by allocation scope */
+	};
+
+}
@@ -98,6 +98,11 @@ namespace Vulkan {
 		 * @return	Vulkan instance
 		 */
 		VkInstance GetInstance() { return m_Instance; }
+		/**
+		 * Get the vulkan api version the instance was created with
+		 * @return	Vulkan api version
+		 */
+		u32 GetApiVersion() const { return m_VulkanApiVersion; }
 
 		////////////////////////////////////////////////////////////////////////////////
 #ifdef VK_USE_PLATFORM_WIN32_KHR
@@ -1,19 +1,112 @@
 #pragma once
+#include <algorithm>
+#include <fstream>
+#include <iterator>
 #include <vulkan/vulkan.h>
 
 #include "VulkanMemory.h"
 #include "VulkanDevice.h"
 #include "VulkanContext.h"
 #include "VulkanPhysicalDevice.h"
+#include "VulkanInstance.h"
+#include "VulkanBuffer.h"
+#include "VulkanTexture.h"
+#include "VulkanHostAllocator.h"
 
 namespace Vulkan {
 
+	namespace {
+
+		/**
+		 * Add the statistics of a block, memory type or heap to other statistics
+		 */
+		void AddStats(VulkanMemoryStats& stats, const VulkanMemoryStats& other)
+		{
+			stats.blockCount += other.blockCount;
+			stats.allocationCount += other.allocationCount;
+			stats.dedicatedCount += other.dedicatedCount;
+			stats.freeRangeCount += other.freeRangeCount;
+			stats.memorySize += other.memorySize;
+			stats.usedSize += other.usedSize;
+			stats.freeSize += other.freeSize;
+			stats.largestFreeRange = std::max(stats.largestFreeRange, other.largestFreeRange);
+		}
+
+		/**
+		 * Write a string as a json string, escaping quotes, backslashes and control characters
+		 */
+		void WriteJsonString(std::ofstream& stream, const std::string& str)
+		{
+			static const char* hexDigits = "0123456789abcdef";
+			stream << '"';
+			for (char c : str)
+			{
+				if (c == '"' || c == '\\')
+					stream << '\\' << c;
+				else if (u8(c) < 0x20)
+					stream << "\\u00" << hexDigits[u8(c) >> 4] << hexDigits[u8(c) & 0xF];
+				else
+					stream << c;
+			}
+			stream << '"';
+		}
+
+		void WriteJsonStats(std::ofstream& stream, const VulkanMemoryStats& stats)
+		{
+			stream << "{ \"blockCount\": " << stats.blockCount
+				<< ", \"allocationCount\": " << stats.allocationCount
+				<< ", \"dedicatedCount\": " << stats.dedicatedCount
+				<< ", \"freeRangeCount\": " << stats.freeRangeCount
+				<< ", \"memorySize\": " << stats.memorySize
+				<< ", \"usedSize\": " << stats.usedSize
+				<< ", \"freeSize\": " << stats.freeSize
+				<< ", \"largestFreeRange\": " << stats.largestFreeRange << " }";
+		}
+
+		void WriteJsonAllocation(std::ofstream& stream, VulkanAllocation* pAllocation)
+		{
+			const char* pOwnerType = "none";
+			std::string name;
+			if (pAllocation->GetOwningBuffer())
+			{
+				pOwnerType = "buffer";
+				name = pAllocation->GetOwningBuffer()->GetDebugName();
+			}
+			else if (pAllocation->GetOwningTexture())
+			{
+				pOwnerType = "texture";
+				name = pAllocation->GetOwningTexture()->GetDebugName();
+			}
+
+			stream << "{ \"name\": ";
+			WriteJsonString(stream, name);
+			stream << ", \"owner\": \"" << pOwnerType << "\""
+				<< ", \"offset\": " << pAllocation->GetOffset()
+				<< ", \"size\": " << pAllocation->GetSize()
+				<< ", \"memoryType\": " << pAllocation->GetMemoryTypeIndex()
+				<< ", \"dedicated\": " << (pAllocation->IsDedicated() ? "true" : "false")
+				<< ", \"aliasCount\": " << pAllocation->GetAliasCount()
+				<< ", \"mapped\": " << (pAllocation->IsMapped() ? "true" : "false") << " }";
+		}
+
+	}
+
 	VulkanAllocation::VulkanAllocation()
 		: m_pContext(nullptr)
 		, m_Memory(VK_NULL_HANDLE)
 		, m_Size(0)
 		, m_Offset(0)
 		, m_HeapIndex()
+		, m_MemoryTypeIndex(0)
+		, m_AliasCount(0)
+		, m_IsDedicated(false)
+		, m_pBlock(nullptr)
+		, m_RangeSize(0)
+		, m_pHeapAllocation(nullptr)
+		, m_PlacedCount(0)
+		, m_pBuffer(nullptr)
+		, m_pTexture(nullptr)
+		, m_LastWriteFrame(u64(-1))
 		, m_IsMapped(false)
 		, m_MapMode(VulkanAllocationMapMode::Read)
 		, m_MapOffset(0)
@@ -59,23 +152,39 @@ namespace Vulkan {
 
 		VulkanDevice* pDevice = m_pContext->GetDevice();
 
-		if (m_MapMode == VulkanAllocationMapMode::Read)
+		void* data;
+		VkResult vkres;
+		if (m_pBlock)
+		{
+			// A vulkan memory object can only be mapped once, so sub-allocations share the mapping of their block
+			void* pBlockData = m_pContext->GetAllocator()->MapBlock(m_pBlock);
+			if (!pBlockData)
+			{
+				m_IsMapped = false;
+				return nullptr;
+			}
+			data = (u8*)pBlockData + m_Offset + m_MapOffset;
+		}
+		else
 		{
-			// Invlidate memory
-			VkMappedMemoryRange range = {};
-			range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-			range.memory = m_Memory;
-			range.offset = m_Offset + m_MapOffset;
-			range.size = m_Size;
-			pDevice->vkInvalidateMappedMemoryRanges(range);
+			vkres = pDevice->VkMapMemory(m_Memory, m_Offset + m_MapOffset, m_MapSize, &data);
+			if (vkres != VK_SUCCESS)
+			{
+				//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to map vulkan memory (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+				m_IsMapped = false;
+				return nullptr;
+			}
 		}
 
-		void* data;
-		VkResult vkres = pDevice->VkMapMemory(m_Memory, m_Offset + m_MapOffset, m_MapSize, &data);
-		if (vkres != VK_SUCCESS)
+		if (m_MapMode == VulkanAllocationMapMode::Read)
 		{
-			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to map vulkan memory (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
-			return nullptr;
+			// Invalidate memory, the range needs to be mapped, so this has to happen after mapping
+			VkMappedMemoryRange range = GetMappedRange();
+			vkres = pDevice->vkInvalidateMappedMemoryRanges(range);
+			if (vkres != VK_SUCCESS)
+			{
+				//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to invalidate vulkan memory (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			}
 		}
 
 		return data;
@@ -89,31 +198,7 @@ namespace Vulkan {
 		if (m_MapMode == VulkanAllocationMapMode::Write)
 		{
 			// Flush memory
-			VkMappedMemoryRange range = {};
-			range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-			range.memory = m_Memory;
-			range.offset = m_Offset + m_MapOffset;
-			range.size = m_MapSize;
-
-			VkDeviceSize atomSize = m_pContext->GetSelectedPhysicalDevice()->GetLimits().nonCoherentAtomSize;
-			VkDeviceSize atomMask = atomSize - 1;
-
-			VkDeviceSize frontPad = range.offset & atomMask;
-			if (frontPad > 0)
-			{
-				range.offset -= frontPad;
-				range.size += frontPad;
-			}
-			VkDeviceSize backPad = (range.offset + range.size) & atomMask;
-			if (backPad > 0)
-			{
-				VkDeviceSize pad = atomSize - backPad;
-				range.size += pad;
-			}
-
-			if (range.offset + range.size >= m_MapSize)
-				range.size = VK_WHOLE_SIZE;
-
+			VkMappedMemoryRange range = GetMappedRange();
 			vkres = pDevice->vkFlushMappedMemoryRanges(range);
 			if (vkres != VK_SUCCESS)
 			{
@@ -121,16 +206,66 @@ namespace Vulkan {
 			}
 		}
 
-		pDevice->VkUnmapMemory(m_Memory);
+		if (m_pBlock)
+			m_pContext->GetAllocator()->UnmapBlock(m_pBlock);
+		else
+			pDevice->VkUnmapMemory(m_Memory);
 
 		m_IsMapped = false;
 
 		return vkres == VK_SUCCESS;
 	}
 
+	VkMappedMemoryRange VulkanAllocation::GetMappedRange()
+	{
+		VkMappedMemoryRange range = {};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = m_Memory;
+		range.offset = m_Offset + m_MapOffset;
+		range.size = m_MapSize;
+
+		VkDeviceSize atomSize = m_pContext->GetSelectedPhysicalDevice()->GetLimits().nonCoherentAtomSize;
+		VkDeviceSize atomMask = atomSize - 1;
+
+		VkDeviceSize frontPad = range.offset & atomMask;
+		if (frontPad > 0)
+		{
+			range.offset -= frontPad;
+			range.size += frontPad;
+		}
+		VkDeviceSize backPad = (range.offset + range.size) & atomMask;
+		if (backPad > 0)
+		{
+			VkDeviceSize pad = atomSize - backPad;
+			range.size += pad;
+		}
+
+		// Sub-allocations map their whole block, so padding may reach into neighbouring allocations, but not past the end of the block
+		VkDeviceSize memorySize = m_pBlock ? m_pBlock->size : m_Offset + m_Size;
+		if (range.offset + range.size >= memorySize)
+			range.size = VK_WHOLE_SIZE;
+
+		return range;
+	}
+
+	void VulkanAllocation::MarkWritten()
+	{
+		m_LastWriteFrame = m_pContext->GetFrameIndex();
+	}
+
+	b8 VulkanAllocation::IsBeingWritten() const
+	{
+		return m_LastWriteFrame != u64(-1) && !m_pContext->IsFrameComplete(m_LastWriteFrame);
+	}
+
 	VulkanAllocator::VulkanAllocator()
 		: m_pContext(nullptr)
 		, m_MemProperties()
+		, m_DedicatedThreshold(32 * 1024 * 1024)
+		, m_PreferredBlockSize(64 * 1024 * 1024)
+#ifdef VK_EXT_memory_budget
+		, m_pfnGetMemoryProperties2(nullptr)
+#endif
 	{
 	}
 
@@ -155,6 +290,12 @@ namespace Vulkan {
 			m_HeapInfo.push_back(info);
 		}
 
+#ifdef VK_EXT_memory_budget
+		if (pDevice->IsExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+			m_pfnGetMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(m_pContext->GetInstance()->GetInstance(), "vkGetPhysicalDeviceMemoryProperties2KHR");
+#endif
+		UpdateBudgets();
+
 		return true;
 	}
 
@@ -169,34 +310,173 @@ namespace Vulkan {
 		return true;
 	}
 
-	VulkanAllocation* VulkanAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags memProps)
+	VulkanAllocation* VulkanAllocator::Allocate(const VkMemoryRequirements& requirements, VulkanMemoryUsage usage)
+	{
+		// The resource type is unknown, so treat it as an image, which has the strictest placement rules
+		return Allocate(requirements, usage, requirements.size >= m_DedicatedThreshold, nullptr, nullptr, true);
+	}
+
+	VulkanAllocation* VulkanAllocator::AllocateForBuffer(VkBuffer buffer, VulkanMemoryUsage usage)
+	{
+		VulkanDevice* pDevice = m_pContext->GetDevice();
+
+		VkMemoryRequirements requirements = {};
+		b8 dedicated = false;
+		if (pDevice->IsMemoryRequirements2Supported())
+		{
+			VkBufferMemoryRequirementsInfo2 info = {};
+			info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+			info.buffer = buffer;
+			VkMemoryDedicatedRequirements dedicatedRequirements = {};
+			dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+			VkMemoryRequirements2 requirements2 = {};
+			requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+			requirements2.pNext = &dedicatedRequirements;
+			pDevice->vkGetBufferMemoryRequirements2(info, requirements2);
+
+			requirements = requirements2.memoryRequirements;
+			dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+		}
+		else
+		{
+			pDevice->vkGetBufferMemoryRequirements(buffer, requirements);
+		}
+		dedicated |= requirements.size >= m_DedicatedThreshold;
+
+		VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+		dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+		dedicatedInfo.buffer = buffer;
+		return Allocate(requirements, usage, dedicated, pDevice->IsMemoryRequirements2Supported() ? &dedicatedInfo : nullptr, nullptr, false);
+	}
+
+	VulkanAllocation* VulkanAllocator::AllocateForImage(VkImage image, VulkanMemoryUsage usage, u64 aliasKey)
 	{
 		VulkanDevice* pDevice = m_pContext->GetDevice();
+
+		VkMemoryRequirements requirements = {};
+		b8 dedicated = false;
+		b8 requiresDedicated = false;
+		if (pDevice->IsMemoryRequirements2Supported())
+		{
+			VkImageMemoryRequirementsInfo2 info = {};
+			info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+			info.image = image;
+			VkMemoryDedicatedRequirements dedicatedRequirements = {};
+			dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+			VkMemoryRequirements2 requirements2 = {};
+			requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+			requirements2.pNext = &dedicatedRequirements;
+			pDevice->vkGetImageMemoryRequirements2(info, requirements2);
+
+			requirements = requirements2.memoryRequirements;
+			dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+			requiresDedicated = dedicatedRequirements.requiresDedicatedAllocation != VK_FALSE;
+		}
+		else
+		{
+			pDevice->vkGetImageMemoryRequirements(image, requirements);
+		}
+		dedicated |= requirements.size >= m_DedicatedThreshold;
+
+		VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+		dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+		dedicatedInfo.image = image;
+		return Allocate(requirements, usage, dedicated, pDevice->IsMemoryRequirements2Supported() ? &dedicatedInfo : nullptr, requiresDedicated ? nullptr : &aliasKey, true);
+	}
+
+	VulkanAllocation* VulkanAllocator::Allocate(const VkMemoryRequirements& requirements, VulkanMemoryUsage usage,
+		b8 dedicated, const VkMemoryDedicatedAllocateInfo* pDedicatedInfo, const u64* pAliasKey, b8 forImage)
+	{
+		std::vector<u32> types = GetMemoryTypes(requirements, usage);
+		if (types.size() == 0)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "No memory type matches the requested memory usage!");
+			return nullptr;
+		}
+
+		// Without lazily allocated memory, transient attachments with the same description share memory, their contents never outlive a render pass
+		b8 alias = usage == VulkanMemoryUsage::Transient && pAliasKey && (m_MemProperties.memoryTypes[types[0]].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) == 0;
+		if (alias)
+		{
+			auto it = m_TransientAllocations.find(*pAliasKey);
+			if (it != m_TransientAllocations.end())
+			{
+				VulkanAllocation* pTransient = it->second;
+				if ((requirements.memoryTypeBits & (1 << pTransient->m_MemoryTypeIndex)) && pTransient->m_Size >= requirements.size)
+				{
+					++pTransient->m_AliasCount;
+					return pTransient;
+				}
+				alias = false;
+			}
+			// Shared memory isn't dedicated to a single resource
+			dedicated = false;
+		}
+
+		// Give the eviction callbacks a chance to release memory before going over budget, types that fit in their budget score higher, so this only happens when none of them fit
+		u32 heapIndex = m_MemProperties.memoryTypes[types[0]].heapIndex;
+		VkDeviceSize heapUsage = GetHeapUsage(heapIndex);
+		if (heapUsage + requirements.size > m_HeapInfo[heapIndex].budget)
+			m_pContext->RequestEviction(heapIndex, heapUsage + requirements.size - m_HeapInfo[heapIndex].budget);
+
 		VulkanAllocation* pAllocation = new VulkanAllocation();
 
-		auto type = GetMemoryType(requirements, memProps);
+		// Tell the driver which resource a dedicated allocation is for, so it can apply resource specific optimizations like render target compression
+		const void* pNext = dedicated ? pDedicatedInfo : nullptr;
 
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = requirements.size;
-		allocInfo.memoryTypeIndex = type.first;
-		VkResult vkres = pDevice->vkAllocateMemory(allocInfo, pAllocation->m_Memory);
+		// Small allocations are sub-allocated from blocks, large and dedicated allocations get their own memory
+		auto allocateFromType = [&](u32 index) -> VkResult
+		{
+			if (!dedicated && requirements.size <= GetBlockSize(index) / 2)
+				return AllocateFromBlocks(requirements, index, forImage, pAllocation);
+			return AllocateMemory(requirements, index, pNext, pAllocation->m_Memory);
+		};
+
+		// Fall back to worse memory types when the better ones are out of memory
+		VkResult vkres = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+		u32 typeIndex = u32(-1);
+		for (u32 index : types)
+		{
+			vkres = allocateFromType(index);
+			if (vkres != VK_ERROR_OUT_OF_DEVICE_MEMORY && vkres != VK_ERROR_OUT_OF_HOST_MEMORY)
+			{
+				typeIndex = index;
+				break;
+			}
+		}
+		if (vkres == VK_ERROR_OUT_OF_DEVICE_MEMORY || vkres == VK_ERROR_OUT_OF_HOST_MEMORY)
+		{
+			// Retry the best type once if the eviction callbacks managed to release memory
+			if (m_pContext->RequestEviction(heapIndex, requirements.size) > 0)
+			{
+				typeIndex = types[0];
+				vkres = allocateFromType(typeIndex);
+			}
+		}
 		if (vkres != VK_SUCCESS)
 		{
 			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to allocate vulkan memory (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
-			return false;
+			delete pAllocation;
+			return nullptr;
 		}
 
 		pAllocation->m_pContext = m_pContext;
-		pAllocation->m_Offset = 0;
 		pAllocation->m_Size = requirements.size;
+		pAllocation->m_IsDedicated = dedicated;
+		pAllocation->m_MemoryTypeIndex = typeIndex;
+		pAllocation->m_HeapIndex = m_MemProperties.memoryTypes[typeIndex].heapIndex;
+		pAllocation->m_AliasCount = 1;
 
 		m_Allocations.push_back(pAllocation);
+		if (alias)
+			m_TransientAllocations[*pAliasKey] = pAllocation;
 
-		// Update heap info
-		pAllocation->m_HeapIndex = type.second.heapIndex;
-		HeapInfo& heap = m_HeapInfo[pAllocation->m_HeapIndex];
-		heap.usedSize += pAllocation->m_Size;
+		// Update heap info, the memory of sub-allocations was already counted when their block was allocated
+		if (!pAllocation->m_pBlock)
+		{
+			HeapInfo& heap = m_HeapInfo[pAllocation->m_HeapIndex];
+			heap.usedSize += pAllocation->m_Size;
+		}
 		
 		return pAllocation;
 	}
@@ -212,16 +492,148 @@ namespace Vulkan {
 			return;
 		}
 
-		pDevice->vkFreeMemory(pAllocation->m_Memory);
+		if (pAllocation->m_AliasCount > 1)
+		{
+			--pAllocation->m_AliasCount;
+			return;
+		}
+		if (pAllocation->m_PlacedCount > 0)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to free a vulkan allocation, %u resources are still placed in it!", pAllocation->m_PlacedCount);
+			return;
+		}
+		for (auto transientIt = m_TransientAllocations.begin(); transientIt != m_TransientAllocations.end(); ++transientIt)
+		{
+			if (transientIt->second == pAllocation)
+			{
+				m_TransientAllocations.erase(transientIt);
+				break;
+			}
+		}
+
+		if (pAllocation->m_pHeapAllocation)
+		{
+			// The memory belongs to the heap
+			--pAllocation->m_pHeapAllocation->m_PlacedCount;
+		}
+		else if (pAllocation->m_pBlock)
+		{
+			VulkanMemoryBlock* pBlock = pAllocation->m_pBlock;
+			ReleaseRange(pAllocation);
+
+			// Release empty blocks, so memory of destroyed resources returns to the heap
+			if (pBlock->allocations.size() == 0)
+			{
+				if (pBlock->pMapped)
+					pDevice->VkUnmapMemory(pBlock->memory);
+				pDevice->vkFreeMemory(pBlock->memory);
+
+				HeapInfo& heap = m_HeapInfo[pAllocation->m_HeapIndex];
+				heap.usedSize -= pBlock->size;
 
-		HeapInfo& heap = m_HeapInfo[pAllocation->m_HeapIndex];
-		heap.usedSize += pAllocation->m_Size;
+				m_Blocks.erase(std::find(m_Blocks.begin(), m_Blocks.end(), pBlock));
+				delete pBlock;
+			}
+		}
+		else
+		{
+			pDevice->vkFreeMemory(pAllocation->m_Memory);
+
+			HeapInfo& heap = m_HeapInfo[pAllocation->m_HeapIndex];
+			heap.usedSize -= pAllocation->m_Size;
+		}
 
 		delete pAllocation;
 
 		m_Allocations.erase(it);
 	}
 
+	VulkanAllocation* VulkanAllocator::AllocateInBlock(VulkanMemoryBlock* pBlock, const VkMemoryRequirements& requirements)
+	{
+		if ((requirements.memoryTypeBits & (1 << pBlock->memoryTypeIndex)) == 0)
+			return nullptr;
+
+		VulkanAllocation* pAllocation = new VulkanAllocation();
+		if (!TakeRange(pBlock, requirements, pAllocation))
+		{
+			delete pAllocation;
+			return nullptr;
+		}
+
+		pAllocation->m_pContext = m_pContext;
+		pAllocation->m_Size = requirements.size;
+		pAllocation->m_MemoryTypeIndex = pBlock->memoryTypeIndex;
+		pAllocation->m_HeapIndex = m_MemProperties.memoryTypes[pBlock->memoryTypeIndex].heapIndex;
+		pAllocation->m_AliasCount = 1;
+
+		m_Allocations.push_back(pAllocation);
+		return pAllocation;
+	}
+
+	VulkanAllocation* VulkanAllocator::AllocatePlaced(VulkanAllocation* pHeapAllocation, VkDeviceSize offset, const VkMemoryRequirements& requirements)
+	{
+		if ((requirements.memoryTypeBits & (1 << pHeapAllocation->m_MemoryTypeIndex)) == 0)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "The memory type of the heap can't be used for the resource!");
+			return nullptr;
+		}
+		if (offset + requirements.size > pHeapAllocation->m_Size)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "A resource placed in a heap can't go past the end of the heap!");
+			return nullptr;
+		}
+		// The heap allocation may itself be sub-allocated, so the alignment applies to the offset in the vulkan memory
+		VkDeviceSize memoryOffset = pHeapAllocation->m_Offset + offset;
+		if (requirements.alignment > 0 && memoryOffset % requirements.alignment != 0)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "A resource placed in a heap needs an offset that matches its alignment!");
+			return nullptr;
+		}
+
+		VulkanAllocation* pAllocation = new VulkanAllocation();
+		pAllocation->m_pContext = m_pContext;
+		pAllocation->m_Memory = pHeapAllocation->m_Memory;
+		pAllocation->m_Offset = memoryOffset;
+		pAllocation->m_Size = requirements.size;
+		pAllocation->m_MemoryTypeIndex = pHeapAllocation->m_MemoryTypeIndex;
+		pAllocation->m_HeapIndex = pHeapAllocation->m_HeapIndex;
+		pAllocation->m_AliasCount = 1;
+		pAllocation->m_pHeapAllocation = pHeapAllocation;
+		++pHeapAllocation->m_PlacedCount;
+
+		m_Allocations.push_back(pAllocation);
+		return pAllocation;
+	}
+
+	void* VulkanAllocator::MapBlock(VulkanMemoryBlock* pBlock)
+	{
+		if (pBlock->mapCount == 0)
+		{
+			VkResult vkres = m_pContext->GetDevice()->VkMapMemory(pBlock->memory, 0, VK_WHOLE_SIZE, &pBlock->pMapped);
+			if (vkres != VK_SUCCESS)
+			{
+				//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to map vulkan memory (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+				pBlock->pMapped = nullptr;
+				return nullptr;
+			}
+		}
+		++pBlock->mapCount;
+		return pBlock->pMapped;
+	}
+
+	void VulkanAllocator::UnmapBlock(VulkanMemoryBlock* pBlock)
+	{
+		if (pBlock->mapCount == 0)
+			return;
+
+		--pBlock->mapCount;
+		if (pBlock->mapCount == 0)
+		{
+			m_pContext->GetDevice()->VkUnmapMemory(pBlock->memory);
+			pBlock->pMapped = nullptr;
+		}
+	}
+
 	std::pair<u32, VkMemoryType> VulkanAllocator::GetMemoryType(const VkMemoryRequirements& requirements,
 		VkMemoryPropertyFlags memProps)
 	{
@@ -233,5 +645,456 @@ namespace Vulkan {
 		return std::pair<u32, VkMemoryType>(u32(-1), VkMemoryType());
 	}
 
+	std::vector<u32> VulkanAllocator::GetMemoryTypes(const VkMemoryRequirements& requirements, VulkanMemoryUsage usage)
+	{
+		std::vector<std::pair<i32, u32>> scores;
+		for (u32 i = 0; i < m_MemProperties.memoryTypeCount; ++i)
+		{
+			if ((requirements.memoryTypeBits & (1 << i)) == 0)
+				continue;
+			i32 score = ScoreMemoryType(i, usage, requirements.size);
+			if (score >= 0)
+				scores.push_back(std::pair<i32, u32>(score, i));
+		}
+
+		// Equal scores keep the order of the driver, which lists the better types first
+		std::stable_sort(scores.begin(), scores.end(), [](const std::pair<i32, u32>& a, const std::pair<i32, u32>& b)
+		{
+			return a.first > b.first;
+		});
+
+		std::vector<u32> types;
+		types.reserve(scores.size());
+		for (const std::pair<i32, u32>& score : scores)
+			types.push_back(score.second);
+		return types;
+	}
+
+	i32 VulkanAllocator::ScoreMemoryType(u32 typeIndex, VulkanMemoryUsage usage, VkDeviceSize size) const
+	{
+		const VkMemoryType& type = m_MemProperties.memoryTypes[typeIndex];
+		VkMemoryPropertyFlags flags = type.propertyFlags;
+
+		// Lazily allocated memory can only back transient attachments and protected memory needs protected queues
+		if (flags & VK_MEMORY_PROPERTY_PROTECTED_BIT)
+			return -1;
+		b8 lazilyAllocated = (flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+		if (lazilyAllocated && usage != VulkanMemoryUsage::Transient)
+			return -1;
+
+		b8 deviceLocal = (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+		b8 hostVisible = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+		b8 hostCoherent = (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+		b8 hostCached = (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != 0;
+
+		if (usage != VulkanMemoryUsage::GpuOnly && usage != VulkanMemoryUsage::Transient && !hostVisible)
+			return -1;
+
+		i32 score = 1000;
+		switch (usage)
+		{
+		case VulkanMemoryUsage::GpuOnly:
+			if (deviceLocal)
+				score += 100;
+			// Leave host visible device local memory (often a small BAR heap) for dynamic data
+			if (hostVisible)
+				score -= 10;
+			break;
+		case VulkanMemoryUsage::Upload:
+			if (hostCoherent)
+				score += 50;
+			if (deviceLocal)
+				score -= 20;
+			if (hostCached)
+				score -= 10;
+			break;
+		case VulkanMemoryUsage::Readback:
+			// Uncached (write-combined) memory is very slow to read from the cpu
+			if (hostCached)
+				score += 100;
+			if (hostCoherent)
+				score += 10;
+			if (deviceLocal)
+				score -= 20;
+			break;
+		case VulkanMemoryUsage::Transient:
+			// Lazily allocated memory is only committed when a tile actually needs to spill to memory, which normally never happens
+			if (lazilyAllocated)
+				score += 200;
+			if (deviceLocal)
+				score += 100;
+			if (hostVisible)
+				score -= 10;
+			break;
+		case VulkanMemoryUsage::DynamicGpuRead:
+			if (deviceLocal)
+				score += 100;
+			if (hostCoherent)
+				score += 20;
+			if (hostCached)
+				score -= 10;
+			break;
+		}
+
+		// Prefer any type that still fits in its heap budget over a better type that doesn't
+		if (GetHeapUsage(type.heapIndex) + size > m_HeapInfo[type.heapIndex].budget)
+			score -= 500;
+
+		return score;
+	}
+
+	VkResult VulkanAllocator::AllocateFromBlocks(const VkMemoryRequirements& requirements, u32 typeIndex, b8 forImage,
+		VulkanAllocation* pAllocation)
+	{
+		// Try the fullest blocks first, which keeps the emptier blocks free to be released or defragmented
+		std::vector<VulkanMemoryBlock*> blocks;
+		for (VulkanMemoryBlock* pBlock : m_Blocks)
+		{
+			if (pBlock->memoryTypeIndex == typeIndex && pBlock->forImages == forImage)
+				blocks.push_back(pBlock);
+		}
+		std::sort(blocks.begin(), blocks.end(), [](const VulkanMemoryBlock* pA, const VulkanMemoryBlock* pB)
+		{
+			return pA->usedSize > pB->usedSize;
+		});
+		for (VulkanMemoryBlock* pBlock : blocks)
+		{
+			if (TakeRange(pBlock, requirements, pAllocation))
+				return VK_SUCCESS;
+		}
+
+		VulkanMemoryBlock* pBlock = new VulkanMemoryBlock();
+		VkMemoryRequirements blockRequirements = requirements;
+		blockRequirements.size = GetBlockSize(typeIndex);
+		VkResult vkres = AllocateMemory(blockRequirements, typeIndex, nullptr, pBlock->memory);
+		if (vkres != VK_SUCCESS)
+		{
+			delete pBlock;
+			return vkres;
+		}
+
+		pBlock->size = blockRequirements.size;
+		pBlock->usedSize = 0;
+		pBlock->memoryTypeIndex = typeIndex;
+		pBlock->forImages = forImage;
+		pBlock->freeRanges.push_back(std::pair<VkDeviceSize, VkDeviceSize>(0, pBlock->size));
+		pBlock->mapCount = 0;
+		pBlock->pMapped = nullptr;
+		m_Blocks.push_back(pBlock);
+
+		HeapInfo& heap = m_HeapInfo[m_MemProperties.memoryTypes[typeIndex].heapIndex];
+		heap.usedSize += pBlock->size;
+
+		TakeRange(pBlock, requirements, pAllocation);
+		return VK_SUCCESS;
+	}
+
+	b8 VulkanAllocator::TakeRange(VulkanMemoryBlock* pBlock, const VkMemoryRequirements& requirements, VulkanAllocation* pAllocation)
+	{
+		VkDeviceSize alignment = requirements.alignment > 0 ? requirements.alignment : 1;
+		VkDeviceSize sizeAlignment = 1;
+
+		// Linear and optimal images can't share a page of buffer image granularity, so images are padded to whole pages
+		const VkPhysicalDeviceLimits& limits = m_pContext->GetSelectedPhysicalDevice()->GetLimits();
+		if (pBlock->forImages)
+		{
+			alignment = std::max(alignment, limits.bufferImageGranularity);
+			sizeAlignment = std::max(sizeAlignment, limits.bufferImageGranularity);
+		}
+		// Flushing and invalidating non-coherent memory works on whole atoms, which should not overlap other allocations
+		VkMemoryPropertyFlags flags = m_MemProperties.memoryTypes[pBlock->memoryTypeIndex].propertyFlags;
+		if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
+		{
+			alignment = std::max(alignment, limits.nonCoherentAtomSize);
+			sizeAlignment = std::max(sizeAlignment, limits.nonCoherentAtomSize);
+		}
+		VkDeviceSize size = (requirements.size + sizeAlignment - 1) / sizeAlignment * sizeAlignment;
+
+		// Best fit, take the smallest free range the allocation fits in
+		sizeT bestIndex = sizeT(-1);
+		VkDeviceSize bestOffset = 0;
+		VkDeviceSize bestSize = VkDeviceSize(-1);
+		for (sizeT i = 0; i < pBlock->freeRanges.size(); ++i)
+		{
+			const std::pair<VkDeviceSize, VkDeviceSize>& range = pBlock->freeRanges[i];
+			VkDeviceSize offset = (range.first + alignment - 1) / alignment * alignment;
+			if (offset + size > range.first + range.second || range.second >= bestSize)
+				continue;
+
+			bestIndex = i;
+			bestOffset = offset;
+			bestSize = range.second;
+		}
+		if (bestIndex == sizeT(-1))
+			return false;
+
+		// Split the range, the padding in front of the allocation stays free
+		std::pair<VkDeviceSize, VkDeviceSize> range = pBlock->freeRanges[bestIndex];
+		pBlock->freeRanges.erase(pBlock->freeRanges.begin() + bestIndex);
+		VkDeviceSize backOffset = bestOffset + size;
+		VkDeviceSize backSize = range.first + range.second - backOffset;
+		if (backSize > 0)
+			pBlock->freeRanges.insert(pBlock->freeRanges.begin() + bestIndex, std::pair<VkDeviceSize, VkDeviceSize>(backOffset, backSize));
+		if (bestOffset > range.first)
+			pBlock->freeRanges.insert(pBlock->freeRanges.begin() + bestIndex, std::pair<VkDeviceSize, VkDeviceSize>(range.first, bestOffset - range.first));
+
+		pBlock->usedSize += size;
+		pBlock->allocations.push_back(pAllocation);
+
+		pAllocation->m_Memory = pBlock->memory;
+		pAllocation->m_Offset = bestOffset;
+		pAllocation->m_RangeSize = size;
+		pAllocation->m_pBlock = pBlock;
+		pAllocation->m_IsDedicated = false;
+		return true;
+	}
+
+	void VulkanAllocator::ReleaseRange(VulkanAllocation* pAllocation)
+	{
+		VulkanMemoryBlock* pBlock = pAllocation->m_pBlock;
+		std::vector<std::pair<VkDeviceSize, VkDeviceSize>>& ranges = pBlock->freeRanges;
+
+		std::pair<VkDeviceSize, VkDeviceSize> range(pAllocation->m_Offset, pAllocation->m_RangeSize);
+		auto it = std::lower_bound(ranges.begin(), ranges.end(), range);
+
+		// Merge with the neighbouring free ranges
+		if (it != ranges.end() && range.first + range.second == it->first)
+		{
+			range.second += it->second;
+			it = ranges.erase(it);
+		}
+		if (it != ranges.begin() && std::prev(it)->first + std::prev(it)->second == range.first)
+		{
+			std::prev(it)->second += range.second;
+		}
+		else
+		{
+			ranges.insert(it, range);
+		}
+
+		pBlock->usedSize -= pAllocation->m_RangeSize;
+		pBlock->allocations.erase(std::find(pBlock->allocations.begin(), pBlock->allocations.end(), pAllocation));
+	}
+
+	VkDeviceSize VulkanAllocator::GetBlockSize(u32 typeIndex) const
+	{
+		// Small heaps, like the host visible part of device local memory, would be used up by a few large blocks
+		VkDeviceSize heapSize = m_MemProperties.memoryHeaps[m_MemProperties.memoryTypes[typeIndex].heapIndex].size;
+		if (heapSize <= 1024ull * 1024 * 1024)
+			return heapSize / 8;
+		return m_PreferredBlockSize;
+	}
+
+	VkResult VulkanAllocator::AllocateMemory(const VkMemoryRequirements& requirements, u32 typeIndex, const void* pNext,
+		VkDeviceMemory& memory)
+	{
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.pNext = pNext;
+		allocInfo.allocationSize = requirements.size;
+		allocInfo.memoryTypeIndex = typeIndex;
+		return m_pContext->GetDevice()->vkAllocateMemory(allocInfo, memory);
+	}
+
+	void VulkanAllocator::UpdateBudgets()
+	{
+#ifdef VK_EXT_memory_budget
+		if (m_pfnGetMemoryProperties2)
+		{
+			VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+			budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+			VkPhysicalDeviceMemoryProperties2KHR properties2 = {};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+			properties2.pNext = &budgetProperties;
+			m_pfnGetMemoryProperties2(m_pContext->GetDevice()->GetPhysicalDevice()->GetPhysicalDevice(), &properties2);
+
+			for (u32 i = 0; i < m_HeapInfo.size(); ++i)
+			{
+				HeapInfo& heap = m_HeapInfo[i];
+				heap.budget = std::min(budgetProperties.heapBudget[i], heap.totalSize);
+				heap.driverUsage = budgetProperties.heapUsage[i];
+				heap.usedSizeAtUpdate = heap.usedSize;
+			}
+			return;
+		}
+#endif
+
+		// Without driver budgets, assume the process can use most of each heap
+		for (HeapInfo& heap : m_HeapInfo)
+		{
+			heap.budget = heap.totalSize / 10 * 8;
+			heap.driverUsage = heap.usedSize;
+			heap.usedSizeAtUpdate = heap.usedSize;
+		}
+	}
+
+	VkDeviceSize VulkanAllocator::GetHeapUsage(u32 heapIndex) const
+	{
+		const HeapInfo& heap = m_HeapInfo[heapIndex];
+		if (heap.driverUsage + heap.usedSize < heap.usedSizeAtUpdate)
+			return 0;
+		return heap.driverUsage + heap.usedSize - heap.usedSizeAtUpdate;
+	}
+
+	VulkanMemoryStats VulkanAllocator::GetBlockStats(const VulkanMemoryBlock* pBlock)
+	{
+		VulkanMemoryStats stats = {};
+		stats.blockCount = 1;
+		stats.allocationCount = u32(pBlock->allocations.size());
+		stats.freeRangeCount = u32(pBlock->freeRanges.size());
+		stats.memorySize = pBlock->size;
+		stats.usedSize = pBlock->usedSize;
+		stats.freeSize = pBlock->size - pBlock->usedSize;
+		for (const std::pair<VkDeviceSize, VkDeviceSize>& range : pBlock->freeRanges)
+		{
+			stats.largestFreeRange = std::max(stats.largestFreeRange, range.second);
+		}
+		return stats;
+	}
+
+	VulkanAllocatorStats VulkanAllocator::GetStats() const
+	{
+		VulkanAllocatorStats stats = {};
+		for (const VulkanMemoryBlock* pBlock : m_Blocks)
+		{
+			AddStats(stats.memoryTypes[pBlock->memoryTypeIndex], GetBlockStats(pBlock));
+		}
+		// Sub-allocations are already counted by their block, placed allocations by the allocation of their heap
+		for (const VulkanAllocation* pAllocation : m_Allocations)
+		{
+			if (pAllocation->m_pBlock || pAllocation->m_pHeapAllocation)
+				continue;
+
+			VulkanMemoryStats& typeStats = stats.memoryTypes[pAllocation->m_MemoryTypeIndex];
+			++typeStats.allocationCount;
+			++typeStats.dedicatedCount;
+			typeStats.memorySize += pAllocation->m_Size;
+			typeStats.usedSize += pAllocation->m_Size;
+		}
+
+		for (u32 i = 0; i < m_MemProperties.memoryTypeCount; ++i)
+		{
+			AddStats(stats.heaps[m_MemProperties.memoryTypes[i].heapIndex], stats.memoryTypes[i]);
+		}
+		for (u32 i = 0; i < m_MemProperties.memoryHeapCount; ++i)
+		{
+			AddStats(stats.total, stats.heaps[i]);
+		}
+		return stats;
+	}
+
+	b8 VulkanAllocator::DumpJson(const std::string& filePath) const
+	{
+		std::ofstream stream(filePath.c_str());
+		if (!stream.is_open())
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to open '%s' to dump the memory statistics!", filePath.c_str());
+			return false;
+		}
+
+		VulkanAllocatorStats stats = GetStats();
+		stream << "{\n";
+		stream << "\t\"frame\": " << m_pContext->GetFrameIndex() << ",\n";
+		stream << "\t\"total\": ";
+		WriteJsonStats(stream, stats.total);
+		stream << ",\n";
+
+		stream << "\t\"heaps\": [";
+		for (u32 i = 0; i < m_HeapInfo.size(); ++i)
+		{
+			const HeapInfo& heap = m_HeapInfo[i];
+			stream << (i == 0 ? "\n" : ",\n") << "\t\t{ \"index\": " << i
+				<< ", \"size\": " << heap.totalSize
+				<< ", \"flags\": " << heap.flags
+				<< ", \"budget\": " << heap.budget
+				<< ", \"usage\": " << GetHeapUsage(i)
+				<< ", \"stats\": ";
+			WriteJsonStats(stream, stats.heaps[i]);
+			stream << " }";
+		}
+		stream << "\n\t],\n";
+
+		stream << "\t\"memoryTypes\": [";
+		for (u32 i = 0; i < m_MemProperties.memoryTypeCount; ++i)
+		{
+			const VkMemoryType& type = m_MemProperties.memoryTypes[i];
+			stream << (i == 0 ? "\n" : ",\n") << "\t\t{ \"index\": " << i
+				<< ", \"heapIndex\": " << type.heapIndex
+				<< ", \"propertyFlags\": " << type.propertyFlags
+				<< ", \"stats\": ";
+			WriteJsonStats(stream, stats.memoryTypes[i]);
+			stream << " }";
+		}
+		stream << "\n\t],\n";
+
+		stream << "\t\"blocks\": [";
+		for (sizeT i = 0; i < m_Blocks.size(); ++i)
+		{
+			const VulkanMemoryBlock* pBlock = m_Blocks[i];
+			stream << (i == 0 ? "\n" : ",\n") << "\t\t{\n"
+				<< "\t\t\t\"memoryType\": " << pBlock->memoryTypeIndex << ",\n"
+				<< "\t\t\t\"forImages\": " << (pBlock->forImages ? "true" : "false") << ",\n"
+				<< "\t\t\t\"mapped\": " << (pBlock->pMapped ? "true" : "false") << ",\n"
+				<< "\t\t\t\"stats\": ";
+			WriteJsonStats(stream, GetBlockStats(pBlock));
+			stream << ",\n\t\t\t\"freeRanges\": [";
+			for (sizeT j = 0; j < pBlock->freeRanges.size(); ++j)
+			{
+				stream << (j == 0 ? " " : ", ") << "{ \"offset\": " << pBlock->freeRanges[j].first << ", \"size\": " << pBlock->freeRanges[j].second << " }";
+			}
+			stream << " ],\n\t\t\t\"allocations\": [";
+			for (sizeT j = 0; j < pBlock->allocations.size(); ++j)
+			{
+				stream << (j == 0 ? "\n" : ",\n") << "\t\t\t\t";
+				WriteJsonAllocation(stream, pBlock->allocations[j]);
+			}
+			stream << "\n\t\t\t]\n\t\t}";
+		}
+		stream << "\n\t],\n";
+
+		// Allocations that own their vulkan memory
+		stream << "\t\"dedicatedAllocations\": [";
+		b8 first = true;
+		for (VulkanAllocation* pAllocation : m_Allocations)
+		{
+			if (pAllocation->m_pBlock || pAllocation->m_pHeapAllocation)
+				continue;
+			stream << (first ? "\n" : ",\n") << "\t\t";
+			WriteJsonAllocation(stream, pAllocation);
+			first = false;
+		}
+		stream << "\n\t],\n";
+
+		// Allocations placed in memory heaps, their offset is the offset in the vulkan memory of the heap
+		stream << "\t\"placedAllocations\": [";
+		first = true;
+		for (VulkanAllocation* pAllocation : m_Allocations)
+		{
+			if (!pAllocation->m_pHeapAllocation)
+				continue;
+			stream << (first ? "\n" : ",\n") << "\t\t";
+			WriteJsonAllocation(stream, pAllocation);
+			first = false;
+		}
+		stream << "\n\t],\n";
+
+		// Host memory used by the driver, by allocation scope
+		static const char* scopeNames[] = { "command", "object", "cache", "device", "instance" };
+		VulkanHostAllocator* pHostAllocator = m_pContext->GetHostAllocator();
+		stream << "\t\"host\": [";
+		for (u32 i = 0; i < sizeof(scopeNames) / sizeof(scopeNames[0]); ++i)
+		{
+			VulkanHostAllocationStats hostStats = pHostAllocator->GetStats(VkSystemAllocationScope(i));
+			stream << (i == 0 ? "\n" : ",\n") << "\t\t{ \"scope\": \"" << scopeNames[i] << "\""
+				<< ", \"allocationCount\": " << hostStats.allocationCount
+				<< ", \"allocatedSize\": " << hostStats.allocatedSize
+				<< ", \"totalAllocationCount\": " << hostStats.totalAllocationCount
+				<< ", \"internalAllocatedSize\": " << hostStats.internalAllocatedSize << " }";
+		}
+		stream << "\n\t]\n";
+		stream << "}\n";
+
+		return stream.good();
+	}
 
 }
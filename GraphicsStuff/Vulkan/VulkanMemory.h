@@ -3,8 +3,10 @@
 // VulkanMemory.h: Vulkan memory functions
 #pragma once
 #include "../General/TypesAndMacros.h"
+#include <string>
 #include <utility>
 #include <vector>
+#include <unordered_map>
 
 namespace RHI {
 	class RHIContext;
@@ -13,12 +15,68 @@ namespace RHI {
 namespace Vulkan {
 
 	class VulkanContext;
+	class VulkanBuffer;
+	class VulkanTexture;
+	class VulkanAllocation;
 
 	enum class VulkanAllocationMapMode : u8
 	{
 		Write,			/**< Write to memory */
 		Read,			/**< Read from memory */
 	};
+
+	/**
+	 * Intended usage of an allocation, used to score the available memory types
+	 */
+	enum class VulkanMemoryUsage : u8
+	{
+		GpuOnly,		/**< Only accessed by the gpu, prefers device local memory */
+		Upload,			/**< Written by the cpu and copied to the gpu, prefers coherent host memory that isn't device local */
+		Readback,		/**< Written by the gpu and read by the cpu, prefers cached host memory */
+		DynamicGpuRead,	/**< Written by the cpu often and read by the gpu, prefers device local host visible memory */
+		Transient,		/**< Transient attachment, prefers lazily allocated memory, otherwise the memory is shared with transient attachments with the same description */
+	};
+
+	/**
+	 * Block of vulkan memory that allocations are sub-allocated from
+	 */
+	struct VulkanMemoryBlock
+	{
+		VkDeviceMemory memory;										/**< Device memory */
+		VkDeviceSize size;											/**< Size of the block */
+		VkDeviceSize usedSize;										/**< Size used by allocations, including alignment padding */
+		u32 memoryTypeIndex;										/**< Memory type index */
+		b8 forImages;												/**< If the block holds images, buffers and images use separate blocks so buffer image granularity only applies between images */
+		std::vector<std::pair<VkDeviceSize, VkDeviceSize>> freeRanges;	/**< Free ranges (offset, size), sorted by offset */
+		std::vector<VulkanAllocation*> allocations;				/**< Allocations in the block */
+		u32 mapCount;												/**< Amount of allocations that currently map the block */
+		void* pMapped;												/**< Mapped memory of the whole block, nullptr if not mapped */
+	};
+	
+	/**
+	 * Memory statistics of a block, memory type or heap
+	 */
+	struct VulkanMemoryStats
+	{
+		u32 blockCount;					/**< Amount of memory blocks */
+		u32 allocationCount;			/**< Amount of allocations, including dedicated allocations */
+		u32 dedicatedCount;				/**< Amount of allocations that own their vulkan memory */
+		u32 freeRangeCount;				/**< Amount of free ranges in the blocks, more ranges for the same free size means more fragmentation */
+		VkDeviceSize memorySize;		/**< Size of the vulkan memory, blocks and allocations that own their memory */
+		VkDeviceSize usedSize;			/**< Size used by allocations, including alignment padding */
+		VkDeviceSize freeSize;			/**< Free size in the blocks */
+		VkDeviceSize largestFreeRange;	/**< Size of the largest free range in a block */
+	};
+
+	/**
+	 * Memory statistics of the allocator
+	 */
+	struct VulkanAllocatorStats
+	{
+		VulkanMemoryStats total;							/**< Statistics of all memory */
+		VulkanMemoryStats memoryTypes[VK_MAX_MEMORY_TYPES];	/**< Statistics by memory type */
+		VulkanMemoryStats heaps[VK_MAX_MEMORY_HEAPS];		/**< Statistics by heap */
+	};
 	
 	class VulkanAllocation
 	{
@@ -55,15 +113,108 @@ namespace Vulkan {
 		 * @return	Memory size
 		 */
 		VkDeviceSize GetOffset() { return m_Offset; }
+		/**
+		 * Check if the allocation is dedicated to a single resource and owns its vulkan memory
+		 * @return	True if the allocation is dedicated, false otherwise
+		 */
+		b8 IsDedicated() const { return m_IsDedicated; }
+		/**
+		 * Check if the allocation is shared by multiple transient attachments
+		 * @return	True if the allocation is aliased, false otherwise
+		 */
+		b8 IsAliased() const { return m_AliasCount > 1; }
+		/**
+		 * Check if the memory is mapped
+		 * @return	True if the memory is mapped, false otherwise
+		 */
+		b8 IsMapped() const { return m_IsMapped; }
+		/**
+		 * Get the memory type index
+		 * @return	Memory type index
+		 */
+		u32 GetMemoryTypeIndex() const { return m_MemoryTypeIndex; }
+		/**
+		 * Get the amount of resources using the allocation
+		 * @return	Amount of resources
+		 */
+		u32 GetAliasCount() const { return m_AliasCount; }
+		/**
+		 * Get the memory block the allocation was sub-allocated from
+		 * @return	Memory block, nullptr if the allocation owns its vulkan memory
+		 */
+		VulkanMemoryBlock* GetBlock() { return m_pBlock; }
+		/**
+		 * Get the allocation of the memory heap the allocation is placed in
+		 * @return	Heap allocation, nullptr if the allocation isn't placed in a memory heap
+		 */
+		VulkanAllocation* GetHeapAllocation() { return m_pHeapAllocation; }
+		/**
+		 * Get the amount of allocations placed in the allocation, when it backs a memory heap
+		 * @return	Amount of placed allocations
+		 */
+		u32 GetPlacedCount() const { return m_PlacedCount; }
+
+		/**
+		 * Set the buffer bound to the allocation, so the buffer can be moved when defragmenting
+		 * @param[in] pBuffer	Buffer
+		 */
+		void SetOwner(VulkanBuffer* pBuffer) { m_pBuffer = pBuffer; m_pTexture = nullptr; }
+		/**
+		 * Set the texture bound to the allocation, so the texture can be moved when defragmenting
+		 * @param[in] pTexture	Texture
+		 */
+		void SetOwner(VulkanTexture* pTexture) { m_pTexture = pTexture; m_pBuffer = nullptr; }
+		/**
+		 * Get the buffer bound to the allocation
+		 * @return	Buffer, nullptr if the allocation isn't bound to a buffer
+		 */
+		VulkanBuffer* GetOwningBuffer() { return m_pBuffer; }
+		/**
+		 * Get the texture bound to the allocation
+		 * @return	Texture, nullptr if the allocation isn't bound to a texture
+		 */
+		VulkanTexture* GetOwningTexture() { return m_pTexture; }
+
+		/**
+		 * Mark the allocation as written by the gpu in the current frame
+		 */
+		void MarkWritten();
+		/**
+		 * Check if the gpu might still be writing to the allocation
+		 * @return	True if the allocation was written by the gpu in one of the last frames in flight, false otherwise
+		 */
+		b8 IsBeingWritten() const;
+		/**
+		 * Get the last frame the gpu wrote to the allocation
+		 * @return	Frame index, u64(-1) if the allocation was never written
+		 */
+		u64 GetLastWriteFrame() const { return m_LastWriteFrame; }
 
 	private:
 		friend class VulkanAllocator;
 
+		/**
+		 * Get the mapped range, aligned to the non-coherent atom size, for flushing and invalidating
+		 * @return	Mapped memory range
+		 */
+		VkMappedMemoryRange GetMappedRange();
+
 		VulkanContext* m_pContext;			/**< Vulkan context */
 		VkDeviceMemory m_Memory;			/**< Device memory */
 		VkDeviceSize m_Size;				/**< Allocated size */
 		VkDeviceSize m_Offset;				/**< Memory offset */
 		u32 m_HeapIndex;					/**< Heap index */
+		u32 m_MemoryTypeIndex;				/**< Memory type index */
+		u32 m_AliasCount;					/**< Amount of resources using the allocation */
+		b8 m_IsDedicated;					/**< Is the allocation dedicated to a single resource */
+		VulkanMemoryBlock* m_pBlock;		/**< Block the allocation was sub-allocated from, nullptr if the allocation owns its memory */
+		VkDeviceSize m_RangeSize;			/**< Size of the range taken from the block, including alignment padding */
+		VulkanAllocation* m_pHeapAllocation;	/**< Allocation of the memory heap the allocation is placed in, nullptr if not placed */
+		u32 m_PlacedCount;					/**< Amount of allocations placed in this allocation */
+
+		VulkanBuffer* m_pBuffer;			/**< Buffer bound to the allocation */
+		VulkanTexture* m_pTexture;			/**< Texture bound to the allocation */
+		u64 m_LastWriteFrame;				/**< Last frame the gpu wrote to the allocation, u64(-1) if never written */
 
 		b8 m_IsMapped;						/**< Is the memory mapped */
 		VulkanAllocationMapMode m_MapMode;	/**< Allocation map mode */
@@ -77,9 +228,12 @@ namespace Vulkan {
 		VkDeviceSize usedSize;
 
 		VkMemoryHeapFlags flags;
+
+		VkDeviceSize budget;			/**< Budget of the process, as of the last update */
+		VkDeviceSize driverUsage;		/**< Usage of the process reported by the driver, as of the last update */
+		VkDeviceSize usedSizeAtUpdate;	/**< Used size at the last update, to estimate the usage in between updates */
 	};
 
-	// TODO: Improve allocation (not just pass through)
 	class VulkanAllocator
 	{
 	public:
@@ -99,26 +253,192 @@ namespace Vulkan {
 		b8 Destroy();
 
 		/**
-		 * Allocate vulkan memory
+		 * Allocate vulkan memory, memory types are tried from best to worst score for the usage
 		 * @param[in] requirements	Memory requirements
-		 * @param[in] memProps		Memory properties
+		 * @param[in] usage			Intended usage of the memory
+		 * @return	Pointer to vlkan allocation, nullptr if allocation failed
+		 * @note	Prefer AllocateForBuffer or AllocateForImage, which can tell the driver which resource a dedicated allocation is for
+		 * @note	Allocations smaller than half a block are sub-allocated from memory blocks, larger allocations get their own vulkan memory
+		 */
+		VulkanAllocation* Allocate(const VkMemoryRequirements& requirements, VulkanMemoryUsage usage);
+		/**
+		 * Allocate vulkan memory for a buffer, the allocation is dedicated when the driver prefers it or the buffer is larger than the dedicated threshold
+		 * @param[in] buffer	Buffer to allocate memory for
+		 * @param[in] usage		Intended usage of the memory
 		 * @return	Pointer to vlkan allocation, nullptr if allocation failed
 		 */
-		VulkanAllocation* Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags memProps);
+		VulkanAllocation* AllocateForBuffer(VkBuffer buffer, VulkanMemoryUsage usage);
 		/**
-		 * Free a vulkan allocation
+		 * Allocate vulkan memory for an image, the allocation is dedicated when the driver prefers it or the image is larger than the dedicated threshold
+		 * @param[in] image		Image to allocate memory for
+		 * @param[in] usage		Intended usage of the memory
+		 * @param[in] aliasKey	Key identifying the image description, transient images with the same key share memory when there is no lazily allocated memory
+		 * @return	Pointer to vlkan allocation, nullptr if allocation failed
+		 */
+		VulkanAllocation* AllocateForImage(VkImage image, VulkanMemoryUsage usage, u64 aliasKey = 0);
+		/**
+		 * Free a vulkan allocation, aliased allocations are only freed when the last resource using them frees them
 		 * @param[in] pAllocation	Allocation to free
 		 */
 		void Free(VulkanAllocation* pAllocation);
+		/**
+		 * Sub-allocate memory from a specific block, used to move resources between blocks
+		 * @param[in] pBlock		Memory block
+		 * @param[in] requirements	Memory requirements
+		 * @return	Pointer to vulkan allocation, nullptr if the requirements don't fit in the block
+		 */
+		VulkanAllocation* AllocateInBlock(VulkanMemoryBlock* pBlock, const VkMemoryRequirements& requirements);
+		/**
+		 * Place an allocation at an offset in the allocation of a memory heap, placed allocations may overlap
+		 * @param[in] pHeapAllocation	Allocation of the memory heap
+		 * @param[in] offset			Offset in the heap allocation
+		 * @param[in] requirements		Memory requirements
+		 * @return	Pointer to vulkan allocation, nullptr if the requirements don't fit at the offset
+		 * @note	Placed allocations don't own memory, freeing them leaves the heap allocation untouched
+		 */
+		VulkanAllocation* AllocatePlaced(VulkanAllocation* pHeapAllocation, VkDeviceSize offset, const VkMemoryRequirements& requirements);
+
+		/**
+		 * Map the memory of a block, the block stays mapped until every allocation that mapped it unmapped it
+		 * @param[in] pBlock	Memory block
+		 * @return				Pointer to the start of the block, nullptr if mapping failed
+		 */
+		void* MapBlock(VulkanMemoryBlock* pBlock);
+		/**
+		 * Unmap the memory of a block
+		 * @param[in] pBlock	Memory block
+		 */
+		void UnmapBlock(VulkanMemoryBlock* pBlock);
+		/**
+		 * Get the memory blocks
+		 * @return	Memory blocks
+		 */
+		const std::vector<VulkanMemoryBlock*>& GetBlocks() const { return m_Blocks; }
 
 		std::pair<u32, VkMemoryType> GetMemoryType(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags memProps);
+		/**
+		 * Get the memory types that can be used for an allocation, sorted from best to worst score
+		 * @param[in] requirements	Memory requirements
+		 * @param[in] usage			Intended usage of the memory
+		 * @return					Memory type indices
+		 */
+		std::vector<u32> GetMemoryTypes(const VkMemoryRequirements& requirements, VulkanMemoryUsage usage);
+
+		/**
+		 * Update the heap budgets, from VK_EXT_memory_budget when available
+		 */
+		void UpdateBudgets();
+		/**
+		 * Get the estimated usage of a heap, the driver usage at the last update plus the allocations made since
+		 * @param[in] heapIndex	Heap index
+		 * @return				Estimated heap usage
+		 */
+		VkDeviceSize GetHeapUsage(u32 heapIndex) const;
+		/**
+		 * Get the heap info
+		 * @return	Heap info, indexed by heap
+		 */
+		const std::vector<HeapInfo>& GetHeapInfo() const { return m_HeapInfo; }
+		/**
+		 * Get the statistics of a memory block
+		 * @param[in] pBlock	Memory block
+		 * @return				Block statistics
+		 */
+		static VulkanMemoryStats GetBlockStats(const VulkanMemoryBlock* pBlock);
+		/**
+		 * Get the memory statistics by heap and memory type
+		 * @return	Allocator statistics
+		 */
+		VulkanAllocatorStats GetStats() const;
+		/**
+		 * Write the memory statistics, the blocks and all allocations to a json file, together with the host memory statistics by allocation scope
+		 * @param[in] filePath	Path of the json file
+		 * @return				True if the file was written successfully, false otherwise
+		 * @note				Allocations are tagged with the debug name of the buffer or texture they are bound to
+		 */
+		b8 DumpJson(const std::string& filePath) const;
+		/**
+		 * Set the size from which resources get a dedicated allocation
+		 * @param[in] threshold	Dedicated allocation threshold
+		 */
+		void SetDedicatedThreshold(VkDeviceSize threshold) { m_DedicatedThreshold = threshold; }
+		/**
+		 * Get the size from which resources get a dedicated allocation
+		 * @return	Dedicated allocation threshold
+		 */
+		VkDeviceSize GetDedicatedThreshold() const { return m_DedicatedThreshold; }
 
 	private:
+		/**
+		 * Allocate vulkan memory
+		 * @param[in] requirements		Memory requirements
+		 * @param[in] usage				Intended usage of the memory
+		 * @param[in] dedicated			If the allocation should be dedicated to a single resource
+		 * @param[in] pDedicatedInfo	Resource for dedicated allocations, nullptr without dedicated allocation support
+		 * @param[in] pAliasKey			Key of the transient allocation to share, nullptr if the memory can't be shared
+		 * @param[in] forImage			If the memory is for an image
+		 * @return	Pointer to vlkan allocation, nullptr if allocation failed
+		 */
+		VulkanAllocation* Allocate(const VkMemoryRequirements& requirements, VulkanMemoryUsage usage, b8 dedicated, const VkMemoryDedicatedAllocateInfo* pDedicatedInfo, const u64* pAliasKey, b8 forImage);
+		/**
+		 * Sub-allocate memory from the blocks of a memory type, a new block is allocated when none of the blocks have enough space
+		 * @param[in] requirements	Memory requirements
+		 * @param[in] typeIndex		Memory type index
+		 * @param[in] forImage		If the memory is for an image
+		 * @param[out] pAllocation	Allocation to fill in
+		 * @return					Vulkan result
+		 */
+		VkResult AllocateFromBlocks(const VkMemoryRequirements& requirements, u32 typeIndex, b8 forImage, VulkanAllocation* pAllocation);
+		/**
+		 * Take a range from a block that fits the requirements, using the smallest free range that fits
+		 * @param[in] pBlock		Memory block
+		 * @param[in] requirements	Memory requirements
+		 * @param[out] pAllocation	Allocation to fill in
+		 * @return					True if the requirements fit in the block, false otherwise
+		 */
+		b8 TakeRange(VulkanMemoryBlock* pBlock, const VkMemoryRequirements& requirements, VulkanAllocation* pAllocation);
+		/**
+		 * Return the range of an allocation to its block, merging it with the neighbouring free ranges
+		 * @param[in] pAllocation	Allocation
+		 */
+		void ReleaseRange(VulkanAllocation* pAllocation);
+		/**
+		 * Get the size of new blocks for a memory type
+		 * @param[in] typeIndex	Memory type index
+		 * @return				Block size
+		 */
+		VkDeviceSize GetBlockSize(u32 typeIndex) const;
+		/**
+		 * Score a memory type for a usage
+		 * @param[in] typeIndex	Memory type index
+		 * @param[in] usage		Intended usage of the memory
+		 * @param[in] size		Size of the allocation
+		 * @return				Score, higher is better, negative if the memory type can't be used
+		 */
+		i32 ScoreMemoryType(u32 typeIndex, VulkanMemoryUsage usage, VkDeviceSize size) const;
+		/**
+		 * Allocate vulkan memory from a memory type
+		 * @param[in] requirements	Memory requirements
+		 * @param[in] typeIndex		Memory type index
+		 * @param[in] pNext			Extension structs for the allocate info
+		 * @param[out] memory		Allocated memory
+		 * @return					Vulkan result
+		 */
+		VkResult AllocateMemory(const VkMemoryRequirements& requirements, u32 typeIndex, const void* pNext, VkDeviceMemory& memory);
+
 		VulkanContext* m_pContext;							/**< Vulkan context */
 
 		VkPhysicalDeviceMemoryProperties m_MemProperties;	/**< Vulkan memory properties */
 		std::vector<HeapInfo> m_HeapInfo;					/**< Heap info */
 
 		std::vector<VulkanAllocation*> m_Allocations;		/**< Allocations */
+		std::unordered_map<u64, VulkanAllocation*> m_TransientAllocations;	/**< Allocations shared by transient attachments by alias key, when there is no lazily allocated memory */
+		VkDeviceSize m_DedicatedThreshold;					/**< Size from which resources get a dedicated allocation */
+		std::vector<VulkanMemoryBlock*> m_Blocks;			/**< Memory blocks */
+		VkDeviceSize m_PreferredBlockSize;					/**< Size of new blocks, smaller heaps use smaller blocks */
+
+#ifdef VK_EXT_memory_budget
+		PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_pfnGetMemoryProperties2;	/**< Used to query the heap budgets, nullptr without VK_EXT_memory_budget */
+#endif
 	};
 }
@@ -0,0 +1,61 @@
+#include "VulkanMemoryHeap.h"
+#include "VulkanMemory.h"
+#include "VulkanContext.h"
+
+namespace Vulkan {
+
+	VulkanMemoryHeap::VulkanMemoryHeap()
+		: MemoryHeap()
+		, m_pAllocation(nullptr)
+	{
+	}
+
+	VulkanMemoryHeap::~VulkanMemoryHeap()
+	{
+	}
+
+	b8 VulkanMemoryHeap::Create(RHI::RHIContext* pContext, u64 size)
+	{
+		m_pContext = pContext;
+		m_Size = size;
+
+		// The resources aren't known yet, so any memory type can be used, the best type for gpu only resources supports about every resource
+		VkMemoryRequirements requirements = {};
+		requirements.size = size;
+		requirements.alignment = HeapAlignment;
+		requirements.memoryTypeBits = ~0u;
+
+		VulkanAllocator* pAllocator = ((VulkanContext*)m_pContext)->GetAllocator();
+		m_pAllocation = pAllocator->Allocate(requirements, VulkanMemoryUsage::GpuOnly);
+		if (!m_pAllocation)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "Failed to allocate the memory of a memory heap!");
+			return false;
+		}
+		return true;
+	}
+
+	b8 VulkanMemoryHeap::Destroy()
+	{
+		if (!m_pAllocation)
+			return true;
+
+		if (m_pAllocation->GetPlacedCount() > 0)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Can't destroy a memory heap with %u resources still placed in it!", m_pAllocation->GetPlacedCount());
+			return false;
+		}
+
+		VulkanAllocator* pAllocator = ((VulkanContext*)m_pContext)->GetAllocator();
+		pAllocator->Free(m_pAllocation);
+		m_pAllocation = nullptr;
+		return true;
+	}
+
+	VulkanAllocation* VulkanMemoryHeap::AllocatePlaced(u64 offset, const VkMemoryRequirements& requirements)
+	{
+		VulkanAllocator* pAllocator = ((VulkanContext*)m_pContext)->GetAllocator();
+		return pAllocator->AllocatePlaced(m_pAllocation, offset, requirements);
+	}
+
+}
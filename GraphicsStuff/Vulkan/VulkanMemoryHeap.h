@@ -0,0 +1,50 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "../RHI/MemoryHeap.h"
+
+namespace Vulkan {
+	class VulkanAllocation;
+
+	class VulkanMemoryHeap final : public RHI::MemoryHeap
+	{
+	public:
+		/**
+		 * Alignment of the heap memory, so offsets aligned to the requirements of a resource are also aligned in the vulkan memory
+		 */
+		static const u64 HeapAlignment = 64 * 1024;
+
+		VulkanMemoryHeap();
+		~VulkanMemoryHeap();
+
+		/**
+		 * Create a memory heap, backed by device local memory
+		 * @param[in] pContext	RHI context
+		 * @param[in] size		Size of the heap
+		 * @return				True if the heap was created successfully, false otherwise
+		 */
+		b8 Create(RHI::RHIContext* pContext, u64 size) override final;
+		/**
+		 * Destroy the memory heap
+		 * @return	True if the heap was destroyed successfully, false if resources are still placed in it
+		 */
+		b8 Destroy() override final;
+
+		/**
+		 * Place an allocation in the heap
+		 * @param[in] offset		Offset in the heap
+		 * @param[in] requirements	Memory requirements of the resource
+		 * @return					Pointer to vulkan allocation, nullptr if the resource doesn't fit at the offset
+		 */
+		VulkanAllocation* AllocatePlaced(u64 offset, const VkMemoryRequirements& requirements);
+
+		/**
+		 * Get the allocation backing the heap
+		 * @return	Vulkan allocation
+		 */
+		VulkanAllocation* GetAllocation() { return m_pAllocation; }
+
+	private:
+		VulkanAllocation* m_pAllocation;	/**< Vulkan allocation backing the heap */
+	};
+
+}
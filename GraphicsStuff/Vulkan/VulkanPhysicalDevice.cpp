@@ -1,6 +1,8 @@
 
 #include "VulkanPhysicalDevice.h"
 #include "VulkanHelpers.h"
+#include "VulkanContext.h"
+#include "VulkanInstance.h"
 
 namespace Vulkan {
 
@@ -12,6 +14,18 @@ namespace Vulkan {
 		, m_MemoryProperties()
 		, m_FormatProperties{}
 		, m_SurfaceSupport()
+		, m_DescriptorIndexingFeatures()
+		, m_DescriptorIndexingProperties()
+#ifdef VK_EXT_extended_dynamic_state
+		, m_ExtendedDynamicStateFeatures()
+#endif
+#ifdef VK_KHR_dynamic_rendering
+		, m_DynamicRenderingFeatures()
+#endif
+#ifdef VK_EXT_graphics_pipeline_library
+		, m_GraphicsPipelineLibraryFeatures()
+		, m_GraphicsPipelineLibraryProperties()
+#endif
 		, m_GpuInfo()
 	{
 	}
@@ -87,9 +101,136 @@ namespace Vulkan {
 			return vkres;
 		}
 
+		// Retrieve extended features and properties
+		VulkanInstance* pInstance = m_pContext->GetInstance();
+		if (pInstance->IsExtensionEnabled(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+		{
+			PFN_vkGetPhysicalDeviceFeatures2KHR pfnGetFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(pInstance->GetInstance(), "vkGetPhysicalDeviceFeatures2KHR");
+			PFN_vkGetPhysicalDeviceProperties2KHR pfnGetProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(pInstance->GetInstance(), "vkGetPhysicalDeviceProperties2KHR");
+
+			if (pfnGetFeatures2 && pfnGetProperties2)
+			{
+				// Chain the feature structs of all available extensions we care about
+				VkPhysicalDeviceFeatures2KHR features2 = {};
+				features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+				void** ppNext = &features2.pNext;
+				if (IsExtensionAvailable(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+				{
+					m_DescriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+					*ppNext = &m_DescriptorIndexingFeatures;
+					ppNext = &m_DescriptorIndexingFeatures.pNext;
+				}
+#ifdef VK_EXT_extended_dynamic_state
+				if (IsExtensionAvailable(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+				{
+					m_ExtendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+					*ppNext = &m_ExtendedDynamicStateFeatures;
+					ppNext = &m_ExtendedDynamicStateFeatures.pNext;
+				}
+#endif
+#ifdef VK_KHR_dynamic_rendering
+				if (IsExtensionAvailable(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+				{
+					m_DynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+					*ppNext = &m_DynamicRenderingFeatures;
+					ppNext = &m_DynamicRenderingFeatures.pNext;
+				}
+#endif
+#ifdef VK_EXT_graphics_pipeline_library
+				if (IsExtensionAvailable(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+				{
+					m_GraphicsPipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+					*ppNext = &m_GraphicsPipelineLibraryFeatures;
+					ppNext = &m_GraphicsPipelineLibraryFeatures.pNext;
+				}
+#endif
+				pfnGetFeatures2(m_PhysicalDevice, &features2);
+				m_DescriptorIndexingFeatures.pNext = nullptr;
+#ifdef VK_EXT_extended_dynamic_state
+				m_ExtendedDynamicStateFeatures.pNext = nullptr;
+#endif
+#ifdef VK_KHR_dynamic_rendering
+				m_DynamicRenderingFeatures.pNext = nullptr;
+#endif
+#ifdef VK_EXT_graphics_pipeline_library
+				m_GraphicsPipelineLibraryFeatures.pNext = nullptr;
+#endif
+
+				if (IsExtensionAvailable(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+				{
+					m_DescriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+					VkPhysicalDeviceProperties2KHR properties2 = {};
+					properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+					properties2.pNext = &m_DescriptorIndexingProperties;
+					pfnGetProperties2(m_PhysicalDevice, &properties2);
+					m_DescriptorIndexingProperties.pNext = nullptr;
+				}
+#ifdef VK_EXT_graphics_pipeline_library
+				if (IsExtensionAvailable(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+				{
+					m_GraphicsPipelineLibraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+					VkPhysicalDeviceProperties2KHR properties2 = {};
+					properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+					properties2.pNext = &m_GraphicsPipelineLibraryProperties;
+					pfnGetProperties2(m_PhysicalDevice, &properties2);
+					m_GraphicsPipelineLibraryProperties.pNext = nullptr;
+				}
+#endif
+			}
+		}
+
 		return VK_SUCCESS;
 	}
 
+	b8 VulkanPhysicalDevice::IsBindlessSupported()
+	{
+		// Bindless needs non-uniform indexing into partially bound, update after bind arrays
+		return IsExtensionAvailable(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+			   IsExtensionAvailable(VK_KHR_MAINTENANCE3_EXTENSION_NAME) &&
+			   m_DescriptorIndexingFeatures.runtimeDescriptorArray &&
+			   m_DescriptorIndexingFeatures.descriptorBindingPartiallyBound &&
+			   m_DescriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+			   m_DescriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+			   m_DescriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind;
+	}
+
+	b8 VulkanPhysicalDevice::IsExtendedDynamicStateSupported()
+	{
+#ifdef VK_EXT_extended_dynamic_state
+		return IsExtensionAvailable(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) &&
+			   m_ExtendedDynamicStateFeatures.extendedDynamicState;
+#else
+		return false;
+#endif
+	}
+
+	b8 VulkanPhysicalDevice::IsDynamicRenderingSupported()
+	{
+#ifdef VK_KHR_dynamic_rendering
+		// Dynamic rendering depends on VK_KHR_depth_stencil_resolve, which depends on VK_KHR_create_renderpass2
+		return IsExtensionAvailable(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) &&
+			   IsExtensionAvailable(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME) &&
+			   IsExtensionAvailable(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME) &&
+			   m_DynamicRenderingFeatures.dynamicRendering;
+#else
+		return false;
+#endif
+	}
+
+	b8 VulkanPhysicalDevice::IsGraphicsPipelineLibrarySupported()
+	{
+#ifdef VK_EXT_graphics_pipeline_library
+		// Libraries are only worth it when linking them is fast, they are also only used with dynamic rendering
+		return IsExtensionAvailable(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+			   IsExtensionAvailable(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+			   m_GraphicsPipelineLibraryFeatures.graphicsPipelineLibrary &&
+			   m_GraphicsPipelineLibraryProperties.graphicsPipelineLibraryFastLinking &&
+			   IsDynamicRenderingSupported();
+#else
+		return false;
+#endif
+	}
+
 	b8 VulkanPhysicalDevice::IsExtensionAvailable(const std::string& extension)
 	{
 		for (const VkExtensionProperties& availableExtension : m_AvailableExtensions)
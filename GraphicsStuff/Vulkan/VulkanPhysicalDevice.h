@@ -149,6 +149,63 @@ namespace Vulkan {
 		* @return	Physical device memory properties
 		*/
 		const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const { return m_MemoryProperties; }
+		/**
+		* Get the physical device queue family properties
+		* @return	Queue family properties, indexed by queue family
+		*/
+		const std::vector<VkQueueFamilyProperties>& GetQueueFamilyProperties() const { return m_QueueFamilyProperties; }
+
+		/**
+		* Get the physical device descriptor indexing features
+		* @return	Descriptor indexing features (all false when VK_EXT_descriptor_indexing is unavailable)
+		*/
+		const VkPhysicalDeviceDescriptorIndexingFeaturesEXT& GetDescriptorIndexingFeatures() const { return m_DescriptorIndexingFeatures; }
+		/**
+		* Get the physical device descriptor indexing properties
+		* @return	Descriptor indexing properties
+		*/
+		const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& GetDescriptorIndexingProperties() const { return m_DescriptorIndexingProperties; }
+		/**
+		 * Check if the physical device supports bindless descriptors
+		 * @return	True if bindless descriptors are supported, false otherwise
+		 */
+		b8 IsBindlessSupported();
+#ifdef VK_EXT_extended_dynamic_state
+		/**
+		* Get the physical device extended dynamic state features
+		* @return	Extended dynamic state features (all false when VK_EXT_extended_dynamic_state is unavailable)
+		*/
+		const VkPhysicalDeviceExtendedDynamicStateFeaturesEXT& GetExtendedDynamicStateFeatures() const { return m_ExtendedDynamicStateFeatures; }
+#endif
+#ifdef VK_KHR_dynamic_rendering
+		/**
+		* Get the physical device dynamic rendering features
+		* @return	Dynamic rendering features (all false when VK_KHR_dynamic_rendering is unavailable)
+		*/
+		const VkPhysicalDeviceDynamicRenderingFeaturesKHR& GetDynamicRenderingFeatures() const { return m_DynamicRenderingFeatures; }
+#endif
+#ifdef VK_EXT_graphics_pipeline_library
+		/**
+		* Get the physical device graphics pipeline library features
+		* @return	Graphics pipeline library features (all false when VK_EXT_graphics_pipeline_library is unavailable)
+		*/
+		const VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT& GetGraphicsPipelineLibraryFeatures() const { return m_GraphicsPipelineLibraryFeatures; }
+#endif
+		/**
+		 * Check if the physical device supports extended dynamic state (cull mode, front face, topology, depth and stencil state)
+		 * @return	True if extended dynamic state is supported, false otherwise (always false when building against a vulkan sdk without VK_EXT_extended_dynamic_state)
+		 */
+		b8 IsExtendedDynamicStateSupported();
+		/**
+		 * Check if the physical device supports rendering without render pass and framebuffer objects
+		 * @return	True if dynamic rendering is supported, false otherwise (always false when building against a vulkan sdk without VK_KHR_dynamic_rendering)
+		 */
+		b8 IsDynamicRenderingSupported();
+		/**
+		 * Check if the physical device supports fast-linking graphics pipelines from independently compiled parts
+		 * @return	True if graphics pipeline libraries are supported, false otherwise (always false when building against a vulkan sdk without VK_EXT_graphics_pipeline_library)
+		 */
+		b8 IsGraphicsPipelineLibrarySupported();
 
 		RHI::GpuInfo GetGpuInfo() const { return m_GpuInfo; }
 
@@ -162,6 +219,18 @@ namespace Vulkan {
 		VkPhysicalDeviceMemoryProperties m_MemoryProperties;			/**< Physical device memory properties */
 		FormatProperties m_FormatProperties[VK_FORMAT_RANGE_SIZE];		/**< Format properties */
 		SurfaceSupport m_SurfaceSupport;								/**< Surface support */
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT m_DescriptorIndexingFeatures;		/**< Descriptor indexing features */
+		VkPhysicalDeviceDescriptorIndexingPropertiesEXT m_DescriptorIndexingProperties;	/**< Descriptor indexing properties */
+#ifdef VK_EXT_extended_dynamic_state
+		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT m_ExtendedDynamicStateFeatures;	/**< Extended dynamic state features */
+#endif
+#ifdef VK_KHR_dynamic_rendering
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR m_DynamicRenderingFeatures;			/**< Dynamic rendering features */
+#endif
+#ifdef VK_EXT_graphics_pipeline_library
+		VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT m_GraphicsPipelineLibraryFeatures;		/**< Graphics pipeline library features */
+		VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT m_GraphicsPipelineLibraryProperties;	/**< Graphics pipeline library properties */
+#endif
 
 		std::vector<VkExtensionProperties> m_AvailableExtensions;		/**< Available extensions */
 		std::vector<VkLayerProperties> m_AvailableLayers;				/**< Available extensions */
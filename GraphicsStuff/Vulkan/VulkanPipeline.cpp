@@ -2,10 +2,13 @@
 #include "VulkanPipeline.h"
 #include "VulkanDevice.h"
 #include "VulkanDescriptorSetLayout.h"
+#include "VulkanDescriptorSetManager.h"
 #include "VulkanRenderPass.h"
 #include "VulkanContext.h"
 #include "VulkanShader.h"
 #include "VulkanHelpers.h"
+#include "VulkanPipelineLibraryCache.h"
+#include "../RHI/RenderPassCache.h"
 
 namespace Vulkan {
 
@@ -29,23 +32,15 @@ namespace Vulkan {
 		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
 		VkResult vkres;
 
-		VkPipelineLayoutCreateInfo layoutInfo = {};
-		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		// TODO: Push constants?
+		// Without extended dynamic state, the states are baked in from the description
+		if (!pDevice->IsExtendedDynamicStateSupported())
+			m_GraphicsDesc.dynamicState &= ~RHI::DynamicState::Extended;
 
-		std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
-		for (const RHI::DescriptorSetLayout* pLayout : desc.descriptorSetLayouts)
-		{
-			descriptorSetLayouts.push_back(((VulkanDescriptorSetLayout*)pLayout)->GetLayout());
-		}
-
-		layoutInfo.setLayoutCount = u32(descriptorSetLayouts.size());
-		layoutInfo.pSetLayouts = descriptorSetLayouts.data();
-
-		vkres = pDevice->vkCreatePipelineLayout(layoutInfo, m_Layout);
+		VulkanDescriptorSetManager* pManager = (VulkanDescriptorSetManager*)m_pContext->GetDescriptorSetManager();
+		vkres = pManager->AcquirePipelineLayout(desc.descriptorSetLayouts, desc.pushConstantSize, m_Layout);
 		if (vkres != VK_SUCCESS)
 		{
-			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to create the compute pipeline layout (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to create the pipeline layout (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
 			return vkres;
 		}
 
@@ -53,7 +48,74 @@ namespace Vulkan {
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 		// TODO: flags??
 		pipelineInfo.layout = m_Layout;
-		pipelineInfo.renderPass = ((VulkanRenderPass*)desc.pRenderPass)->GetRenderPass();
+
+		// Pipelines used with BeginRendering are created from their attachment formats
+#ifdef VK_KHR_dynamic_rendering
+		VkFormat colorFormats[RHI::MaxRenderingColorAttachments];
+		VkPipelineRenderingCreateInfoKHR renderingInfo = {};
+#endif
+		if (desc.pRenderPass)
+		{
+			pipelineInfo.renderPass = ((VulkanRenderPass*)desc.pRenderPass)->GetRenderPass();
+		}
+		else if (pDevice->IsDynamicRenderingSupported())
+		{
+#ifdef VK_KHR_dynamic_rendering
+			const RHI::RenderingFormats& formats = desc.renderingFormats;
+			for (u32 i = 0; i < formats.colorFormatCount; ++i)
+			{
+				colorFormats[i] = Helpers::GetFormat(formats.colorFormats[i]);
+			}
+			renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+			renderingInfo.colorAttachmentCount = formats.colorFormatCount;
+			renderingInfo.pColorAttachmentFormats = colorFormats;
+			renderingInfo.depthAttachmentFormat = formats.depthStencilFormat.HasDepthComponent() ? Helpers::GetFormat(formats.depthStencilFormat) : VK_FORMAT_UNDEFINED;
+			renderingInfo.stencilAttachmentFormat = formats.depthStencilFormat.HasStencilComponent() ? Helpers::GetFormat(formats.depthStencilFormat) : VK_FORMAT_UNDEFINED;
+			pipelineInfo.pNext = &renderingInfo;
+			pipelineInfo.renderPass = VK_NULL_HANDLE;
+#endif
+		}
+		else
+		{
+			// Without dynamic rendering, any render pass with compatible attachments can be used
+			const RHI::RenderingFormats& formats = desc.renderingFormats;
+			RHI::SampleCount samples = desc.multisample.enable ? desc.multisample.samples : RHI::SampleCount::Sample1;
+			std::vector<RHI::RenderPassAttachment> attachments;
+			RHI::SubRenderPass subpass;
+			for (u32 i = 0; i < formats.colorFormatCount + 1; ++i)
+			{
+				RHI::RenderPassAttachment attachment;
+				attachment.samples = samples;
+				if (i < formats.colorFormatCount)
+				{
+					attachment.format = formats.colorFormats[i];
+					attachment.type = RHI::RenderTargetType::Color;
+				}
+				else if (formats.depthStencilFormat.HasDepthComponent())
+				{
+					attachment.format = formats.depthStencilFormat;
+					attachment.type = RHI::RenderTargetType::DepthStencil;
+				}
+				else
+				{
+					break;
+				}
+
+				RHI::RenderPassAttachmentRef attachmentRef;
+				attachmentRef.index = u32(attachments.size());
+				attachmentRef.type = attachment.type;
+				subpass.attachments.push_back(attachmentRef);
+				attachments.push_back(attachment);
+			}
+
+			RHI::RenderPass* pRenderPass = m_pContext->GetRenderPassCache()->GetPersistentRenderPass(attachments, { subpass });
+			if (!pRenderPass)
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "Failed to get a compatible render pass for the pipeline!");
+				return false;
+			}
+			pipelineInfo.renderPass = ((VulkanRenderPass*)pRenderPass)->GetRenderPass();
+		}
 
 		// Shader stages
 		assert(desc.pVertexShader && desc.pFragmentShader);
@@ -121,9 +183,10 @@ namespace Vulkan {
 		scissor.extent.height = desc.scissor.height;
 		VkPipelineViewportStateCreateInfo viewportState = {};
 		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-		viewportState.pViewports = &viewport;
+		// Dynamic viewports and scissors only need their count
+		viewportState.pViewports = (desc.dynamicState & RHI::DynamicState::Viewport) != RHI::DynamicState::None ? nullptr : &viewport;
 		viewportState.viewportCount = 1;
-		viewportState.pScissors = &scissor;
+		viewportState.pScissors = (desc.dynamicState & RHI::DynamicState::Scissor) != RHI::DynamicState::None ? nullptr : &scissor;
 		viewportState.scissorCount = 1;
 		pipelineInfo.pViewportState = &viewportState;
 
@@ -207,11 +270,11 @@ namespace Vulkan {
 		VkPipelineDynamicStateCreateInfo dynamicState = {};
 		std::vector<VkDynamicState> vkDynamicStates;
 		pipelineInfo.pDynamicState = nullptr;
-		if (u16(desc.dynamicState) != 0)
+		if (u16(m_GraphicsDesc.dynamicState) != 0)
 		{
 			dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
 
-			vkDynamicStates = Helpers::GetDynamicStates(desc.dynamicState);
+			vkDynamicStates = Helpers::GetDynamicStates(m_GraphicsDesc.dynamicState);
 			dynamicState.dynamicStateCount = u32(vkDynamicStates.size());
 			dynamicState.pDynamicStates = vkDynamicStates.data();
 
@@ -222,7 +285,12 @@ namespace Vulkan {
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 		pipelineInfo.basePipelineIndex = 0;
 
-		vkres = pDevice->vkCreatePipeline(pipelineInfo, m_Pipeline);
+		// Pipelines used with BeginRendering are linked from cached parts when possible, so only new parts need to be compiled
+		VulkanPipelineLibraryCache* pLibraryCache = ((VulkanContext*)m_pContext)->GetPipelineLibraryCache();
+		if (pLibraryCache && !desc.pRenderPass)
+			vkres = pLibraryCache->CreatePipeline(pipelineInfo, m_Pipeline);
+		else
+			vkres = pDevice->vkCreatePipeline(pipelineInfo, m_Pipeline);
 		if (vkres != VK_SUCCESS)
 		{
 			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to create the compute pipeline (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
@@ -241,14 +309,11 @@ namespace Vulkan {
 		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
 		VkResult vkres;
 
-		VkPipelineLayoutCreateInfo layoutInfo = {};
-		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		// TODO
-
-		vkres = pDevice->vkCreatePipelineLayout(layoutInfo, m_Layout);
+		VulkanDescriptorSetManager* pManager = (VulkanDescriptorSetManager*)m_pContext->GetDescriptorSetManager();
+		vkres = pManager->AcquirePipelineLayout(desc.descriptorSetLayouts, desc.pushConstantSize, m_Layout);
 		if (vkres != VK_SUCCESS)
 		{
-			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to create the compute pipeline layout (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Fatal, "Failed to create the pipeline layout (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
 			return vkres;
 		}
 
@@ -280,7 +345,7 @@ namespace Vulkan {
 
 		if (m_Layout)
 		{
-			pDevice->vkDestroyPipelineLayout(m_Layout);
+			((VulkanDescriptorSetManager*)m_pContext->GetDescriptorSetManager())->ReleasePipelineLayout(m_Layout);
 			m_Layout = VK_NULL_HANDLE;
 		}
 
@@ -0,0 +1,413 @@
+
+#include "VulkanPipelineLibraryCache.h"
+#include <algorithm>
+#include <cstring>
+#include "VulkanDevice.h"
+#include "VulkanContext.h"
+#include "../General/Hash.h"
+
+namespace Vulkan {
+
+	VulkanPipelineLibraryCache::VulkanPipelineLibraryCache()
+		: m_pContext(nullptr)
+	{
+	}
+
+	VulkanPipelineLibraryCache::~VulkanPipelineLibraryCache()
+	{
+	}
+
+	b8 VulkanPipelineLibraryCache::Create(VulkanContext* pContext)
+	{
+		m_pContext = pContext;
+		return true;
+	}
+
+	b8 VulkanPipelineLibraryCache::Destroy()
+	{
+		VulkanDevice* pDevice = m_pContext->GetDevice();
+		for (std::pair<const u64, LibraryEntry>& pair : m_Libraries)
+		{
+			pDevice->vkDestroyPipeline(pair.second.library);
+		}
+		m_Libraries.clear();
+		return true;
+	}
+
+	VkResult VulkanPipelineLibraryCache::CreatePipeline(const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline& pipeline)
+	{
+#ifdef VK_EXT_graphics_pipeline_library
+		VkPipeline libraries[u8(PipelineLibraryPart::Count)];
+		for (u8 i = 0; i < u8(PipelineLibraryPart::Count); ++i)
+		{
+			VkResult vkres = GetLibrary(PipelineLibraryPart(i), createInfo, libraries[i]);
+			if (vkres != VK_SUCCESS)
+				return vkres;
+		}
+
+		// Fast-link the parts, without link time optimization
+		VkPipelineLibraryCreateInfoKHR libraryInfo = {};
+		libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+		libraryInfo.libraryCount = u32(PipelineLibraryPart::Count);
+		libraryInfo.pLibraries = libraries;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.pNext = &libraryInfo;
+		pipelineInfo.layout = createInfo.layout;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineInfo.basePipelineIndex = 0;
+
+		return m_pContext->GetDevice()->vkCreatePipeline(pipelineInfo, pipeline);
+#else
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+#endif
+	}
+
+	void VulkanPipelineLibraryCache::InvalidateLibraries(u64 handle)
+	{
+		VulkanDevice* pDevice = m_pContext->GetDevice();
+		for (auto it = m_Libraries.begin(); it != m_Libraries.end();)
+		{
+			const std::vector<u64>& handles = it->second.handles;
+			if (std::find(handles.begin(), handles.end(), handle) != handles.end())
+			{
+				// Pipelines linked from the library don't reference it, so it can be destroyed right away
+				pDevice->vkDestroyPipeline(it->second.library);
+				it = m_Libraries.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	VkResult VulkanPipelineLibraryCache::GetLibrary(PipelineLibraryPart part, const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline& library)
+	{
+#ifdef VK_EXT_graphics_pipeline_library
+		std::vector<u8> key;
+		std::vector<u64> handles;
+		PackKey(part, createInfo, key, handles);
+		u64 hash = Hash::Fnv1a(key.data(), key.size());
+
+		auto range = m_Libraries.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second.key == key)
+			{
+				library = it->second.library;
+				return VK_SUCCESS;
+			}
+		}
+
+		VkGraphicsPipelineLibraryCreateInfoEXT partInfo = {};
+		partInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+		partInfo.pNext = (void*)createInfo.pNext;
+
+		VkGraphicsPipelineCreateInfo libraryInfo = createInfo;
+		libraryInfo.pNext = &partInfo;
+		libraryInfo.flags |= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+
+		// Only pass the shader stages that belong to the part
+		std::vector<VkPipelineShaderStageCreateInfo> stages;
+		switch (part)
+		{
+		case PipelineLibraryPart::VertexInput:
+			partInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+			libraryInfo.layout = VK_NULL_HANDLE;
+			break;
+		case PipelineLibraryPart::PreRasterization:
+			partInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+			for (u32 i = 0; i < createInfo.stageCount; ++i)
+			{
+				if (createInfo.pStages[i].stage != VK_SHADER_STAGE_FRAGMENT_BIT)
+					stages.push_back(createInfo.pStages[i]);
+			}
+			break;
+		case PipelineLibraryPart::FragmentShader:
+			partInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+			for (u32 i = 0; i < createInfo.stageCount; ++i)
+			{
+				if (createInfo.pStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+					stages.push_back(createInfo.pStages[i]);
+			}
+			break;
+		case PipelineLibraryPart::FragmentOutput:
+			partInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+			libraryInfo.layout = VK_NULL_HANDLE;
+			break;
+		default:
+			break;
+		}
+		libraryInfo.stageCount = u32(stages.size());
+		libraryInfo.pStages = stages.data();
+
+		VkResult vkres = m_pContext->GetDevice()->vkCreatePipeline(libraryInfo, library);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to create a pipeline library (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return vkres;
+		}
+
+		LibraryEntry entry;
+		entry.key = std::move(key);
+		entry.handles = std::move(handles);
+		entry.library = library;
+		m_Libraries.emplace(hash, std::move(entry));
+		return VK_SUCCESS;
+#else
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+#endif
+	}
+
+	void VulkanPipelineLibraryCache::PackKey(PipelineLibraryPart part, const VkGraphicsPipelineCreateInfo& createInfo, std::vector<u8>& key, std::vector<u64>& handles)
+	{
+		Pack(key, part);
+
+		// Dynamic state is packed into every part, as it changes what state is baked into each part
+		if (createInfo.pDynamicState)
+		{
+			Pack(key, createInfo.pDynamicState->dynamicStateCount);
+			for (u32 i = 0; i < createInfo.pDynamicState->dynamicStateCount; ++i)
+			{
+				Pack(key, createInfo.pDynamicState->pDynamicStates[i]);
+			}
+		}
+		else
+		{
+			Pack(key, u32(0));
+		}
+
+		// State that is set dynamically isn't baked into the part, so it shouldn't split the cache
+		b8 dynamicViewport = IsDynamic(createInfo, VK_DYNAMIC_STATE_VIEWPORT);
+		b8 dynamicScissor = IsDynamic(createInfo, VK_DYNAMIC_STATE_SCISSOR);
+		b8 dynamicLineWidth = IsDynamic(createInfo, VK_DYNAMIC_STATE_LINE_WIDTH);
+		b8 dynamicDepthBias = IsDynamic(createInfo, VK_DYNAMIC_STATE_DEPTH_BIAS);
+		b8 dynamicBlendConstants = IsDynamic(createInfo, VK_DYNAMIC_STATE_BLEND_CONSTANTS);
+		b8 dynamicDepthBounds = IsDynamic(createInfo, VK_DYNAMIC_STATE_DEPTH_BOUNDS);
+		b8 dynamicStencilCompareMask = IsDynamic(createInfo, VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK);
+		b8 dynamicStencilWriteMask = IsDynamic(createInfo, VK_DYNAMIC_STATE_STENCIL_WRITE_MASK);
+		b8 dynamicStencilReference = IsDynamic(createInfo, VK_DYNAMIC_STATE_STENCIL_REFERENCE);
+		b8 dynamicCullMode = false;
+		b8 dynamicFrontFace = false;
+		b8 dynamicTopology = false;
+		b8 dynamicDepthTestEnable = false;
+		b8 dynamicDepthWriteEnable = false;
+		b8 dynamicDepthCompareOp = false;
+		b8 dynamicDepthBoundsTestEnable = false;
+		b8 dynamicStencilTestEnable = false;
+		b8 dynamicStencilOp = false;
+#ifdef VK_EXT_extended_dynamic_state
+		dynamicCullMode = IsDynamic(createInfo, VK_DYNAMIC_STATE_CULL_MODE_EXT);
+		dynamicFrontFace = IsDynamic(createInfo, VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+		dynamicTopology = IsDynamic(createInfo, VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT);
+		dynamicDepthTestEnable = IsDynamic(createInfo, VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+		dynamicDepthWriteEnable = IsDynamic(createInfo, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+		dynamicDepthCompareOp = IsDynamic(createInfo, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT);
+		dynamicDepthBoundsTestEnable = IsDynamic(createInfo, VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE_EXT);
+		dynamicStencilTestEnable = IsDynamic(createInfo, VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT);
+		dynamicStencilOp = IsDynamic(createInfo, VK_DYNAMIC_STATE_STENCIL_OP_EXT);
+#endif
+
+		// Shader stages
+		if (part == PipelineLibraryPart::PreRasterization || part == PipelineLibraryPart::FragmentShader)
+		{
+			for (u32 i = 0; i < createInfo.stageCount; ++i)
+			{
+				const VkPipelineShaderStageCreateInfo& stage = createInfo.pStages[i];
+				if ((stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT) != (part == PipelineLibraryPart::FragmentShader))
+					continue;
+
+				Pack(key, stage.stage);
+				Pack(key, stage.module);
+				key.insert(key.end(), stage.pName, stage.pName + strlen(stage.pName) + 1);
+				handles.push_back(u64(stage.module));
+			}
+
+			Pack(key, createInfo.layout);
+			handles.push_back(u64(createInfo.layout));
+		}
+
+		// Attachment formats, libraries are only used with dynamic rendering, so the formats fully describe the attachments
+		if (part != PipelineLibraryPart::VertexInput)
+		{
+#ifdef VK_KHR_dynamic_rendering
+			const VkBaseInStructure* pNext = (const VkBaseInStructure*)createInfo.pNext;
+			while (pNext && pNext->sType != VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR)
+			{
+				pNext = pNext->pNext;
+			}
+			if (pNext)
+			{
+				const VkPipelineRenderingCreateInfoKHR* pRenderingInfo = (const VkPipelineRenderingCreateInfoKHR*)pNext;
+				Pack(key, pRenderingInfo->viewMask);
+				Pack(key, pRenderingInfo->colorAttachmentCount);
+				for (u32 i = 0; i < pRenderingInfo->colorAttachmentCount; ++i)
+				{
+					Pack(key, pRenderingInfo->pColorAttachmentFormats[i]);
+				}
+				Pack(key, pRenderingInfo->depthAttachmentFormat);
+				Pack(key, pRenderingInfo->stencilAttachmentFormat);
+			}
+#endif
+			Pack(key, createInfo.renderPass);
+			Pack(key, createInfo.subpass);
+		}
+
+		switch (part)
+		{
+		case PipelineLibraryPart::VertexInput:
+		{
+			const VkPipelineVertexInputStateCreateInfo& vertexInput = *createInfo.pVertexInputState;
+			Pack(key, vertexInput.vertexBindingDescriptionCount);
+			for (u32 i = 0; i < vertexInput.vertexBindingDescriptionCount; ++i)
+			{
+				Pack(key, vertexInput.pVertexBindingDescriptions[i]);
+			}
+			Pack(key, vertexInput.vertexAttributeDescriptionCount);
+			for (u32 i = 0; i < vertexInput.vertexAttributeDescriptionCount; ++i)
+			{
+				Pack(key, vertexInput.pVertexAttributeDescriptions[i]);
+			}
+			if (dynamicTopology)
+				Pack(key, GetTopologyClass(createInfo.pInputAssemblyState->topology));
+			else
+				Pack(key, createInfo.pInputAssemblyState->topology);
+			Pack(key, createInfo.pInputAssemblyState->primitiveRestartEnable);
+			break;
+		}
+		case PipelineLibraryPart::PreRasterization:
+		{
+			const VkPipelineRasterizationStateCreateInfo& raster = *createInfo.pRasterizationState;
+			Pack(key, raster.depthClampEnable);
+			Pack(key, raster.rasterizerDiscardEnable);
+			Pack(key, raster.polygonMode);
+			if (!dynamicCullMode)
+				Pack(key, raster.cullMode);
+			if (!dynamicFrontFace)
+				Pack(key, raster.frontFace);
+			Pack(key, raster.depthBiasEnable);
+			if (!dynamicDepthBias)
+			{
+				Pack(key, raster.depthBiasConstantFactor);
+				Pack(key, raster.depthBiasClamp);
+				Pack(key, raster.depthBiasSlopeFactor);
+			}
+			if (!dynamicLineWidth)
+				Pack(key, raster.lineWidth);
+
+			const VkPipelineViewportStateCreateInfo& viewport = *createInfo.pViewportState;
+			Pack(key, viewport.viewportCount);
+			for (u32 i = 0; !dynamicViewport && viewport.pViewports && i < viewport.viewportCount; ++i)
+			{
+				Pack(key, viewport.pViewports[i]);
+			}
+			Pack(key, viewport.scissorCount);
+			for (u32 i = 0; !dynamicScissor && viewport.pScissors && i < viewport.scissorCount; ++i)
+			{
+				Pack(key, viewport.pScissors[i]);
+			}
+
+			Pack(key, createInfo.pTessellationState ? createInfo.pTessellationState->patchControlPoints : 0u);
+			// The topology class needs to match the shaders
+			if (dynamicTopology)
+				Pack(key, GetTopologyClass(createInfo.pInputAssemblyState->topology));
+			else
+				Pack(key, createInfo.pInputAssemblyState->topology);
+			break;
+		}
+		case PipelineLibraryPart::FragmentShader:
+		{
+			const VkPipelineDepthStencilStateCreateInfo& depthStencil = *createInfo.pDepthStencilState;
+			if (!dynamicDepthTestEnable)
+				Pack(key, depthStencil.depthTestEnable);
+			if (!dynamicDepthWriteEnable)
+				Pack(key, depthStencil.depthWriteEnable);
+			if (!dynamicDepthCompareOp)
+				Pack(key, depthStencil.depthCompareOp);
+			if (!dynamicDepthBoundsTestEnable)
+				Pack(key, depthStencil.depthBoundsTestEnable);
+			if (!dynamicStencilTestEnable)
+				Pack(key, depthStencil.stencilTestEnable);
+			for (const VkStencilOpState& stencil : { depthStencil.front, depthStencil.back })
+			{
+				if (!dynamicStencilOp)
+				{
+					Pack(key, stencil.failOp);
+					Pack(key, stencil.passOp);
+					Pack(key, stencil.depthFailOp);
+					Pack(key, stencil.compareOp);
+				}
+				if (!dynamicStencilCompareMask)
+					Pack(key, stencil.compareMask);
+				if (!dynamicStencilWriteMask)
+					Pack(key, stencil.writeMask);
+				if (!dynamicStencilReference)
+					Pack(key, stencil.reference);
+			}
+			if (!dynamicDepthBounds)
+			{
+				Pack(key, depthStencil.minDepthBounds);
+				Pack(key, depthStencil.maxDepthBounds);
+			}
+		}
+		// Fallthrough, the fragment shader also depends on the multisample state
+		case PipelineLibraryPart::FragmentOutput:
+		{
+			const VkPipelineMultisampleStateCreateInfo& multisample = *createInfo.pMultisampleState;
+			Pack(key, multisample.rasterizationSamples);
+			Pack(key, multisample.sampleShadingEnable);
+			Pack(key, multisample.minSampleShading);
+			Pack(key, multisample.pSampleMask ? *multisample.pSampleMask : ~0u);
+			Pack(key, multisample.alphaToCoverageEnable);
+			Pack(key, multisample.alphaToOneEnable);
+
+			if (part == PipelineLibraryPart::FragmentOutput)
+			{
+				const VkPipelineColorBlendStateCreateInfo& blend = *createInfo.pColorBlendState;
+				Pack(key, blend.logicOpEnable);
+				Pack(key, blend.logicOp);
+				Pack(key, blend.attachmentCount);
+				for (u32 i = 0; i < blend.attachmentCount; ++i)
+				{
+					Pack(key, blend.pAttachments[i]);
+				}
+				if (!dynamicBlendConstants)
+					Pack(key, blend.blendConstants);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	b8 VulkanPipelineLibraryCache::IsDynamic(const VkGraphicsPipelineCreateInfo& createInfo, VkDynamicState state)
+	{
+		if (!createInfo.pDynamicState)
+			return false;
+		const VkDynamicState* pBegin = createInfo.pDynamicState->pDynamicStates;
+		const VkDynamicState* pEnd = pBegin + createInfo.pDynamicState->dynamicStateCount;
+		return std::find(pBegin, pEnd, state) != pEnd;
+	}
+
+	u32 VulkanPipelineLibraryCache::GetTopologyClass(VkPrimitiveTopology topology)
+	{
+		switch (topology)
+		{
+		case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+			return 0;
+		case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+		case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+		case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+		case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+			return 1;
+		case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+			return 3;
+		default:
+			return 2;
+		}
+	}
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+#include "../General/TypesAndMacros.h"
+
+namespace Vulkan {
+	class VulkanContext;
+
+	/**
+	 * Independently compiled part of a graphics pipeline (VK_EXT_graphics_pipeline_library)
+	 */
+	enum class PipelineLibraryPart : u8
+	{
+		VertexInput,		/**< Vertex input and input assembly */
+		PreRasterization,	/**< Vertex, tessellation and geometry shaders, rasterizer and viewport */
+		FragmentShader,		/**< Fragment shader, depth stencil and multisample state */
+		FragmentOutput,		/**< Blend and multisample state */
+		Count
+	};
+
+	/**
+	 * Cache of graphics pipeline library parts, new graphics pipelines are fast-linked from cached parts
+	 * so that only parts that weren't seen before need to be compiled
+	 */
+	class VulkanPipelineLibraryCache final
+	{
+	public:
+		VulkanPipelineLibraryCache();
+		~VulkanPipelineLibraryCache();
+
+		/**
+		 * Create the pipeline library cache
+		 * @param[in] pContext	Vulkan context
+		 * @return				True if the pipeline library cache was created successfully, false otherwise
+		 */
+		b8 Create(VulkanContext* pContext);
+		/**
+		 * Destroy the pipeline library cache and all libraries in it
+		 * @return	True if the pipeline library cache was destroyed successfully, false otherwise
+		 */
+		b8 Destroy();
+
+		/**
+		 * Create a graphics pipeline by linking a library for each part, libraries are only compiled when no matching part is cached
+		 * @param[in] createInfo	Complete graphics pipeline create info
+		 * @param[out] pipeline		Linked pipeline
+		 * @return					Vulkan result
+		 */
+		VkResult CreatePipeline(const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline& pipeline);
+
+		/**
+		 * Remove all cached libraries referencing a vulkan handle (shader module or pipeline layout)
+		 * @param[in] handle	Vulkan handle that is about to be destroyed
+		 */
+		void InvalidateLibraries(u64 handle);
+
+	private:
+		/**
+		 * Cached pipeline library
+		 */
+		struct LibraryEntry
+		{
+			std::vector<u8> key;		/**< Packed state of the part, for exact matching */
+			std::vector<u64> handles;	/**< Vulkan handles referenced by the library */
+			VkPipeline library;			/**< Pipeline library */
+		};
+
+		/**
+		 * Get a library for a part of the pipeline, compiling it when it isn't cached
+		 * @param[in] part			Pipeline part
+		 * @param[in] createInfo	Complete graphics pipeline create info
+		 * @param[out] library		Pipeline library
+		 * @return					Vulkan result
+		 */
+		VkResult GetLibrary(PipelineLibraryPart part, const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline& library);
+		/**
+		 * Pack the state of a pipeline part
+		 * @param[in] part			Pipeline part
+		 * @param[in] createInfo	Complete graphics pipeline create info
+		 * @param[out] key			Packed state
+		 * @param[out] handles		Vulkan handles referenced by the part
+		 */
+		void PackKey(PipelineLibraryPart part, const VkGraphicsPipelineCreateInfo& createInfo, std::vector<u8>& key, std::vector<u64>& handles);
+		/**
+		 * Check if a state is dynamic in a pipeline
+		 * @param[in] createInfo	Complete graphics pipeline create info
+		 * @param[in] state			Dynamic state
+		 * @return					True if the state is dynamic, false otherwise
+		 */
+		static b8 IsDynamic(const VkGraphicsPipelineCreateInfo& createInfo, VkDynamicState state);
+		/**
+		 * Get the class of a primitive topology (point, line, triangle or patch), a dynamic topology can only change within its class
+		 * @param[in] topology	Primitive topology
+		 * @return				Topology class
+		 */
+		static u32 GetTopologyClass(VkPrimitiveTopology topology);
+
+		/**
+		 * Append a value to a key (appended by its bytes, so it should not contain padding)
+		 * @param[in] key	Key
+		 * @param[in] value	Value
+		 */
+		template<typename T>
+		static void Pack(std::vector<u8>& key, const T& value)
+		{
+			const u8* pBytes = (const u8*)&value;
+			key.insert(key.end(), pBytes, pBytes + sizeof(T));
+		}
+
+		VulkanContext* m_pContext;								/**< Vulkan context */
+		std::unordered_multimap<u64, LibraryEntry> m_Libraries;	/**< Cached libraries by hash of their key */
+	};
+
+}
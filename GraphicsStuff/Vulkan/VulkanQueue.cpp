@@ -50,6 +50,11 @@ namespace Vulkan {
 		return vkQueueSubmit(m_Queue, u32(submitInfo.size()), submitInfo.data(), fence);
 	}
 
+	VkResult VulkanQueue::vkBindSparse(const VkBindSparseInfo& bindInfo, VkFence fence)
+	{
+		return vkQueueBindSparse(m_Queue, 1, &bindInfo, fence);
+	}
+
 	VkResult VulkanQueue::vkPresent(const VkPresentInfoKHR& presentInfo)
 	{
 		return vkQueuePresentKHR(m_Queue, &presentInfo);
@@ -57,6 +57,14 @@ namespace Vulkan {
 		 * @return					Vulkan result
 		 */
 		VkResult vkSubmit(const std::vector<VkSubmitInfo>& submitInfo, VkFence fence);
+		/**
+		 * Bind sparse memory on a vk queue
+		 * @param[in] bindInfo	Vk bind sparse info
+		 * @param[in] fence		Vk fence
+		 * @return				Vulkan result
+		 * @note				The queue family needs to support sparse binding
+		 */
+		VkResult vkBindSparse(const VkBindSparseInfo& bindInfo, VkFence fence);
 		/**
 		 * Present a vk swapchain
 		 * @param[in] presentInfo	Vk present info
@@ -0,0 +1,53 @@
+#include "VulkanRenderPassCache.h"
+#include "VulkanRenderPass.h"
+#include "VulkanFramebuffer.h"
+
+namespace Vulkan {
+
+	VulkanRenderPassCache::VulkanRenderPassCache()
+		: RenderPassCache()
+	{
+	}
+
+	VulkanRenderPassCache::~VulkanRenderPassCache()
+	{
+	}
+
+	b8 VulkanRenderPassCache::Create(RHI::RHIContext* pContext)
+	{
+		m_pContext = pContext;
+		return true;
+	}
+
+	b8 VulkanRenderPassCache::Destroy()
+	{
+		DestroyObjects();
+		return true;
+	}
+
+	RHI::RenderPass* VulkanRenderPassCache::CreateRenderPassObject(const std::vector<RHI::RenderPassAttachment>& attachments, const std::vector<RHI::SubRenderPass>& subpasses)
+	{
+		VulkanRenderPass* pRenderPass = new VulkanRenderPass();
+		b8 res = pRenderPass->Create(m_pContext, attachments, subpasses);
+		if (!res)
+		{
+			pRenderPass->Destroy();
+			delete pRenderPass;
+			return nullptr;
+		}
+		return pRenderPass;
+	}
+
+	RHI::Framebuffer* VulkanRenderPassCache::CreateFramebufferObject(const std::vector<RHI::RenderTarget*>& renderTargets, RHI::RenderPass* pRenderPass)
+	{
+		VulkanFramebuffer* pFramebuffer = new VulkanFramebuffer();
+		b8 res = pFramebuffer->Create(m_pContext, renderTargets, pRenderPass);
+		if (!res)
+		{
+			pFramebuffer->Destroy();
+			delete pFramebuffer;
+			return nullptr;
+		}
+		return pFramebuffer;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "../RHI/RenderPassCache.h"
+
+namespace Vulkan {
+	
+	class VulkanRenderPassCache final : public RHI::RenderPassCache
+	{
+	public:
+		VulkanRenderPassCache();
+		~VulkanRenderPassCache();
+
+		/**
+		 * Create the render pass cache
+		 * @param[in] pContext	RHI context
+		 * @return				True if the render pass cache was created successfully, false otherwise
+		 */
+		b8 Create(RHI::RHIContext* pContext) override final;
+		/**
+		 * Destroy the render pass cache and all render passes and framebuffers in it
+		 * @return	True if the render pass cache was destroyed successfully, false otherwise
+		 */
+		b8 Destroy() override final;
+
+	protected:
+		/**
+		 * Create a new vulkan render pass
+		 * @param[in] attachments	Attachments
+		 * @param[in] subpasses		Sub passes
+		 * @return					Pointer to a render pass, nullptr if the creation failed
+		 */
+		RHI::RenderPass* CreateRenderPassObject(const std::vector<RHI::RenderPassAttachment>& attachments, const std::vector<RHI::SubRenderPass>& subpasses) override final;
+		/**
+		 * Create a new vulkan framebuffer
+		 * @param[in] renderTargets	Render targets
+		 * @param[in] pRenderPass	Associated render pass
+		 * @return					Pointer to a framebuffer, nullptr if the creation failed
+		 */
+		RHI::Framebuffer* CreateFramebufferObject(const std::vector<RHI::RenderTarget*>& renderTargets, RHI::RenderPass* pRenderPass) override final;
+	};
+
+}
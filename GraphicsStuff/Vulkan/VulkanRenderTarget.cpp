@@ -24,17 +24,38 @@ namespace Vulkan {
 		m_Type = desc.type;
 
 		m_pTexture = new VulkanTexture();
+		RHI::TextureDesc texDesc = GetTextureDesc((VulkanContext*)m_pContext, desc);
 
+		RHI::Queue* pQueue = m_pContext->GetQueue(RHI::QueueType::Graphics);
+		RHI::CommandListManager* pCommandListManager = m_pContext->GetCommandListManager();
+		RHI::CommandList* pCommandList = pCommandListManager->CreateSingleTimeCommandList(pQueue);
+
+		b8 res = m_pTexture->Create(m_pContext, texDesc, pCommandList);
+		if (!res)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "Failed to create underlying texture for render target!");
+			return false;
+		}
+
+		pCommandListManager->EndSingleTimeCommandList(pCommandList);
+
+		return true;
+	}
+
+	RHI::TextureDesc VulkanRenderTarget::GetTextureDesc(VulkanContext* pContext, const RHI::RenderTargetDesc& desc)
+	{
 		RHI::TextureFlags textureFlags = RHI::TextureFlags::RenderTargetable;
 		if (desc.type == RHI::RenderTargetType::Color || desc.type == RHI::RenderTargetType::Presentable)
 			textureFlags |= RHI::TextureFlags::Color;
 		if (desc.type == RHI::RenderTargetType::DepthStencil)
 			textureFlags |= RHI::TextureFlags::DepthStencil;
+		if (desc.transient)
+			textureFlags |= RHI::TextureFlags::Transient;
 
 		u32 width = desc.width;
 		u32 height = desc.height;
 
-		VulkanPhysicalDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice()->GetPhysicalDevice();
+		VulkanPhysicalDevice* pDevice = pContext->GetDevice()->GetPhysicalDevice();
 		if (width > pDevice->GetLimits().maxFramebufferWidth)
 		{
 			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Warning, "Width to large (currenty: %u, max: %u). Width will be resized!", width, pDevice->GetLimits().maxFramebufferWidth);
@@ -54,21 +75,9 @@ namespace Vulkan {
 		texDesc.samples = desc.samples;
 		texDesc.flags = textureFlags;
 		texDesc.layout = RHI::Helpers::GetTextureLayoutFromRTType(desc.type);
-
-		RHI::Queue* pQueue = m_pContext->GetQueue(RHI::QueueType::Graphics);
-		RHI::CommandListManager* pCommandListManager = m_pContext->GetCommandListManager();
-		RHI::CommandList* pCommandList = pCommandListManager->CreateSingleTimeCommandList(pQueue);
-
-		b8 res = m_pTexture->Create(m_pContext, texDesc, pCommandList);
-		if (!res)
-		{
-			//g_Logger.LogError(LogVulkanRHI(), "Failed to create underlying texture for render target!");
-			return false;
-		}
-
-		pCommandListManager->EndSingleTimeCommandList(pCommandList);
-
-		return true;
+		texDesc.pHeap = desc.pHeap;
+		texDesc.heapOffset = desc.heapOffset;
+		return texDesc;
 	}
 
 	b8 VulkanRenderTarget::Create(RHI::RHIContext* pContext, VkImage image, VkImageLayout layout, u32 width, u32 height, PixelFormat format, RHI::SampleCount samples,
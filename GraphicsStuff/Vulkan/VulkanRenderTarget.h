@@ -8,6 +8,7 @@ namespace RHI {
 }
 
 namespace Vulkan {
+	class VulkanContext;
 
 	// TODO: complete class
 	class VulkanRenderTarget final : public RHI::RenderTarget
@@ -37,6 +38,13 @@ namespace Vulkan {
 		 * @return				True if the texture was created successfully, false otherwise
 		 */
 		b8 Create(RHI::RHIContext* pContext, VkImage image, VkImageLayout layout, u32 width, u32 height, PixelFormat format, RHI::SampleCount samples, RHI::RenderTargetType type);
+		/**
+		 * Get the description of the texture underlying a render target
+		 * @param[in] pContext	Vulkan context
+		 * @param[in] desc		Render target description
+		 * @return				Texture description
+		 */
+		static RHI::TextureDesc GetTextureDesc(VulkanContext* pContext, const RHI::RenderTargetDesc& desc);
 
 		/**
 		 * Destroy the texture
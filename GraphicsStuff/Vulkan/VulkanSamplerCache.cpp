@@ -0,0 +1,39 @@
+#include "VulkanSamplerCache.h"
+#include "VulkanSampler.h"
+
+namespace Vulkan {
+
+	VulkanSamplerCache::VulkanSamplerCache()
+		: SamplerCache()
+	{
+	}
+
+	VulkanSamplerCache::~VulkanSamplerCache()
+	{
+	}
+
+	b8 VulkanSamplerCache::Create(RHI::RHIContext* pContext)
+	{
+		m_pContext = pContext;
+		return true;
+	}
+
+	b8 VulkanSamplerCache::Destroy()
+	{
+		DestroySamplers();
+		return true;
+	}
+
+	RHI::Sampler* VulkanSamplerCache::CreateSamplerObject(const RHI::SamplerDesc& desc)
+	{
+		VulkanSampler* pSampler = new VulkanSampler();
+		b8 res = pSampler->Create(m_pContext, desc);
+		if (!res)
+		{
+			pSampler->Destroy();
+			delete pSampler;
+			return nullptr;
+		}
+		return pSampler;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "../RHI/SamplerCache.h"
+
+namespace Vulkan {
+	
+	class VulkanSamplerCache final : public RHI::SamplerCache
+	{
+	public:
+		VulkanSamplerCache();
+		~VulkanSamplerCache();
+
+		/**
+		 * Create the sampler cache
+		 * @param[in] pContext	RHI context
+		 * @return				True if the sampler cache was created successfully, false otherwise
+		 */
+		b8 Create(RHI::RHIContext* pContext) override final;
+		/**
+		 * Destroy the sampler cache and all samplers in it
+		 * @return	True if the sampler cache was destroyed successfully, false otherwise
+		 */
+		b8 Destroy() override final;
+
+	protected:
+		/**
+		 * Create a new vulkan sampler
+		 * @param[in] desc	Sampler description
+		 * @return			Pointer to a sampler, nullptr if the creation failed
+		 */
+		RHI::Sampler* CreateSamplerObject(const RHI::SamplerDesc& desc) override final;
+	};
+
+}
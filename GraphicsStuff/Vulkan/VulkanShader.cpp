@@ -3,6 +3,7 @@
 #include "VulkanDevice.h"
 #include "VulkanContext.h"
 #include "VulkanHelpers.h"
+#include "VulkanPipelineLibraryCache.h"
 
 namespace Vulkan {
 
@@ -59,6 +60,10 @@ namespace Vulkan {
 	{
 		if (m_ShaderModule)
 		{
+			VulkanPipelineLibraryCache* pLibraryCache = ((VulkanContext*)m_pContext)->GetPipelineLibraryCache();
+			if (pLibraryCache)
+				pLibraryCache->InvalidateLibraries(u64(m_ShaderModule));
+
 			VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
 			pDevice->vkDestroyShaderModule(m_ShaderModule);
 			m_ShaderModule = VK_NULL_HANDLE;
@@ -0,0 +1,299 @@
+
+#include "VulkanSparseTextureResidency.h"
+#include <algorithm>
+#include "VulkanBuffer.h"
+#include "VulkanContext.h"
+#include "VulkanDevice.h"
+#include "VulkanMemory.h"
+#include "VulkanPhysicalDevice.h"
+#include "VulkanQueue.h"
+#include "VulkanTexture.h"
+
+namespace Vulkan {
+
+
+	VulkanSparseTextureResidency::VulkanSparseTextureResidency()
+		: SparseTextureResidency()
+		, m_pQueue(nullptr)
+		, m_SparseRequirements()
+		, m_pTileAllocation(nullptr)
+		, m_pMipTailAllocation(nullptr)
+		, m_MipTailBound(false)
+	{
+	}
+
+	VulkanSparseTextureResidency::~VulkanSparseTextureResidency()
+	{
+	}
+
+	b8 VulkanSparseTextureResidency::Create(RHI::RHIContext* pContext, RHI::Texture* pTexture, u64 memoryBudget)
+	{
+		m_pContext = pContext;
+		m_pTexture = pTexture;
+		m_MemoryBudget = memoryBudget;
+
+		if ((m_pTexture->GetFlags() & RHI::TextureFlags::Sparse) == RHI::TextureFlags::None)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "A sparse texture residency needs a texture created with the sparse flag!");
+			return false;
+		}
+
+		VulkanContext* pVulkanContext = (VulkanContext*)m_pContext;
+		VulkanDevice* pDevice = pVulkanContext->GetDevice();
+		m_pQueue = (VulkanQueue*)m_pContext->GetQueue(RHI::QueueType::Graphics);
+		const std::vector<VkQueueFamilyProperties>& queueFamilies = pVulkanContext->GetSelectedPhysicalDevice()->GetQueueFamilyProperties();
+		if ((queueFamilies[m_pQueue->GetQueueFamily()].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) == 0)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "The graphics queue doesn't support sparse binding!");
+			m_pQueue = nullptr;
+			return false;
+		}
+
+		// Sparse textures are color textures, so only the color aspect has tiles
+		VkImage image = ((VulkanTexture*)m_pTexture)->GetImage();
+		std::vector<VkSparseImageMemoryRequirements> sparseRequirements;
+		pDevice->vkGetImageSparseMemoryRequirements(image, sparseRequirements);
+		std::vector<VkSparseImageMemoryRequirements>::iterator it = std::find_if(sparseRequirements.begin(), sparseRequirements.end(), [](const VkSparseImageMemoryRequirements& requirements)
+		{
+			return (requirements.formatProperties.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) != 0;
+		});
+		if (it == sparseRequirements.end())
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "The sparse texture has no color aspect!");
+			return false;
+		}
+		m_SparseRequirements = *it;
+
+		// The alignment of a sparse image is the size of its sparse blocks, each tile is a single block
+		VkMemoryRequirements requirements = {};
+		pDevice->vkGetImageMemoryRequirements(image, requirements);
+		VulkanAllocator* pAllocator = pVulkanContext->GetAllocator();
+
+		u32 mipTailStart = std::min(m_SparseRequirements.imageMipTailFirstLod, m_pTexture->GetMipLevels());
+		u64 mipTailSize = 0;
+		if (mipTailStart < m_pTexture->GetMipLevels())
+		{
+			b8 singleMipTail = (m_SparseRequirements.formatProperties.flags & VK_SPARSE_IMAGE_FORMAT_SINGLE_MIPTAIL_BIT) != 0;
+			VkMemoryRequirements mipTailRequirements = requirements;
+			mipTailRequirements.size = m_SparseRequirements.imageMipTailSize * (singleMipTail ? 1 : m_pTexture->GetLayerCount());
+			mipTailSize = mipTailRequirements.size;
+			if (mipTailSize > m_MemoryBudget)
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "The memory budget of a sparse texture doesn't fit its mip tail!");
+				Destroy();
+				return false;
+			}
+			m_pMipTailAllocation = pAllocator->Allocate(mipTailRequirements, VulkanMemoryUsage::GpuOnly);
+			if (!m_pMipTailAllocation)
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "Failed to allocate the mip tail of a sparse texture!");
+				Destroy();
+				return false;
+			}
+		}
+
+		// The rest of the budget is allocated at once, so the tiles never go over it
+		u32 slotCount = u32((m_MemoryBudget - mipTailSize) / requirements.alignment);
+		if (slotCount == 0 && mipTailStart > 0)
+		{
+			//g_Logger.LogError(LogVulkanRHI(), "The memory budget of a sparse texture doesn't fit a single tile!");
+			Destroy();
+			return false;
+		}
+		if (slotCount > 0)
+		{
+			VkMemoryRequirements tileRequirements = requirements;
+			tileRequirements.size = u64(slotCount) * requirements.alignment;
+			m_pTileAllocation = pAllocator->Allocate(tileRequirements, VulkanMemoryUsage::GpuOnly);
+			if (!m_pTileAllocation)
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "Failed to allocate the tile memory of a sparse texture!");
+				Destroy();
+				return false;
+			}
+		}
+
+		const VkExtent3D& granularity = m_SparseRequirements.formatProperties.imageGranularity;
+		InitTiles(granularity.width, granularity.height, mipTailStart, slotCount, requirements.alignment);
+
+		// Feedback is written by the gpu and read by the cpu every frame, the page table the other way around, so each frame in flight has its own copies
+		u64 bufferSize = std::max(u64(GetTileCountX()) * GetTileCountY() * m_pTexture->GetLayerCount(), u64(1)) * sizeof(u32);
+		for (u32 i = 0; i < RHI::MaxFramesInFlight; ++i)
+		{
+			VulkanBuffer* pFeedbackBuffer = new VulkanBuffer();
+			if (!pFeedbackBuffer->Create(m_pContext, RHI::BufferType::Storage, bufferSize, RHI::BufferFlags::Dynamic | RHI::BufferFlags::Readback))
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "Failed to create the feedback buffer of a sparse texture!");
+				delete pFeedbackBuffer;
+				Destroy();
+				return false;
+			}
+			pFeedbackBuffer->SetDebugName("Sparse texture feedback");
+			m_pFeedbackBuffers[i] = pFeedbackBuffer;
+			VulkanBuffer* pPageTableBuffer = new VulkanBuffer();
+			if (!pPageTableBuffer->Create(m_pContext, RHI::BufferType::Storage, bufferSize, RHI::BufferFlags::Dynamic))
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "Failed to create the page table buffer of a sparse texture!");
+				delete pPageTableBuffer;
+				Destroy();
+				return false;
+			}
+			pPageTableBuffer->SetDebugName("Sparse texture page table");
+			m_pPageTableBuffers[i] = pPageTableBuffer;
+		}
+
+		if (!BindMipTail(true) || !ResetBuffers())
+		{
+			Destroy();
+			return false;
+		}
+		return true;
+	}
+
+	b8 VulkanSparseTextureResidency::Destroy()
+	{
+		b8 res = true;
+
+		// Unbind all memory, so it can be freed while the texture still exists, evicted tiles still have their memory bound
+		if (m_pQueue)
+		{
+			std::vector<TileBinding> bindings;
+			for (u32 i = 0; i < u32(m_Tiles.size()); ++i)
+			{
+				if (m_Tiles[i].slot != InvalidSlot)
+					bindings.push_back({ i, InvalidSlot });
+			}
+			if (!bindings.empty())
+				res &= BindTiles(bindings);
+			if (m_MipTailBound)
+				res &= BindMipTail(false);
+		}
+
+		VulkanAllocator* pAllocator = ((VulkanContext*)m_pContext)->GetAllocator();
+		if (m_pTileAllocation)
+		{
+			pAllocator->Free(m_pTileAllocation);
+			m_pTileAllocation = nullptr;
+		}
+		if (m_pMipTailAllocation)
+		{
+			pAllocator->Free(m_pMipTailAllocation);
+			m_pMipTailAllocation = nullptr;
+		}
+
+		for (u32 i = 0; i < RHI::MaxFramesInFlight; ++i)
+		{
+			if (m_pFeedbackBuffers[i])
+			{
+				m_pFeedbackBuffers[i]->Destroy();
+				delete m_pFeedbackBuffers[i];
+				m_pFeedbackBuffers[i] = nullptr;
+			}
+			if (m_pPageTableBuffers[i])
+			{
+				m_pPageTableBuffers[i]->Destroy();
+				delete m_pPageTableBuffers[i];
+				m_pPageTableBuffers[i] = nullptr;
+			}
+		}
+
+		ReleaseTiles();
+		m_pQueue = nullptr;
+		return res;
+	}
+
+	b8 VulkanSparseTextureResidency::BindTiles(const std::vector<TileBinding>& bindings)
+	{
+		std::vector<VkSparseImageMemoryBind> binds(bindings.size());
+		for (sizeT i = 0; i < bindings.size(); ++i)
+		{
+			RHI::TextureRegion region = GetTileRegion(bindings[i].tile);
+			VkSparseImageMemoryBind& bind = binds[i];
+			bind.subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			bind.subresource.mipLevel = region.mipLevel;
+			bind.subresource.arrayLayer = region.baseArrayLayer;
+			bind.offset = { i32(region.offset.x), i32(region.offset.y), 0 };
+			bind.extent = { region.extent.x, region.extent.y, 1 };
+			// Binding VK_NULL_HANDLE makes the tile non-resident
+			if (bindings[i].slot != InvalidSlot)
+			{
+				bind.memory = m_pTileAllocation->GetMemory();
+				bind.memoryOffset = m_pTileAllocation->GetOffset() + u64(bindings[i].slot) * m_TileMemorySize;
+			}
+		}
+
+		VkSparseImageMemoryBindInfo imageBindInfo = {};
+		imageBindInfo.image = ((VulkanTexture*)m_pTexture)->GetImage();
+		imageBindInfo.bindCount = u32(binds.size());
+		imageBindInfo.pBinds = binds.data();
+
+		VkBindSparseInfo bindInfo = {};
+		bindInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+		bindInfo.imageBindCount = 1;
+		bindInfo.pImageBinds = &imageBindInfo;
+		return SubmitBindings(bindInfo);
+	}
+
+	b8 VulkanSparseTextureResidency::BindMipTail(b8 bind)
+	{
+		if (!m_pMipTailAllocation)
+			return true;
+
+		// Without a single mip tail, every layer has a mip tail of its own, spaced by the mip tail stride
+		b8 singleMipTail = (m_SparseRequirements.formatProperties.flags & VK_SPARSE_IMAGE_FORMAT_SINGLE_MIPTAIL_BIT) != 0;
+		u32 mipTailCount = singleMipTail ? 1 : m_pTexture->GetLayerCount();
+		std::vector<VkSparseMemoryBind> binds(mipTailCount);
+		for (u32 i = 0; i < mipTailCount; ++i)
+		{
+			VkSparseMemoryBind& memoryBind = binds[i];
+			memoryBind.resourceOffset = m_SparseRequirements.imageMipTailOffset + i * m_SparseRequirements.imageMipTailStride;
+			memoryBind.size = m_SparseRequirements.imageMipTailSize;
+			if (bind)
+			{
+				memoryBind.memory = m_pMipTailAllocation->GetMemory();
+				memoryBind.memoryOffset = m_pMipTailAllocation->GetOffset() + i * m_SparseRequirements.imageMipTailSize;
+			}
+		}
+
+		VkSparseImageOpaqueMemoryBindInfo opaqueBindInfo = {};
+		opaqueBindInfo.image = ((VulkanTexture*)m_pTexture)->GetImage();
+		opaqueBindInfo.bindCount = u32(binds.size());
+		opaqueBindInfo.pBinds = binds.data();
+
+		VkBindSparseInfo bindInfo = {};
+		bindInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+		bindInfo.imageOpaqueBindCount = 1;
+		bindInfo.pImageOpaqueBinds = &opaqueBindInfo;
+		b8 res = SubmitBindings(bindInfo);
+		if (res)
+			m_MipTailBound = bind;
+		return res;
+	}
+
+	b8 VulkanSparseTextureResidency::SubmitBindings(const VkBindSparseInfo& bindInfo)
+	{
+		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkFence fence;
+		VkResult vkres = pDevice->vkCreateFence(fenceInfo, fence);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to create the vulkan fence of a sparse binding (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return false;
+		}
+
+		// Tiles are written right after they are bound, so the binding is waited on, like single time command lists
+		vkres = m_pQueue->vkBindSparse(bindInfo, fence);
+		if (vkres == VK_SUCCESS)
+			vkres = pDevice->vkWaitForFence(fence);
+		pDevice->vkDestroyFence(fence);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to bind sparse vulkan memory (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return false;
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "../RHI/SparseTextureResidency.h"
+
+namespace Vulkan {
+	class VulkanAllocation;
+	class VulkanQueue;
+
+	class VulkanSparseTextureResidency final : public RHI::SparseTextureResidency
+	{
+	public:
+		VulkanSparseTextureResidency();
+		~VulkanSparseTextureResidency();
+
+		/**
+		 * Create the residency of a sparse texture, the tiles are bound on the graphics queue
+		 * @param[in] pContext		RHI context
+		 * @param[in] pTexture		Texture, created with TextureFlags::Sparse
+		 * @param[in] memoryBudget	Amount of memory the tiles and mip tail can use, the tile memory is allocated up front
+		 * @return					True if the residency was created successfully, false otherwise
+		 */
+		b8 Create(RHI::RHIContext* pContext, RHI::Texture* pTexture, u64 memoryBudget) override final;
+		/**
+		 * Destroy the residency, all memory is unbound from the texture
+		 * @return	True if the residency was destroyed successfully, false otherwise
+		 */
+		b8 Destroy() override final;
+
+	protected:
+		/**
+		 * Bind and unbind tiles, waits until the bindings are finished
+		 * @param[in] bindings	Tile bindings
+		 * @return				True if the tiles were bound successfully, false otherwise
+		 */
+		b8 BindTiles(const std::vector<TileBinding>& bindings) override final;
+
+	private:
+		/**
+		 * Bind or unbind the mip tail
+		 * @param[in] bind	True to bind the mip tail, false to unbind it
+		 * @return			True if the mip tail was bound successfully, false otherwise
+		 */
+		b8 BindMipTail(b8 bind);
+		/**
+		 * Submit sparse bindings to the queue and wait for them to finish
+		 * @param[in] bindInfo	Vk bind sparse info
+		 * @return				True if the bindings finished successfully, false otherwise
+		 */
+		b8 SubmitBindings(const VkBindSparseInfo& bindInfo);
+
+		VulkanQueue* m_pQueue;									/**< Queue the tiles are bound on */
+		VkSparseImageMemoryRequirements m_SparseRequirements;	/**< Sparse memory requirements of the color aspect */
+		VulkanAllocation* m_pTileAllocation;					/**< Memory of the resident tiles */
+		VulkanAllocation* m_pMipTailAllocation;					/**< Memory of the mip tail, nullptr if there is no mip tail */
+		b8 m_MipTailBound;										/**< If the mip tail is bound */
+	};
+
+}
@@ -3,6 +3,11 @@
 #include "VulkanDevice.h"
 #include "VulkanHelpers.h"
 #include "VulkanContext.h"
+#include "VulkanMemoryHeap.h"
+#include "VulkanDefragmenter.h"
+#include "VulkanPhysicalDevice.h"
+#include "../RHI/RenderPassCache.h"
+#include "../General/Hash.h"
 
 namespace Vulkan {
 
@@ -41,6 +46,24 @@ namespace Vulkan {
 			}
 		}
 
+		if ((m_Desc.flags & RHI::TextureFlags::Sparse) != RHI::TextureFlags::None)
+		{
+			// Tiles are bound by a sparse texture residency, so the texture can't have any other kind of memory
+			if ((m_Desc.flags & (RHI::TextureFlags::Dynamic | RHI::TextureFlags::RenderTargetable | RHI::TextureFlags::Transient)) != RHI::TextureFlags::None || m_Desc.pHeap)
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "Sparse textures can't be dynamic, render targets or placed in a memory heap!");
+				return false;
+			}
+			const VkPhysicalDeviceFeatures& features = ((VulkanContext*)m_pContext)->GetSelectedPhysicalDevice()->GetFeatures();
+			if (!features.sparseBinding || !features.sparseResidencyImage2D || (m_Desc.type != RHI::TextureType::Tex2D && m_Desc.type != RHI::TextureType::Tex2DArray) || m_Desc.samples != RHI::SampleCount::Sample1)
+			{
+				//g_Logger.LogError(LogVulkanRHI(), "Sparse textures are only supported for single sampled 2D textures and 2D texture arrays, when the device supports sparse residency!");
+				return false;
+			}
+			// Tiles are written when they become resident, through temporary staging buffers
+			m_Desc.flags |= RHI::TextureFlags::Static;
+		}
+
 		return CreateInternal(pCommandList);
 	}
 
@@ -65,6 +88,9 @@ namespace Vulkan {
 		VulkanDevice* pDevice = ((VulkanContext*)m_pContext)->GetDevice();
 		if (m_View)
 		{
+			// Cached framebuffers can't outlive the view
+			if (m_pContext->GetRenderPassCache())
+				m_pContext->GetRenderPassCache()->InvalidateFramebuffers(this);
 			pDevice->vkDestroyImageView(m_View);
 		}
 
@@ -75,6 +101,14 @@ namespace Vulkan {
 			m_pStagingBuffer = nullptr;
 		}
 
+		// A pending defragmentation copy still reads the image, the defragmenter releases it once the copy is done
+		VulkanDefragmenter* pDefragmenter = ((VulkanContext*)m_pContext)->GetDefragmenter();
+		if (m_OwnsImage && m_Image && pDefragmenter && pDefragmenter->CancelMoves(this))
+		{
+			m_pAllocation = nullptr;
+			m_Image = VK_NULL_HANDLE;
+		}
+
 		if (m_OwnsImage && m_Image)
 		{
 			if (m_pAllocation)
@@ -344,41 +378,8 @@ namespace Vulkan {
 		if (m_OwnsImage)
 		{
 			VkImageCreateInfo imageInfo = {};
-			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-			imageInfo.extent.width = m_Desc.width;
-			imageInfo.extent.height = m_Desc.height;
-			imageInfo.extent.depth = m_Desc.depth;
-			imageInfo.arrayLayers = m_Desc.layerCount;
-			imageInfo.mipLevels = m_Desc.mipLevels;
-			imageInfo.imageType = Helpers::GetImageType(m_Desc.type);
-			imageInfo.format = Helpers::GetFormat(m_Desc.format);
-			imageInfo.tiling = ((m_Desc.flags & RHI::TextureFlags::Dynamic) != RHI::TextureFlags::None) ? VK_IMAGE_TILING_LINEAR : VK_IMAGE_TILING_OPTIMAL;
-			imageInfo.samples = Helpers::GetSampleCount(m_Desc.samples);
-			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-			// usage
-			imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-			if ((m_Desc.flags & RHI::TextureFlags::NoSampling) == RHI::TextureFlags::None)
-				imageInfo.usage |=  VK_IMAGE_USAGE_SAMPLED_BIT;
-			if ((m_Desc.flags & RHI::TextureFlags::Storage) != RHI::TextureFlags::None)
-				imageInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
-			if ((m_Desc.flags & RHI::TextureFlags::InputAttachment) != RHI::TextureFlags::None)
-				imageInfo.usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
-
-			if ((m_Desc.flags & RHI::TextureFlags::Color) != RHI::TextureFlags::None)
-				imageInfo.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-			if ((m_Desc.flags & RHI::TextureFlags::DepthStencil) != RHI::TextureFlags::None)
-				imageInfo.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-
-			// flags
-			// Always mutable?
-			imageInfo.flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
-			if (m_Desc.type == RHI::TextureType::Cubemap || m_Desc.type == RHI::TextureType::CubemapArray)
-				imageInfo.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
-			if (m_Desc.type == RHI::TextureType::Tex2DArray)
-				imageInfo.flags |= VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT;
-			// TODO: other flags
+			GetCreateInfo(imageInfo);
+			b8 transient = (m_Desc.flags & RHI::TextureFlags::Transient) != RHI::TextureFlags::None;
 
 			vkres = pDevice->vkCreateImage(imageInfo, m_Image);
 			if (vkres != VK_SUCCESS)
@@ -387,34 +388,73 @@ namespace Vulkan {
 				return false;
 			}
 
-			VkMemoryRequirements memReqs;
-			pDevice->vkGetImageMemoryRequirements(m_Image, memReqs);
-			m_MemorySize = memReqs.size;
-
-			VulkanAllocator* pAllocator = ((VulkanContext*)m_pContext)->GetAllocator();
-			VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-			if ((m_Desc.flags & RHI::TextureFlags::Dynamic) != RHI::TextureFlags::None)
-				memProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+			if ((m_Desc.flags & RHI::TextureFlags::Sparse) != RHI::TextureFlags::None)
+			{
+				// Sparse textures start without any memory, tiles are bound later
+				m_pAllocation = nullptr;
+				m_MemorySize = 0;
+			}
+			else if (m_Desc.pHeap)
+			{
+				// Heaps are gpu only memory, which can't be mapped
+				if ((m_Desc.flags & RHI::TextureFlags::Dynamic) != RHI::TextureFlags::None)
+				{
+					//g_Logger.LogError(LogVulkanRHI(), "Dynamic textures can't be placed in a memory heap!");
+					Destroy();
+					return false;
+				}
 
-			m_pAllocation = pAllocator->Allocate(memReqs, memProps);
-			if (!m_pAllocation)
+				VkMemoryRequirements requirements = {};
+				pDevice->vkGetImageMemoryRequirements(m_Image, requirements);
+				m_pAllocation = ((VulkanMemoryHeap*)m_Desc.pHeap)->AllocatePlaced(m_Desc.heapOffset, requirements);
+			}
+			else
 			{
-				//g_Logger.LogError(LogVulkanRHI(), "Failed to allocate a vulkan allocation!");
-				Destroy();
-				return false;
+				VulkanAllocator* pAllocator = ((VulkanContext*)m_pContext)->GetAllocator();
+				VulkanMemoryUsage memUsage = VulkanMemoryUsage::GpuOnly;
+				if ((m_Desc.flags & RHI::TextureFlags::Dynamic) != RHI::TextureFlags::None)
+					memUsage = VulkanMemoryUsage::DynamicGpuRead;
+				else if (transient)
+					memUsage = VulkanMemoryUsage::Transient;
+
+				// Transient images with the same description can share memory
+				u64 aliasKey = 0;
+				if (transient)
+				{
+					aliasKey = Hash::Fnv1a(&imageInfo.extent, sizeof(VkExtent3D));
+					aliasKey = Hash::Combine(aliasKey, imageInfo.imageType);
+					aliasKey = Hash::Combine(aliasKey, imageInfo.format);
+					aliasKey = Hash::Combine(aliasKey, imageInfo.samples);
+					aliasKey = Hash::Combine(aliasKey, imageInfo.usage);
+					aliasKey = Hash::Combine(aliasKey, imageInfo.flags);
+					aliasKey = Hash::Combine(aliasKey, imageInfo.mipLevels);
+					aliasKey = Hash::Combine(aliasKey, imageInfo.arrayLayers);
+				}
+				m_pAllocation = pAllocator->AllocateForImage(m_Image, memUsage, aliasKey);
 			}
+			if (m_pAllocation)
+			{
+				m_MemorySize = m_pAllocation->GetSize();
+				m_pAllocation->SetOwner(this);
 
-			vkres = pDevice->vkBindImageMemory(m_Image, m_pAllocation->GetMemory(), m_pAllocation->GetOffset());
-			if (vkres != VK_SUCCESS)
+				vkres = pDevice->vkBindImageMemory(m_Image, m_pAllocation->GetMemory(), m_pAllocation->GetOffset());
+				if (vkres != VK_SUCCESS)
+				{
+					//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to bind vulkan image memory (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+					return false;
+				}
+			}
+			else if ((m_Desc.flags & RHI::TextureFlags::Sparse) == RHI::TextureFlags::None)
 			{
-				//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to bind vulkan image memory (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+				//g_Logger.LogError(LogVulkanRHI(), "Failed to allocate a vulkan allocation!");
+				Destroy();
 				return false;
 			}
 
-			if ((m_Desc.flags & RHI::TextureFlags::Static) == RHI::TextureFlags::None && (m_Desc.flags & RHI::TextureFlags::Dynamic) == RHI::TextureFlags::None && (m_Desc.flags & RHI::TextureFlags::RenderTargetable) == RHI::TextureFlags::None)
+			if ((m_Desc.flags & (RHI::TextureFlags::Static | RHI::TextureFlags::Dynamic | RHI::TextureFlags::RenderTargetable | RHI::TextureFlags::Sparse)) == RHI::TextureFlags::None)
 			{
 				m_pStagingBuffer = new VulkanBuffer();
-				b8 res = m_pStagingBuffer->Create(m_pContext, RHI::BufferType::Staging, memReqs.size, RHI::BufferFlags::None);
+				b8 res = m_pStagingBuffer->Create(m_pContext, RHI::BufferType::Staging, m_MemorySize, RHI::BufferFlags::None);
 			}
 
 			// Transition layout
@@ -446,9 +486,119 @@ namespace Vulkan {
 		}
 
 		// Create image view
+		vkres = CreateView(m_Image, m_View);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to create vulkan image view (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return false;
+		}
+
+		return true;
+	}
+
+	void VulkanTexture::MarkWritten()
+	{
+		if (m_pAllocation)
+			m_pAllocation->MarkWritten();
+	}
+
+	VkResult VulkanTexture::CreateMoveTarget(VkImage& image)
+	{
+		VkImageCreateInfo imageInfo = {};
+		GetCreateInfo(imageInfo);
+		return ((VulkanContext*)m_pContext)->GetDevice()->vkCreateImage(imageInfo, image);
+	}
+
+	b8 VulkanTexture::Move(VkImage image, VulkanAllocation* pAllocation, VkImage& oldImage, VkImageView& oldView,
+		VulkanAllocation*& pOldAllocation)
+	{
+		VkImageView view;
+		VkResult vkres = CreateView(image, view);
+		if (vkres != VK_SUCCESS)
+		{
+			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to create the vulkan image view of a moved texture (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
+			return false;
+		}
+
+		oldImage = m_Image;
+		oldView = m_View;
+		pOldAllocation = m_pAllocation;
+
+		m_Image = image;
+		m_View = view;
+		m_pAllocation = pAllocation;
+		m_pAllocation->SetOwner(this);
+		pOldAllocation->SetOwner((VulkanTexture*)nullptr);
+		return true;
+	}
+
+	b8 VulkanTexture::GetMemoryRequirements(VulkanContext* pContext, const RHI::TextureDesc& desc, VkMemoryRequirements& requirements)
+	{
+		// Create an unbound image with the same create info as the texture would use
+		VulkanTexture texture;
+		texture.m_pContext = pContext;
+		texture.m_Desc = desc;
+		VkImage image;
+		if (texture.CreateMoveTarget(image) != VK_SUCCESS)
+			return false;
+
+		VulkanDevice* pDevice = pContext->GetDevice();
+		pDevice->vkGetImageMemoryRequirements(image, requirements);
+		pDevice->vkDestroyImage(image);
+		return true;
+	}
+
+	void VulkanTexture::GetCreateInfo(VkImageCreateInfo& imageInfo)
+	{
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.extent.width = m_Desc.width;
+		imageInfo.extent.height = m_Desc.height;
+		imageInfo.extent.depth = m_Desc.depth;
+		imageInfo.arrayLayers = m_Desc.layerCount;
+		imageInfo.mipLevels = m_Desc.mipLevels;
+		imageInfo.imageType = Helpers::GetImageType(m_Desc.type);
+		imageInfo.format = Helpers::GetFormat(m_Desc.format);
+		imageInfo.tiling = ((m_Desc.flags & RHI::TextureFlags::Dynamic) != RHI::TextureFlags::None) ? VK_IMAGE_TILING_LINEAR : VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.samples = Helpers::GetSampleCount(m_Desc.samples);
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		// usage
+		// Transient attachments can only be used as attachments
+		b8 transient = (m_Desc.flags & RHI::TextureFlags::Transient) != RHI::TextureFlags::None;
+		if (transient)
+			imageInfo.usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		else
+			imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		if ((m_Desc.flags & RHI::TextureFlags::NoSampling) == RHI::TextureFlags::None && !transient)
+			imageInfo.usage |=  VK_IMAGE_USAGE_SAMPLED_BIT;
+		if ((m_Desc.flags & RHI::TextureFlags::Storage) != RHI::TextureFlags::None && !transient)
+			imageInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+		if ((m_Desc.flags & RHI::TextureFlags::InputAttachment) != RHI::TextureFlags::None)
+			imageInfo.usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+		if ((m_Desc.flags & RHI::TextureFlags::Color) != RHI::TextureFlags::None)
+			imageInfo.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		if ((m_Desc.flags & RHI::TextureFlags::DepthStencil) != RHI::TextureFlags::None)
+			imageInfo.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+		// flags
+		// Always mutable?
+		imageInfo.flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
+		if (m_Desc.type == RHI::TextureType::Cubemap || m_Desc.type == RHI::TextureType::CubemapArray)
+			imageInfo.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+		if (m_Desc.type == RHI::TextureType::Tex2DArray)
+			imageInfo.flags |= VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT;
+		if ((m_Desc.flags & RHI::TextureFlags::Sparse) != RHI::TextureFlags::None)
+			imageInfo.flags |= VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+		// TODO: other flags
+	}
+
+	VkResult VulkanTexture::CreateView(VkImage image, VkImageView& view)
+	{
 		VkImageViewCreateInfo viewInfo = {};
 		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		viewInfo.image = m_Image;
+		viewInfo.image = image;
 		viewInfo.format = Helpers::GetFormat(m_Desc.format);
 		viewInfo.viewType = Helpers::GetImageViewType(m_Desc.type);;
 		viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -465,13 +615,6 @@ namespace Vulkan {
 		viewInfo.subresourceRange.baseMipLevel = 0;
 		viewInfo.subresourceRange.levelCount = m_Desc.mipLevels;
 
-		vkres = pDevice->vkCreateImageView(viewInfo, m_View);
-		if (vkres != VK_SUCCESS)
-		{
-			//g_Logger.LogFormat(LogVulkanRHI(), LogLevel::Error, "Failed to create vulkan image view (VkResult: %s)!", Helpers::GetResultstd::string(vkres));
-			return false;
-		}
-
-		return true;
+		return ((VulkanContext*)m_pContext)->GetDevice()->vkCreateImageView(viewInfo, view);
 	}
 }
@@ -5,6 +5,7 @@
 namespace Vulkan {
 	class VulkanBuffer;
 	class VulkanAllocation;
+	class VulkanContext;
 
 	class VulkanTexture final : public RHI::Texture
 	{
@@ -22,6 +23,10 @@ namespace Vulkan {
 		 * @note					A dynamic texture has some restrictions:
 		 *							- Only 1 array layer is supported
 		 *							- Only 1 mip level is supported
+		 *							A sparse texture has some restrictions:
+		 *							- Only 2D textures and 2D texture arrays are supported
+		 *							- Only 1 sample is supported
+		 *							- It is always static, memory is bound per tile by a SparseTextureResidency
 		*/
 		b8 Create(RHI::RHIContext* pContext, const RHI::TextureDesc& desc, RHI::CommandList* pCommandList) override final;
 
@@ -97,8 +102,56 @@ namespace Vulkan {
 		 * @param[in] queueFamily	Vulkan queue family
 		 */
 		void SetOwningQueueFamily(u32 queueFamily) { m_OwningQueueFamily = queueFamily; }
+		/**
+		 * Get the memory allocation
+		 * @return	Memory allocation, nullptr if the image isn't owned by the texture
+		 */
+		VulkanAllocation* GetAllocation() { return m_pAllocation; }
+		/**
+		 * Mark the texture as written by the gpu in the current frame
+		 */
+		void MarkWritten();
+
+		/**
+		 * Create an unbound vulkan image with the same description, to move the texture to other memory
+		 * @param[out] image	Vulkan image
+		 * @return				Vulkan result
+		 */
+		VkResult CreateMoveTarget(VkImage& image);
+		/**
+		 * Switch the texture to a new vulkan image, which already contains a copy of the texture's data in the texture's current layout
+		 * @param[in] image				New vulkan image
+		 * @param[in] pAllocation		Allocation bound to the new vulkan image
+		 * @param[out] oldImage			Previous vulkan image
+		 * @param[out] oldView			Previous vulkan image view
+		 * @param[out] pOldAllocation	Previous allocation
+		 * @return						True if the texture was moved, false otherwise
+		 * @note						The previous handles and allocation can only be released once no command list uses them anymore
+		 */
+		b8 Move(VkImage image, VulkanAllocation* pAllocation, VkImage& oldImage, VkImageView& oldView, VulkanAllocation*& pOldAllocation);
+
+		/**
+		 * Get the memory requirements of a texture, without creating it
+		 * @param[in] pContext		Vulkan context
+		 * @param[in] desc			Texture description
+		 * @param[out] requirements	Memory requirements
+		 * @return					True if the requirements were retrieved, false if the vulkan image can't be created
+		 */
+		static b8 GetMemoryRequirements(VulkanContext* pContext, const RHI::TextureDesc& desc, VkMemoryRequirements& requirements);
 
 	private:
+		/**
+		 * Get the create info of the vulkan image
+		 * @param[out] imageInfo	Image create info
+		 */
+		void GetCreateInfo(VkImageCreateInfo& imageInfo);
+		/**
+		 * Create a view of the whole image
+		 * @param[in] image		Vulkan image
+		 * @param[out] view		Vulkan image view
+		 * @return				Vulkan result
+		 */
+		VkResult CreateView(VkImage image, VkImageView& view);
 
 		/**
 		 * Internal creation function